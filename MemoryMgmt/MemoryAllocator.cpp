@@ -1,5 +1,7 @@
 #include "MemoryAllocator.h"
 
+#include <algorithm>
+
 //#include "MemoryMgmt/VirtualMemoryPool.h"
 #include "VirtualMemoryPool.h"
 
@@ -33,23 +35,37 @@ void MemoryAllocator::Free(void* p_Pointer)
     m_MemoryPool->FreeVirtualMemory(p_Pointer);
 }
 
-bool MemoryAllocator::ConfigureMemory(std::vector<UserMemoryRequirementConfig> p_UserMemoryRequirement)
+bool MemoryAllocator::ConfigureMemory(std::vector<UserMemoryRequirementConfig> p_UserMemoryRequirement, const VMPageConfig& p_PageConfig)
 {
+    std::lock_guard<std::mutex> lock(m_ConfigureMutex);
     if (m_IsMemoryConfigured) return true;
 
     const size_t userMemoryRequirementSize = p_UserMemoryRequirement.size();
     if (userMemoryRequirementSize == 0) return false;
 
-    m_VirtualMemoryTable.resize(userMemoryRequirementSize);
+    // Requirements rounding to the same pool size share a single pool, allocations are routed by size
+    m_VirtualMemoryTable.clear();
     for (size_t i = 0; i < userMemoryRequirementSize; i++)
     {
         size_t poolSize = p_UserMemoryRequirement.at(i).memorySize;
         VM_NEXT_POWER_OF_2(poolSize);
-        m_VirtualMemoryTable[i].poolSize = poolSize;
-        m_VirtualMemoryTable[i].poolCapacity = poolSize * p_UserMemoryRequirement.at(i).memoryInstances;
+        const size_t poolCapacity = poolSize * p_UserMemoryRequirement.at(i).memoryInstances;
+
+        auto pool = std::find_if(m_VirtualMemoryTable.begin(), m_VirtualMemoryTable.end(),
+                                 [poolSize](const VM::VMPoolConfig& p_Pool) { return p_Pool.poolSize == poolSize; });
+        if (pool != m_VirtualMemoryTable.end())
+        {
+            pool->poolCapacity += poolCapacity;
+            continue;
+        }
+
+        VM::VMPoolConfig poolConfig;
+        poolConfig.poolSize = poolSize;
+        poolConfig.poolCapacity = poolCapacity;
+        m_VirtualMemoryTable.push_back(poolConfig);
     }
 
-    m_MemoryPool = std::unique_ptr<VM::VirtualMemoryPool>(new VM::VirtualMemoryPool(m_VirtualMemoryTable));
+    m_MemoryPool = std::unique_ptr<VM::VirtualMemoryPool>(new VM::VirtualMemoryPool(m_VirtualMemoryTable, p_PageConfig));
 
     m_IsMemoryConfigured = true;
 
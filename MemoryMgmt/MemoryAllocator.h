@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -24,10 +25,12 @@ public:
 
     ~MemoryAllocator();
 
+    // Safe to call from several threads once the memory is configured, see VirtualMemoryPool
     void* Allocate(size_t p_Size);
     void Free(void* p_Pointer);
 
-    bool ConfigureMemory(std::vector<UserMemoryRequirementConfig> p_UserMemoryRequirement);
+    // Pools of the requirements, backed by the pages of p_PageConfig. The first configuration is kept.
+    bool ConfigureMemory(std::vector<UserMemoryRequirementConfig> p_UserMemoryRequirement, const VMPageConfig& p_PageConfig = VMPageConfig());
 
     size_t InUsedMemory();
     size_t TotalMemoryCapacity();
@@ -41,6 +44,7 @@ private:
     static std::unique_ptr<MemoryAllocator> m_Instance;
     static std::once_flag m_OnceFlag;
     bool m_IsMemoryConfigured = false;
+    std::mutex m_ConfigureMutex;
 
     static std::unique_ptr<VM::VirtualMemoryPool> m_MemoryPool;
     std::vector<VM::VMPoolConfig> m_VirtualMemoryTable;
@@ -2,18 +2,74 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__APPLE__)
 #include <mach/mach.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#else
+#error "Unsupported platform, the virtual memory backend needs Mach or Linux"
+#endif
 
 using namespace VM;
 
+// Write to every page of an allocation, the threads fault in disjoint ranges
+static void s_TouchPages(void* p_Address, size_t p_Size, size_t p_PageSize, int p_ThreadCount)
+{
+    const size_t pageCount = p_Size / p_PageSize;
+    if (pageCount == 0) return;
+
+    size_t threadCount = (p_ThreadCount > 0) ? static_cast<size_t>(p_ThreadCount) : std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, pageCount);
+
+    const auto touchRange = [p_Address, p_PageSize, pageCount, threadCount](size_t p_Thread)
+    {
+        const size_t pageBegin = pageCount * p_Thread / threadCount;
+        const size_t pageEnd = pageCount * (p_Thread + 1) / threadCount;
+        for (size_t page = pageBegin; page < pageEnd; page++)
+        {
+            *static_cast<volatile char*>(VM_ADVANCE_POINTER_BY_OFFSET(p_Address, page * p_PageSize)) = 0;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t thread = 1; thread < threadCount; thread++)
+    {
+        workers.emplace_back(touchRange, thread);
+    }
+
+    touchRange(0);
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
 VirtualMemory::VirtualMemory()
 {
 }
 
+VirtualMemory::VirtualMemory(const VMPageConfig& pageConfig)
+    : m_PageConfig(pageConfig)
+{
+}
+
 VirtualMemory::~VirtualMemory()
 {
 }
 
+bool VirtualMemory::VmAllocate(size_t size, VM::PageAllocation* allocationInfo)
+{
+    return VmAllocate(size, allocationInfo, m_PageConfig);
+}
+
+#if defined(__APPLE__)
+
 bool VirtualMemory::VmFree(const VM::PageAllocation* allocationInfo)
 {
     return (vm_deallocate(mach_task_self(),
@@ -28,7 +84,8 @@ size_t VirtualMemory::VmSize()
     return (size_t)size;
 }
 
-bool VirtualMemory::VmAllocate(size_t size, VM::PageAllocation* allocationInfo)
+// The default pages are used whatever the page size, the pages are faulted in by touching them
+bool VirtualMemory::VmAllocate(size_t size, VM::PageAllocation* allocationInfo, const VMPageConfig& pageConfig)
 {
     vm_address_t address = 0;
     vm_size_t pageSize = round_page(size);
@@ -39,6 +96,133 @@ bool VirtualMemory::VmAllocate(size_t size, VM::PageAllocation* allocationInfo)
 
     allocationInfo->baseAddress = reinterpret_cast<void*>(address);
     allocationInfo->size = pageSize;
+    allocationInfo->pageSize = VmSize();
+
+    if (pageConfig.prefault != VMPrefault::None)
+    {
+        s_TouchPages(allocationInfo->baseAddress, allocationInfo->size, allocationInfo->pageSize, pageConfig.touchThreadCount);
+    }
+
+    return true;
+}
+
+#elif defined(__linux__)
+
+#ifndef MAP_HUGE_SHIFT
+#define MAP_HUGE_SHIFT 26
+#endif
+
+// Flags of the base page mappings, MAP_NORESERVE skips the overcommit check of unchecked mappings
+static int s_BasePageMapFlags(const VMPageConfig& p_PageConfig)
+{
+    return MAP_PRIVATE | MAP_ANONYMOUS | ((p_PageConfig.commitCheck == VMCommitCheck::Unchecked) ? MAP_NORESERVE : 0);
+}
+
+static constexpr size_t VM_HUGE_PAGE_2MB = VM_MEM_MB(2);
+static constexpr size_t VM_HUGE_PAGE_1GB = VM_MEM_GB(1);
+
+static size_t s_RoundUp(size_t p_Size, size_t p_Alignment)
+{
+    return (p_Size + p_Alignment - 1) / p_Alignment * p_Alignment;
+}
+
+// Reserved huge pages of p_HugePageSize, fails when the system has none left
+static void* s_MapHugePages(size_t p_Size, size_t p_HugePageSize, bool p_Populate)
+{
+    const int hugePageShift = (p_HugePageSize == VM_HUGE_PAGE_1GB) ? 30 : 21;
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (hugePageShift << MAP_HUGE_SHIFT) | (p_Populate ? MAP_POPULATE : 0);
+
+    void* address = mmap(nullptr, p_Size, PROT_READ | PROT_WRITE, flags, -1, 0);
+
+    return (address == MAP_FAILED) ? nullptr : address;
+}
+
+// Base pages aligned to a 2 MB boundary, the kernel can back every aligned 2 MB range with a transparent huge page
+static void* s_MapTransparentHugePages(size_t p_Size, int p_MapFlags)
+{
+    // Over reserve by one huge page and trim the unaligned head and tail
+    const size_t reservedSize = p_Size + VM_HUGE_PAGE_2MB;
+    void* reservedAddress = mmap(nullptr, reservedSize, PROT_READ | PROT_WRITE, p_MapFlags, -1, 0);
+    if (reservedAddress == MAP_FAILED) return nullptr;
+
+    void* address = VM_ALIGN_POINTER(reservedAddress, VM_HUGE_PAGE_2MB);
+    const size_t headSize = VM_POINTER_TO_UINT(address) - VM_POINTER_TO_UINT(reservedAddress);
+    const size_t tailSize = reservedSize - headSize - p_Size;
+    if (headSize > 0) munmap(reservedAddress, headSize);
+    if (tailSize > 0) munmap(VM_ADVANCE_POINTER_BY_OFFSET(address, p_Size), tailSize);
+
+#if defined(MADV_HUGEPAGE)
+    madvise(address, p_Size, MADV_HUGEPAGE);
+#endif
+
+    return address;
+}
+
+bool VirtualMemory::VmFree(const VM::PageAllocation* allocationInfo)
+{
+    return (munmap(allocationInfo->baseAddress, allocationInfo->size) == 0);
+}
+
+size_t VirtualMemory::VmSize()
+{
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+}
+
+bool VirtualMemory::VmAllocate(size_t size, VM::PageAllocation* allocationInfo, const VMPageConfig& pageConfig)
+{
+    const size_t basePageSize = VmSize();
+    const bool populate = (pageConfig.prefault == VMPrefault::Populate);
+
+    void* address = nullptr;
+    size_t allocationSize = 0;
+    size_t pageSize = basePageSize;
+
+    // 1 GB pages only for allocations of at least one page, 2 MB pages when no 1 GB page is left
+    if (pageConfig.pageSize == VMPageSize::Huge1GB && size >= VM_HUGE_PAGE_1GB)
+    {
+        allocationSize = s_RoundUp(size, VM_HUGE_PAGE_1GB);
+        address = s_MapHugePages(allocationSize, VM_HUGE_PAGE_1GB, populate);
+        pageSize = VM_HUGE_PAGE_1GB;
+    }
+
+    if (!address && (pageConfig.pageSize == VMPageSize::Huge1GB || pageConfig.pageSize == VMPageSize::Huge2MB))
+    {
+        allocationSize = s_RoundUp(size, VM_HUGE_PAGE_2MB);
+        address = s_MapHugePages(allocationSize, VM_HUGE_PAGE_2MB, populate);
+        pageSize = VM_HUGE_PAGE_2MB;
+    }
+
+    if (!address && pageConfig.pageSize != VMPageSize::Default)
+    {
+        allocationSize = s_RoundUp(size, VM_HUGE_PAGE_2MB);
+        address = s_MapTransparentHugePages(allocationSize, s_BasePageMapFlags(pageConfig));
+        pageSize = basePageSize;
+
+        // MAP_POPULATE would fault in base pages before the hint, the pages are touched after it instead
+        if (address && populate)
+        {
+            s_TouchPages(address, allocationSize, basePageSize, pageConfig.touchThreadCount);
+        }
+    }
+    else if (!address)
+    {
+        allocationSize = s_RoundUp(size, basePageSize);
+        address = mmap(nullptr, allocationSize, PROT_READ | PROT_WRITE, s_BasePageMapFlags(pageConfig) | (populate ? MAP_POPULATE : 0), -1, 0);
+        address = (address == MAP_FAILED) ? nullptr : address;
+    }
+
+    if (!address) return false;
+
+    allocationInfo->baseAddress = address;
+    allocationInfo->size = allocationSize;
+    allocationInfo->pageSize = pageSize;
+
+    if (pageConfig.prefault == VMPrefault::Touch)
+    {
+        s_TouchPages(address, allocationSize, pageSize, pageConfig.touchThreadCount);
+    }
 
     return true;
 }
+
+#endif
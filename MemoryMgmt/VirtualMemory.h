@@ -10,11 +10,17 @@ class VirtualMemory
 {
 public:
     VirtualMemory();
+    explicit VirtualMemory(const VMPageConfig& pageConfig);
     virtual ~VirtualMemory();
 
+    // Allocations use the page configuration of the constructor unless one is given
     bool VmAllocate(size_t size, VM::PageAllocation* allocationInfo);
+    bool VmAllocate(size_t size, VM::PageAllocation* allocationInfo, const VMPageConfig& pageConfig);
     bool VmFree(const VM::PageAllocation* allocationInfo);
     size_t VmSize();
+
+protected:
+    VMPageConfig m_PageConfig;
 };
 
 }
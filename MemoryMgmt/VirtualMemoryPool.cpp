@@ -2,13 +2,152 @@
 
 #include <assert.h>
 #include <inttypes.h>
+#include <algorithm>
+#include <cstring>
 
 //#include "PixelSum/HelperClasses/LogMacros.h"
 #include "LogMacros.h"
 
 using namespace VM;
 
-VirtualMemoryPool::VirtualMemoryPool(std::vector<VMPoolConfig> p_VmPoolConfig)
+static_assert(VM_MAX_THREAD_SLOTS == 64, "One bit of the slot mask per thread slot");
+
+// Slots of the threads with a block cache, bit t is set while slot t is taken
+static std::atomic<uint64_t> s_ThreadSlotMask{0};
+
+// Slot of a thread, taken on the first allocation or free of the thread and returned when it exits
+struct ThreadSlot
+{
+    ThreadSlot()
+    {
+        uint64_t slotMask = s_ThreadSlotMask.load(std::memory_order_relaxed);
+        while (slotMask != UINT64_MAX)
+        {
+            int slot = 0;
+            while (slotMask & (uint64_t(1) << slot)) slot++;
+
+            if (s_ThreadSlotMask.compare_exchange_weak(slotMask, slotMask | (uint64_t(1) << slot), std::memory_order_acquire,
+                                                       std::memory_order_relaxed))
+            {
+                index = slot;
+                break;
+            }
+        }
+    }
+
+    ~ThreadSlot()
+    {
+        if (index >= 0)
+        {
+            s_ThreadSlotMask.fetch_and(~(uint64_t(1) << index), std::memory_order_release);
+        }
+    }
+
+    int index = -1; // -1 when all the slots are taken
+};
+
+static thread_local ThreadSlot t_ThreadSlot;
+
+// Head of a free stack with p_TopIndex + 1 on top, the tag of p_Head incremented
+static uint64_t s_NextStackHead(uint64_t p_Head, uint64_t p_TopIndexPlusOne)
+{
+    return (((p_Head >> 32) + 1) << 32) | p_TopIndexPlusOne;
+}
+
+static void s_PushBlock(MemoryPage* p_Pool, void* p_Block)
+{
+    const uint64_t blockIndex = (VM_POINTER_TO_UINT(p_Block) - VM_POINTER_TO_UINT(p_Pool->baseAddress)) / p_Pool->elementSize;
+    std::atomic<uint32_t>* nextIndex = static_cast<std::atomic<uint32_t>*>(p_Block);
+
+    uint64_t head = p_Pool->freeStack.head.load(std::memory_order_relaxed);
+    do
+    {
+        nextIndex->store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+    } while (!p_Pool->freeStack.head.compare_exchange_weak(head, s_NextStackHead(head, blockIndex + 1), std::memory_order_release,
+                                                           std::memory_order_relaxed));
+}
+
+static void* s_PopBlock(MemoryPage* p_Pool)
+{
+    uint64_t head = p_Pool->freeStack.head.load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(head) != 0)
+    {
+        // The link of a block popped meanwhile by another thread is stale, the tag then fails the exchange
+        void* block = VM_ADVANCE_POINTER_BY_OFFSET(p_Pool->baseAddress, (static_cast<uint32_t>(head) - 1) * p_Pool->elementSize);
+        const uint32_t nextIndex = static_cast<std::atomic<uint32_t>*>(block)->load(std::memory_order_relaxed);
+        if (p_Pool->freeStack.head.compare_exchange_weak(head, s_NextStackHead(head, nextIndex), std::memory_order_acquire,
+                                                         std::memory_order_acquire))
+        {
+            return block;
+        }
+    }
+
+    return nullptr;
+}
+
+// Up to p_Count blocks never used before, carved with a single exchange of the bump pointer. Returns the count.
+static size_t s_CarveBlocks(MemoryPage* p_Pool, size_t p_Count, void** p_Blocks)
+{
+    const size_t poolByteSize = p_Pool->blockCount * p_Pool->elementSize;
+
+    size_t carvedByteSize = p_Pool->carvedByteSize.load(std::memory_order_relaxed);
+    size_t blockCount = 0;
+    do
+    {
+        blockCount = std::min(p_Count, (poolByteSize - carvedByteSize) / p_Pool->elementSize);
+        if (blockCount == 0) return 0;
+    } while (!p_Pool->carvedByteSize.compare_exchange_weak(carvedByteSize, carvedByteSize + blockCount * p_Pool->elementSize,
+                                                           std::memory_order_relaxed, std::memory_order_relaxed));
+
+    for (size_t i = 0; i < blockCount; i++)
+    {
+        p_Blocks[i] = VM_ADVANCE_POINTER_BY_OFFSET(p_Pool->baseAddress, carvedByteSize + i * p_Pool->elementSize);
+    }
+
+    return blockCount;
+}
+
+// Up to p_Count blocks from the free stack, then from the bump pointer. Returns the count.
+static size_t s_AcquireBlocks(MemoryPage* p_Pool, size_t p_Count, void** p_Blocks)
+{
+    size_t blockCount = 0;
+    while (blockCount < p_Count)
+    {
+        void* block = s_PopBlock(p_Pool);
+        if (!block) break;
+
+        p_Blocks[blockCount++] = block;
+    }
+
+    blockCount += s_CarveBlocks(p_Pool, p_Count - blockCount, p_Blocks + blockCount);
+    p_Pool->usedByteSize.fetch_add(blockCount * p_Pool->elementSize, std::memory_order_relaxed);
+
+    return blockCount;
+}
+
+static void s_ReleaseBlocks(MemoryPage* p_Pool, size_t p_Count, void* const* p_Blocks)
+{
+    for (size_t i = 0; i < p_Count; i++)
+    {
+        s_PushBlock(p_Pool, p_Blocks[i]);
+    }
+
+    p_Pool->usedByteSize.fetch_sub(p_Count * p_Pool->elementSize, std::memory_order_relaxed);
+}
+
+// Smallest k with 2^k >= p_Size
+static int s_CeilLog2(size_t p_Size)
+{
+    return (p_Size <= 1) ? 0 : 64 - __builtin_clzll(static_cast<unsigned long long>(p_Size - 1));
+}
+
+static size_t s_RoundUp(size_t p_Size, size_t p_Alignment)
+{
+    return (p_Size + p_Alignment - 1) / p_Alignment * p_Alignment;
+}
+
+VirtualMemoryPool::VirtualMemoryPool(std::vector<VMPoolConfig> p_VmPoolConfig, const VMPageConfig& p_PageConfig)
+    : VirtualMemory(p_PageConfig)
 {
     if (p_VmPoolConfig.empty())
     {
@@ -16,126 +155,227 @@ VirtualMemoryPool::VirtualMemoryPool(std::vector<VMPoolConfig> p_VmPoolConfig)
         assert(false);
     }
 
+    // A pool keeps its block count when its size is rounded up, pools of sizes rounding to the same power of two
+    // are merged
+    for (VMPoolConfig& poolConfig : p_VmPoolConfig)
+    {
+        const size_t poolSize = std::max<size_t>(poolConfig.poolSize, sizeof(uint32_t));
+        const size_t roundedPoolSize = size_t(1) << s_CeilLog2(poolSize);
+
+        poolConfig.poolCapacity = poolConfig.poolCapacity / poolSize * roundedPoolSize;
+        poolConfig.poolSize = roundedPoolSize;
+    }
+
     // Sort the virtual memory pool config in ascending order of the pool size
     std::sort (p_VmPoolConfig.begin(), p_VmPoolConfig.end(), m_VmPoolConfigSortObject);
 
-    m_PoolCount = p_VmPoolConfig.size();
+    std::vector<VMPoolConfig> poolConfigs;
+    for (const VMPoolConfig& poolConfig : p_VmPoolConfig)
+    {
+        if (!poolConfigs.empty() && poolConfigs.back().poolSize == poolConfig.poolSize)
+        {
+            poolConfigs.back().poolCapacity += poolConfig.poolCapacity;
+            continue;
+        }
+
+        poolConfigs.push_back(poolConfig);
+    }
+
+    m_PoolCount = poolConfigs.size();
 
     m_PoolConfig = new VMPoolConfig[m_PoolCount];
     m_VMPool = new MemoryPool(m_PoolCount);
+    m_ThreadCaches.reset(new ThreadCache[VM_MAX_THREAD_SLOTS * m_PoolCount]);
 
+    size_t reservedByteSize = 0;
     for (uint32_t poolIdx = 0; poolIdx < m_PoolCount; ++poolIdx)
     {
-        m_PoolConfig[poolIdx].poolSize = p_VmPoolConfig[poolIdx].poolSize;
-        m_PoolConfig[poolIdx].poolCapacity = p_VmPoolConfig[poolIdx].poolCapacity;
+        m_PoolConfig[poolIdx] = poolConfigs[poolIdx];
+        MemoryPage* memPool = &m_VMPool->pools[poolIdx];
+
+        // The caches hold at most a quarter of the configured blocks
+        const size_t configuredBlockCount = std::max<size_t>(m_PoolConfig[poolIdx].poolCapacity / m_PoolConfig[poolIdx].poolSize, 1);
+        const size_t threadCacheCapacity = std::min<size_t>(VM_THREAD_CACHE_MAX_BLOCKS, configuredBlockCount / (4 * VM_MAX_THREAD_SLOTS));
+        memPool->threadCacheCapacity = (threadCacheCapacity >= 2) ? static_cast<uint32_t>(threadCacheCapacity) : 0;
+
+        // The blocks all the thread caches can hold are reserved on top, the configured blocks stay available to any thread
+        // The region is rounded up for the address lookup only, the blocks past the reserved ones are never carved
+        const size_t reservedBlockCount = configuredBlockCount + VM_MAX_THREAD_SLOTS * memPool->threadCacheCapacity;
+        memPool->elementSize = m_PoolConfig[poolIdx].poolSize;
+        memPool->blockCount = std::min<size_t>(reservedBlockCount, UINT32_MAX - 1);
+        memPool->regionByteSize = s_RoundUp(reservedBlockCount * m_PoolConfig[poolIdx].poolSize, VM_POOL_REGION_ALIGNMENT);
+        reservedByteSize += memPool->regionByteSize;
     }
 
-    for (uint32_t poolIdx = 0; poolIdx < m_PoolCount; ++poolIdx)
+    // Allocations of a size class go to the smallest pool of at least its size
+    int classPoolIdx = m_PoolCount - 1;
+    for (int sizeClass = VM_SIZE_CLASS_COUNT - 1; sizeClass >= 0; --sizeClass)
+    {
+        while (classPoolIdx > 0 && m_PoolConfig[classPoolIdx - 1].poolSize >= (size_t(1) << sizeClass)) classPoolIdx--;
+
+        m_PoolIndexBySizeClass[sizeClass] = (m_PoolConfig[classPoolIdx].poolSize >= (size_t(1) << sizeClass)) ? static_cast<int8_t>(classPoolIdx) : -1;
+    }
+
+    // The reservation of all the pools is address space, a block is backed on its first write
+    VMPageConfig reservationConfig = m_PageConfig;
+    reservationConfig.commitCheck = VMCommitCheck::Unchecked;
+
+    bool success = VmAllocate(reservedByteSize, &m_PoolAlloc, reservationConfig);
+    if (!success)
     {
-        m_PoolSizeLookupTableIdx[m_PoolConfig[poolIdx].poolSize] = poolIdx;
+        LOG_ERROR("Failed to allocate virtual memory for the pools of size %zu", reservedByteSize);
+        assert(success);
     }
 
+    // The reservation may be rounded up to larger pages, the remainder is mapped to the last pool but holds no blocks
+    m_VMPool->pools[m_PoolCount - 1].regionByteSize += m_PoolAlloc.size - reservedByteSize;
+    m_PoolIndexByRegion.reset(new uint8_t[m_PoolAlloc.size >> VM_POOL_REGION_SHIFT]);
+
+    size_t regionOffset = 0;
     for (uint32_t poolIdx = 0; poolIdx < m_PoolCount; ++poolIdx)
     {
         MemoryPage* memPool = &m_VMPool->pools[poolIdx];
 
-        size_t elementSize   = m_PoolConfig[poolIdx].poolSize;
-        size_t poolCapacity  = m_PoolConfig[poolIdx].poolCapacity;
-        size_t stackCapacity = poolCapacity / elementSize;
-        size_t stackByteSize = stackCapacity * sizeof(void*);
+        memPool->baseAddress = VM_ADVANCE_POINTER_BY_OFFSET(m_PoolAlloc.baseAddress, regionOffset);
 
-        memPool->elementSize        = elementSize;
-        memPool->usedByteSize       = 0;
-        memPool->freeStack.count    = 0;
-        memPool->freeStack.capacity = stackCapacity;
+        std::fill_n(&m_PoolIndexByRegion[regionOffset >> VM_POOL_REGION_SHIFT], memPool->regionByteSize >> VM_POOL_REGION_SHIFT, static_cast<uint8_t>(poolIdx));
+        regionOffset += memPool->regionByteSize;
+    }
+}
 
-        bool success = VmAllocate(poolCapacity, &memPool->pageAlloc);
-        if (!success)
-        {
-            LOG_ERROR("Failed to allocate virtual memory for pool of size %zu", elementSize);
-            assert(success);
-        }
+VirtualMemoryPool::~VirtualMemoryPool()
+{
+    if (m_PoolAlloc.baseAddress)
+    {
+        VmFree(&m_PoolAlloc);
+    }
 
-        success = VmAllocate(stackByteSize, &memPool->freeStack.pageAlloc);
-        if (!success)
-        {
-            LOG_ERROR("Failed to allocate virtual memory for pool's free stack of size %zu", elementSize);
-            assert(success);
-        }
+    delete m_VMPool;
+    delete[] m_PoolConfig;
+}
 
-        memPool->freeStack.addressPtr = (void**)memPool->freeStack.pageAlloc.baseAddress;
-        memPool->baseAddress = memPool->pageAlloc.baseAddress;
-        memPool->currentAddress = memPool->baseAddress;
-    }
+int VirtualMemoryPool::ResolvePoolIndex(size_t p_Size) const
+{
+    const int sizeClass = s_CeilLog2(p_Size);
+
+    return (sizeClass < VM_SIZE_CLASS_COUNT) ? m_PoolIndexBySizeClass[sizeClass] : -1;
 }
 
-VirtualMemoryPool::~VirtualMemoryPool()
+int VirtualMemoryPool::ResolvePoolIndex(const void* p_Pointer) const
 {
-    delete m_PoolConfig; // TODO use unique ptr
+    const size_t offset = VM_POINTER_TO_UINT(p_Pointer) - VM_POINTER_TO_UINT(m_PoolAlloc.baseAddress);
+
+    // Pointers below the reservation wrap around to large offsets
+    return (offset < m_PoolAlloc.size) ? m_PoolIndexByRegion[offset >> VM_POOL_REGION_SHIFT] : -1;
 }
 
-void* VirtualMemoryPool::AllocateVirtualMemory(size_t p_Size)
+ThreadCache* VirtualMemoryPool::GetThreadCache(int p_PoolIndex)
 {
-    if (p_Size < m_PoolConfig[0].poolSize)
-    {
-        p_Size = m_PoolConfig[0].poolSize;
-    }
+    if (m_VMPool->pools[p_PoolIndex].threadCacheCapacity == 0) return nullptr;
+
+    const int threadSlot = t_ThreadSlot.index;
+
+    return (threadSlot >= 0) ? &m_ThreadCaches[threadSlot * m_PoolCount + p_PoolIndex] : nullptr;
+}
 
-    VM_NEXT_POWER_OF_2(p_Size);
-    if (p_Size <= m_PoolConfig[m_PoolCount - 1].poolSize)
+void* VirtualMemoryPool::AllocateVirtualMemory(size_t p_Size)
+{
+    const int poolIndex = ResolvePoolIndex(p_Size);
+    if (poolIndex >= 0)
     {
-        uint32_t poolIndex = m_PoolSizeLookupTableIdx[p_Size];
         MemoryPage* pPool = &m_VMPool->pools[poolIndex];
-        if (pPool->freeStack.count > 0)
+        void* pNewAddress = nullptr;
+
+        ThreadCache* threadCache = GetThreadCache(poolIndex);
+        if (threadCache)
         {
-            return pPool->freeStack.addressPtr[--pPool->freeStack.count];
+            // Refill half of an empty cache, the next frees of the thread fit without a flush
+            uint32_t count = threadCache->count.load(std::memory_order_relaxed);
+            if (count == 0)
+            {
+                count = static_cast<uint32_t>(s_AcquireBlocks(pPool, pPool->threadCacheCapacity / 2, threadCache->blocks));
+            }
+
+            if (count > 0)
+            {
+                pNewAddress = threadCache->blocks[--count];
+            }
+
+            threadCache->count.store(count, std::memory_order_relaxed);
+        }
+        else
+        {
+            s_AcquireBlocks(pPool, 1, &pNewAddress);
         }
 
-        void* pNewAddress = pPool->currentAddress;
-        void* pNextAddress = VM_ADVANCE_POINTER_BY_OFFSET(pNewAddress, p_Size);
-        if (VM_IS_VALID_RANGE(pNextAddress, pPool->baseAddress, VM_ADVANCE_POINTER_BY_OFFSET(pPool->baseAddress, pPool->pageAlloc.size)))
+        if (pNewAddress)
         {
-            pPool->currentAddress = pNextAddress;
-            pPool->usedByteSize += p_Size;
 #if defined(_DEBUG)
-            memset(pNewAddress, 0xAA, size);
+            memset(pNewAddress, 0xAA, pPool->elementSize);
 #endif
             return pNewAddress;
         }
+
+        LOG_ERROR("The virtual memory pool of size: %zu is exhausted.", pPool->elementSize);
+
+        return NULL;
     }
 
-    LOG_ERROR("Attempting an allocation of size: %ld is not supported by the virtual memory pool. Valid memory range is %ld - %ld", p_Size, m_PoolConfig[0].poolSize, m_PoolConfig[m_PoolCount - 1].poolSize);
+    LOG_ERROR("Attempting an allocation of size: %zu is not supported by the virtual memory pool. Valid memory range is %zu - %zu", p_Size, m_PoolConfig[0].poolSize, m_PoolConfig[m_PoolCount - 1].poolSize);
 
     return NULL;
 }
 
 void VirtualMemoryPool::FreeVirtualMemory(void* p_Pointer)
 {
-    for (uint32_t index = 0; index < m_PoolCount; ++index)
+    const int poolIndex = ResolvePoolIndex(static_cast<const void*>(p_Pointer));
+    if (poolIndex < 0)
     {
-        MemoryPage* pPool = &m_VMPool->pools[index];
-        void* pHead = pPool->baseAddress;
-        if (VM_IS_VALID_RANGE(p_Pointer, pHead, VM_ADVANCE_POINTER_BY_OFFSET(pHead, pPool->pageAlloc.size)))
-        {
-            pPool->freeStack.addressPtr[pPool->freeStack.count++] = p_Pointer;
-            pPool->usedByteSize -= pPool->elementSize;
+        LOG_ERROR("The memory you are trying to free doesn't belong to any of the pools.");
+        assert(false);
+        return;
+    }
+
+    MemoryPage* pPool = &m_VMPool->pools[poolIndex];
 #if defined(_DEBUG)
-            memset(p, 0xDD, pPool->elementSize);
+    memset(p_Pointer, 0xDD, pPool->elementSize);
 #endif
-            return;
-        }
+    ThreadCache* threadCache = GetThreadCache(poolIndex);
+    if (!threadCache)
+    {
+        s_ReleaseBlocks(pPool, 1, &p_Pointer);
+        return;
     }
 
-    LOG_ERROR("The memory you are trying to free doesn't belong to any of the pools.");
-    assert(false);
+    // Flush the older half of a full cache
+    uint32_t count = threadCache->count.load(std::memory_order_relaxed);
+    if (count == pPool->threadCacheCapacity)
+    {
+        const uint32_t flushCount = count / 2;
+        s_ReleaseBlocks(pPool, flushCount, threadCache->blocks);
+        std::copy(threadCache->blocks + flushCount, threadCache->blocks + count, threadCache->blocks);
+        count -= flushCount;
+    }
+
+    threadCache->blocks[count++] = p_Pointer;
+    threadCache->count.store(count, std::memory_order_relaxed);
 }
 
+// Blocks in the thread caches are free, the count is exact when no thread allocates or frees meanwhile
 size_t VirtualMemoryPool::InUsedMemory()
 {
     size_t size = 0;
     for (uint32_t index = 0; index < m_PoolCount; ++index)
     {
-        size += m_VMPool->pools[index].usedByteSize;
+        size += m_VMPool->pools[index].usedByteSize.load(std::memory_order_relaxed);
+    }
+
+    for (int threadSlot = 0; threadSlot < VM_MAX_THREAD_SLOTS; ++threadSlot)
+    {
+        for (uint32_t index = 0; index < m_PoolCount; ++index)
+        {
+            size -= m_ThreadCaches[threadSlot * m_PoolCount + index].count.load(std::memory_order_relaxed) * m_VMPool->pools[index].elementSize;
+        }
     }
 
     return size;
@@ -165,7 +405,7 @@ void VirtualMemoryPool::PrintStats()
 
     for (uint32_t poolIdx = 0; poolIdx < m_PoolCount; ++poolIdx)
     {
-        float memoryUsage = static_cast<float>(m_VMPool->pools[poolIdx].usedByteSize) / static_cast<float>(m_PoolConfig[poolIdx].poolCapacity) * 100.0f;
+        float memoryUsage = static_cast<float>(m_VMPool->pools[poolIdx].usedByteSize.load()) / static_cast<float>(m_PoolConfig[poolIdx].poolCapacity) * 100.0f;
         float relativePoolWeight = static_cast<float>(m_PoolConfig[poolIdx].poolCapacity) / static_cast<float>(minCapacity);
         LOG_INFO("Pool[%d] Usage: %f %%, Relative Pool Weight: %f", poolIdx, memoryUsage, relativePoolWeight);
     }
@@ -1,7 +1,5 @@
 #pragma once
 
-#include <map>
-
 #include "VirtualMemory.h"
 #include "VirtualMemoryPoolConfig.h"
 
@@ -9,10 +7,22 @@
 namespace VM
 {
 
+// Pools of fixed size blocks, the pool sizes are rounded up to powers of two. An allocation is routed to its pool by
+// the log2 of its size and a free by the offset of the pointer in the reservation of all the pools, both in constant
+// time whatever the pool count. The pools are safe to use from several threads without lock. A pool hands out blocks
+// from a lock-free free stack, then from a bump pointer carved with a compare exchange. Pools of many blocks are
+// fronted by a block cache per thread, the allocations and frees of a thread then touch no shared cache line until
+// its cache runs empty or full. The caches hold at most a quarter of a pool and smaller pools are not cached. A
+// cached pool reserves the blocks all the caches can hold on top of its capacity, so the configured blocks stay
+// available to any thread whatever the other threads, exited ones included, keep cached. The blocks cached by a
+// thread which exited are reused by the next thread of its slot.
 class VirtualMemoryPool : public VirtualMemory
 {
 public:
-    explicit VirtualMemoryPool(std::vector<VMPoolConfig> p_VmPoolConfig);
+    // The pools are backed by the pages of p_PageConfig. Their reservation is not checked against the memory of the
+    // system (VMCommitCheck::Unchecked), the capacities may exceed it. Once the memory runs out, a write to a block not
+    // yet backed raises SIGSEGV or wakes the OOM killer instead of the allocation returning NULL.
+    explicit VirtualMemoryPool(std::vector<VMPoolConfig> p_VmPoolConfig, const VMPageConfig& p_PageConfig = VMPageConfig());
     virtual ~VirtualMemoryPool();
 
     void* AllocateVirtualMemory(size_t p_Size);
@@ -24,12 +34,26 @@ public:
     size_t TotalMemoryCapacity();
 
 private:
-    std::map<size_t, size_t> m_PoolSizeLookupTableIdx;
-    VMPoolConfig*            m_PoolConfig;
-    MemoryPool*              m_VMPool;
-    uint8_t                  m_PoolCount = 0;
+    // Smallest pool of blocks of at least p_Size bytes, -1 when p_Size is larger than the largest pool
+    int ResolvePoolIndex(size_t p_Size) const;
+
+    // Pool of the block at p_Pointer, -1 when p_Pointer is outside the reservation
+    int ResolvePoolIndex(const void* p_Pointer) const;
+
+    // Cache of the calling thread for the pool, nullptr when the pool is not cached or the thread has no slot
+    ThreadCache* GetThreadCache(int p_PoolIndex);
+
+private:
+    PageAllocation             m_PoolAlloc;                                  // Reservation of all the pools
+    int8_t                     m_PoolIndexBySizeClass[VM_SIZE_CLASS_COUNT]; // Smallest pool of the size class, -1 for none
+    std::unique_ptr<uint8_t[]> m_PoolIndexByRegion;                          // Pool of every 2 MB of the reservation
+    VMPoolConfig*              m_PoolConfig;
+    MemoryPool*                m_VMPool;
+    uint8_t                    m_PoolCount = 0;
+
+    std::unique_ptr<ThreadCache[]> m_ThreadCaches; // Cache of pool p of thread slot t at t * m_PoolCount + p
 
-    MemRequirementSortObject m_VmPoolConfigSortObject;
+    MemRequirementSortObject   m_VmPoolConfigSortObject;
 };
 
 } //namespace VM (Virtual memory namespace)
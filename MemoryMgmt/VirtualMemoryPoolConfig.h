@@ -1,5 +1,7 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include "VirtualMemoryUtils.h"
@@ -7,49 +9,115 @@
 namespace VM
 {
 
+// Pages backing the pools. Huge pages cut the TLB misses of the random corner lookups into large tables, they are
+// only available on Linux, the other platforms use their default pages.
+enum class VMPageSize
+{
+    Default,     // Base pages of the system
+    Transparent, // Base pages, 2 MB aligned with the transparent huge page hint (MADV_HUGEPAGE)
+    Huge2MB,     // Reserved 2 MB huge pages (MAP_HUGETLB), Transparent when none are available
+    Huge1GB,     // Reserved 1 GB huge pages, Huge2MB for allocations smaller than 1 GB or when none are available
+};
+
+// When the pages of a pool are faulted in. By default the first write of every page faults, e.g. 16K minor faults
+// for the first build of a 64 MB table.
+enum class VMPrefault
+{
+    None,     // On the first write
+    Populate, // At allocation by the kernel (MAP_POPULATE), a single pass without faults
+    Touch,    // At allocation by a write to every page from several threads
+};
+
+// Whether Linux checks the base and transparent huge page mappings against the memory of the system when they are
+// made. The other mappings and platforms ignore it.
+enum class VMCommitCheck
+{
+    Checked,   // The heuristic overcommit check refuses a mapping much larger than the free memory, the allocation fails
+    Unchecked, // MAP_NORESERVE, the mapping may exceed the memory of the system. Once the memory runs out a write to a
+               // page not yet faulted in raises SIGSEGV or wakes the OOM killer, no allocation fails.
+};
+
+struct VMPageConfig
+{
+    VMPageSize pageSize = VMPageSize::Default;
+    VMPrefault prefault = VMPrefault::None;
+    VMCommitCheck commitCheck = VMCommitCheck::Checked;
+    int touchThreadCount = 0; // Threads of VMPrefault::Touch, 0 for the hardware concurrency
+};
+
 struct PageAllocation
 {
     void* baseAddress = nullptr;
     size_t size = 0;
+    size_t pageSize = 0; // Size of the pages backing the allocation, the base page size for transparent huge pages
 };
 
+// Threads with a block cache in every pool, one bit of the slot mask each. Further threads use the free stacks.
+static constexpr int VM_MAX_THREAD_SLOTS = 64;
+
+// Blocks a thread caches per pool at most
+static constexpr uint32_t VM_THREAD_CACHE_MAX_BLOCKS = 16;
+
+static constexpr size_t VM_CACHE_LINE_SIZE = 64;
+
+// Lock-free stack of the free blocks of a pool. The blocks are linked through their first 4 bytes by block index,
+// the head packs the index + 1 of the top block (0 when empty) with a tag in the high 32 bits which every push and
+// pop increments, a pop racing with the pop and push back of the same block fails its compare exchange (ABA).
 struct FreeStack
 {
-    PageAllocation pageAlloc;
+    std::atomic<uint64_t> head{0};
+};
+
+// Blocks of a pool cached by a single thread, allocated and freed without atomic read-modify-write
+struct ThreadCache
+{
+    std::atomic<uint32_t> count{0}; // Written by the owning thread only, read by InUsedMemory()
+    void* blocks[VM_THREAD_CACHE_MAX_BLOCKS];
+
+    char padding[VM_CACHE_LINE_SIZE]; // No false sharing with the cache of the next thread
+};
 
-    void** addressPtr   = nullptr;
+// The pools are regions of a single reservation, every region starts on a 2 MB boundary. The pool of an address
+// follows from its offset in the reservation, huge pages never straddle two pools.
+static constexpr int    VM_POOL_REGION_SHIFT     = 21;
+static constexpr size_t VM_POOL_REGION_ALIGNMENT = size_t(1) << VM_POOL_REGION_SHIFT;
 
-    size_t capacity     = 0;
-    size_t count        = 0;
-} ;
+// Power of two size classes of the pools, class k holds blocks of 2^k bytes
+static constexpr int VM_SIZE_CLASS_COUNT = 64;
 
 struct MemoryPage
 {
-    FreeStack freeStack;
-    PageAllocation pageAlloc;
-
     void* baseAddress    = nullptr;
-    void* currentAddress = nullptr;
+    size_t regionByteSize = 0; // Region of the pool in the reservation, its capacity and the blocks of the thread
+                               // caches rounded up to the alignment
 
     size_t elementSize   = 0;
-    size_t usedByteSize  = 0;
+    size_t blockCount    = 0; // Configured blocks and the blocks of the thread caches, the free stack links them by
+                              // 32 bit index from their first bytes
+    uint32_t threadCacheCapacity = 0; // 0 when the pool has too few blocks to be spread over the thread caches
+
+    char padding0[VM_CACHE_LINE_SIZE];
+    FreeStack freeStack;
+    char padding1[VM_CACHE_LINE_SIZE];
+    std::atomic<size_t> carvedByteSize{0}; // Bump pointer, bytes from baseAddress carved into blocks
+    std::atomic<size_t> usedByteSize{0};   // Blocks out of the free stack and the bump pointer, thread caches included
+    char padding2[VM_CACHE_LINE_SIZE];
 };
 
 struct MemoryPool
 {
     MemoryPool(uint8_t p_MemoryPoolCount)
+        : pools(new MemoryPage[p_MemoryPoolCount])
     {
-        pools.resize(p_MemoryPoolCount);
     }
 
-    std::vector<MemoryPage> pools;
+    std::unique_ptr<MemoryPage[]> pools;
 };
 
-
 struct VMPoolConfig
 {
     size_t   poolSize;
-    uint32_t poolCapacity;
+    size_t   poolCapacity;
 };
 
 struct MemRequirementSortObject
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <stdint.h>
+
 #define VM_MEM_1KB             1024
 #define VM_MEM_KB(capacity)    (capacity                                    * VM_MEM_1KB)
 #define VM_MEM_MB(capacity)    (VM_MEM_KB(capacity)                         * VM_MEM_1KB)
@@ -18,5 +20,5 @@
 #elif defined(UINTPTR_MAX) && UINTPTR_MAX == UINT64_MAX
     #define VM_SYSTEM_DEFAULT_ALIGNMENT 8
 #else
-#error "Invalid Darwin platform architecture"
+#error "Invalid platform architecture"
 #endif
@@ -1,14 +1,17 @@
 #pragma once
 
+#include <stdint.h>
+
 template<typename T>
 struct Vector4
 {
     Vector4() = default;
-    Vector4(float p_Top, float p_Left, float p_Bottom, float p_Right)
+    Vector4(T p_Top, T p_Left, T p_Bottom, T p_Right)
         : top(p_Top), left(p_Left), bottom(p_Bottom), right(p_Right) {}
 
-    int width() const { return right + 1; }
-    int height() const { return bottom + 1; }
+    // 64-bit, right + 1 overflows int for a right coordinate of 2^31-1
+    int64_t width() const { return static_cast<int64_t>(right) + 1; }
+    int64_t height() const { return static_cast<int64_t>(bottom) + 1; }
 
     union
     {
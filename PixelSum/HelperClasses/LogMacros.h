@@ -26,16 +26,17 @@ static inline char* currentTime();
 #define LOG_IF_ERROR(condition, msg, args...) if (condition) PRINT_LOG(LOG_FMT msg NEWLINE, LOG_ARGS(ERROR_STR), ## args)
 #define LOG_INFO(msg, args...)      PRINT_LOG(LOG_FMT msg NEWLINE, LOG_ARGS(INFO_STR), ## args)
 
+// Per thread buffer, the pools log from several threads
 static inline char* currentTime()
 {
-    static char buffer[64];
+    static thread_local char buffer[64];
     time_t lTime;
-    struct tm* timeInfo;
+    struct tm timeInfo;
 
     time(&lTime);
-    timeInfo = localtime(&lTime);
+    localtime_r(&lTime, &timeInfo);
 
-    strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", timeInfo);
+    strftime(buffer, 64, "%Y-%m-%d %H:%M:%S", &timeInfo);
 
     return buffer;
 }
@@ -10,20 +10,35 @@ public:
         : m_Width(p_Width)
         , m_Height(p_Height)
     {
-        m_Buffer = m_MemoryAllocator->Allocate(m_Width * m_Height);
+        m_Buffer = m_MemoryAllocator->Allocate(static_cast<size_t>(m_Width) * m_Height);
+    }
+
+    // Pixels owned by the caller e.g. a file mapping or shared memory, used in place without copy
+    Image(unsigned char* p_Buffer, int p_Width, int p_Height)
+        : m_Buffer(p_Buffer)
+        , m_IsBufferOwner(false)
+        , m_Width(p_Width)
+        , m_Height(p_Height)
+    {
     }
 
     ~Image()
     {
-        m_MemoryAllocator->Free(m_Buffer);
+        if (m_IsBufferOwner) m_MemoryAllocator->Free(m_Buffer);
     }
 
+    Image(const Image&) = delete;
+    Image& operator= (const Image&) = delete;
+
     unsigned char* GetPixelBufferPtr() { return reinterpret_cast<unsigned char*>(m_Buffer); }
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
     void PrintData();
 
 private:
     VM::MemoryAllocator* m_MemoryAllocator = &VM::MemoryAllocator::GetInstance();
     void* m_Buffer = nullptr;
+    bool m_IsBufferOwner = true;
 
     int m_Width  = 0;
     int m_Height = 0;
@@ -38,7 +53,7 @@ void Image::PrintData()
         std::cout << std::endl;
         for (int col = 0; col < m_Width; col++)
         {
-            std::cout << "[" << (int)imageData[row * m_Width + col] << "]" << ", ";
+            std::cout << "[" << (int)imageData[static_cast<size_t>(row) * m_Width + col] << "]" << ", ";
         }
     }
 }
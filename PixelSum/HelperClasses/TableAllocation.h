@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "MemoryAllocator.h"
+
+// Allocate a table from the preallocated virtual memory pools, fails when the pool of the size is exhausted
+template<typename T>
+static bool s_AllocateVirtualMemory(T*& p_Table, size_t p_ByteSize)
+{
+    p_Table = static_cast<T*>(VM::MemoryAllocator::GetInstance().Allocate(p_ByteSize));
+
+    return p_Table != nullptr;
+}
+
+// Return a table to its pool, the pointer is reset so a released table is never freed twice
+template<typename T>
+static void s_FreeVirtualMemory(T*& p_Table)
+{
+    if (p_Table)
+    {
+        VM::MemoryAllocator::GetInstance().Free(p_Table);
+    }
+
+    p_Table = nullptr;
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stddef.h>
+#include <cstring>
 #include <iostream>
 
 #include "CustomTypes.h"
@@ -13,13 +14,15 @@ constexpr const T& g_Clamp( const T& v, const T& low, const T& high )
     return (v < low) ? low : (high < v) ? high : v;
 }
 
-// Return total number of pixels for a valid search window, for invalid search window return 0
-static uint32_t inline s_ValidateSearchWindowClipCoords(int& x0, int& y0, int& x1, int& y1, const PixBufTLBR_i& sourcePixBufTLBR)
+// Return total number of pixels for a valid search window, for invalid search window return 0. The count is 64-bit
+// since the unclamped window of a large image can exceed 2^32 pixels. An empty image has a right or bottom of -1,
+// images of a single row or column are valid.
+static uint64_t inline s_ValidateSearchWindowClipCoords(int& x0, int& y0, int& x1, int& y1, const PixBufTLBR_i& sourcePixBufTLBR)
 {
-    if (sourcePixBufTLBR.right * sourcePixBufTLBR.bottom  == 0 ||
-        x1 < 0                                                 ||
-        x0 > sourcePixBufTLBR.right                            ||
-        y1 < 0                                                 ||
+    if (sourcePixBufTLBR.right < 0 || sourcePixBufTLBR.bottom < 0   ||
+        x1 < 0                                                     ||
+        x0 > sourcePixBufTLBR.right                                ||
+        y1 < 0                                                     ||
         y0 > sourcePixBufTLBR.bottom)
     {
         return 0;
@@ -29,7 +32,8 @@ static uint32_t inline s_ValidateSearchWindowClipCoords(int& x0, int& y0, int& x
     if (y1 < y0) { std::swap(y0, y1); }
 
     // Must compute the search window total pixel before clamping
-    const uint32_t searchWindowTotalPixels = (x1 - x0 + 1) * (y1 - y0 + 1);
+    const uint64_t searchWindowTotalPixels = static_cast<uint64_t>(static_cast<int64_t>(x1) - x0 + 1) *
+                                             static_cast<uint64_t>(static_cast<int64_t>(y1) - y0 + 1);
 
     x0 = g_Clamp(x0, 0, sourcePixBufTLBR.right);
     x1 = g_Clamp(x1, 0, sourcePixBufTLBR.right);
@@ -39,6 +43,41 @@ static uint32_t inline s_ValidateSearchWindowClipCoords(int& x0, int& y0, int& x
     return searchWindowTotalPixels; // searchWindowWidth * searchWindowHeight
 }
 
+// Rows of the padded tables are aligned to a cache line
+static constexpr size_t TABLE_CACHE_LINE_SIZE = 64;
+
+// Pitch, origin i.e. offset of the entry of pixel (0, 0), and allocation size in elements of a padded summed area
+// table with p_LanesPerPixel entries of p_ElementSize bytes per pixel. A cache line in front of the first pixel of
+// every row holds the zero column in its last entry and the first row is the zero row, the pixels stay aligned.
+static inline void s_ResolvePaddedTableGeometry(int p_Width, int p_Height, size_t p_LanesPerPixel, size_t p_ElementSize,
+                                                size_t& p_Pitch, size_t& p_Origin, size_t& p_ElementCount)
+{
+    const size_t lineElements = TABLE_CACHE_LINE_SIZE / p_ElementSize;
+    const size_t rowElements = static_cast<size_t>(p_Width) * p_LanesPerPixel;
+    size_t pitchLines = 1 + (rowElements + lineElements - 1) / lineElements;
+
+    // With an even number of cache lines per row (e.g. power of two widths) the entries of a column map to a
+    // few cache sets only, an odd pitch spreads the rows over all the sets
+    if (pitchLines % 2 == 0) pitchLines++;
+
+    p_Pitch = pitchLines * lineElements;
+    p_Origin = p_Pitch + lineElements;
+    p_ElementCount = p_Pitch * (static_cast<size_t>(p_Height) + 1);
+}
+
+// Zero row and the leading cache line of every pixel row of a padded table, the rest is written by the build
+template<typename T>
+static inline void s_ClearPaddedTableBorder(T* p_Table, size_t p_Pitch, size_t p_Origin, int p_Height)
+{
+    memset(p_Table, 0, p_Origin * sizeof(T));
+
+    const size_t leadElements = p_Origin - p_Pitch;
+    for (int row = 1; row < p_Height; row++)
+    {
+        memset(p_Table + (static_cast<size_t>(row) + 1) * p_Pitch, 0, leadElements * sizeof(T));
+    }
+}
+
 template<typename T>
 static void s_PrintSummedAreaMatrix(const T* p_SumArea, int p_Width, int p_Height)
 {
@@ -1,160 +1,1781 @@
 #include "PixelSum.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <condition_variable>
+#include <cstring>
 #include <immintrin.h>
 #include <iostream>
+#include <limits>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+
+#include "MemoryAllocator.h"
+#include "ScopedTimer.h"
+#include "UtilityFunctions.h"
+
+// Column tile width (in pixels) for fused build, the two scratch rows (2 x 4KB) comfortably fit in L1.
+static constexpr int FUSED_TILE_WIDTH = 1024;
+
+// Fallback when the platform does not report the last level cache size.
+static constexpr size_t DEFAULT_LAST_LEVEL_CACHE_SIZE = 8 * 1024 * 1024;
+
+// Query the last level cache size once, used for deciding when to bypass the cache with streaming stores.
+static size_t s_LastLevelCacheSize()
+{
+    static const size_t s_CacheSize = []() -> size_t
+    {
+        long cacheSize = 0;
+#if defined(__APPLE__)
+        size_t length = sizeof(cacheSize);
+        if (sysctlbyname("hw.l3cachesize", &cacheSize, &length, nullptr, 0) != 0 || cacheSize <= 0)
+        {
+            length = sizeof(cacheSize);
+            sysctlbyname("hw.l2cachesize", &cacheSize, &length, nullptr, 0);
+        }
+#elif defined(_SC_LEVEL3_CACHE_SIZE)
+        cacheSize = sysconf(_SC_LEVEL3_CACHE_SIZE);
+        if (cacheSize <= 0) cacheSize = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+        return (cacheSize > 0) ? static_cast<size_t>(cacheSize) : DEFAULT_LAST_LEVEL_CACHE_SIZE;
+    }();
+
+    return s_CacheSize;
+}
+
+// Pool blocks of the summed area tables, the interleaved layout has a single block
+struct PixelSumTableStorage
+{
+    uint32_t* sumAreaTable = nullptr;
+    uint32_t* sumAreaNonZeroTable = nullptr;
+    uint64_t* sumAreaTable64 = nullptr;
+    uint64_t* sumAreaNonZeroTable64 = nullptr;
+    uint64_t* sumAreaSquaredTable = nullptr;
+    uint32_t* sumAreaRotatedRightTable = nullptr;
+    uint32_t* sumAreaRotatedLeftTable = nullptr;
+
+    // Read-only file mapping of PixelSum::MapTables(..), the tables point into it and no pool block is allocated
+    void*  mappedAddress  = nullptr;
+    size_t mappedByteSize = 0;
+
+    ~PixelSumTableStorage()
+    {
+        if (mappedAddress)
+        {
+            munmap(mappedAddress, mappedByteSize);
+        }
+
+        void* tables[] = { sumAreaTable, sumAreaNonZeroTable, sumAreaTable64, sumAreaNonZeroTable64, sumAreaSquaredTable,
+                           sumAreaRotatedRightTable, sumAreaRotatedLeftTable };
+        for (void* table : tables)
+        {
+            if (table)
+            {
+                VM::MemoryAllocator::GetInstance().Free(table);
+            }
+        }
+    }
+};
+
+// Table file of PixelSum::SaveTables(..). The header is followed by the table allocations as they are in memory, in
+// the slot order of PixelSum::GetTableSlots(..), each payload starts at a multiple of PIXELSUM_FILE_ALIGNMENT. All
+// the fields are native endian, a file of another byte order is rejected through the byte order mark.
+static constexpr char     PIXELSUM_FILE_MAGIC[8]    = { 'P', 'I', 'X', 'S', 'U', 'M', 'T', 'B' };
+static constexpr uint32_t PIXELSUM_FILE_VERSION     = 1;
+static constexpr uint32_t PIXELSUM_FILE_BYTE_ORDER  = 0x01020304;
+static constexpr size_t   PIXELSUM_FILE_ALIGNMENT   = 16384; // Multiple of the 4 KB and 16 KB pages
+static constexpr int      PIXELSUM_FILE_TABLE_SLOTS = 7;
+
+struct PixelSumFileHeader
+{
+    char     magic[8];
+    uint32_t version;
+    uint32_t byteOrder;
+    int32_t  width;
+    int32_t  height;
+    uint32_t tableLayout;  // PixelSumTableLayout
+    uint32_t tablePadding; // PixelSumTablePadding
+    uint32_t accumulator;  // PixelSumAccumulator
+    uint32_t squaredSums;  // PixelSumSquaredSums
+    uint32_t rotatedSums;  // PixelSumRotatedSums
+    uint32_t reserved;
+    uint64_t payloadOffsets[PIXELSUM_FILE_TABLE_SLOTS];   // 0 for the tables of other configurations
+    uint64_t payloadByteSizes[PIXELSUM_FILE_TABLE_SLOTS];
+    uint64_t payloadChecksum; // s_FileChecksum(..) of the payloads chained in slot order
+    uint64_t headerChecksum;  // s_FileChecksum(..) of the header fields above
+};
+
+// Checksum for detecting corrupted or truncated files, not a cryptographic hash. Four independent lanes of
+// (h ^ word) x odd constant keep the multiplier busy, every step is a bijection so any changed word changes the
+// result.
+static uint64_t s_FileChecksum(const void* p_Data, size_t p_ByteSize, uint64_t p_Seed)
+{
+    static constexpr uint64_t PRIME = 0x9E3779B97F4A7C15ull;
+
+    const unsigned char* bytes = static_cast<const unsigned char*>(p_Data);
+    uint64_t lanes[4] = { p_Seed, p_Seed + PRIME, p_Seed ^ (PRIME >> 1), ~p_Seed };
+
+    size_t i = 0;
+    for (; i + 32 <= p_ByteSize; i += 32)
+    {
+        uint64_t words[4];
+        memcpy(words, bytes + i, sizeof(words));
+        for (int lane = 0; lane < 4; lane++)
+        {
+            lanes[lane] = (lanes[lane] ^ words[lane]) * PRIME;
+        }
+    }
+
+    // Handle left-over
+    for (; i < p_ByteSize; i++)
+    {
+        lanes[i % 4] = (lanes[i % 4] ^ bytes[i]) * PRIME;
+    }
+
+    uint64_t checksum = p_ByteSize;
+    for (uint64_t lane : lanes)
+    {
+        checksum = (checksum ^ lane ^ (lane >> 29)) * PRIME;
+    }
+
+    return checksum ^ (checksum >> 32);
+}
+
+// Pitch, origin i.e. offset of the entry of pixel (0, 0), and allocation size in elements of a summed area table
+static void s_ResolveTableGeometry(int p_Width, int p_Height, const PixelSumConfig& p_Config, size_t& p_Pitch, size_t& p_Origin,
+                                   size_t& p_ElementCount)
+{
+    const bool isWide = (p_Config.accumulator == PixelSumAccumulator::Wide64);
+    const bool isInterleaved = !isWide && (p_Config.tableLayout == PixelSumTableLayout::Interleaved);
+    const size_t elementSize = isWide ? sizeof(uint64_t) : sizeof(uint32_t);
+    const size_t lanesPerPixel = isInterleaved ? 2 : 1;
+
+    if (p_Config.tablePadding == PixelSumTablePadding::Packed)
+    {
+        p_Pitch = static_cast<size_t>(p_Width) * lanesPerPixel;
+        p_Origin = 0;
+        p_ElementCount = p_Pitch * p_Height;
+        return;
+    }
+
+    s_ResolvePaddedTableGeometry(p_Width, p_Height, lanesPerPixel, elementSize, p_Pitch, p_Origin, p_ElementCount);
+}
+
+// Minimum rows added to a lazy table at once, the queries just below the built rows do not take the lock again
+static constexpr int LAZY_BUILD_MIN_ROWS = 64;
+
+// Pixels per band of a frame read by a PixelSumRowReader, the band local tables are still in L2 when the carry is added
+static constexpr int STREAM_BAND_PIXELS = 64 * 1024;
+
+// Regions evaluated per batched query kernel call
+static constexpr size_t BATCH_QUERY_CHUNK_SIZE = 256;
+
+// Minimum rows per band and pixels per thread, smaller work does not amortize the thread launch.
+static constexpr int PARALLEL_MIN_BAND_ROWS = 64;
+static constexpr size_t PARALLEL_MIN_PIXELS_PER_THREAD = 256 * 1024;
+
+// Number of horizontal bands the SAT build is split into, one band per thread.
+static int s_ResolveBandCount(unsigned int p_ThreadCount, int p_Width, int p_Height)
+{
+    unsigned int threadCount = p_ThreadCount;
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const size_t pixelCount = static_cast<size_t>(p_Width) * p_Height;
+    const size_t maxBandsByPixels = std::max<size_t>(1, pixelCount / PARALLEL_MIN_PIXELS_PER_THREAD);
+    const size_t maxBandsByRows = std::max<size_t>(1, p_Height / PARALLEL_MIN_BAND_ROWS);
+
+    return static_cast<int>(std::min<size_t>(threadCount, std::min(maxBandsByPixels, maxBandsByRows)));
+}
+
+// Turn the band local summed area tables into the global ones. p_Planes point to the first pixel of each plane,
+// rows are p_PlanePitch elements apart. The carry of each band is the global SAT row
+// above it, i.e. the carry of the previous band plus the local last row of the previous band. This is a tiny
+// serial prefix over (bandCount x width) elements followed by a parallel fix-up where every row of a band
+// accumulates the carry. The first band is already final.
+template<typename T>
+static void s_AddBandCarries(void (*p_AddRow)(T*, const T*, int), T* const* p_Planes, int p_PlaneCount, size_t p_PlaneRowSize,
+                             size_t p_PlanePitch, const std::vector<int>& p_BandRowBegin);
+
+// Add a row of the rotated tables above, p_Shift rows higher, to a row of both rotated tables. The right table entry
+// (x, y) receives the entry (x + p_Shift, y - p_Shift) which is the row total past the right border, the left
+// table entry (x, y) receives the entry (x - p_Shift, y - p_Shift) which is 0 past the left border.
+static void s_AddRotatedRows(void (*p_AddRow)(uint32_t*, const uint32_t*, int), uint32_t* p_RightRow, uint32_t* p_LeftRow,
+                             const uint32_t* p_RightAbove, const uint32_t* p_LeftAbove, int p_Width, int p_Shift)
+{
+    const int shiftedCount = std::max(0, p_Width - p_Shift);
+
+    p_AddRow(p_RightRow, p_RightAbove + (p_Width - shiftedCount), shiftedCount);
+    for (int x = shiftedCount; x < p_Width; x++)
+    {
+        p_RightRow[x] += p_RightAbove[p_Width - 1];
+    }
+
+    p_AddRow(p_LeftRow + (p_Width - shiftedCount), p_LeftAbove, shiftedCount);
+}
+
+// Rotated tables version of s_AddBandCarries(..). The carry of a band is the global row above it, every row of the
+// band receives the carry shifted by its distance to the carry row.
+static void s_AddRotatedBandCarries(void (*p_AddRow)(uint32_t*, const uint32_t*, int), uint32_t* p_RightPlane, uint32_t* p_LeftPlane,
+                                    int p_Width, size_t p_PlanePitch, const std::vector<int>& p_BandRowBegin);
+
+// Execute p_Task(0 .. p_TaskCount - 1) with one thread per task, the calling thread executes the first task.
+template<typename Task>
+static void s_ParallelFor(int p_TaskCount, const Task& p_Task)
+{
+    if (p_TaskCount <= 0) return;
+
+    std::vector<std::thread> workers;
+    workers.reserve(p_TaskCount - 1);
+    for (int task = 1; task < p_TaskCount; task++)
+    {
+        workers.emplace_back([&p_Task, task]() { p_Task(task); });
+    }
+
+    p_Task(0);
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+PixelSum::PixelSum(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, const PixelSumConfig& p_Config)
+    : m_SourcePixBufTLBR(0 /*Top Coord*/, 0/*Left Coord*/, p_YHeight - 1/*Bottom Coord*/, p_XWidth - 1/*Right Coord*/)
+    , m_Config(p_Config)
+{
+    if (p_XWidth <= 0 || p_YHeight <= 0) return;
+
+    // The 64-bit tables are only built planar, the lazy tables are built independently of each other
+    if (IsWideAccumulator() || IsLazy()) m_Config.tableLayout = PixelSumTableLayout::Planar;
+
+    ResolveTableGeometries(p_XWidth, p_YHeight);
+
+    // Pixel Sum Allocations are made from preallocated virtual memory
+    // This helps in quick allocation and deallocation of pixel sum preventing performance hiches
+    // that can cause by constant allocation and deallocation Pixel Sum class objects.
+    if (!AllocateSumAreaTables()) return;
+
+    // The tables are built by the first queries
+    if (IsLazy())
+    {
+        m_PixelBuffer = p_Buffer;
+        return;
+    }
+
+    // SIMD kernels for the host CPU, selected once through CPUID dispatch
+    const PixelSumKernels& kernels = PixelSumKernels::Get(m_Config.simdLevel);
+
+    ComputePixelSumParallel(kernels, p_Buffer);
+
+    m_BuiltRowCount[0] = m_BuiltRowCount[1] = m_BuiltRowCount[2] = m_BuiltRowCount[3] = p_YHeight;
+}
+
+PixelSum::~PixelSum()
+{
+    // Free the memory, this memory will return back to Virtual Memory free stack,
+    // where it can be efficiently reused again and again without
+
+    FreeSumAreaTables();
+}
+
+PixelSum::PixelSum(const PixelSum& p_PixelSum)
+{
+    m_SourcePixBufTLBR = p_PixelSum.m_SourcePixBufTLBR;
+    m_Config = p_PixelSum.m_Config;
+    m_TablePitch = p_PixelSum.m_TablePitch;
+    m_TableOrigin = p_PixelSum.m_TableOrigin;
+    m_TableElementCount = p_PixelSum.m_TableElementCount;
+    m_SquaredTablePitch = p_PixelSum.m_SquaredTablePitch;
+    m_SquaredTableOrigin = p_PixelSum.m_SquaredTableOrigin;
+    m_SquaredTableElementCount = p_PixelSum.m_SquaredTableElementCount;
+    m_RotatedTablePitch = p_PixelSum.m_RotatedTablePitch;
+    m_RotatedTableOrigin = p_PixelSum.m_RotatedTableOrigin;
+    m_RotatedTableElementCount = p_PixelSum.m_RotatedTableElementCount;
+
+    // Shared tables are immutable, the lazy build of the source is completed first
+    if (p_PixelSum.m_TableStorage && m_Config.tableSharing == PixelSumTableSharing::CopyOnWrite)
+    {
+        p_PixelSum.EnsureTableRows(PixelSumOperationType::SummedAreaTable, m_SourcePixBufTLBR.bottom);
+        p_PixelSum.EnsureTableRows(PixelSumOperationType::NonZeroElementCount, m_SourcePixBufTLBR.bottom);
+        if (HasSquaredSums()) p_PixelSum.EnsureTableRows(PixelSumOperationType::SquaredSum, m_SourcePixBufTLBR.bottom);
+        if (HasRotatedSums()) p_PixelSum.EnsureTableRows(PixelSumOperationType::RotatedSum, m_SourcePixBufTLBR.bottom);
+    }
+
+    // Rows built after the copy are not shared, the copy continues the lazy build on its own
+    std::lock_guard<std::mutex> lock(p_PixelSum.m_LazyBuildMutex);
+    m_PixelBuffer = p_PixelSum.m_PixelBuffer;
+    m_BuiltRowCount[0] = p_PixelSum.m_BuiltRowCount[0].load();
+    m_BuiltRowCount[1] = p_PixelSum.m_BuiltRowCount[1].load();
+    m_BuiltRowCount[2] = p_PixelSum.m_BuiltRowCount[2].load();
+    m_BuiltRowCount[3] = p_PixelSum.m_BuiltRowCount[3].load();
+
+    // Deep copy the sum areas pixel buffer and the non-zero elements sum areas
+    CopySumAreaTables(p_PixelSum);
+}
+
+PixelSum& PixelSum::operator=(const PixelSum& p_PixelSum)
+{
+    if (this != &p_PixelSum)
+    {
+        // 1. Free the existing summed area matrixes if object is being reassigned
+        FreeSumAreaTables();
+
+        // 2. Overwrite the pixel buffer top-left and bottom-right
+        m_SourcePixBufTLBR = p_PixelSum.m_SourcePixBufTLBR;
+        m_Config = p_PixelSum.m_Config;
+        m_TablePitch = p_PixelSum.m_TablePitch;
+        m_TableOrigin = p_PixelSum.m_TableOrigin;
+        m_TableElementCount = p_PixelSum.m_TableElementCount;
+        m_SquaredTablePitch = p_PixelSum.m_SquaredTablePitch;
+        m_SquaredTableOrigin = p_PixelSum.m_SquaredTableOrigin;
+        m_SquaredTableElementCount = p_PixelSum.m_SquaredTableElementCount;
+        m_RotatedTablePitch = p_PixelSum.m_RotatedTablePitch;
+        m_RotatedTableOrigin = p_PixelSum.m_RotatedTableOrigin;
+        m_RotatedTableElementCount = p_PixelSum.m_RotatedTableElementCount;
+
+        if (p_PixelSum.m_TableStorage && m_Config.tableSharing == PixelSumTableSharing::CopyOnWrite)
+        {
+            p_PixelSum.EnsureTableRows(PixelSumOperationType::SummedAreaTable, m_SourcePixBufTLBR.bottom);
+            p_PixelSum.EnsureTableRows(PixelSumOperationType::NonZeroElementCount, m_SourcePixBufTLBR.bottom);
+            if (HasSquaredSums()) p_PixelSum.EnsureTableRows(PixelSumOperationType::SquaredSum, m_SourcePixBufTLBR.bottom);
+            if (HasRotatedSums()) p_PixelSum.EnsureTableRows(PixelSumOperationType::RotatedSum, m_SourcePixBufTLBR.bottom);
+        }
+
+        std::lock_guard<std::mutex> lock(p_PixelSum.m_LazyBuildMutex);
+        m_PixelBuffer = p_PixelSum.m_PixelBuffer;
+        m_BuiltRowCount[0] = p_PixelSum.m_BuiltRowCount[0].load();
+        m_BuiltRowCount[1] = p_PixelSum.m_BuiltRowCount[1].load();
+        m_BuiltRowCount[2] = p_PixelSum.m_BuiltRowCount[2].load();
+        m_BuiltRowCount[3] = p_PixelSum.m_BuiltRowCount[3].load();
+
+        // Perform Deep copy for both summed area matrix
+        CopySumAreaTables(p_PixelSum);
+    }
+
+    return *this;
+}
+
+PixelSum::PixelSum(PixelSum&& p_PixelSum) noexcept
+{
+    *this = std::move(p_PixelSum);
+}
+
+PixelSum& PixelSum::operator=(PixelSum&& p_PixelSum) noexcept
+{
+    if (this != &p_PixelSum)
+    {
+        FreeSumAreaTables();
+
+        m_SourcePixBufTLBR = p_PixelSum.m_SourcePixBufTLBR;
+        m_Config = p_PixelSum.m_Config;
+        m_TablePitch = p_PixelSum.m_TablePitch;
+        m_TableOrigin = p_PixelSum.m_TableOrigin;
+        m_TableElementCount = p_PixelSum.m_TableElementCount;
+        m_SquaredTablePitch = p_PixelSum.m_SquaredTablePitch;
+        m_SquaredTableOrigin = p_PixelSum.m_SquaredTableOrigin;
+        m_SquaredTableElementCount = p_PixelSum.m_SquaredTableElementCount;
+        m_RotatedTablePitch = p_PixelSum.m_RotatedTablePitch;
+        m_RotatedTableOrigin = p_PixelSum.m_RotatedTableOrigin;
+        m_RotatedTableElementCount = p_PixelSum.m_RotatedTableElementCount;
+        m_PixelBuffer = p_PixelSum.m_PixelBuffer;
+        m_BuiltRowCount[0] = p_PixelSum.m_BuiltRowCount[0].load();
+        m_BuiltRowCount[1] = p_PixelSum.m_BuiltRowCount[1].load();
+        m_BuiltRowCount[2] = p_PixelSum.m_BuiltRowCount[2].load();
+        m_BuiltRowCount[3] = p_PixelSum.m_BuiltRowCount[3].load();
+
+        // The pool blocks change owner, nothing is allocated or copied
+        m_TableStorage = std::move(p_PixelSum.m_TableStorage);
+        m_SumAreaTable = p_PixelSum.m_SumAreaTable;
+        m_SumAreaNonZeroTable = p_PixelSum.m_SumAreaNonZeroTable;
+        m_SumAreaTable64 = p_PixelSum.m_SumAreaTable64;
+        m_SumAreaNonZeroTable64 = p_PixelSum.m_SumAreaNonZeroTable64;
+        m_SumAreaSquaredTable = p_PixelSum.m_SumAreaSquaredTable;
+        m_SumAreaRotatedRightTable = p_PixelSum.m_SumAreaRotatedRightTable;
+        m_SumAreaRotatedLeftTable = p_PixelSum.m_SumAreaRotatedLeftTable;
+
+        p_PixelSum.FreeSumAreaTables();
+        p_PixelSum.m_PixelBuffer = nullptr;
+        p_PixelSum.m_BuiltRowCount[0] = p_PixelSum.m_BuiltRowCount[1] = p_PixelSum.m_BuiltRowCount[2] = p_PixelSum.m_BuiltRowCount[3] = 0;
+    }
+
+    return *this;
+}
+
+bool PixelSum::Rebuild(const unsigned char* p_Buffer)
+{
+    if (!p_Buffer || (!m_SumAreaTable && !m_SumAreaTable64)) return false;
+
+    // Tables shared with copies are replaced, not copied, every entry is about to be overwritten
+    if (!DetachSharedTables(false)) return false;
+
+    if (IsLazy())
+    {
+        m_PixelBuffer = p_Buffer;
+        m_BuiltRowCount[0] = m_BuiltRowCount[1] = m_BuiltRowCount[2] = m_BuiltRowCount[3] = 0;
+        return true;
+    }
+
+    // Every table entry is overwritten by the build, the zero border of the padded tables is never written
+    ComputePixelSumParallel(PixelSumKernels::Get(m_Config.simdLevel), p_Buffer);
+
+    return true;
+}
+
+bool PixelSum::Rebuild(unsigned char* p_Buffer, const PixelSumRowReader& p_ReadRows)
+{
+    if (!p_Buffer || !p_ReadRows || (!m_SumAreaTable && !m_SumAreaTable64)) return false;
+
+    if (!DetachSharedTables(false)) return false;
+
+    const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
+    const int srcPixBufHeight = m_SourcePixBufTLBR.height();
+    const int bandRowCount = std::max(1, std::min(srcPixBufHeight, STREAM_BAND_PIXELS / srcPixBufWidth));
+
+    std::mutex readMutex;
+    std::condition_variable readCondition;
+    int readRowCount = 0;
+    bool isReadFailed = false;
+
+    // The reader publishes every band once its rows are complete
+    std::thread reader([&]()
+    {
+        for (int rowBegin = 0; rowBegin < srcPixBufHeight; rowBegin += bandRowCount)
+        {
+            const int rowEnd = std::min(rowBegin + bandRowCount, srcPixBufHeight);
+            const bool isRead = p_ReadRows(p_Buffer + static_cast<size_t>(rowBegin) * srcPixBufWidth, rowBegin, rowEnd);
+            {
+                std::lock_guard<std::mutex> lock(readMutex);
+                if (isRead) readRowCount = rowEnd;
+                else        isReadFailed = true;
+            }
+            readCondition.notify_one();
+
+            if (!isRead) return;
+        }
+    });
+
+    const auto waitForRows = [&](int p_RowEnd)
+    {
+        std::unique_lock<std::mutex> lock(readMutex);
+        readCondition.wait(lock, [&]() { return readRowCount >= p_RowEnd || isReadFailed; });
+        return !isReadFailed;
+    };
+
+    bool isComplete = true;
+    if (IsLazy())
+    {
+        isComplete = waitForRows(srcPixBufHeight);
+        m_PixelBuffer = p_Buffer;
+        m_BuiltRowCount[0] = m_BuiltRowCount[1] = m_BuiltRowCount[2] = m_BuiltRowCount[3] = 0;
+    }
+    else
+    {
+        // Band local tables of the arrived band, then the carry of the band above while the band is in cache
+        const PixelSumKernels& kernels = PixelSumKernels::Get(m_Config.simdLevel);
+        for (int rowBegin = 0; rowBegin < srcPixBufHeight && isComplete; rowBegin += bandRowCount)
+        {
+            const int rowEnd = std::min(rowBegin + bandRowCount, srcPixBufHeight);
+            isComplete = waitForRows(rowEnd);
+            if (!isComplete) break;
+
+            if (IsWideAccumulator())
+            {
+                ComputePixelSumBandWide(kernels, p_Buffer, rowBegin, rowEnd);
+            }
+            else
+            {
+                ComputePixelSumBand(kernels, p_Buffer, rowBegin, rowEnd);
+            }
+
+            if (rowBegin > 0) AddBandCarries(kernels, { rowBegin - bandRowCount, rowBegin, rowEnd });
+        }
+    }
+
+    reader.join();
+
+    return isComplete;
+}
+
+PixelSumRegionStats PixelSum::GetRegionStats(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    PixelSumRegionStats regionStats;
+
+    // Single clip for all the statistics
+    const uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+    if (searchWindowPixelCount == 0) return regionStats;
+
+    // With the interleaved layout the second table reads the same four cache lines as the first one
+    const uint64_t pixelSum     = ComputeRegionSum(PixelSumOperationType::SummedAreaTable, p_X0, p_Y0, p_X1, p_Y1);
+    const uint64_t nonZeroCount = ComputeRegionSum(PixelSumOperationType::NonZeroElementCount, p_X0, p_Y0, p_X1, p_Y1);
+
+    regionStats.pixelSum       = static_cast<unsigned int>(pixelSum);
+    regionStats.nonZeroCount   = static_cast<int>(nonZeroCount);
+    regionStats.pixelAverage   = pixelSum / static_cast<double>(searchWindowPixelCount);
+    regionStats.nonZeroAverage = nonZeroCount / static_cast<double>(searchWindowPixelCount);
+
+    if (HasSquaredSums())
+    {
+        const uint64_t squaredSum = ComputeRegionSum(PixelSumOperationType::SquaredSum, p_X0, p_Y0, p_X1, p_Y1);
+        regionStats.pixelVariance = ComputeVariance(pixelSum, squaredSum, searchWindowPixelCount);
+    }
+
+    return regionStats;
+}
+
+unsigned int PixelSum::GetPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return static_cast<unsigned int>(ComputeRegionSum(PixelSumOperationType::SummedAreaTable, p_X0, p_Y0, p_X1, p_Y1));
+}
+
+double PixelSum::GetPixelAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+
+    if (searchWindowPixelCount == 0) return 0.0; // Prevent return Nan
+
+    return ComputeRegionSum(PixelSumOperationType::SummedAreaTable, p_X0, p_Y0, p_X1, p_Y1) / static_cast<double>(searchWindowPixelCount);
+}
+
+int PixelSum::GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return static_cast<int>(ComputeRegionSum(PixelSumOperationType::NonZeroElementCount, p_X0, p_Y0, p_X1, p_Y1));
+}
+
+double PixelSum::GetNonZeroAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+
+    if (searchWindowPixelCount == 0) return 0.0;
+
+    return ComputeRegionSum(PixelSumOperationType::NonZeroElementCount, p_X0, p_Y0, p_X1, p_Y1) / static_cast<double>(searchWindowPixelCount);
+}
+
+uint64_t PixelSum::GetPixelSum64(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return ComputeRegionSum(PixelSumOperationType::SummedAreaTable, p_X0, p_Y0, p_X1, p_Y1);
+}
+
+uint64_t PixelSum::GetNonZeroCount64(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return ComputeRegionSum(PixelSumOperationType::NonZeroElementCount, p_X0, p_Y0, p_X1, p_Y1);
+}
+
+double PixelSum::GetPixelVariance(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    const uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+
+    if (searchWindowPixelCount == 0 || !HasSquaredSums()) return 0.0;
+
+    const uint64_t pixelSum = ComputeRegionSum(PixelSumOperationType::SummedAreaTable, p_X0, p_Y0, p_X1, p_Y1);
+    const uint64_t squaredSum = ComputeRegionSum(PixelSumOperationType::SquaredSum, p_X0, p_Y0, p_X1, p_Y1);
+
+    return ComputeVariance(pixelSum, squaredSum, searchWindowPixelCount);
+}
+
+double PixelSum::GetPixelStdDev(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    return std::sqrt(GetPixelVariance(p_X0, p_Y0, p_X1, p_Y1));
+}
+
+uint64_t PixelSum::GetSquaredPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return ComputeRegionSum(PixelSumOperationType::SquaredSum, p_X0, p_Y0, p_X1, p_Y1);
+}
+
+unsigned int PixelSum::GetRotatedPixelSum(int p_X, int p_Y, int p_Width, int p_Height) const
+{
+    if (!m_SumAreaRotatedRightTable || p_Width <= 0 || p_Height <= 0) return 0;
+
+    // Rows of the bottom corner, 64-bit since the corners can be far outside the image
+    const int64_t x = p_X, y = p_Y, width = p_Width, height = p_Height;
+    const int64_t bottomRow = y + width + height - 1;
+    if (bottomRow < 0 || y > m_SourcePixBufTLBR.bottom) return 0;
+
+    // The corners below the image read the last row
+    EnsureTableRows(PixelSumOperationType::RotatedSum, static_cast<int>(std::min<int64_t>(bottomRow, m_SourcePixBufTLBR.bottom)));
+
+    // The rectangle is D - C - B + A of the triangles just outside of its corners
+    return ComputeRotatedTriangleSum(x + width - height, bottomRow)     // Region D => below the bottom corner
+         - ComputeRotatedTriangleSum(x - height, y + height - 1)      // Region C => left of the left corner
+         - ComputeRotatedTriangleSum(x + width, y + width - 1)        // Region B => right of the right corner
+         + ComputeRotatedTriangleSum(x, y - 1);                       // Region A => above the top corner
+}
+
+uint32_t PixelSum::ComputeRotatedTriangleSum(int64_t p_X, int64_t p_Y) const
+{
+    const int64_t width = m_SourcePixBufTLBR.width();
+
+    // Points of the image (and the row above it) read both tables directly, the left table has a zero column
+    if (p_X >= 0 && p_X < width && p_Y >= -1 && p_Y <= m_SourcePixBufTLBR.bottom)
+    {
+        const ptrdiff_t rowOffset = static_cast<ptrdiff_t>(m_RotatedTableOrigin) + static_cast<ptrdiff_t>(p_Y) * static_cast<ptrdiff_t>(m_RotatedTablePitch);
+        return m_SumAreaRotatedRightTable[rowOffset + p_X] - m_SumAreaRotatedLeftTable[rowOffset + p_X - 1];
+    }
+
+    return RotatedRightTableEntry(p_X, p_Y) - RotatedLeftTableEntry(p_X - 1, p_Y);
+}
+
+uint32_t PixelSum::RotatedRightTableEntry(int64_t p_X, int64_t p_Y) const
+{
+    if (p_Y < 0) return 0;
+
+    // Below the image the diagonal continues from the last row
+    const int64_t bottom = m_SourcePixBufTLBR.bottom;
+    if (p_Y > bottom)
+    {
+        p_X += p_Y - bottom;
+        p_Y = bottom;
+    }
+
+    // Right of the image every row prefix is the row total, left of it the diagonal starts in column 0
+    if (p_X > m_SourcePixBufTLBR.right)
+    {
+        p_X = m_SourcePixBufTLBR.right;
+    }
+    else if (p_X < 0)
+    {
+        p_Y += p_X;
+        p_X = 0;
+        if (p_Y < 0) return 0;
+    }
+
+    return m_SumAreaRotatedRightTable[m_RotatedTableOrigin + static_cast<size_t>(p_Y) * m_RotatedTablePitch + static_cast<size_t>(p_X)];
+}
+
+uint32_t PixelSum::RotatedLeftTableEntry(int64_t p_X, int64_t p_Y) const
+{
+    if (p_Y < 0) return 0;
+
+    const int64_t bottom = m_SourcePixBufTLBR.bottom;
+    if (p_Y > bottom)
+    {
+        p_X -= p_Y - bottom;
+        p_Y = bottom;
+    }
+
+    // Left of the image every row prefix is 0
+    if (p_X < 0) return 0;
+
+    const int64_t right = m_SourcePixBufTLBR.right;
+    if (p_X > right)
+    {
+        // The last d rows contribute their row totals i.e. the right table difference in the last column, the
+        // rows above meet the image on the last column d rows higher
+        const int64_t d = p_X - right;
+        return RotatedLeftTableEntry(right, p_Y - d) + RotatedRightTableEntry(right, p_Y) - RotatedRightTableEntry(right, p_Y - d);
+    }
+
+    return m_SumAreaRotatedLeftTable[m_RotatedTableOrigin + static_cast<size_t>(p_Y) * m_RotatedTablePitch + static_cast<size_t>(p_X)];
+}
+
+double PixelSum::ComputeVariance(uint64_t p_PixelSum, uint64_t p_SquaredSum, uint64_t p_PixelCount)
+{
+    if (p_PixelCount == 0) return 0.0;
+
+    // n * S2 - S^2 >= 0, the 128-bit products avoid the cancellation of S2 / n - (S / n)^2 in doubles
+    const unsigned __int128 numerator = static_cast<unsigned __int128>(p_PixelCount) * p_SquaredSum -
+                                        static_cast<unsigned __int128>(p_PixelSum) * p_PixelSum;
+    const double pixelCount = static_cast<double>(p_PixelCount);
+
+    return static_cast<double>(numerator) / pixelCount / pixelCount;
+}
+
+size_t PixelSum::GetTableByteSize(int p_Width, int p_Height, const PixelSumConfig& p_Config)
+{
+    if (p_Width <= 0 || p_Height <= 0) return 0;
+
+    size_t pitch = 0, origin = 0, elementCount = 0;
+    s_ResolveTableGeometry(p_Width, p_Height, p_Config, pitch, origin, elementCount);
+
+    return elementCount * ((p_Config.accumulator == PixelSumAccumulator::Wide64) ? sizeof(uint64_t) : sizeof(uint32_t));
+}
+
+uint64_t PixelSum::ComputeRegionSum(PixelSumOperationType p_OperationType, int x0, int y0, int x1, int y1) const
+{
+    if (p_OperationType == PixelSumOperationType::SquaredSum && !m_SumAreaSquaredTable) return 0;
+
+    EnsureTableRows(p_OperationType, y1);
+
+    if (p_OperationType == PixelSumOperationType::SquaredSum)
+    {
+        return ComputeSumAreaForSearchWindow<uint64_t>(x0, y0, x1, y1, m_SumAreaSquaredTable, m_SquaredTablePitch, m_SquaredTableOrigin, 1);
+    }
+
+    const bool isNonZero = (p_OperationType == PixelSumOperationType::NonZeroElementCount);
+    if (IsWideAccumulator())
+    {
+        return ComputeSumAreaForSearchWindow<uint64_t>(x0, y0, x1, y1, isNonZero ? m_SumAreaNonZeroTable64 : m_SumAreaTable64,
+                                                       m_TablePitch, m_TableOrigin, TableStride());
+    }
+
+    return ComputeSumAreaForSearchWindow<uint32_t>(x0, y0, x1, y1, isNonZero ? m_SumAreaNonZeroTable : m_SumAreaTable,
+                                                   m_TablePitch, m_TableOrigin, TableStride());
+}
+
+void PixelSum::ComputePixelSumBand(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd)
+{
+    const size_t bandOffset = static_cast<size_t>(p_RowBegin) * m_SourcePixBufTLBR.width();
+    const size_t bandTableOffset = m_TableOrigin + static_cast<size_t>(p_RowBegin) * m_TablePitch;
+    const int bandRowCount = p_RowEnd - p_RowBegin;
+
+    // Rotated tables, their rows depend on the diagonal neighbours above so they are built row by row
+    ComputeRotatedSumRows(p_Kernels, p_PixelBuffer, p_RowBegin, p_RowEnd, true);
+
+    // The interleaved layout is only produced by the fused build, the two pass kernels work on planar rows
+    if (m_Config.buildMode == PixelSumBuildMode::FusedTiled || m_Config.tableLayout == PixelSumTableLayout::Interleaved)
+    {
+        // Both summed matrixes in one pass over the pixel buffer
+        ComputePixelSumFused(p_Kernels, p_PixelBuffer + bandOffset, p_RowBegin, bandRowCount);
+        return;
+    }
+
+    // The summed matrix pixel buffer
+    ComputePixelSum<uint32_t>(p_Kernels, PixelSumOperationType::SummedAreaTable, p_PixelBuffer + bandOffset, m_SumAreaTable + bandTableOffset, bandRowCount);
+
+    // Non-Zero Element summed matrix
+    ComputePixelSum<uint32_t>(p_Kernels, PixelSumOperationType::NonZeroElementCount, p_PixelBuffer + bandOffset, m_SumAreaNonZeroTable + bandTableOffset, bandRowCount);
+
+    // Squared pixel summed matrix, single pass over the rows
+    ComputeSquaredSumRows(p_Kernels, p_PixelBuffer, p_RowBegin, p_RowEnd, true);
+}
+
+void PixelSum::ComputePixelSumBandWide(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd)
+{
+    const size_t srcPixBufWidth = m_SourcePixBufTLBR.width();
+
+    // u32 horizontal prefix of the current row, widened into the u64 tables
+    std::vector<uint32_t> rowPrefix(srcPixBufWidth);
+
+    uint64_t* tables[] = { m_SumAreaTable64, m_SumAreaNonZeroTable64 };
+    uint32_t (*prefixScanRows[])(const uint8_t*, uint32_t*, int) = { p_Kernels.prefixSumRow, p_Kernels.prefixNonZeroRow };
+
+    for (int row = p_RowBegin; row < p_RowEnd; row++)
+    {
+        const size_t rowOffset = static_cast<size_t>(row) * srcPixBufWidth;
+        for (int table = 0; table < 2; table++)
+        {
+            prefixScanRows[table](p_PixelBuffer + rowOffset, rowPrefix.data(), static_cast<int>(srcPixBufWidth));
+
+            // The first row of the band has no row above, band carries are added afterwards
+            uint64_t* sumAreaRow = tables[table] + m_TableOrigin + static_cast<size_t>(row) * m_TablePitch;
+            p_Kernels.accumulateRowWide(sumAreaRow, (row == p_RowBegin) ? nullptr : sumAreaRow - m_TablePitch,
+                                        rowPrefix.data(), static_cast<int>(srcPixBufWidth));
+        }
+
+        // Squares and rotated rows of the same row while it is in L1
+        ComputeSquaredSumRows(p_Kernels, p_PixelBuffer, row, row + 1, row == p_RowBegin);
+        ComputeRotatedSumRows(p_Kernels, p_PixelBuffer, row, row + 1, row == p_RowBegin);
+    }
+}
+
+void PixelSum::ComputeSquaredSumRows(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd, bool p_IsBandStart) const
+{
+    if (!m_SumAreaSquaredTable) return;
+
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+    for (int row = p_RowBegin; row < p_RowEnd; row++)
+    {
+        uint64_t* squaredRow = m_SumAreaSquaredTable + m_SquaredTableOrigin + static_cast<size_t>(row) * m_SquaredTablePitch;
+        const bool hasRowAbove = (row > p_RowBegin) || !p_IsBandStart;
+
+        p_Kernels.accumulateSquareRow(p_PixelBuffer + static_cast<size_t>(row) * srcPixBufWidth, squaredRow,
+                                      hasRowAbove ? squaredRow - m_SquaredTablePitch : nullptr, srcPixBufWidth, 0);
+    }
+}
+
+void PixelSum::ComputeRotatedSumRows(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd, bool p_IsBandStart) const
+{
+    if (!m_SumAreaRotatedRightTable || !m_SumAreaRotatedLeftTable) return;
+
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+    for (int row = p_RowBegin; row < p_RowEnd; row++)
+    {
+        const size_t rowOffset = m_RotatedTableOrigin + static_cast<size_t>(row) * m_RotatedTablePitch;
+        uint32_t* rightRow = m_SumAreaRotatedRightTable + rowOffset;
+        uint32_t* leftRow = m_SumAreaRotatedLeftTable + rowOffset;
+
+        // Both tables start from the row prefix, then take the diagonal neighbours of the row above
+        p_Kernels.prefixSumRow(p_PixelBuffer + static_cast<size_t>(row) * srcPixBufWidth, rightRow, srcPixBufWidth);
+        memcpy(leftRow, rightRow, srcPixBufWidth * sizeof(uint32_t));
+
+        const bool hasRowAbove = (row > p_RowBegin) || !p_IsBandStart;
+        if (hasRowAbove)
+        {
+            s_AddRotatedRows(p_Kernels.addRow, rightRow, leftRow, rightRow - m_RotatedTablePitch, leftRow - m_RotatedTablePitch, srcPixBufWidth, 1);
+        }
+    }
+}
+
+void PixelSum::ComputePixelSumParallel(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer)
+{
+    if (!p_PixelBuffer) return;
+
+    const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
+    const int srcPixBufHeight = m_SourcePixBufTLBR.height();
+
+    const int bandCount = s_ResolveBandCount(m_Config.threadCount, srcPixBufWidth, srcPixBufHeight);
+
+    // Equal height bands, the first (height % bandCount) bands take one extra row
+    std::vector<int> bandRowBegin(bandCount + 1, 0);
+    for (int band = 0; band < bandCount; band++)
+    {
+        bandRowBegin[band + 1] = bandRowBegin[band] + (srcPixBufHeight / bandCount) + (band < (srcPixBufHeight % bandCount) ? 1 : 0);
+    }
+
+    // 1. Band local summed area tables, the calling thread builds the first band
+    s_ParallelFor(bandCount, [&](int p_Band)
+    {
+        if (IsWideAccumulator())
+        {
+            ComputePixelSumBandWide(p_Kernels, p_PixelBuffer, bandRowBegin[p_Band], bandRowBegin[p_Band + 1]);
+        }
+        else
+        {
+            ComputePixelSumBand(p_Kernels, p_PixelBuffer, bandRowBegin[p_Band], bandRowBegin[p_Band + 1]);
+        }
+    });
+
+    if (bandCount <= 1) return;
+
+    // 2. Carry fix-up
+    AddBandCarries(p_Kernels, bandRowBegin);
+}
+
+void PixelSum::AddBandCarries(const PixelSumKernels& p_Kernels, const std::vector<int>& p_BandRowBegin)
+{
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+
+    if (m_SumAreaSquaredTable)
+    {
+        uint64_t* squaredPlanes[] = { m_SumAreaSquaredTable + m_SquaredTableOrigin };
+        s_AddBandCarries(p_Kernels.addRowWide, squaredPlanes, 1, static_cast<size_t>(srcPixBufWidth), m_SquaredTablePitch, p_BandRowBegin);
+    }
+
+    if (m_SumAreaRotatedRightTable)
+    {
+        s_AddRotatedBandCarries(p_Kernels.addRow, m_SumAreaRotatedRightTable + m_RotatedTableOrigin, m_SumAreaRotatedLeftTable + m_RotatedTableOrigin,
+                                srcPixBufWidth, m_RotatedTablePitch, p_BandRowBegin);
+    }
+
+    // Works on table planes. Planar layout has two planes of width elements per row, the interleaved layout has a
+    // single plane of 2 x width elements per row (sum and non-zero pairs).
+    if (IsWideAccumulator())
+    {
+        uint64_t* planes[] = { m_SumAreaTable64 + m_TableOrigin, m_SumAreaNonZeroTable64 + m_TableOrigin };
+        s_AddBandCarries(p_Kernels.addRowWide, planes, 2, static_cast<size_t>(srcPixBufWidth), m_TablePitch, p_BandRowBegin);
+        return;
+    }
+
+    const bool isInterleaved = (m_Config.tableLayout == PixelSumTableLayout::Interleaved);
+    uint32_t* planes[] = { m_SumAreaTable + m_TableOrigin, m_SumAreaNonZeroTable + m_TableOrigin };
+    s_AddBandCarries(p_Kernels.addRow, planes, isInterleaved ? 1 : 2, static_cast<size_t>(srcPixBufWidth) * TableStride(), m_TablePitch, p_BandRowBegin);
+}
+
+template<typename T>
+static void s_AddBandCarries(void (*p_AddRow)(T*, const T*, int), T* const* p_Planes, int p_PlaneCount, size_t p_PlaneRowSize,
+                             size_t p_PlanePitch, const std::vector<int>& p_BandRowBegin)
+{
+    const int bandCount = static_cast<int>(p_BandRowBegin.size()) - 1;
+
+    std::vector<T> carries(static_cast<size_t>(p_PlaneCount) * bandCount * p_PlaneRowSize, 0);
+    for (int plane = 0; plane < p_PlaneCount; plane++)
+    {
+        T* planeCarries = &carries[static_cast<size_t>(plane) * bandCount * p_PlaneRowSize];
+        for (int band = 1; band < bandCount; band++)
+        {
+            const size_t lastRowOffset = static_cast<size_t>(p_BandRowBegin[band] - 1) * p_PlanePitch;
+            T* bandCarry = planeCarries + band * p_PlaneRowSize;
+
+            memcpy(bandCarry, bandCarry - p_PlaneRowSize, p_PlaneRowSize * sizeof(T));
+            p_AddRow(bandCarry, p_Planes[plane] + lastRowOffset, static_cast<int>(p_PlaneRowSize));
+        }
+    }
+
+    s_ParallelFor(bandCount - 1, [&](int p_Band)
+    {
+        const int band = p_Band + 1;
+        for (int plane = 0; plane < p_PlaneCount; plane++)
+        {
+            const T* bandCarry = &carries[(static_cast<size_t>(plane) * bandCount + band) * p_PlaneRowSize];
+            for (int row = p_BandRowBegin[band]; row < p_BandRowBegin[band + 1]; row++)
+            {
+                p_AddRow(p_Planes[plane] + static_cast<size_t>(row) * p_PlanePitch, bandCarry, static_cast<int>(p_PlaneRowSize));
+            }
+        }
+    });
+}
+
+static void s_AddRotatedBandCarries(void (*p_AddRow)(uint32_t*, const uint32_t*, int), uint32_t* p_RightPlane, uint32_t* p_LeftPlane,
+                                    int p_Width, size_t p_PlanePitch, const std::vector<int>& p_BandRowBegin)
+{
+    const int bandCount = static_cast<int>(p_BandRowBegin.size()) - 1;
+    const size_t rowSize = static_cast<size_t>(p_Width);
+
+    // Global row above each band, the local last row of the previous band plus its carry shifted by its row count
+    std::vector<uint32_t> rightCarries(bandCount * rowSize, 0);
+    std::vector<uint32_t> leftCarries(bandCount * rowSize, 0);
+    for (int band = 1; band < bandCount; band++)
+    {
+        const size_t lastRowOffset = static_cast<size_t>(p_BandRowBegin[band] - 1) * p_PlanePitch;
+        uint32_t* rightCarry = &rightCarries[band * rowSize];
+        uint32_t* leftCarry = &leftCarries[band * rowSize];
+
+        memcpy(rightCarry, p_RightPlane + lastRowOffset, rowSize * sizeof(uint32_t));
+        memcpy(leftCarry, p_LeftPlane + lastRowOffset, rowSize * sizeof(uint32_t));
+        if (band > 1)
+        {
+            const int previousBandRowCount = p_BandRowBegin[band] - p_BandRowBegin[band - 1];
+            s_AddRotatedRows(p_AddRow, rightCarry, leftCarry, rightCarry - rowSize, leftCarry - rowSize, p_Width, previousBandRowCount);
+        }
+    }
+
+    s_ParallelFor(bandCount - 1, [&](int p_Band)
+    {
+        const int band = p_Band + 1;
+        const uint32_t* rightCarry = &rightCarries[band * rowSize];
+        const uint32_t* leftCarry = &leftCarries[band * rowSize];
+        for (int row = p_BandRowBegin[band]; row < p_BandRowBegin[band + 1]; row++)
+        {
+            const size_t rowOffset = static_cast<size_t>(row) * p_PlanePitch;
+            s_AddRotatedRows(p_AddRow, p_RightPlane + rowOffset, p_LeftPlane + rowOffset, rightCarry, leftCarry, p_Width,
+                             row - p_BandRowBegin[band] + 1);
+        }
+    });
+}
+
+void PixelSum::GetRegionsBatch(const PixelBufferCoords_i* p_Regions, size_t p_RegionCount, const PixelSumBatchOutput& p_Output) const
+{
+    if (!p_Regions) return;
+
+    // The query kernels read u32 tables, the wide tables are queried region by region
+    if (IsWideAccumulator())
+    {
+        for (size_t region = 0; region < p_RegionCount; region++)
+        {
+            const PixelBufferCoords_i& r = p_Regions[region];
+            const PixelSumRegionStats regionStats = GetRegionStats(r.x0, r.y0, r.x1, r.y1);
+
+            if (p_Output.pixelSums)       p_Output.pixelSums[region]       = regionStats.pixelSum;
+            if (p_Output.pixelAverages)   p_Output.pixelAverages[region]   = regionStats.pixelAverage;
+            if (p_Output.nonZeroCounts)   p_Output.nonZeroCounts[region]   = regionStats.nonZeroCount;
+            if (p_Output.nonZeroAverages) p_Output.nonZeroAverages[region] = regionStats.nonZeroAverage;
+            if (p_Output.pixelVariances)  p_Output.pixelVariances[region]  = regionStats.pixelVariance;
+            if (p_Output.pixelStdDevs)    p_Output.pixelStdDevs[region]    = std::sqrt(regionStats.pixelVariance);
+        }
+        return;
+    }
+
+    const bool needsVariance = p_Output.pixelVariances || p_Output.pixelStdDevs;
+    const bool needsPixelSum = p_Output.pixelSums || p_Output.pixelAverages || needsVariance;
+    const bool needsNonZero  = p_Output.nonZeroCounts || p_Output.nonZeroAverages;
+
+    if (IsLazy())
+    {
+        // Lowest row any of the regions can reach after clipping
+        int lastRow = 0;
+        for (size_t region = 0; region < p_RegionCount; region++)
+        {
+            lastRow = std::max(lastRow, std::max(p_Regions[region].y0, p_Regions[region].y1));
+        }
+        lastRow = std::min(lastRow, m_SourcePixBufTLBR.bottom);
+
+        if (needsPixelSum) EnsureTableRows(PixelSumOperationType::SummedAreaTable, lastRow);
+        if (needsNonZero) EnsureTableRows(PixelSumOperationType::NonZeroElementCount, lastRow);
+        if (needsVariance && HasSquaredSums()) EnsureTableRows(PixelSumOperationType::SquaredSum, lastRow);
+    }
+
+    PixelSumQueryTables tables;
+    tables.sumAreaTable = needsPixelSum ? m_SumAreaTable : nullptr;
+    tables.nonZeroTable = needsNonZero ? m_SumAreaNonZeroTable : nullptr;
+    tables.sourceTLBR   = m_SourcePixBufTLBR;
+    tables.tableStride  = TableStride();
+    tables.tablePitch   = m_TablePitch;
+    tables.tableOrigin  = m_TableOrigin;
+    tables.hasZeroBorder = IsPadded();
+    if (needsVariance && HasSquaredSums())
+    {
+        tables.squaredTable       = m_SumAreaSquaredTable;
+        tables.squaredTablePitch  = m_SquaredTablePitch;
+        tables.squaredTableOrigin = m_SquaredTableOrigin;
+    }
+
+    // SIMD gathers take 32-bit indices, larger tables are queried with the scalar kernel
+    const size_t maxGatherIndex = static_cast<size_t>(std::numeric_limits<int32_t>::max());
+    const bool fitsGatherIndex = m_TableElementCount <= maxGatherIndex && (!tables.squaredTable || m_SquaredTableElementCount <= maxGatherIndex);
+    const PixelSumKernels& kernels = PixelSumKernels::Get(fitsGatherIndex ? m_Config.simdLevel : PixelSumSimdLevel::Scalar);
+
+    // Regions are evaluated in chunks, intermediate results stay on the stack
+    uint32_t pixelSums[BATCH_QUERY_CHUNK_SIZE];
+    uint32_t nonZeroCounts[BATCH_QUERY_CHUNK_SIZE];
+    uint64_t squaredSums[BATCH_QUERY_CHUNK_SIZE];
+    uint64_t pixelCounts[BATCH_QUERY_CHUNK_SIZE];
+
+    for (size_t chunkBegin = 0; chunkBegin < p_RegionCount; chunkBegin += BATCH_QUERY_CHUNK_SIZE)
+    {
+        const int chunkSize = static_cast<int>(std::min<size_t>(BATCH_QUERY_CHUNK_SIZE, p_RegionCount - chunkBegin));
+        kernels.queryRegions(tables, p_Regions + chunkBegin, chunkSize, pixelSums, nonZeroCounts, squaredSums, pixelCounts);
+
+        for (int i = 0; i < chunkSize; i++)
+        {
+            const size_t region = chunkBegin + i;
+            const double pixelCount = static_cast<double>(pixelCounts[i]);
+
+            if (p_Output.pixelSums)       p_Output.pixelSums[region]       = pixelSums[i];
+            if (p_Output.pixelAverages)   p_Output.pixelAverages[region]   = pixelCounts[i] ? pixelSums[i] / pixelCount : 0.0;
+            if (p_Output.nonZeroCounts)   p_Output.nonZeroCounts[region]   = static_cast<int>(nonZeroCounts[i]);
+            if (p_Output.nonZeroAverages) p_Output.nonZeroAverages[region] = pixelCounts[i] ? nonZeroCounts[i] / pixelCount : 0.0;
+
+            if (needsVariance)
+            {
+                const bool hasVariance = pixelCounts[i] && tables.squaredTable;
+                const double pixelVariance = hasVariance ? ComputeVariance(pixelSums[i], squaredSums[i], pixelCounts[i]) : 0.0;
+
+                if (p_Output.pixelVariances) p_Output.pixelVariances[region] = pixelVariance;
+                if (p_Output.pixelStdDevs)   p_Output.pixelStdDevs[region]   = std::sqrt(pixelVariance);
+            }
+        }
+    }
+}
+
+bool PixelSum::GetQueryTables(PixelSumQueryTables& p_Tables) const
+{
+    if (!m_SumAreaTable) return false;
+
+    EnsureTableRows(PixelSumOperationType::SummedAreaTable, m_SourcePixBufTLBR.bottom);
+    EnsureTableRows(PixelSumOperationType::NonZeroElementCount, m_SourcePixBufTLBR.bottom);
+    if (HasSquaredSums()) EnsureTableRows(PixelSumOperationType::SquaredSum, m_SourcePixBufTLBR.bottom);
+
+    p_Tables.sumAreaTable       = m_SumAreaTable;
+    p_Tables.nonZeroTable       = m_SumAreaNonZeroTable;
+    p_Tables.sourceTLBR         = m_SourcePixBufTLBR;
+    p_Tables.tableStride        = TableStride();
+    p_Tables.tablePitch         = m_TablePitch;
+    p_Tables.tableOrigin        = m_TableOrigin;
+    p_Tables.hasZeroBorder      = IsPadded();
+    p_Tables.squaredTable       = m_SumAreaSquaredTable;
+    p_Tables.squaredTablePitch  = m_SquaredTablePitch;
+    p_Tables.squaredTableOrigin = m_SquaredTableOrigin;
+
+    return true;
+}
+
+// Averages of an output row of the box filter, every window has the same unclamped pixel count
+template<typename S>
+static void s_StoreBoxFilterRow(const S* p_WindowSums, int p_Count, uint64_t p_WindowPixelCount, float* p_Output)
+{
+    const double pixelCount = static_cast<double>(p_WindowPixelCount);
+    for (int i = 0; i < p_Count; i++)
+    {
+        p_Output[i] = static_cast<float>(p_WindowSums[i] / pixelCount);
+    }
+}
+
+// Rounded to nearest, (sum + n / 2) / n is evaluated in double. Both are integers below 2^53, the quotient is exact
+// when it is an integer and is never rounded up to the next one, the truncation matches the integer division.
+template<typename S>
+static void s_StoreBoxFilterRow(const S* p_WindowSums, int p_Count, uint64_t p_WindowPixelCount, unsigned char* p_Output)
+{
+    const double pixelCount = static_cast<double>(p_WindowPixelCount);
+    const double halfPixelCount = static_cast<double>(p_WindowPixelCount / 2);
+    for (int i = 0; i < p_Count; i++)
+    {
+        p_Output[i] = static_cast<unsigned char>((p_WindowSums[i] + halfPixelCount) / pixelCount);
+    }
+}
+
+// 8.8 fixed point, rounded to nearest like the u8 output
+template<typename S>
+static void s_StoreBoxFilterRow(const S* p_WindowSums, int p_Count, uint64_t p_WindowPixelCount, uint16_t* p_Output)
+{
+    const double pixelCount = static_cast<double>(p_WindowPixelCount);
+    const double halfPixelCount = static_cast<double>(p_WindowPixelCount / 2);
+    for (int i = 0; i < p_Count; i++)
+    {
+        p_Output[i] = static_cast<uint16_t>((p_WindowSums[i] * 256.0 + halfPixelCount) / pixelCount);
+    }
+}
+
+bool PixelSum::ComputeBoxFilter(int p_WindowWidth, int p_WindowHeight, int p_Stride, unsigned char* p_Output) const
+{
+    return ComputeBoxFilterOutput(p_WindowWidth, p_WindowHeight, p_Stride, p_Output);
+}
+
+bool PixelSum::ComputeBoxFilter(int p_WindowWidth, int p_WindowHeight, int p_Stride, uint16_t* p_Output) const
+{
+    return ComputeBoxFilterOutput(p_WindowWidth, p_WindowHeight, p_Stride, p_Output);
+}
+
+bool PixelSum::ComputeBoxFilter(int p_WindowWidth, int p_WindowHeight, int p_Stride, float* p_Output) const
+{
+    return ComputeBoxFilterOutput(p_WindowWidth, p_WindowHeight, p_Stride, p_Output);
+}
+
+template<typename T>
+bool PixelSum::ComputeBoxFilterOutput(int p_WindowWidth, int p_WindowHeight, int p_Stride, T* p_Output) const
+{
+    if (p_WindowWidth <= 0 || p_WindowHeight <= 0 || p_Stride <= 0 || !p_Output) return false;
+    if (!m_SumAreaTable && !m_SumAreaTable64) return false;
+
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+    const int outputWidth = (srcPixBufWidth - 1) / p_Stride + 1;
+    const int outputHeight = (m_SourcePixBufTLBR.height() - 1) / p_Stride + 1;
+    const uint64_t windowPixelCount = static_cast<uint64_t>(p_WindowWidth) * static_cast<uint64_t>(p_WindowHeight);
+
+    // The windows cover the whole image, a lazy table is completed once instead of per output row
+    EnsureTableRows(PixelSumOperationType::SummedAreaTable, m_SourcePixBufTLBR.bottom);
+
+    // The planar u32 table is read directly. Row -1 and column -1 of a window on the border are the zero row and
+    // column of a padded table, a packed table uses a zero row and skips the column. The other layouts go through
+    // ComputeRegionSum(..) window by window.
+    const bool isDirect = !IsWideAccumulator() && TableStride() == 1;
+    const bool hasZeroBorder = IsPadded();
+
+    // At stride 1 the windows [interiorBegin, interiorBegin + interiorCount) of every row lie inside the image
+    // horizontally, i.e. two contiguous spans of each table row for the SIMD kernel. Without the zero column the
+    // window starting on column 0 is a border window.
+    const int firstInteriorColumn = hasZeroBorder ? 0 : 1;
+    const int interiorBegin = p_WindowWidth / 2 + firstInteriorColumn;
+    const int interiorCount = (isDirect && p_Stride == 1) ? std::max(0, srcPixBufWidth - p_WindowWidth + 1 - firstInteriorColumn) : 0;
+    const int leftBorderEnd = (interiorCount > 0) ? interiorBegin : outputWidth;
+    const int rightBorderBegin = (interiorCount > 0) ? interiorBegin + interiorCount : outputWidth;
+
+    const PixelSumKernels& kernels = PixelSumKernels::Get(m_Config.simdLevel);
+    const int bandCount = s_ResolveBandCount(m_Config.threadCount, outputWidth, outputHeight);
+
+    s_ParallelFor(bandCount, [&](int p_Band)
+    {
+        const int rowBegin = static_cast<int>(static_cast<int64_t>(outputHeight) * p_Band / bandCount);
+        const int rowEnd = static_cast<int>(static_cast<int64_t>(outputHeight) * (p_Band + 1) / bandCount);
+
+        std::vector<uint32_t> windowSums(isDirect ? outputWidth : 0);
+        std::vector<uint64_t> windowSums64(isDirect ? 0 : outputWidth);
+        std::vector<uint32_t> zeroRow((isDirect && !hasZeroBorder) ? srcPixBufWidth + 1 : 0); // Row -1 of a packed table
+
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            // Window rows clamped to the image, the pixel count stays the unclamped one
+            const int64_t windowY0 = static_cast<int64_t>(row) * p_Stride - p_WindowHeight / 2;
+            const int y0 = static_cast<int>(std::max<int64_t>(windowY0, 0));
+            const int y1 = static_cast<int>(std::min<int64_t>(windowY0 + p_WindowHeight - 1, m_SourcePixBufTLBR.bottom));
+            T* outputRow = p_Output + static_cast<size_t>(row) * outputWidth;
+
+            if (!isDirect)
+            {
+                for (int column = 0; column < outputWidth; column++)
+                {
+                    const int64_t windowX0 = static_cast<int64_t>(column) * p_Stride - p_WindowWidth / 2;
+                    const int x0 = static_cast<int>(std::max<int64_t>(windowX0, 0));
+                    const int x1 = static_cast<int>(std::min<int64_t>(windowX0 + p_WindowWidth - 1, m_SourcePixBufTLBR.right));
+                    windowSums64[column] = ComputeRegionSum(PixelSumOperationType::SummedAreaTable, x0, y0, x1, y1);
+                }
+
+                s_StoreBoxFilterRow(windowSums64.data(), outputWidth, windowPixelCount, outputRow);
+                continue;
+            }
+
+            const uint32_t* bottomRow = m_SumAreaTable + m_TableOrigin + static_cast<ptrdiff_t>(y1) * static_cast<ptrdiff_t>(m_TablePitch);
+            const uint32_t* topRow = (y0 == 0 && !hasZeroBorder)
+                                         ? zeroRow.data() + 1
+                                         : m_SumAreaTable + m_TableOrigin + (static_cast<ptrdiff_t>(y0) - 1) * static_cast<ptrdiff_t>(m_TablePitch);
+
+            // Interior window i starts at column firstInteriorColumn + i, the kernel reads the columns left of the windows
+            if (interiorCount > 0)
+            {
+                kernels.windowSumRow(bottomRow + firstInteriorColumn - 1, topRow + firstInteriorColumn - 1, p_WindowWidth, interiorCount,
+                                     windowSums.data() + interiorBegin);
+            }
+
+            // Border windows, clamped like s_ValidateSearchWindowClipCoords(..)
+            auto computeBorderWindow = [&](int p_Column)
+            {
+                const int64_t windowX0 = static_cast<int64_t>(p_Column) * p_Stride - p_WindowWidth / 2;
+                const ptrdiff_t left = static_cast<ptrdiff_t>(std::max<int64_t>(windowX0, 0)) - 1;
+                const ptrdiff_t right = static_cast<ptrdiff_t>(std::min<int64_t>(windowX0 + p_WindowWidth - 1, m_SourcePixBufTLBR.right));
+                const uint32_t leftSum = (left >= 0 || hasZeroBorder) ? bottomRow[left] - topRow[left] : 0;
+                windowSums[p_Column] = bottomRow[right] - topRow[right] - leftSum;
+            };
+
+            for (int column = 0; column < leftBorderEnd; column++) computeBorderWindow(column);
+            for (int column = rightBorderBegin; column < outputWidth; column++) computeBorderWindow(column);
+
+            s_StoreBoxFilterRow(windowSums.data(), outputWidth, windowPixelCount, outputRow);
+        }
+    });
+
+    return true;
+}
+
+bool PixelSum::UpdateRegion(int p_X0, int p_Y0, int p_X1, int p_Y1, const unsigned char* p_NewPixels)
+{
+    if (!p_NewPixels) return false;
+
+    if (p_X1 < p_X0) { std::swap(p_X0, p_X1); }
+    if (p_Y1 < p_Y0) { std::swap(p_Y0, p_Y1); }
+
+    PixelBufferCoords_i region;
+    region.x0 = p_X0;
+    region.y0 = p_Y0;
+    region.x1 = p_X1;
+    region.y1 = p_Y1;
+
+    // The new pixels are laid out for the unclamped region
+    const ptrdiff_t pixelsPitch = static_cast<ptrdiff_t>(p_X1) - p_X0 + 1;
+
+    return ApplyDirtyRegions(&region, 1, p_NewPixels, pixelsPitch, p_X0, p_Y0);
+}
+
+bool PixelSum::UpdateRegions(const PixelBufferCoords_i* p_Regions, size_t p_RegionCount, const unsigned char* p_Frame)
+{
+    if (!p_Regions || !p_Frame) return false;
+
+    return ApplyDirtyRegions(p_Regions, p_RegionCount, p_Frame, m_SourcePixBufTLBR.width(), 0, 0);
+}
+
+bool PixelSum::ApplyDirtyRegions(const PixelBufferCoords_i* p_Regions, size_t p_RegionCount, const unsigned char* p_Pixels,
+                                 ptrdiff_t p_PixelsPitch, int p_PixelsX0, int p_PixelsY0)
+{
+    if (!m_SumAreaTable && !m_SumAreaTable64) return false;
+
+    // Same clipping as the queries, regions outside the image are dropped
+    std::vector<PixelBufferCoords_i> dirtyRegions;
+    dirtyRegions.reserve(p_RegionCount);
+    for (size_t region = 0; region < p_RegionCount; region++)
+    {
+        PixelBufferCoords_i r = p_Regions[region];
+        if (s_ValidateSearchWindowClipCoords(r.x0, r.y0, r.x1, r.y1, m_SourcePixBufTLBR))
+        {
+            dirtyRegions.push_back(r);
+        }
+    }
+
+    if (dirtyRegions.empty()) return false;
+
+    // The old pixels are read back from the tables, the update needs complete tables
+    EnsureTableRows(PixelSumOperationType::SummedAreaTable, m_SourcePixBufTLBR.bottom);
+    EnsureTableRows(PixelSumOperationType::NonZeroElementCount, m_SourcePixBufTLBR.bottom);
+    if (HasSquaredSums()) EnsureTableRows(PixelSumOperationType::SquaredSum, m_SourcePixBufTLBR.bottom);
+    if (HasRotatedSums()) EnsureTableRows(PixelSumOperationType::RotatedSum, m_SourcePixBufTLBR.bottom);
+
+    if (!DetachSharedTables(true)) return false;
+
+    const PixelSumKernels& kernels = PixelSumKernels::Get(m_Config.simdLevel);
+    if (m_SumAreaRotatedRightTable)
+    {
+        UpdateRotatedTables(kernels, dirtyRegions, p_Pixels, p_PixelsPitch, p_PixelsX0, p_PixelsY0);
+    }
+    if (IsWideAccumulator())
+    {
+        UpdateSumAreaTables<uint64_t>(kernels, kernels.addRowWide, m_SumAreaTable64, m_SumAreaNonZeroTable64, dirtyRegions,
+                                      p_Pixels, p_PixelsPitch, p_PixelsX0, p_PixelsY0);
+    }
+    else
+    {
+        UpdateSumAreaTables<uint32_t>(kernels, kernels.addRow, m_SumAreaTable, m_SumAreaNonZeroTable, dirtyRegions,
+                                      p_Pixels, p_PixelsPitch, p_PixelsX0, p_PixelsY0);
+    }
+
+    return true;
+}
+
+template<typename T>
+void PixelSum::UpdateSumAreaTables(const PixelSumKernels& p_Kernels, void (*p_AddRow)(T*, const T*, int), T* p_SumTable, T* p_NonZeroTable,
+                                   const std::vector<PixelBufferCoords_i>& p_Regions, const unsigned char* p_Pixels,
+                                   ptrdiff_t p_PixelsPitch, int p_PixelsX0, int p_PixelsY0)
+{
+    const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
+    const int srcPixBufHeight = m_SourcePixBufTLBR.height();
+    const ptrdiff_t tableStride = TableStride();
+
+    int minX = srcPixBufWidth, minY = srcPixBufHeight, maxX = 0, maxY = 0;
+    for (const PixelBufferCoords_i& r : p_Regions)
+    {
+        minX = std::min(minX, r.x0);
+        minY = std::min(minY, r.y0);
+        maxX = std::max(maxX, r.x1);
+        maxY = std::max(maxY, r.y1);
+    }
+
+    // Only the entries (x >= minX, y >= minY) change. The delta of a table row is laid out like the table planes,
+    // the planar layout has a sum and a non-zero plane, the interleaved layout one plane of { sum, non-zero } pairs.
+    const bool isInterleaved = (m_Config.tableLayout == PixelSumTableLayout::Interleaved);
+    const int planeCount = isInterleaved ? 1 : 2;
+    const size_t planeRowSize = static_cast<size_t>(srcPixBufWidth - minX) * tableStride;
+
+    std::vector<T> rowDelta(planeCount * planeRowSize, 0);
+    T* sumDelta = rowDelta.data();
+    T* nonZeroDelta = isInterleaved ? rowDelta.data() + 1 : rowDelta.data() + planeRowSize;
+
+    T* const planes[] = { p_SumTable + m_TableOrigin + minX * tableStride, p_NonZeroTable + m_TableOrigin + minX * tableStride };
+
+    // The squared pixel table is planar u64 whatever the accumulator
+    const size_t squaredRowSize = m_SumAreaSquaredTable ? static_cast<size_t>(srcPixBufWidth - minX) : 0;
+    std::vector<uint64_t> squaredDelta(squaredRowSize, 0);
+    uint64_t* const squaredPlane = m_SumAreaSquaredTable ? m_SumAreaSquaredTable + m_SquaredTableOrigin + minX : nullptr;
+
+    // Old pixels are recovered from the untouched pixel sum table entries of columns [minX - 1, maxX] of the
+    // current row and the row above
+    const size_t segmentSize = static_cast<size_t>(maxX - minX) + 2;
+    std::vector<T> previousRow(segmentSize, 0);
+    std::vector<T> currentRow(segmentSize, 0);
+    auto copyTableRow = [&](int p_Row, T* p_Dest)
+    {
+        const T* sumAreaRow = p_SumTable + m_TableOrigin + static_cast<size_t>(p_Row) * m_TablePitch;
+        for (int x = minX - 1; x <= maxX; x++)
+        {
+            p_Dest[x - minX + 1] = (x < 0) ? 0 : sumAreaRow[x * tableStride];
+        }
+    };
+
+    if (minY > 0) copyTableRow(minY - 1, previousRow.data());
+
+    // 1. Dirty rows, the row delta accumulates the horizontal prefix of the pixel changes of every row
+    std::vector<std::pair<int, int>> spans;
+    for (int row = minY; row <= maxY; row++)
+    {
+        spans.clear();
+        for (const PixelBufferCoords_i& r : p_Regions)
+        {
+            if (r.y0 <= row && row <= r.y1) spans.emplace_back(r.x0, r.x1);
+        }
+        std::sort(spans.begin(), spans.end());
+
+        copyTableRow(row, currentRow.data());
+        const ptrdiff_t pixelsRowOffset = (row - p_PixelsY0) * p_PixelsPitch - p_PixelsX0;
+
+        // Horizontal prefix of the changes of this row, added to every column from the change onwards
+        T sumChange = 0;
+        T nonZeroChange = 0;
+        uint64_t squaredChange = 0;
+        int column = minX;
+        auto addChangeUpTo = [&](int p_ColumnEnd)
+        {
+            if (sumChange || nonZeroChange || squaredChange)
+            {
+                for (; column < p_ColumnEnd; column++)
+                {
+                    sumDelta[(column - minX) * tableStride] += sumChange;
+                    nonZeroDelta[(column - minX) * tableStride] += nonZeroChange;
+                    if (squaredPlane) squaredDelta[column - minX] += squaredChange;
+                }
+            }
+            column = p_ColumnEnd;
+        };
+
+        for (size_t span = 0; span < spans.size();)
+        {
+            // Overlapping and touching spans are merged, every pixel is applied once
+            const int spanX0 = spans[span].first;
+            int spanX1 = spans[span].second;
+            for (span++; span < spans.size() && spans[span].first <= spanX1 + 1; span++)
+            {
+                spanX1 = std::max(spanX1, spans[span].second);
+            }
+
+            addChangeUpTo(spanX0);
+            for (int x = spanX0; x <= spanX1; x++)
+            {
+                // Old pixel => S(x, y) - S(x - 1, y) - S(x, y - 1) + S(x - 1, y - 1), exact in modular arithmetic
+                const size_t i = static_cast<size_t>(x - minX) + 1;
+                const uint8_t oldPixel = static_cast<uint8_t>(currentRow[i] - currentRow[i - 1] - previousRow[i] + previousRow[i - 1]);
+                const uint8_t newPixel = p_Pixels[pixelsRowOffset + x];
+
+                sumChange += static_cast<T>(newPixel) - static_cast<T>(oldPixel);
+                nonZeroChange += static_cast<T>(newPixel != 0) - static_cast<T>(oldPixel != 0);
+
+                sumDelta[(x - minX) * tableStride] += sumChange;
+                nonZeroDelta[(x - minX) * tableStride] += nonZeroChange;
+
+                if (squaredPlane)
+                {
+                    squaredChange += static_cast<uint64_t>(newPixel * newPixel) - static_cast<uint64_t>(oldPixel * oldPixel);
+                    squaredDelta[x - minX] += squaredChange;
+                }
+            }
+            column = spanX1 + 1;
+        }
+
+        // Right of the last span the change of the row is constant
+        addChangeUpTo(srcPixBufWidth);
+
+        std::swap(previousRow, currentRow);
+
+        for (int plane = 0; plane < planeCount; plane++)
+        {
+            p_AddRow(planes[plane] + static_cast<size_t>(row) * m_TablePitch, rowDelta.data() + plane * planeRowSize, static_cast<int>(planeRowSize));
+        }
+
+        if (squaredPlane)
+        {
+            p_Kernels.addRowWide(squaredPlane + static_cast<size_t>(row) * m_SquaredTablePitch, squaredDelta.data(), static_cast<int>(squaredRowSize));
+        }
+    }
+
+    // 2. Below the last dirty row every row receives the same delta, added in parallel bands
+    const int rowBegin = maxY + 1;
+    const int rowCount = srcPixBufHeight - rowBegin;
+    if (rowCount <= 0) return;
+
+    const int bandCount = s_ResolveBandCount(m_Config.threadCount, srcPixBufWidth - minX, rowCount);
+    s_ParallelFor(bandCount, [&](int p_Band)
+    {
+        const int bandRowBegin = rowBegin + static_cast<int>(static_cast<int64_t>(rowCount) * p_Band / bandCount);
+        const int bandRowEnd = rowBegin + static_cast<int>(static_cast<int64_t>(rowCount) * (p_Band + 1) / bandCount);
+        for (int plane = 0; plane < planeCount; plane++)
+        {
+            for (int row = bandRowBegin; row < bandRowEnd; row++)
+            {
+                p_AddRow(planes[plane] + static_cast<size_t>(row) * m_TablePitch, rowDelta.data() + plane * planeRowSize, static_cast<int>(planeRowSize));
+            }
+        }
+
+        for (int row = bandRowBegin; row < bandRowEnd && squaredPlane; row++)
+        {
+            p_Kernels.addRowWide(squaredPlane + static_cast<size_t>(row) * m_SquaredTablePitch, squaredDelta.data(), static_cast<int>(squaredRowSize));
+        }
+    });
+}
+
+void PixelSum::UpdateRotatedTables(const PixelSumKernels& p_Kernels, const std::vector<PixelBufferCoords_i>& p_Regions, const unsigned char* p_Pixels,
+                                   ptrdiff_t p_PixelsPitch, int p_PixelsX0, int p_PixelsY0)
+{
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+    const size_t rowSize = static_cast<size_t>(srcPixBufWidth);
+
+    int minY = m_SourcePixBufTLBR.height(), maxY = 0;
+    for (const PixelBufferCoords_i& r : p_Regions)
+    {
+        minY = std::min(minY, r.y0);
+        maxY = std::max(maxY, r.y1);
+    }
+
+    // Delta of the current and the previous row of both tables, the delta of a row is the row prefix of its
+    // pixel changes plus the diagonal neighbours of the delta above
+    std::vector<uint32_t> rightDelta(2 * rowSize, 0);
+    std::vector<uint32_t> leftDelta(2 * rowSize, 0);
+
+    // Old pixels are recovered from the right table, P(x, y) = R(x, y) - R(x + 1, y - 1) with the row above taken
+    // before it was updated
+    std::vector<uint32_t> previousRightRow(rowSize, 0);
+    std::vector<uint32_t> pixelChange(rowSize, 0);
+    if (minY > 0)
+    {
+        memcpy(previousRightRow.data(), m_SumAreaRotatedRightTable + m_RotatedTableOrigin + static_cast<size_t>(minY - 1) * m_RotatedTablePitch,
+               rowSize * sizeof(uint32_t));
+    }
+
+    for (int row = minY; row < m_SourcePixBufTLBR.height(); row++)
+    {
+        const size_t rowOffset = m_RotatedTableOrigin + static_cast<size_t>(row) * m_RotatedTablePitch;
+        uint32_t* rightRow = m_SumAreaRotatedRightTable + rowOffset;
+        uint32_t* leftRow = m_SumAreaRotatedLeftTable + rowOffset;
+
+        uint32_t* rightRowDelta = &rightDelta[(row & 1) * rowSize];
+        uint32_t* leftRowDelta = &leftDelta[(row & 1) * rowSize];
+        std::fill(rightRowDelta, rightRowDelta + rowSize, 0);
+
+        if (row <= maxY)
+        {
+            // Overlapping regions assign the same change, every pixel is applied once
+            std::fill(pixelChange.begin(), pixelChange.end(), 0);
+            const ptrdiff_t pixelsRowOffset = (row - p_PixelsY0) * p_PixelsPitch - p_PixelsX0;
+            for (const PixelBufferCoords_i& r : p_Regions)
+            {
+                if (row < r.y0 || row > r.y1) continue;
+
+                for (int x = r.x0; x <= r.x1; x++)
+                {
+                    const uint32_t oldPrefix = rightRow[x] - previousRightRow[std::min(x + 1, srcPixBufWidth - 1)];
+                    const uint32_t oldPrefixLeft = (x > 0) ? rightRow[x - 1] - previousRightRow[x] : 0;
+                    const uint8_t oldPixel = static_cast<uint8_t>(oldPrefix - oldPrefixLeft);
+                    pixelChange[x] = static_cast<uint32_t>(p_Pixels[pixelsRowOffset + x]) - oldPixel;
+                }
+            }
+
+            uint32_t rowChange = 0;
+            for (int x = 0; x < srcPixBufWidth; x++)
+            {
+                rowChange += pixelChange[x];
+                rightRowDelta[x] = rowChange;
+            }
+
+            memcpy(previousRightRow.data(), rightRow, rowSize * sizeof(uint32_t));
+        }
 
-#include "MemoryAllocator.h"
-#include "ScopedTimer.h"
-#include "UtilityFunctions.h"
+        memcpy(leftRowDelta, rightRowDelta, rowSize * sizeof(uint32_t));
+        if (row > minY)
+        {
+            s_AddRotatedRows(p_Kernels.addRow, rightRowDelta, leftRowDelta, &rightDelta[((row - 1) & 1) * rowSize],
+                             &leftDelta[((row - 1) & 1) * rowSize], srcPixBufWidth, 1);
+        }
 
-PixelSum::PixelSum(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight)
-    : m_SourcePixBufTLBR(0 /*Top Coord*/, 0/*Left Coord*/, p_YHeight - 1/*Bottom Coord*/, p_XWidth - 1/*Right Coord*/)
+        p_Kernels.addRow(rightRow, rightRowDelta, srcPixBufWidth);
+        p_Kernels.addRow(leftRow, leftRowDelta, srcPixBufWidth);
+    }
+}
+
+void PixelSum::BuildTableRows(int p_Table, int p_Row) const
 {
-    if (p_XWidth * p_YHeight <= 0) return;
+    std::lock_guard<std::mutex> lock(m_LazyBuildMutex);
 
-    // Pixel Sum Allocations are made from preallocated virtual memory
-    // This helps in quick allocation and deallocation of pixel sum preventing performance hiches
-    // that can cause by constant allocation and deallocation Pixel Sum class objects.
-    const size_t srcBufferPixelCount = m_SourcePixBufTLBR.width() * m_SourcePixBufTLBR.height();
-    AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(m_SumAreaTable, srcBufferPixelCount);
-    AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(m_SumAreaNonZeroTable, srcBufferPixelCount);
+    // Another reader may have built the rows while this one was waiting for the lock
+    const int rowBegin = m_BuiltRowCount[p_Table].load(std::memory_order_relaxed);
+    if (rowBegin > p_Row || !m_PixelBuffer) return;
 
-    // The summed matrix pixel buffer
-    ComputePixelSum<uint32_t>(PixelSumOperationType::SummedAreaTable, p_Buffer, m_SumAreaTable);
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+    const int rowEnd = static_cast<int>(std::min<int64_t>(m_SourcePixBufTLBR.height(), std::max(p_Row + 1, rowBegin + LAZY_BUILD_MIN_ROWS)));
 
-    // Non-Zero Element summed matrix
-    ComputePixelSum<uint32_t>(PixelSumOperationType::NonZeroElementCount, p_Buffer, m_SumAreaNonZeroTable);
+    const PixelSumKernels& kernels = PixelSumKernels::Get(m_Config.simdLevel);
+    const auto prefixScanRow = (p_Table == 1) ? kernels.prefixNonZeroRow : kernels.prefixSumRow;
+
+    // Same row recurrence as the serial build, the row above is final
+    if (p_Table == 2)
+    {
+        ComputeSquaredSumRows(kernels, m_PixelBuffer, rowBegin, rowEnd, rowBegin == 0);
+    }
+    else if (p_Table == 3)
+    {
+        ComputeRotatedSumRows(kernels, m_PixelBuffer, rowBegin, rowEnd, rowBegin == 0);
+    }
+    else if (IsWideAccumulator())
+    {
+        uint64_t* sumAreaTable = (p_Table == 1) ? m_SumAreaNonZeroTable64 : m_SumAreaTable64;
+        std::vector<uint32_t> rowPrefix(srcPixBufWidth);
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            prefixScanRow(m_PixelBuffer + static_cast<size_t>(row) * srcPixBufWidth, rowPrefix.data(), srcPixBufWidth);
+
+            uint64_t* sumAreaRow = sumAreaTable + m_TableOrigin + static_cast<size_t>(row) * m_TablePitch;
+            kernels.accumulateRowWide(sumAreaRow, (row == 0) ? nullptr : sumAreaRow - m_TablePitch, rowPrefix.data(), srcPixBufWidth);
+        }
+    }
+    else
+    {
+        uint32_t* sumAreaTable = (p_Table == 1) ? m_SumAreaNonZeroTable : m_SumAreaTable;
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            uint32_t* sumAreaRow = sumAreaTable + m_TableOrigin + static_cast<size_t>(row) * m_TablePitch;
+            prefixScanRow(m_PixelBuffer + static_cast<size_t>(row) * srcPixBufWidth, sumAreaRow, srcPixBufWidth);
+
+            if (row > 0) kernels.addRow(sumAreaRow, sumAreaRow - m_TablePitch, srcPixBufWidth);
+        }
+    }
+
+    // Readers which see the new row count also see the rows
+    m_BuiltRowCount[p_Table].store(rowEnd, std::memory_order_release);
 }
 
-PixelSum::~PixelSum()
+template<typename T>
+void PixelSum::ComputePixelSum(const PixelSumKernels& p_Kernels, PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf, int p_RowCount)
 {
-    // Free the memory, this memory will return back to Virtual Memory free stack,
-    // where it can be efficiently reused again and again without
+    // SIMD optimized horizontal prefix sum pass
+    PixelSumHorizontalPass<T>(p_Kernels, p_OperationType, p_PixelBuffer, p_SumAreaPixBuf, p_RowCount);
 
-    VM::MemoryAllocator::GetInstance().Free(m_SumAreaTable);
-    VM::MemoryAllocator::GetInstance().Free(m_SumAreaNonZeroTable);
+    // SIMD optimized vertical pass
+    PixelSumVerticalPass<T>(p_Kernels, p_PixelBuffer, p_SumAreaPixBuf, p_RowCount);
 }
 
-PixelSum::PixelSum(const PixelSum& p_PixelSum)
+void PixelSum::ComputePixelSumFused(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowCount)
 {
-    m_SourcePixBufTLBR = p_PixelSum.m_SourcePixBufTLBR;
+    if (!p_PixelBuffer || !m_SumAreaTable || !m_SumAreaNonZeroTable) return;
 
-    const size_t srcBufferPixelCount = m_SourcePixBufTLBR.width() * m_SourcePixBufTLBR.height();
+    const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
+    const int srcPixBufHeight = p_RowCount;
 
-    // Deep copy the sum areas pixel buffer
-    AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(m_SumAreaTable, srcBufferPixelCount);
-    memcpy(m_SumAreaTable, p_PixelSum.m_SumAreaTable, srcBufferPixelCount * sizeof(uint32_t));
+    if (srcPixBufWidth == 0 || srcPixBufHeight == 0) return;
 
-    // Deep copy the non-zero elements sum areas
-    AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(m_SumAreaNonZeroTable, srcBufferPixelCount);
-    memcpy(m_SumAreaNonZeroTable, p_PixelSum.m_SumAreaNonZeroTable, srcBufferPixelCount * sizeof(uint32_t));
-}
+    // Tables which do not fit in the last level cache would be evicted before being queried anyway,
+    // stream them directly to memory and keep the cache for the scratch rows and the pixel buffer.
+    const size_t tablesByteSize = ((m_Config.tableLayout == PixelSumTableLayout::Interleaved) ? 1 : 2) * m_TableElementCount * sizeof(uint32_t) +
+                                  m_SquaredTableElementCount * sizeof(uint64_t);
+    const bool useNonTemporalStores = tablesByteSize > s_LastLevelCacheSize();
 
-PixelSum& PixelSum::operator=(const PixelSum& p_PixelSum)
-{
-    if (this != &p_PixelSum)
+    const int tileWidth = std::min(srcPixBufWidth, FUSED_TILE_WIDTH);
+
+    // Running column sums of the tile i.e. the previous SAT row segment, kept hot in L1
+    std::vector<uint32_t> columnSum(tileWidth);
+    std::vector<uint32_t> columnNonZero(tileWidth);
+    std::vector<uint64_t> columnSquared(m_SumAreaSquaredTable ? tileWidth : 0);
+
+    // Horizontal prefix of each row up to the end of the previous tile
+    std::vector<uint32_t> rowCarrySum(srcPixBufHeight, 0);
+    std::vector<uint32_t> rowCarryNonZero(srcPixBufHeight, 0);
+    std::vector<uint64_t> rowCarrySquared(m_SumAreaSquaredTable ? srcPixBufHeight : 0, 0);
+
+    for (int tileX0 = 0; tileX0 < srcPixBufWidth; tileX0 += tileWidth)
     {
-        // 1. Free the existing summed area matrixes if object is being reassigned
-        if (m_SumAreaTable)
-        {
-            VM::MemoryAllocator::GetInstance().Free(m_SumAreaTable);
-        }
+        const int tileCols = std::min(tileWidth, srcPixBufWidth - tileX0);
+
+        std::fill(columnSum.begin(), columnSum.end(), 0);
+        std::fill(columnNonZero.begin(), columnNonZero.end(), 0);
+        std::fill(columnSquared.begin(), columnSquared.end(), 0);
 
-        if (m_SumAreaNonZeroTable)
+        for (int row = 0; row < srcPixBufHeight; row++)
         {
-            VM::MemoryAllocator::GetInstance().Free(m_SumAreaNonZeroTable);
-        }
+            const size_t rowOffset = static_cast<size_t>(row) * srcPixBufWidth + tileX0;
 
-        // 2. Overwrite the pixel buffer top-left and bottom-right
-        m_SourcePixBufTLBR = p_PixelSum.m_SourcePixBufTLBR;
+            // Horizontal prefix continued from the previous tile, accumulated into the column sums
+            p_Kernels.prefixAccumulateRow(p_PixelBuffer + rowOffset, columnSum.data(), columnNonZero.data(), tileCols,
+                                          &rowCarrySum[row], &rowCarryNonZero[row]);
 
-        // Perform Deep copy for both summed area matrix
-        const size_t srcBufferPixelCount = m_SourcePixBufTLBR.width() * m_SourcePixBufTLBR.height();
+            const size_t tableOffset = m_TableOrigin + static_cast<size_t>(p_RowBegin + row) * m_TablePitch + static_cast<size_t>(tileX0) * TableStride();
+            if (m_Config.tableLayout == PixelSumTableLayout::Interleaved)
+            {
+                StoreRowSegmentInterleaved(m_SumAreaTable + tableOffset, columnSum.data(), columnNonZero.data(), tileCols, useNonTemporalStores);
+            }
+            else
+            {
+                StoreRowSegment(m_SumAreaTable + tableOffset, columnSum.data(), tileCols, useNonTemporalStores);
+                StoreRowSegment(m_SumAreaNonZeroTable + tableOffset, columnNonZero.data(), tileCols, useNonTemporalStores);
+            }
 
-        AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(m_SumAreaTable, srcBufferPixelCount);
-        memcpy(m_SumAreaTable, p_PixelSum.m_SumAreaTable, srcBufferPixelCount * sizeof(uint32_t));
+            if (m_SumAreaSquaredTable)
+            {
+                // Squares of the same pixels, accumulated into the u64 column sums of the tile
+                rowCarrySquared[row] = p_Kernels.accumulateSquareRow(p_PixelBuffer + rowOffset, columnSquared.data(), columnSquared.data(),
+                                                                     tileCols, rowCarrySquared[row]);
 
-        AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(m_SumAreaNonZeroTable, srcBufferPixelCount);
-        memcpy(m_SumAreaNonZeroTable, p_PixelSum.m_SumAreaNonZeroTable, srcBufferPixelCount * sizeof(uint32_t));
+                const size_t squaredOffset = m_SquaredTableOrigin + static_cast<size_t>(p_RowBegin + row) * m_SquaredTablePitch + tileX0;
+                StoreRowSegment(m_SumAreaSquaredTable + squaredOffset, columnSquared.data(), tileCols, useNonTemporalStores);
+            }
+        }
     }
 
-    return *this;
+    if (useNonTemporalStores)
+    {
+        // Streaming stores are weakly ordered, make them visible before the tables are queried
+        _mm_sfence();
+    }
 }
 
-unsigned int PixelSum::GetPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+void PixelSum::StoreRowSegment(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count, bool p_NonTemporal)
 {
-    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+    if (!p_NonTemporal)
+    {
+        memcpy(p_Dest, p_Src, p_Count * sizeof(uint32_t));
+        return;
+    }
 
-    return ComputeSumAreaForSearchWindow<uint32_t>(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaTable);
-}
+    int i = 0;
 
-double PixelSum::GetPixelAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
-{
-    uint32_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+    // Streaming stores require 16 byte aligned destination, peel the unaligned head
+    const uint32_t* alignedDest = p_Dest;
+    for (; i < p_Count && !VM_IS_ALIGNED(alignedDest, 16); i++, alignedDest++)
+    {
+        p_Dest[i] = p_Src[i];
+    }
 
-    if (searchWindowPixelCount == 0) return 0.0; // Prevent return Nan
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        _mm_stream_si128((__m128i*) (p_Dest + i), _mm_loadu_si128((const __m128i*) (p_Src + i)));
+    }
 
-    return ComputeSumAreaForSearchWindow<uint32_t>(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaTable) / static_cast<double>(searchWindowPixelCount);
+    // Handle left-over
+    for (; i < p_Count; i++)
+    {
+        p_Dest[i] = p_Src[i];
+    }
 }
 
-int PixelSum::GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+void PixelSum::StoreRowSegment(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count, bool p_NonTemporal)
 {
-    return ComputeSumAreaForSearchWindow<uint32_t>(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaNonZeroTable);
+    // Plain copy of the bits, two u32 per entry
+    StoreRowSegment(reinterpret_cast<uint32_t*>(p_Dest), reinterpret_cast<const uint32_t*>(p_Src), 2 * p_Count, p_NonTemporal);
 }
 
-double PixelSum::GetNonZeroAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+void PixelSum::StoreRowSegmentInterleaved(uint32_t* p_Dest, const uint32_t* p_SrcSum, const uint32_t* p_SrcNonZero, int p_Count, bool p_NonTemporal)
 {
-    uint32_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+    int i = 0;
 
-    if (searchWindowPixelCount == 0) return 0.0;
+    // Streaming stores require 16 byte aligned destination, a pair is 8 bytes so at most one pair is peeled
+    if (p_NonTemporal && !VM_IS_ALIGNED(p_Dest, 16) && p_Count > 0)
+    {
+        p_Dest[0] = p_SrcSum[0];
+        p_Dest[1] = p_SrcNonZero[0];
+        i = 1;
+    }
 
-    return ComputeSumAreaForSearchWindow<uint32_t>(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaNonZeroTable) / static_cast<double>(searchWindowPixelCount);
-}
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        const __m128i sum = _mm_loadu_si128((const __m128i*) (p_SrcSum + i));
+        const __m128i nonZero = _mm_loadu_si128((const __m128i*) (p_SrcNonZero + i));
 
-template<typename T>
-void PixelSum::ComputePixelSum(PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf)
-{
-    // Horizontal prefix sum pass
-    PixelSumHorizontalPass<T>(p_OperationType, p_PixelBuffer, p_SumAreaPixBuf);
+        // { s0, n0, s1, n1 } { s2, n2, s3, n3 }
+        const __m128i low  = _mm_unpacklo_epi32(sum, nonZero);
+        const __m128i high = _mm_unpackhi_epi32(sum, nonZero);
+        if (p_NonTemporal)
+        {
+            _mm_stream_si128((__m128i*) (p_Dest + 2 * i), low);
+            _mm_stream_si128((__m128i*) (p_Dest + 2 * i + 4), high);
+        }
+        else
+        {
+            _mm_storeu_si128((__m128i*) (p_Dest + 2 * i), low);
+            _mm_storeu_si128((__m128i*) (p_Dest + 2 * i + 4), high);
+        }
+    }
 
-    // SIMD optimized vertical pass
-    PixelSumVerticalPass<T>(p_PixelBuffer, p_SumAreaPixBuf);
+    // Handle left-over
+    for (; i < p_Count; i++)
+    {
+        p_Dest[2 * i] = p_SrcSum[i];
+        p_Dest[2 * i + 1] = p_SrcNonZero[i];
+    }
 }
 
 template<typename T>
-void PixelSum::PixelSumHorizontalPass(PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixelBuffer/*, T* p_SumAreaNonZero*/)
+void PixelSum::PixelSumHorizontalPass(const PixelSumKernels& p_Kernels, PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixelBuffer, int p_RowCount)
 {
     if (!p_PixelBuffer || !p_SumAreaPixelBuffer) return;
 
     const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
-    const int srcPixBufHeight = m_SourcePixBufTLBR.height();
+    const int srcPixBufHeight = p_RowCount;
 
-    if (srcPixBufWidth * srcPixBufHeight == 0) return;
+    if (srcPixBufWidth == 0 || srcPixBufHeight == 0) return;
+
+    // Resolve the operation once, the row kernels are free of per pixel branches
+    const auto prefixScanRow = (p_OperationType == PixelSumOperationType::NonZeroElementCount) ? p_Kernels.prefixNonZeroRow : p_Kernels.prefixSumRow;
 
     T* sumAreaPtr = p_SumAreaPixelBuffer;
     const uint8_t* pixelBufferPtr = p_PixelBuffer;
     for (int row = 0; row < srcPixBufHeight; row++)
     {
-        for (int col = 0; col < srcPixBufWidth; col++)
-        {
-            *sumAreaPtr = (p_OperationType == PixelSumOperationType::NonZeroElementCount) ? ((*pixelBufferPtr == 0) ? 0 : 1) : *pixelBufferPtr;
-            *sumAreaPtr += (col == 0)/*isFirstCol*/ ? 0 : *(sumAreaPtr - 1);
+        prefixScanRow(pixelBufferPtr, sumAreaPtr, srcPixBufWidth);
 
-            pixelBufferPtr++;
-            sumAreaPtr++;
-        }
+        pixelBufferPtr += srcPixBufWidth;
+        sumAreaPtr += m_TablePitch;
     }
 }
 
 template<typename T>
-void PixelSum::PixelSumVerticalPass(const unsigned char* p_PixelBuffer, T* p_SumAreaPixelBuffer)
+void PixelSum::PixelSumVerticalPass(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, T* p_SumAreaPixelBuffer, int p_RowCount)
 {
     if (!p_PixelBuffer || !p_SumAreaPixelBuffer) return;
 
     const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
-    const int srcPixBufHeight = m_SourcePixBufTLBR.height();
+    const int srcPixBufHeight = p_RowCount;
 
-    if (srcPixBufWidth * srcPixBufHeight == 0) return;
+    if (srcPixBufWidth == 0 || srcPixBufHeight == 0) return;
 
     T* sumAreaPtr = p_SumAreaPixelBuffer;
     T* prevRow = nullptr;
@@ -164,62 +1785,19 @@ void PixelSum::PixelSumVerticalPass(const unsigned char* p_PixelBuffer, T* p_Sum
         currentRow = sumAreaPtr;
         if (row == 0) // Skip the first row, since we there is not previous row to add into
         {
-            sumAreaPtr += srcPixBufWidth;
+            sumAreaPtr += m_TablePitch;
             prevRow = currentRow;
             continue;
         }
 
-        SimdAddSSE(srcPixBufWidth, currentRow, prevRow);
+        // Rows of the padded tables start on a cache line, loads and stores are aligned
+        p_Kernels.addRow(currentRow, prevRow, srcPixBufWidth);
 
-        sumAreaPtr += srcPixBufWidth;
+        sumAreaPtr += m_TablePitch;
         prevRow = currentRow;
     }
 }
 
-void PixelSum::SimdAddSSE(int p_ArraySize, unsigned int* p_DestArray, unsigned int* p_SrcArray)
-{
-    int i = 0;
-#if 0 // For debugging SIMD arrays
-    std::cout<< "Before Curr =>";
-    for (int j = 0; j < p_ArraySize; ++j)
-    {
-        std::cout<< p_SrcArray[j] << ", ";
-    }
-    std::cout << std::endl;
-
-    std::cout<< "Before Prev =>";
-    for (int j = 0; j < p_ArraySize; ++j)
-    {
-        std::cout<< p_DestArray[j] << ", ";
-    }
-    std::cout << std::endl;
-    std::cout << "----------------------------------------"<<std::endl;
-#endif
-
-    const int leftOverSize = p_ArraySize % 4;
-    const int alignedSize = p_ArraySize - leftOverSize;
-    for (; i < alignedSize; i = i + 4)
-    {
-        // Load 128-bit chunks of each array
-        __m128i destValues = _mm_loadu_si128((__m128i*) (p_DestArray + i));
-        __m128i srcValues = _mm_loadu_si128((__m128i*) (p_SrcArray + i));
-
-        // Add each pair of 32-bit integers in the 128-bit chunks
-        destValues = _mm_add_epi32(destValues, srcValues);
-
-        // Store 128-bit chunk to destination array
-        _mm_storeu_si128((__m128i*) (p_DestArray + i), destValues);
-    }
-
-    if (leftOverSize == 0) return;
-
-    // Handle left-over
-    for (; i < p_ArraySize; i++)
-    {
-        *(p_DestArray + i) += *(p_SrcArray + i);
-    }
-}
-
 /********************************************************************************
         0              1              2               3      A => Area((0,0) To (1, 1))
       0 +--------------+------------------------------+
@@ -244,27 +1822,205 @@ void PixelSum::SimdAddSSE(int p_ArraySize, unsigned int* p_DestArray, unsigned i
                        C                              D
 *********************************************************************************/
 template<typename T>
-unsigned int PixelSum::ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, T* p_SumArea) const
+T PixelSum::ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, const T* p_SumArea, size_t p_TablePitch, size_t p_TableOrigin,
+                                          ptrdiff_t p_TableStride) const
 {
-    const T* sumAreaPtr = p_SumArea;
-    const int srcPixBufWidth  = m_SourcePixBufTLBR.width();
+    const T* sumAreaPtr = p_SumArea + p_TableOrigin;
+    const ptrdiff_t tablePitch  = static_cast<ptrdiff_t>(p_TablePitch);
+    const ptrdiff_t tableStride = p_TableStride;
+
+    // 64-bit offsets, y * width overflows 32 bits beyond 46340 x 46340 pixels
+    const ptrdiff_t y0Top  = (y0 - 1) * tablePitch;
+    const ptrdiff_t y1Row  = y1 * tablePitch;
+    const ptrdiff_t x0Left = (x0 - 1) * tableStride;
+    const ptrdiff_t x1Col  = x1 * tableStride;
 
-    const bool isX0AtFirstRow = (x0 == 0); // true: Area A and B is zero, no need to compute A and B
-    const bool isY0AtFirstCol = (y0 == 0); // true: Area A and C is zero, no need to compute A and C
+    if (IsPadded())
+    {
+        // Row -1 and column -1 are the zero border, no branches on the image border
+        return sumAreaPtr[y1Row + x1Col]      // Region D => (x1,     y1)
+             - sumAreaPtr[y1Row + x0Left]     // Region C => (x0 - 1, y1)
+             - sumAreaPtr[y0Top + x1Col]      // Region B => (x1,     y0 - 1)
+             + sumAreaPtr[y0Top + x0Left];    // Region A => (x0 - 1, y0 - 1)
+    }
 
-    uint32_t x0Left = (isX0AtFirstRow ? 0 : (x0 - 1));
-    uint32_t y0Top  = (isY0AtFirstCol ? 0 : ((y0 - 1) * srcPixBufWidth));
+    const bool isX0AtFirstCol = (x0 == 0); // true: Area A and C is zero, no need to compute A and C
+    const bool isY0AtFirstRow = (y0 == 0); // true: Area A and B is zero, no need to compute A and B
 
     // Summed Area => D - C - B + A
     T pixelSum = 0;
-    pixelSum += *(sumAreaPtr + (y1 * srcPixBufWidth + x1));                                 // Region D => (x1,     y1)
-    pixelSum -= isY0AtFirstCol ? 0 : *(sumAreaPtr + (y1 * srcPixBufWidth) + x0Left);        // Region C => (x0 - 1, y1)
-    pixelSum -= isX0AtFirstRow ? 0 : *(sumAreaPtr + y0Top + x1);                            // Region B => (x1,     y0 - 1)
-    pixelSum += (isX0AtFirstRow && isY0AtFirstCol) ? 0 : *(sumAreaPtr + y0Top + x0Left);    // Region A => (x0 - 1, y0 - 1)
+    pixelSum += sumAreaPtr[y1Row + x1Col];                                                  // Region D => (x1,     y1)
+    pixelSum -= isX0AtFirstCol ? 0 : sumAreaPtr[y1Row + x0Left];                            // Region C => (x0 - 1, y1)
+    pixelSum -= isY0AtFirstRow ? 0 : sumAreaPtr[y0Top + x1Col];                             // Region B => (x1,     y0 - 1)
+    pixelSum += (isX0AtFirstCol || isY0AtFirstRow) ? 0 : sumAreaPtr[y0Top + x0Left];        // Region A => (x0 - 1, y0 - 1)
 
     return pixelSum;
 }
 
+template<typename T>
+void PixelSum::ClearTableBorder(T* p_SumAreaPixBuf, size_t p_TablePitch, size_t p_TableOrigin)
+{
+    // Packed tables start with the entry of pixel (0, 0), there is no border
+    if (p_TableOrigin == 0 || !p_SumAreaPixBuf) return;
+
+    s_ClearPaddedTableBorder(p_SumAreaPixBuf, p_TablePitch, p_TableOrigin, static_cast<int>(m_SourcePixBufTLBR.height()));
+}
+
+bool PixelSum::AllocateSumAreaTables()
+{
+    // The storage owns whatever was allocated, also when one of the allocations fails
+    std::shared_ptr<PixelSumTableStorage> tableStorage = std::make_shared<PixelSumTableStorage>();
+    m_TableStorage = tableStorage;
+
+    if (HasSquaredSums())
+    {
+        if (!AllocateVirtualMemoryForSumAreaMatrix<uint64_t>(tableStorage->sumAreaSquaredTable, m_SquaredTableElementCount)) return false;
+
+        m_SumAreaSquaredTable = tableStorage->sumAreaSquaredTable;
+        ClearTableBorder(m_SumAreaSquaredTable, m_SquaredTablePitch, m_SquaredTableOrigin);
+    }
+
+    if (HasRotatedSums())
+    {
+        if (!AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(tableStorage->sumAreaRotatedRightTable, m_RotatedTableElementCount) ||
+            !AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(tableStorage->sumAreaRotatedLeftTable, m_RotatedTableElementCount)) return false;
+
+        m_SumAreaRotatedRightTable = tableStorage->sumAreaRotatedRightTable;
+        m_SumAreaRotatedLeftTable = tableStorage->sumAreaRotatedLeftTable;
+        ClearTableBorder(m_SumAreaRotatedRightTable, m_RotatedTablePitch, m_RotatedTableOrigin);
+        ClearTableBorder(m_SumAreaRotatedLeftTable, m_RotatedTablePitch, m_RotatedTableOrigin);
+    }
+
+    if (IsWideAccumulator())
+    {
+        if (!AllocateVirtualMemoryForSumAreaMatrix<uint64_t>(tableStorage->sumAreaTable64, m_TableElementCount) ||
+            !AllocateVirtualMemoryForSumAreaMatrix<uint64_t>(tableStorage->sumAreaNonZeroTable64, m_TableElementCount)) return false;
+
+        m_SumAreaTable64 = tableStorage->sumAreaTable64;
+        m_SumAreaNonZeroTable64 = tableStorage->sumAreaNonZeroTable64;
+        ClearTableBorder(m_SumAreaTable64, m_TablePitch, m_TableOrigin);
+        ClearTableBorder(m_SumAreaNonZeroTable64, m_TablePitch, m_TableOrigin);
+        return true;
+    }
+
+    if (m_Config.tableLayout == PixelSumTableLayout::Interleaved)
+    {
+        // Single allocation, the non-zero table is the odd element of each { sum, non-zero } pair
+        if (!AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(tableStorage->sumAreaTable, m_TableElementCount)) return false;
+
+        m_SumAreaTable = tableStorage->sumAreaTable;
+        m_SumAreaNonZeroTable = m_SumAreaTable + 1;
+        ClearTableBorder(m_SumAreaTable, m_TablePitch, m_TableOrigin);
+        return true;
+    }
+
+    if (!AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(tableStorage->sumAreaTable, m_TableElementCount) ||
+        !AllocateVirtualMemoryForSumAreaMatrix<uint32_t>(tableStorage->sumAreaNonZeroTable, m_TableElementCount)) return false;
+
+    m_SumAreaTable = tableStorage->sumAreaTable;
+    m_SumAreaNonZeroTable = tableStorage->sumAreaNonZeroTable;
+    ClearTableBorder(m_SumAreaTable, m_TablePitch, m_TableOrigin);
+    ClearTableBorder(m_SumAreaNonZeroTable, m_TablePitch, m_TableOrigin);
+    return true;
+}
+
+void PixelSum::FreeSumAreaTables()
+{
+    // The pool blocks are freed with the last PixelSum referencing them
+    m_TableStorage.reset();
+
+    m_SumAreaTable = nullptr;
+    m_SumAreaNonZeroTable = nullptr;
+    m_SumAreaTable64 = nullptr;
+    m_SumAreaNonZeroTable64 = nullptr;
+    m_SumAreaSquaredTable = nullptr;
+    m_SumAreaRotatedRightTable = nullptr;
+    m_SumAreaRotatedLeftTable = nullptr;
+}
+
+void PixelSum::CopySumAreaTables(const PixelSum& p_PixelSum)
+{
+    if (!p_PixelSum.m_TableStorage) return;
+
+    if (m_Config.tableSharing == PixelSumTableSharing::CopyOnWrite)
+    {
+        // Another reference to the same tables, no allocation and no copy
+        m_TableStorage = p_PixelSum.m_TableStorage;
+        m_SumAreaTable = p_PixelSum.m_SumAreaTable;
+        m_SumAreaNonZeroTable = p_PixelSum.m_SumAreaNonZeroTable;
+        m_SumAreaTable64 = p_PixelSum.m_SumAreaTable64;
+        m_SumAreaNonZeroTable64 = p_PixelSum.m_SumAreaNonZeroTable64;
+        m_SumAreaSquaredTable = p_PixelSum.m_SumAreaSquaredTable;
+        m_SumAreaRotatedRightTable = p_PixelSum.m_SumAreaRotatedRightTable;
+        m_SumAreaRotatedLeftTable = p_PixelSum.m_SumAreaRotatedLeftTable;
+        return;
+    }
+
+    if (!AllocateSumAreaTables()) return;
+
+    CopyTableContent(p_PixelSum.m_SumAreaTable, p_PixelSum.m_SumAreaNonZeroTable, p_PixelSum.m_SumAreaTable64, p_PixelSum.m_SumAreaNonZeroTable64,
+                     p_PixelSum.m_SumAreaSquaredTable, p_PixelSum.m_SumAreaRotatedRightTable, p_PixelSum.m_SumAreaRotatedLeftTable);
+}
+
+void PixelSum::CopyTableContent(const uint32_t* p_SumAreaTable, const uint32_t* p_SumAreaNonZeroTable,
+                                const uint64_t* p_SumAreaTable64, const uint64_t* p_SumAreaNonZeroTable64,
+                                const uint64_t* p_SumAreaSquaredTable, const uint32_t* p_SumAreaRotatedRightTable,
+                                const uint32_t* p_SumAreaRotatedLeftTable)
+{
+    if (m_SumAreaSquaredTable)
+    {
+        memcpy(m_SumAreaSquaredTable, p_SumAreaSquaredTable, m_SquaredTableElementCount * sizeof(uint64_t));
+    }
+
+    if (m_SumAreaRotatedRightTable)
+    {
+        memcpy(m_SumAreaRotatedRightTable, p_SumAreaRotatedRightTable, m_RotatedTableElementCount * sizeof(uint32_t));
+        memcpy(m_SumAreaRotatedLeftTable, p_SumAreaRotatedLeftTable, m_RotatedTableElementCount * sizeof(uint32_t));
+    }
+
+    if (IsWideAccumulator())
+    {
+        memcpy(m_SumAreaTable64, p_SumAreaTable64, m_TableElementCount * sizeof(uint64_t));
+        memcpy(m_SumAreaNonZeroTable64, p_SumAreaNonZeroTable64, m_TableElementCount * sizeof(uint64_t));
+        return;
+    }
+
+    if (m_Config.tableLayout == PixelSumTableLayout::Interleaved)
+    {
+        memcpy(m_SumAreaTable, p_SumAreaTable, m_TableElementCount * sizeof(uint32_t));
+        return;
+    }
+
+    memcpy(m_SumAreaTable, p_SumAreaTable, m_TableElementCount * sizeof(uint32_t));
+    memcpy(m_SumAreaNonZeroTable, p_SumAreaNonZeroTable, m_TableElementCount * sizeof(uint32_t));
+}
+
+bool PixelSum::DetachSharedTables(bool p_KeepContent)
+{
+    if (!m_TableStorage || (m_TableStorage.use_count() == 1 && !m_TableStorage->mappedAddress)) return true;
+
+    // The other owners keep the shared storage alive until the content is copied
+    const std::shared_ptr<PixelSumTableStorage> sharedStorage = m_TableStorage;
+    const uint32_t* sumAreaTable = m_SumAreaTable;
+    const uint32_t* sumAreaNonZeroTable = m_SumAreaNonZeroTable;
+    const uint64_t* sumAreaTable64 = m_SumAreaTable64;
+    const uint64_t* sumAreaNonZeroTable64 = m_SumAreaNonZeroTable64;
+    const uint64_t* sumAreaSquaredTable = m_SumAreaSquaredTable;
+    const uint32_t* sumAreaRotatedRightTable = m_SumAreaRotatedRightTable;
+    const uint32_t* sumAreaRotatedLeftTable = m_SumAreaRotatedLeftTable;
+
+    FreeSumAreaTables();
+    if (!AllocateSumAreaTables()) return false;
+
+    if (p_KeepContent)
+    {
+        CopyTableContent(sumAreaTable, sumAreaNonZeroTable, sumAreaTable64, sumAreaNonZeroTable64, sumAreaSquaredTable,
+                         sumAreaRotatedRightTable, sumAreaRotatedLeftTable);
+    }
+
+    return true;
+}
+
 template<typename T>
 bool PixelSum::AllocateVirtualMemoryForSumAreaMatrix(T*& p_SumAreaMatrix, size_t p_AllocSize)
 {
@@ -272,3 +2028,227 @@ bool PixelSum::AllocateVirtualMemoryForSumAreaMatrix(T*& p_SumAreaMatrix, size_t
 
     return p_SumAreaMatrix != nullptr;
 }
+
+void PixelSum::ResolveTableGeometries(int p_Width, int p_Height)
+{
+    s_ResolveTableGeometry(p_Width, p_Height, m_Config, m_TablePitch, m_TableOrigin, m_TableElementCount);
+
+    // The squared pixel table is laid out like a planar wide accumulator table
+    if (HasSquaredSums())
+    {
+        PixelSumConfig squaredConfig = m_Config;
+        squaredConfig.accumulator = PixelSumAccumulator::Wide64;
+        s_ResolveTableGeometry(p_Width, p_Height, squaredConfig, m_SquaredTablePitch, m_SquaredTableOrigin, m_SquaredTableElementCount);
+    }
+
+    // The rotated tables read the zero column on the left and the entries right of the image row, always padded
+    if (HasRotatedSums())
+    {
+        PixelSumConfig rotatedConfig = m_Config;
+        rotatedConfig.accumulator  = PixelSumAccumulator::Wraparound32;
+        rotatedConfig.tableLayout  = PixelSumTableLayout::Planar;
+        rotatedConfig.tablePadding = PixelSumTablePadding::Padded;
+        s_ResolveTableGeometry(p_Width, p_Height, rotatedConfig, m_RotatedTablePitch, m_RotatedTableOrigin, m_RotatedTableElementCount);
+    }
+}
+
+void PixelSum::GetTableSlots(const void* p_Tables[TABLE_SLOT_COUNT], size_t p_ByteSizes[TABLE_SLOT_COUNT]) const
+{
+    const bool isInterleaved = (m_Config.tableLayout == PixelSumTableLayout::Interleaved);
+
+    // The interleaved { sum, non-zero } pairs are a single table in the pixel sum slot
+    const void* tables[TABLE_SLOT_COUNT] = { m_SumAreaTable, isInterleaved ? nullptr : m_SumAreaNonZeroTable, m_SumAreaTable64,
+                                             m_SumAreaNonZeroTable64, m_SumAreaSquaredTable, m_SumAreaRotatedRightTable,
+                                             m_SumAreaRotatedLeftTable };
+    const size_t byteSizes[TABLE_SLOT_COUNT] =
+    {
+        IsWideAccumulator() ? 0 : m_TableElementCount * sizeof(uint32_t),
+        (IsWideAccumulator() || isInterleaved) ? 0 : m_TableElementCount * sizeof(uint32_t),
+        IsWideAccumulator() ? m_TableElementCount * sizeof(uint64_t) : 0,
+        IsWideAccumulator() ? m_TableElementCount * sizeof(uint64_t) : 0,
+        HasSquaredSums() ? m_SquaredTableElementCount * sizeof(uint64_t) : 0,
+        HasRotatedSums() ? m_RotatedTableElementCount * sizeof(uint32_t) : 0,
+        HasRotatedSums() ? m_RotatedTableElementCount * sizeof(uint32_t) : 0,
+    };
+
+    for (int slot = 0; slot < TABLE_SLOT_COUNT; slot++)
+    {
+        p_Tables[slot] = tables[slot];
+        p_ByteSizes[slot] = byteSizes[slot];
+    }
+}
+
+bool PixelSum::SaveTables(const char* p_FilePath) const
+{
+    static_assert(TABLE_SLOT_COUNT == PIXELSUM_FILE_TABLE_SLOTS, "Table slots of the file format");
+
+    if (!p_FilePath || (!m_SumAreaTable && !m_SumAreaTable64)) return false;
+
+    // The file holds complete tables
+    EnsureTableRows(PixelSumOperationType::SummedAreaTable, m_SourcePixBufTLBR.bottom);
+    EnsureTableRows(PixelSumOperationType::NonZeroElementCount, m_SourcePixBufTLBR.bottom);
+    if (HasSquaredSums()) EnsureTableRows(PixelSumOperationType::SquaredSum, m_SourcePixBufTLBR.bottom);
+    if (HasRotatedSums()) EnsureTableRows(PixelSumOperationType::RotatedSum, m_SourcePixBufTLBR.bottom);
+
+    const void* tables[TABLE_SLOT_COUNT];
+    size_t byteSizes[TABLE_SLOT_COUNT];
+    GetTableSlots(tables, byteSizes);
+
+    PixelSumFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, PIXELSUM_FILE_MAGIC, sizeof(header.magic));
+    header.version      = PIXELSUM_FILE_VERSION;
+    header.byteOrder    = PIXELSUM_FILE_BYTE_ORDER;
+    header.width        = m_SourcePixBufTLBR.width();
+    header.height       = m_SourcePixBufTLBR.height();
+    header.tableLayout  = static_cast<uint32_t>(m_Config.tableLayout);
+    header.tablePadding = static_cast<uint32_t>(m_Config.tablePadding);
+    header.accumulator  = static_cast<uint32_t>(m_Config.accumulator);
+    header.squaredSums  = static_cast<uint32_t>(m_Config.squaredSums);
+    header.rotatedSums  = static_cast<uint32_t>(m_Config.rotatedSums);
+
+    uint64_t payloadOffset = PIXELSUM_FILE_ALIGNMENT;
+    for (int slot = 0; slot < TABLE_SLOT_COUNT; slot++)
+    {
+        if (byteSizes[slot] == 0) continue;
+
+        header.payloadOffsets[slot] = payloadOffset;
+        header.payloadByteSizes[slot] = byteSizes[slot];
+        header.payloadChecksum = s_FileChecksum(tables[slot], byteSizes[slot], header.payloadChecksum);
+        payloadOffset += (byteSizes[slot] + PIXELSUM_FILE_ALIGNMENT - 1) / PIXELSUM_FILE_ALIGNMENT * PIXELSUM_FILE_ALIGNMENT;
+    }
+    header.headerChecksum = s_FileChecksum(&header, offsetof(PixelSumFileHeader, headerChecksum), 0);
+
+    FILE* file = fopen(p_FilePath, "wb");
+    if (!file) return false;
+
+    // Header and payloads are padded with zeros up to the next payload
+    const std::vector<unsigned char> padding(PIXELSUM_FILE_ALIGNMENT, 0);
+    bool isWritten = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+                     (fwrite(padding.data(), PIXELSUM_FILE_ALIGNMENT - sizeof(header), 1, file) == 1);
+    for (int slot = 0; isWritten && slot < TABLE_SLOT_COUNT; slot++)
+    {
+        if (byteSizes[slot] == 0) continue;
+
+        const size_t paddingByteSize = (PIXELSUM_FILE_ALIGNMENT - byteSizes[slot] % PIXELSUM_FILE_ALIGNMENT) % PIXELSUM_FILE_ALIGNMENT;
+        isWritten = (fwrite(tables[slot], byteSizes[slot], 1, file) == 1) &&
+                    (paddingByteSize == 0 || fwrite(padding.data(), paddingByteSize, 1, file) == 1);
+    }
+
+    isWritten = (fclose(file) == 0) && isWritten;
+    if (!isWritten) remove(p_FilePath);
+
+    return isWritten;
+}
+
+bool PixelSum::MapTables(const char* p_FilePath, PixelSumFileVerification p_Verification)
+{
+    if (!p_FilePath) return false;
+
+    const int file = open(p_FilePath, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat fileStat;
+    void* mappedAddress = MAP_FAILED;
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size >= static_cast<off_t>(sizeof(PixelSumFileHeader)))
+    {
+        mappedAddress = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_SHARED, file, 0);
+    }
+
+    // The mapping keeps its own reference to the file
+    close(file);
+    if (mappedAddress == MAP_FAILED) return false;
+
+    // The storage unmaps the file on every early return below
+    std::shared_ptr<PixelSumTableStorage> tableStorage = std::make_shared<PixelSumTableStorage>();
+    tableStorage->mappedAddress = mappedAddress;
+    tableStorage->mappedByteSize = static_cast<size_t>(fileStat.st_size);
+
+    PixelSumFileHeader header;
+    memcpy(&header, mappedAddress, sizeof(header));
+    if (memcmp(header.magic, PIXELSUM_FILE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PIXELSUM_FILE_VERSION || header.byteOrder != PIXELSUM_FILE_BYTE_ORDER ||
+        header.headerChecksum != s_FileChecksum(&header, offsetof(PixelSumFileHeader, headerChecksum), 0))
+    {
+        return false;
+    }
+
+    if (header.width <= 0 || header.height <= 0 ||
+        header.tableLayout > static_cast<uint32_t>(PixelSumTableLayout::Interleaved) ||
+        header.tablePadding > static_cast<uint32_t>(PixelSumTablePadding::Padded) ||
+        header.accumulator > static_cast<uint32_t>(PixelSumAccumulator::Wide64) ||
+        header.squaredSums > static_cast<uint32_t>(PixelSumSquaredSums::Enabled) ||
+        header.rotatedSums > static_cast<uint32_t>(PixelSumRotatedSums::Enabled))
+    {
+        return false;
+    }
+
+    // Geometry of the tables of the file configuration, the build options of this PixelSum are kept
+    PixelSum mappedPixelSum;
+    mappedPixelSum.m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, header.height - 1, header.width - 1);
+    mappedPixelSum.m_Config              = m_Config;
+    mappedPixelSum.m_Config.tableLayout  = static_cast<PixelSumTableLayout>(header.tableLayout);
+    mappedPixelSum.m_Config.tablePadding = static_cast<PixelSumTablePadding>(header.tablePadding);
+    mappedPixelSum.m_Config.accumulator  = static_cast<PixelSumAccumulator>(header.accumulator);
+    mappedPixelSum.m_Config.squaredSums  = static_cast<PixelSumSquaredSums>(header.squaredSums);
+    mappedPixelSum.m_Config.rotatedSums  = static_cast<PixelSumRotatedSums>(header.rotatedSums);
+    mappedPixelSum.m_Config.buildTiming  = PixelSumBuildTiming::Eager;
+    mappedPixelSum.m_Config.tableSharing = PixelSumTableSharing::CopyOnWrite;
+    mappedPixelSum.ResolveTableGeometries(header.width, header.height);
+
+    const void* tables[TABLE_SLOT_COUNT];
+    size_t byteSizes[TABLE_SLOT_COUNT];
+    mappedPixelSum.GetTableSlots(tables, byteSizes);
+
+    // Every table of the configuration is in the file with the expected size, page aligned
+    void* mappedTables[TABLE_SLOT_COUNT] = {};
+    uint64_t payloadChecksum = 0;
+    for (int slot = 0; slot < TABLE_SLOT_COUNT; slot++)
+    {
+        const uint64_t payloadOffset = header.payloadOffsets[slot];
+        if (header.payloadByteSizes[slot] != byteSizes[slot]) return false;
+        if (byteSizes[slot] == 0) continue;
+
+        if (payloadOffset % PIXELSUM_FILE_ALIGNMENT != 0 || payloadOffset < sizeof(header) ||
+            payloadOffset > tableStorage->mappedByteSize || tableStorage->mappedByteSize - payloadOffset < byteSizes[slot])
+        {
+            return false;
+        }
+
+        mappedTables[slot] = static_cast<unsigned char*>(mappedAddress) + payloadOffset;
+        if (p_Verification == PixelSumFileVerification::Full)
+        {
+            payloadChecksum = s_FileChecksum(mappedTables[slot], byteSizes[slot], payloadChecksum);
+        }
+    }
+
+    if (p_Verification == PixelSumFileVerification::Full && payloadChecksum != header.payloadChecksum) return false;
+
+    mappedPixelSum.m_TableStorage = tableStorage;
+    mappedPixelSum.m_SumAreaTable             = static_cast<uint32_t*>(mappedTables[0]);
+    mappedPixelSum.m_SumAreaNonZeroTable      = static_cast<uint32_t*>(mappedTables[1]);
+    mappedPixelSum.m_SumAreaTable64           = static_cast<uint64_t*>(mappedTables[2]);
+    mappedPixelSum.m_SumAreaNonZeroTable64    = static_cast<uint64_t*>(mappedTables[3]);
+    mappedPixelSum.m_SumAreaSquaredTable      = static_cast<uint64_t*>(mappedTables[4]);
+    mappedPixelSum.m_SumAreaRotatedRightTable = static_cast<uint32_t*>(mappedTables[5]);
+    mappedPixelSum.m_SumAreaRotatedLeftTable  = static_cast<uint32_t*>(mappedTables[6]);
+
+    // The non-zero table is the odd element of each { sum, non-zero } pair
+    if (mappedPixelSum.m_Config.tableLayout == PixelSumTableLayout::Interleaved && mappedPixelSum.m_SumAreaTable)
+    {
+        mappedPixelSum.m_SumAreaNonZeroTable = mappedPixelSum.m_SumAreaTable + 1;
+    }
+
+    const int height = header.height;
+    mappedPixelSum.m_BuiltRowCount[0] = mappedPixelSum.m_BuiltRowCount[1] = height;
+    mappedPixelSum.m_BuiltRowCount[2] = mappedPixelSum.m_BuiltRowCount[3] = height;
+
+    *this = std::move(mappedPixelSum);
+
+    return true;
+}
+
+bool PixelSum::IsMapped() const
+{
+    return m_TableStorage && m_TableStorage->mappedAddress;
+}
@@ -1,9 +1,15 @@
 #pragma once
 
 #include <stdint.h>
+#include <atomic>
 #include <cstddef>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 #include "CustomTypes.h"
+#include "PixelSumKernels.h"
 
 //----------------------------------------------------------------------------
 // Class for providing fast region queries from an 8-bit pixel buffer.
@@ -17,63 +23,454 @@
 // If the resulting region after clamping is empty, the return value for all
 // functions should be 0.
 //
-// The width and height of the buffer dimensions < 4096 x 4096.
+// The width and height of the buffer are only limited by the int coordinates
+// and the preallocated memory pools, all the offsets are computed in 64-bit.
+// With the default wraparound accumulator the 32-bit results are exact as long
+// as the region sum fits in 32 bits, i.e. always for regions of up to
+// 16843009 (2^32 / 255) pixels. The same holds for the averages, they divide
+// the region sum modulo 2^32. Use the wide accumulator and GetPixelSum64()
+// for larger sums.
 //----------------------------------------------------------------------------
 
+// Strategy used for building the summed area tables (SAT).
+enum class PixelSumBuildMode
+{
+    TwoPass,    // Horizontal pass followed by vertical pass, executed separately for each table
+    FusedTiled, // Single read of the pixel buffer, both tables are produced tile by tile while hot in cache
+};
+
+// Memory layout of the pixel sum and non-zero summed area tables.
+enum class PixelSumTableLayout
+{
+    Planar,      // Two separate tables of width x height entries
+    Interleaved, // One table of { sum, non-zero } pairs, both values of a pixel share a cache line. Always built fused.
+};
+
+// Row layout of the summed area tables. A padded table is larger than width x height entries, for power of two
+// images it takes the next power of two pool block i.e. twice the memory of a packed table.
+enum class PixelSumTablePadding
+{
+    Packed, // Exactly width entries per row, queries on the image border skip the missing corners
+    Padded, // Leading zero row and zero column, rows aligned to 64 bytes with a pitch of an odd number of cache lines.
+            // Required by PixelSumCascade.
+};
+
+// Accumulator width of the summed area tables.
+enum class PixelSumAccumulator
+{
+    Wraparound32, // u32 entries with modular arithmetic, D - C - B + A is exact whenever the region sum fits in 32 bits
+    Wide64,       // u64 entries, exact for any region at twice the memory. Always planar.
+};
+
+// When the summed area tables are built.
+enum class PixelSumBuildTiming
+{
+    Eager, // Both tables are built by the constructor
+    Lazy,  // Each table is built on its first query, down to the lowest row queried so far. Always planar, the
+           // pixel buffer must stay valid and unchanged for the lifetime of the PixelSum.
+};
+
+// What a copy of a PixelSum does with the summed area tables.
+enum class PixelSumTableSharing
+{
+    DeepCopy,    // Every copy allocates and copies its own tables
+    CopyOnWrite, // Copies share the immutable tables through a reference count, a copy which is updated (e.g.
+                 // UpdateRegion(..) or Rebuild(..)) gets its own tables first. Lazy tables are completed before
+                 // they are shared.
+};
+
+// Optional summed area table of the squared pixels, needed by the variance and standard deviation queries.
+enum class PixelSumSquaredSums
+{
+    Disabled,
+    Enabled,  // Additional planar u64 table built in the same pass as the pixel sum table, exact for any region.
+              // It has the size of a PixelSumAccumulator::Wide64 table.
+};
+
+// Optional rotated (45 degree) summed area tables, needed by the tilted rectangle queries e.g. the extended Haar
+// features of an object detector.
+enum class PixelSumRotatedSums
+{
+    Disabled,
+    Enabled,  // Two additional planar padded u32 tables, prefix sums of the row prefixes along both diagonals. Same
+              // wraparound arithmetic as PixelSumAccumulator::Wraparound32 whatever the accumulator.
+};
+
+// Integrity checks of a table file mapped by PixelSum::MapTables(..).
+enum class PixelSumFileVerification
+{
+    Header, // Format, version and the checksum of the header, the tables are not read and the start up costs only
+            // the page faults of the first queries
+    Full,   // Also the checksum of the tables, reads the whole file once
+};
+
+// Construction options for PixelSum, defaults are the fastest known configuration.
+struct PixelSumConfig
+{
+    PixelSumBuildMode buildMode = PixelSumBuildMode::FusedTiled;
+    PixelSumSimdLevel simdLevel = PixelSumSimdLevel::Auto; // Override the CPUID dispatch e.g. for benchmarking
+    unsigned int threadCount    = 0;                       // Threads building the SAT, 0 uses all hardware threads
+    PixelSumTableLayout tableLayout = PixelSumTableLayout::Planar;
+    PixelSumAccumulator accumulator = PixelSumAccumulator::Wraparound32;
+    PixelSumTablePadding tablePadding = PixelSumTablePadding::Packed;
+    PixelSumBuildTiming buildTiming = PixelSumBuildTiming::Eager;
+    PixelSumTableSharing tableSharing = PixelSumTableSharing::DeepCopy;
+    PixelSumSquaredSums squaredSums = PixelSumSquaredSums::Disabled;
+    PixelSumRotatedSums rotatedSums = PixelSumRotatedSums::Disabled;
+};
+
+// Pool blocks of the summed area tables, returned to the memory pools with their last owner.
+struct PixelSumTableStorage;
+
+// Output arrays of the batched region query, one entry per region. Outputs left as nullptr are skipped.
+struct PixelSumBatchOutput
+{
+    unsigned int* pixelSums       = nullptr;
+    double*       pixelAverages   = nullptr;
+    int*          nonZeroCounts   = nullptr;
+    double*       nonZeroAverages = nullptr;
+    double*       pixelVariances  = nullptr; // Requires PixelSumSquaredSums::Enabled, 0 otherwise
+    double*       pixelStdDevs    = nullptr;
+};
+
+// Source of a frame arriving in row order, e.g. a file or a socket: fills rows [p_RowBegin, p_RowEnd) of the frame
+// at p_Rows and returns false when the rows cannot be read.
+using PixelSumRowReader = std::function<bool(unsigned char* p_Rows, int p_RowBegin, int p_RowEnd)>;
+
+// All the statistics of a region returned by a single query.
+struct PixelSumRegionStats
+{
+    unsigned int pixelSum     = 0;
+    double       pixelAverage = 0.0;
+    int          nonZeroCount = 0;
+    double       nonZeroAverage = 0.0;
+    double       pixelVariance  = 0.0; // Requires PixelSumSquaredSums::Enabled, 0 otherwise
+};
+
 // Simd optimize and thread scalable PixelSum implementation.
 // The implementation precomputes the summed area table (SAT) using horizontal and vertical pass.
 class PixelSum
 {
 public:
     PixelSum() = default;
-    PixelSum(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight);
+    PixelSum(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, const PixelSumConfig& p_Config = PixelSumConfig());
     ~PixelSum(void);
 
     PixelSum(const PixelSum& p_PixelSum);
     PixelSum& operator= (const PixelSum& p_PixelSum);
 
+    /*!
+     * Transfer the tables without allocation or copy, the moved from PixelSum is left empty.
+     */
+    PixelSum(PixelSum&& p_PixelSum) noexcept;
+    PixelSum& operator= (PixelSum&& p_PixelSum) noexcept;
+
+    /*!
+     * Recompute the tables from a new pixel buffer of the same dimensions, the table allocations are reused.
+     * Returns false when the tables are not allocated.
+     */
+    bool Rebuild(const unsigned char* p_Buffer);
+
+    /*!
+     * Rebuild(..) from a frame which is read into p_Buffer while the tables are built: p_ReadRows reads bands of
+     * rows on a reader thread and the band local tables of every band are built as soon as it arrives, the I/O
+     * overlaps the build. Lazy tables wait for the whole frame. Returns false when the tables are not allocated
+     * or a read fails, the tables are then incomplete.
+     */
+    bool Rebuild(unsigned char* p_Buffer, const PixelSumRowReader& p_ReadRows);
+
     // Note: I have changed the signatures of function and arguments to stick with same coding style through out.
     // Please refer to 'Coding style and guidelines' in the test assignment document more detailed info.
 
+    // With the wraparound accumulator the sum and the average are exact as long as the region sum fits in 32 bits
     unsigned int GetPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
     double GetPixelAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
 
     int GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
     double GetNonZeroAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
 
+    /*!
+     * 64-bit versions of GetPixelSum(..) and GetNonZeroCount(..). Exact for any region with the wide accumulator,
+     * with the wraparound accumulator the result is the region sum modulo 2^32.
+     */
+    uint64_t GetPixelSum64(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+    uint64_t GetNonZeroCount64(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Population variance and standard deviation of the pixels of a region in O(1), from the pixel sum and the
+     * squared pixel tables. Like the averages they are taken over the unclamped region, i.e. the pixels outside
+     * the image count as zero. Requires PixelSumSquaredSums::Enabled, returns 0 otherwise. With the wraparound
+     * accumulator the pixel sum must fit in 32 bits, see GetPixelSum64(..).
+     */
+    double GetPixelVariance(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+    double GetPixelStdDev(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Squared pixel sum of a region, exact for any region. Returns 0 without the squared pixel table.
+     */
+    uint64_t GetSquaredPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Pixel sum of a rectangle rotated by 45 degrees in O(1), as used by the tilted Haar features. The top corner
+     * is pixel (p_X, p_Y), the sides go p_Width steps down-right and p_Height steps down-left, the 2 x width x
+     * height pixels (x, y) with 0 <= (x - p_X) + (y - p_Y) < 2 x width and 0 <= (p_X - x) + (y - p_Y) < 2 x
+     * height are summed, e.g. width = height = 1 is pixel (p_X, p_Y) and the pixel below it. Like the axis
+     * aligned queries the pixels outside the image count as zero and the sum is exact whenever it fits in 32 bits.
+     * Requires PixelSumRotatedSums::Enabled, returns 0 otherwise or when the width or height is not positive.
+     */
+    unsigned int GetRotatedPixelSum(int p_X, int p_Y, int p_Width, int p_Height) const;
+
+    /*!
+     * Sum, non-zero count and both averages of a region with a single clip. With the interleaved table layout
+     * the query touches only the four corner cache lines. With the wraparound accumulator the pixel average is
+     * taken from the sum modulo 2^32 like GetPixelAverage(..), it is exact whenever the region sum fits in 32 bits.
+     */
+    PixelSumRegionStats GetRegionStats(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Batched version of the above queries, for each region writes the same values as the individual calls
+     * into the requested output arrays. Clipping, corner fetches and D-C-B+A are evaluated with SIMD gathers
+     * and masks, and the corners of the upcoming regions are prefetched. The 32-bit outputs hold the low bits of
+     * the sums and the averages are those of the individual calls, i.e. with the wraparound accumulator the pixel
+     * averages are exact only for region sums below 2^32. The variances gather the corners of the squared pixel
+     * table in the same pass, at the same clipped coordinates as the pixel sums.
+     */
+    void GetRegionsBatch(const PixelBufferCoords_i* p_Regions, size_t p_RegionCount, const PixelSumBatchOutput& p_Output) const;
+
+    /*!
+     * Dense box filter, the mean of a p_WindowWidth x p_WindowHeight window around every p_Stride-th pixel of every
+     * p_Stride-th row. p_Output receives ceil(width / p_Stride) x ceil(height / p_Stride) values row by row, output
+     * (ox, oy) is the window with the top left pixel (ox x p_Stride - p_WindowWidth / 2, oy x p_Stride -
+     * p_WindowHeight / 2). Like GetPixelAverage(..) the pixels outside the image count as zero. The float output is
+     * the average rounded to float, the u8 output is the average rounded to nearest and the u16 output the average
+     * in 8.8 fixed point, rounded to nearest. The output rows are split over the configured threads, the interior
+     * windows of a row are evaluated with SIMD loads of the two table rows and the border windows are clamped.
+     * Returns false for an empty window or stride, a null output or when the tables are not allocated.
+     */
+    bool ComputeBoxFilter(int p_WindowWidth, int p_WindowHeight, int p_Stride, unsigned char* p_Output) const;
+    bool ComputeBoxFilter(int p_WindowWidth, int p_WindowHeight, int p_Stride, uint16_t* p_Output) const;
+    bool ComputeBoxFilter(int p_WindowWidth, int p_WindowHeight, int p_Stride, float* p_Output) const;
+
+    /*!
+     * Geometry and entries of the u32 tables and of the squared pixel table, for code addressing the entries
+     * directly e.g. the compiled cascade of PixelSumCascade. Lazy tables are completed first. The view stays valid
+     * until the PixelSum is modified, moved or destroyed. Returns false with the wide accumulator or when the
+     * tables are not allocated.
+     */
+    bool GetQueryTables(PixelSumQueryTables& p_Tables) const;
+
+    /*!
+     * Patch the summed area tables after the pixels of a region changed, e.g. an overlay or a moving object of a
+     * video frame. p_NewPixels holds the (x1 - x0 + 1) x (y1 - y0 + 1) new pixels of the unclamped region row by
+     * row. The old pixels are recovered from the tables and only the entries right of and below (x0, y0) change.
+     * Returns false when the region is outside the image or the tables are not allocated.
+     */
+    bool UpdateRegion(int p_X0, int p_Y0, int p_X1, int p_Y1, const unsigned char* p_NewPixels);
+
+    /*!
+     * Several dirty regions of one frame, p_Frame is the complete new frame. Overlapping regions are merged so
+     * every changed pixel is applied once, the rows below all the regions are updated in one parallel pass.
+     */
+    bool UpdateRegions(const PixelBufferCoords_i* p_Regions, size_t p_RegionCount, const unsigned char* p_Frame);
+
+    /*!
+     * Write the tables to a versioned file for a warm start with MapTables(..): a header with the dimensions, the
+     * table set and layout and the checksums, followed by the tables as they are in memory, each starting on a
+     * page boundary. Lazy tables are completed first. Returns false when the tables are not allocated or the file
+     * cannot be written.
+     */
+    bool SaveTables(const char* p_FilePath) const;
+
+    /*!
+     * Replace the tables with a read-only mapping of a file written by SaveTables(..), the queries read the
+     * mapping directly without copy or build and several processes mapping the same file share the page cache.
+     * The table set, layout, padding and accumulator are taken from the file, the tables are eager and copies
+     * share the mapping (PixelSumTableSharing::CopyOnWrite). Rebuild(..) and UpdateRegion(..) move the tables to
+     * the memory pools first, the file is never written. Returns false and leaves the PixelSum unchanged when the
+     * file cannot be mapped, has another format, version or byte order, or fails the verification.
+     */
+    bool MapTables(const char* p_FilePath, PixelSumFileVerification p_Verification = PixelSumFileVerification::Header);
+
+    /*!
+     * True when the tables are read from a file mapping
+     */
+    bool IsMapped() const;
+
+    /*!
+     * Size in bytes of a single summed area table allocation for the given image and configuration, the planar
+     * layout makes two of them. Meant for sizing the preallocated memory pools.
+     */
+    static size_t GetTableByteSize(int p_Width, int p_Height, const PixelSumConfig& p_Config = PixelSumConfig());
+
 private:
     enum class PixelSumOperationType
     {
         SummedAreaTable     = (1u << 0u),
         NonZeroElementCount = (1u << 1u),
+        SquaredSum          = (1u << 2u),
+        RotatedSum          = (1u << 3u),
     };
 
+    // Tables of the file format: pixel sum, non-zero, wide pixel sum, wide non-zero, squared, rotated right and left
+    static constexpr int TABLE_SLOT_COUNT = 7;
+
+    /*!
+     * Pitch, origin and allocation size of all the tables of the configuration
+     */
+    void ResolveTableGeometries(int p_Width, int p_Height);
+
+    /*!
+     * Entries and byte sizes of the tables in the slot order of the file format, nullptr and 0 for the tables of
+     * other configurations
+     */
+    void GetTableSlots(const void* p_Tables[TABLE_SLOT_COUNT], size_t p_ByteSizes[TABLE_SLOT_COUNT]) const;
+
+    /*!
+     * Add the carry of every band after the first one to the band local tables of ComputePixelSumBand(..) and
+     * ComputePixelSumBandWide(..), the last row of the first band must be final. p_BandRowBegin holds the first
+     * row of every band followed by the row count.
+     */
+    void AddBandCarries(const PixelSumKernels& p_Kernels, const std::vector<int>& p_BandRowBegin);
+
+    /*!
+     * Build both summed area tables in parallel. The image is split into horizontal bands, band local SATs
+     * are built concurrently, then every band is fixed up in parallel with the carry i.e. the global SAT row
+     * just above the band. The modular u32 arithmetic makes the result bit-identical to the serial build.
+     */
+    void ComputePixelSumParallel(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer);
+
+    /*!
+     * Build the band local summed area tables for rows [p_RowBegin, p_RowEnd) with the configured build mode.
+     */
+    void ComputePixelSumBand(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd);
+
+    /*!
+     * Wide accumulator version of ComputePixelSumBand(..). Every row prefix is computed in u32, exact for rows of
+     * up to 16843009 pixels, then widened and accumulated into the u64 row above.
+     */
+    void ComputePixelSumBandWide(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd);
+
+    /*!
+     * Build the rows [p_RowBegin, p_RowEnd) of the squared pixel table, the first row of a band has no row above.
+     */
+    void ComputeSquaredSumRows(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd, bool p_IsBandStart) const;
+
+    /*!
+     * Build the rows [p_RowBegin, p_RowEnd) of both rotated tables, the first row of a band has no row above.
+     */
+    void ComputeRotatedSumRows(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowEnd, bool p_IsBandStart) const;
+
+    /*!
+     * Patch the rotated tables after the pixels of the clipped dirty regions changed. The row prefix of the
+     * changes travels down both diagonals, every row from the first dirty row down to the bottom is updated.
+     */
+    void UpdateRotatedTables(const PixelSumKernels& p_Kernels, const std::vector<PixelBufferCoords_i>& p_Regions, const unsigned char* p_Pixels,
+                             ptrdiff_t p_PixelsPitch, int p_PixelsX0, int p_PixelsY0);
+
+    /*!
+     * Pixel sum of the triangle {(x, y) : y <= p_Y, |x - p_X| <= p_Y - y} i.e. rotated SAT entry of any point,
+     * inside or outside the image. Right table (x, y) - left table (x - 1, y), the entries outside the image
+     * are derived from the ones on the border.
+     */
+    uint32_t ComputeRotatedTriangleSum(int64_t p_X, int64_t p_Y) const;
+
+    /*!
+     * Entry of the right or left rotated table extended to any point, see ComputeRotatedTriangleSum(..)
+     */
+    uint32_t RotatedRightTableEntry(int64_t p_X, int64_t p_Y) const;
+    uint32_t RotatedLeftTableEntry(int64_t p_X, int64_t p_Y) const;
+
+    /*!
+     * ComputeBoxFilter(..) for any of the output types, see s_StoreBoxFilterRow(..) for the conversion
+     */
+    template<typename T>
+    bool ComputeBoxFilterOutput(int p_WindowWidth, int p_WindowHeight, int p_Stride, T* p_Output) const;
+
+    /*!
+     * Clip the dirty regions and apply them to the tables of the configured accumulator. Pixel (x, y) of the new
+     * frame is read from p_Pixels[(y - p_PixelsY0) * p_PixelsPitch + (x - p_PixelsX0)].
+     */
+    bool ApplyDirtyRegions(const PixelBufferCoords_i* p_Regions, size_t p_RegionCount, const unsigned char* p_Pixels,
+                           ptrdiff_t p_PixelsPitch, int p_PixelsX0, int p_PixelsY0);
+
+    /*!
+     * Add the delta of the clipped dirty regions to the bottom-right quadrant they affect. The delta of every
+     * table row is accumulated row by row down to the last dirty row, below it the delta is the same for all the
+     * rows and is added in parallel bands. The squared pixel table, when enabled, is patched the same way.
+     */
+    template<typename T>
+    void UpdateSumAreaTables(const PixelSumKernels& p_Kernels, void (*p_AddRow)(T*, const T*, int), T* p_SumTable, T* p_NonZeroTable,
+                             const std::vector<PixelBufferCoords_i>& p_Regions, const unsigned char* p_Pixels,
+                             ptrdiff_t p_PixelsPitch, int p_PixelsX0, int p_PixelsY0);
+
     /*!
      * Calls pixelSumPass(..) with Horizontal pass followed with Vertical pass.
      */
     template<typename T>
-    void ComputePixelSum(PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf);
+    void ComputePixelSum(const PixelSumKernels& p_Kernels, PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf, int p_RowCount);
+
+    /*!
+     * Make sure rows [0, p_Row] of a table are built before it is queried. Eager tables are always complete,
+     * lazy tables take the slow path below only when the query reaches past the rows built so far.
+     */
+    void EnsureTableRows(PixelSumOperationType p_OperationType, int p_Row) const
+    {
+        const int table = (p_OperationType == PixelSumOperationType::NonZeroElementCount) ? 1 :
+                          (p_OperationType == PixelSumOperationType::SquaredSum) ? 2 :
+                          (p_OperationType == PixelSumOperationType::RotatedSum) ? 3 : 0;
+        if (m_BuiltRowCount[table].load(std::memory_order_acquire) <= p_Row)
+        {
+            BuildTableRows(table, p_Row);
+        }
+    }
+
+    /*!
+     * Lazy build, extends a table down to p_Row under the build lock. Concurrent readers of the rows built
+     * before are not affected, the new row count is published once the rows are complete.
+     */
+    void BuildTableRows(int p_Table, int p_Row) const;
+
+    /*!
+     * Zero the leading row and the leading column of a padded table with the given geometry.
+     */
+    template<typename T>
+    void ClearTableBorder(T* p_SumAreaPixBuf, size_t p_TablePitch, size_t p_TableOrigin);
+
+    /*!
+     * Build both summed area tables with a single read of the pixel buffer. The image is processed in column
+     * tiles, for each tile the running column sums are kept in a small scratch row that stays resident in
+     * L1/L2, while the horizontal prefix of every row is carried from the previous tile. When the tables are
+     * larger than the last level cache the output is written with non-temporal stores.
+     */
+    void ComputePixelSumFused(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, int p_RowBegin, int p_RowCount);
+
+    /*!
+     * Store a row segment into the summed area table, uses streaming stores when requested to avoid polluting
+     * the cache with data which will not be read back during the build.
+     */
+    static void StoreRowSegment(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count, bool p_NonTemporal);
+    static void StoreRowSegment(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count, bool p_NonTemporal);
+
+    /*!
+     * Interleaved layout version of StoreRowSegment(..), writes { sum, non-zero } pairs.
+     */
+    static void StoreRowSegmentInterleaved(uint32_t* p_Dest, const uint32_t* p_SrcSum, const uint32_t* p_SrcNonZero, int p_Count, bool p_NonTemporal);
 
     /*!
      * Compute the pixel sum in horizontal pass. It can compute
      * (1) sumarea for pixel buffer value or
      * (2) Non-Zero elements
+     * The operation type is resolved once per pass to a vectorised prefix-scan kernel.
      */
     template<typename T>
-    void PixelSumHorizontalPass(PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf/*, T* p_SumAreaNonZero*/);
+    void PixelSumHorizontalPass(const PixelSumKernels& p_Kernels, PixelSumOperationType p_OperationType, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf, int p_RowCount);
 
     /*!
      * Compute the pixel sum in either horizontal or vertical pass. It can compute sum area for pixel
      * buffer value or non-zero elements
      */
     template<typename T>
-    void PixelSumVerticalPass(const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf/*, T* p_SumAreaNonZero*/);
-
-    /*!
-     * Single Instruction Multiple Data (SIMD) helper function to add two arrays (1) destination and (2) source array
-     * into the destination array.
-     */
-    void SimdAddSSE(int p_ArraySize, unsigned int* p_DestArray, unsigned int* p_SrcArray);
+    void PixelSumVerticalPass(const PixelSumKernels& p_Kernels, const unsigned char* p_PixelBuffer, T* p_SumAreaPixBuf, int p_RowCount);
 
     /*!
      * Compute the Sum area of the search window coordinates with below formula
@@ -89,9 +486,24 @@ private:
      *   |        |               |
      * 3 +--------+---------------+
      *            C               D
+     *
+     * With the padded layout A, B and C of a window on the image border read the zero row or column, the query
+     * is four unconditional loads. The squared pixel table has its own pitch and origin.
      */
     template<typename T>
-    unsigned int ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, T* p_SumArea) const;
+    T ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, const T* p_SumArea, size_t p_TablePitch, size_t p_TableOrigin,
+                                    ptrdiff_t p_TableStride) const;
+
+    /*!
+     * Region sum of a clipped search window from the pixel sum or non-zero table of the configured accumulator,
+     * or from the squared pixel table
+     */
+    uint64_t ComputeRegionSum(PixelSumOperationType p_OperationType, int x0, int y0, int x1, int y1) const;
+
+    /*!
+     * Variance over p_PixelCount pixels from the region sum and squared sum, n * S2 - S^2 is evaluated exactly
+     */
+    static double ComputeVariance(uint64_t p_PixelSum, uint64_t p_SquaredSum, uint64_t p_PixelCount);
 
     /*!
      * Allocate virtual memory from preallocated memory pool for summed area matrix
@@ -99,12 +511,88 @@ private:
     template<typename T>
     bool AllocateVirtualMemoryForSumAreaMatrix(T*& p_SumAreaMatrix, size_t p_AllocSize);
 
+    /*!
+     * Allocate, free or deep copy the summed area tables for the configured table layout
+     */
+    bool AllocateSumAreaTables();
+    void FreeSumAreaTables();
+    void CopySumAreaTables(const PixelSum& p_PixelSum);
+
+    /*!
+     * Copy the content of the tables of another PixelSum with the same geometry into the allocated tables
+     */
+    void CopyTableContent(const uint32_t* p_SumAreaTable, const uint32_t* p_SumAreaNonZeroTable,
+                          const uint64_t* p_SumAreaTable64, const uint64_t* p_SumAreaNonZeroTable64,
+                          const uint64_t* p_SumAreaSquaredTable, const uint32_t* p_SumAreaRotatedRightTable,
+                          const uint32_t* p_SumAreaRotatedLeftTable);
+
+    /*!
+     * Copy on write, make sure no other PixelSum shares the tables and that they are not mapped from a file before
+     * they are modified. p_KeepContent is false when the tables are about to be overwritten completely.
+     */
+    bool DetachSharedTables(bool p_KeepContent);
+
+    /*!
+     * Distance in elements between two consecutive entries of a summed area table
+     */
+    int TableStride() const { return (m_Config.tableLayout == PixelSumTableLayout::Interleaved) ? 2 : 1; }
+
+    bool IsWideAccumulator() const { return m_Config.accumulator == PixelSumAccumulator::Wide64; }
+
+    bool IsPadded() const { return m_Config.tablePadding == PixelSumTablePadding::Padded; }
+
+    bool IsLazy() const { return m_Config.buildTiming == PixelSumBuildTiming::Lazy; }
+
+    bool HasSquaredSums() const { return m_Config.squaredSums == PixelSumSquaredSums::Enabled; }
+
+    bool HasRotatedSums() const { return m_Config.rotatedSums == PixelSumRotatedSums::Enabled; }
+
 private:
-    PixBufTLBR_i m_SourcePixBufTLBR;
+    PixBufTLBR_i m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, -1, -1); /*!< Empty image until constructed from a buffer */
+    PixelSumConfig m_Config;
+
+    // Entry (x, y) of a table is at element m_TableOrigin + y * m_TablePitch + x * TableStride()
+    size_t m_TablePitch        = 0; /*!< Elements between two table rows */
+    size_t m_TableOrigin       = 0; /*!< Element offset of the entry of pixel (0, 0) */
+    size_t m_TableElementCount = 0; /*!< Elements of a single table allocation */
+
+    // Same for the u64 squared pixel table, it is always planar
+    size_t m_SquaredTablePitch        = 0;
+    size_t m_SquaredTableOrigin       = 0;
+    size_t m_SquaredTableElementCount = 0;
+
+    // Same for the two u32 rotated tables, they are always planar and padded
+    size_t m_RotatedTablePitch        = 0;
+    size_t m_RotatedTableOrigin       = 0;
+    size_t m_RotatedTableElementCount = 0;
 
-    // Max image size can be 4096x4096 with highest possible val 255, therefore unsigned 32bit storage is more than enough
+    // Owner of the table pool blocks or of the file mapping, shared between copies with
+    // PixelSumTableSharing::CopyOnWrite. The table pointers below point into it.
+    std::shared_ptr<PixelSumTableStorage> m_TableStorage;
+
+    // Wraparound accumulator, entries are the SAT modulo 2^32 which keeps the region sums below 2^32 exact
     uint32_t* m_SumAreaTable = nullptr; /*!< Summed area table for pixel buffer */
 
-    // The non-zero element can be marked with 1 and zero with 0. With 4096x4096 and 1 as max possible value, 32bit storage suffice.
+    // The non-zero element can be marked with 1 and zero with 0, same modular storage as above.
     uint32_t* m_SumAreaNonZeroTable = nullptr; /*!< Summed area table for non-zero pixel buffer */
+
+    // Wide accumulator tables, only allocated for PixelSumAccumulator::Wide64
+    uint64_t* m_SumAreaTable64 = nullptr;        /*!< 64-bit summed area table for pixel buffer */
+    uint64_t* m_SumAreaNonZeroTable64 = nullptr; /*!< 64-bit summed area table for non-zero pixel buffer */
+
+    // Squared pixels, only allocated for PixelSumSquaredSums::Enabled. u64 entries are exact for any region.
+    uint64_t* m_SumAreaSquaredTable = nullptr; /*!< Summed area table for squared pixel buffer */
+
+    // Rotated tables, only allocated for PixelSumRotatedSums::Enabled. With P(x, y) the inclusive prefix of row y
+    // the right table is R(x, y) = sum over y' <= y of P(x + y - y', y') and the left table is
+    // L(x, y) = sum over y' <= y of P(x - y + y', y'), the row prefix is clamped to the row total on the right
+    // and is 0 on the left of the image. The rotated SAT entry of (x, y) is R(x, y) - L(x - 1, y).
+    uint32_t* m_SumAreaRotatedRightTable = nullptr; /*!< Row prefixes accumulated along the down-left diagonals */
+    uint32_t* m_SumAreaRotatedLeftTable = nullptr;  /*!< Row prefixes accumulated along the down-right diagonals */
+
+    // Lazy build state, the rows [0, count) of the pixel sum [0], non-zero [1], squared [2] and rotated [3] tables
+    // are complete
+    const unsigned char* m_PixelBuffer = nullptr; /*!< Source of the lazy build */
+    mutable std::atomic<int> m_BuiltRowCount[4] = { {0}, {0}, {0}, {0} };
+    mutable std::mutex m_LazyBuildMutex;
 };
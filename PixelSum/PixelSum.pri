@@ -5,8 +5,26 @@ HEADERS += \
     $$PWD/HelperClasses/UtilityFunctions.h \
     $$PWD/HelperClasses/CustomTypes.h \
     $$PWD/PixelSum.h \
-    $$PWD/PixelSumNaive.h
+    $$PWD/PixelSumNaive.h \
+    $$PWD/PixelSumKernels.h \
+    $$PWD/PixelSumCompact.h \
+    $$PWD/PixelSumStream.h \
+    $$PWD/PixelSumScanline.h \
+    $$PWD/PixelSumMultiChannel.h \
+    $$PWD/PixelSumCascade.h \
+    $$PWD/PixelSumHistogram.h \
+    $$PWD/PixelSumThresholdCounts.h \
+    $$PWD/PixelSumImageFile.h
 
 SOURCES += \
     $$PWD/PixelSum.cpp \
-    $$PWD/PixelSumNaive.cpp
+    $$PWD/PixelSumNaive.cpp \
+    $$PWD/PixelSumKernels.cpp \
+    $$PWD/PixelSumCompact.cpp \
+    $$PWD/PixelSumStream.cpp \
+    $$PWD/PixelSumScanline.cpp \
+    $$PWD/PixelSumMultiChannel.cpp \
+    $$PWD/PixelSumCascade.cpp \
+    $$PWD/PixelSumHistogram.cpp \
+    $$PWD/PixelSumThresholdCounts.cpp \
+    $$PWD/PixelSumImageFile.cpp
@@ -0,0 +1,266 @@
+#include "PixelSumCascade.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+// Scan rows of a scale evaluated per task, the tasks of all the scales are handed out to the threads one by one
+static constexpr int CASCADE_TASK_ROWS = 8;
+
+// Length in pixels of a base window length or coordinate at the given scale
+static int s_ScaleLength(int p_Length, float p_Scale)
+{
+    return static_cast<int>(p_Length * p_Scale + 0.5f);
+}
+
+// Threshold scale of the window with the top left pixel (p_X, p_Y), see the PixelSumCascade description
+static float s_WindowNormalization(const PixelSumQueryTables& p_Tables, int p_X, int p_Y, int p_Width, int p_Height)
+{
+    const uint64_t pixelCount = static_cast<uint64_t>(p_Width) * static_cast<uint64_t>(p_Height);
+    if (!p_Tables.squaredTable) return static_cast<float>(pixelCount);
+
+    const ptrdiff_t left   = static_cast<ptrdiff_t>(p_X) - 1;
+    const ptrdiff_t right  = static_cast<ptrdiff_t>(p_X) + p_Width - 1;
+    const ptrdiff_t top    = static_cast<ptrdiff_t>(p_Y) - 1;
+    const ptrdiff_t bottom = static_cast<ptrdiff_t>(p_Y) + p_Height - 1;
+
+    const uint32_t* sumTable = p_Tables.sumAreaTable + p_Tables.tableOrigin;
+    const ptrdiff_t pitch = static_cast<ptrdiff_t>(p_Tables.tablePitch);
+    const ptrdiff_t stride = p_Tables.tableStride;
+    const uint32_t pixelSum = sumTable[bottom * pitch + right * stride] - sumTable[bottom * pitch + left * stride] -
+                              sumTable[top * pitch + right * stride] + sumTable[top * pitch + left * stride];
+
+    const uint64_t* squaredTable = p_Tables.squaredTable + p_Tables.squaredTableOrigin;
+    const ptrdiff_t squaredPitch = static_cast<ptrdiff_t>(p_Tables.squaredTablePitch);
+    const uint64_t squaredSum = squaredTable[bottom * squaredPitch + right] - squaredTable[bottom * squaredPitch + left] -
+                                squaredTable[top * squaredPitch + right] + squaredTable[top * squaredPitch + left];
+
+    // n * S2 - S^2 >= 0 is evaluated exactly like PixelSum::ComputeVariance(..)
+    const unsigned __int128 spread = static_cast<unsigned __int128>(pixelCount) * squaredSum -
+                                     static_cast<unsigned __int128>(pixelSum) * pixelSum;
+
+    return (spread > 0) ? static_cast<float>(std::sqrt(static_cast<double>(spread))) : 1.0f;
+}
+
+PixelSumCascade::PixelSumCascade(const PixelSumHaarCascade& p_Cascade)
+    : m_WindowWidth(p_Cascade.windowWidth)
+    , m_WindowHeight(p_Cascade.windowHeight)
+{
+    if (m_WindowWidth <= 0 || m_WindowHeight <= 0 || p_Cascade.stages.empty()) return;
+
+    for (const PixelSumHaarStage& stage : p_Cascade.stages)
+    {
+        PixelSumCascadeStage cascadeStage;
+        cascadeStage.featureBegin = static_cast<int>(m_Features.size());
+        cascadeStage.featureCount = static_cast<int>(stage.features.size());
+        cascadeStage.threshold    = stage.threshold;
+        m_Stages.push_back(cascadeStage);
+
+        for (const PixelSumHaarFeature& feature : stage.features)
+        {
+            if (feature.rectCount < 1 || feature.rectCount > 4) return;
+
+            for (int rect = 0; rect < feature.rectCount; rect++)
+            {
+                const PixelSumHaarRect& r = feature.rects[rect];
+                if (r.x < 0 || r.y < 0 || r.width < 0 || r.height < 0 ||
+                    r.x + r.width > m_WindowWidth || r.y + r.height > m_WindowHeight) return;
+            }
+
+            m_Features.push_back(feature);
+        }
+    }
+
+    m_IsValid = true;
+}
+
+bool PixelSumCascade::Detect(const PixelSum& p_PixelSum, std::vector<PixelSumDetection>& p_Detections, const PixelSumDetectionParams& p_Params) const
+{
+    p_Detections.clear();
+
+    if (!m_IsValid || !(p_Params.scaleFactor > 1.0f) || !(p_Params.minScale > 0.0f) || !(p_Params.step > 0.0f)) return false;
+
+    PixelSumQueryTables tables;
+    if (!GetSupportedTables(p_PixelSum, tables)) return false;
+
+    const int imageWidth = tables.sourceTLBR.width();
+    const int imageHeight = tables.sourceTLBR.height();
+
+    // Compile every scale whose window fits in the image
+    std::vector<CompiledScale> compiledScales;
+    for (float scale = p_Params.minScale; p_Params.maxScale <= 0.0f || scale <= p_Params.maxScale; scale *= p_Params.scaleFactor)
+    {
+        const int windowWidth = s_ScaleLength(m_WindowWidth, scale);
+        const int windowHeight = s_ScaleLength(m_WindowHeight, scale);
+        if (windowWidth > imageWidth || windowHeight > imageHeight) break;
+        if (windowWidth == 0 || windowHeight == 0) continue;
+
+        compiledScales.emplace_back();
+        CompileScale(scale, p_Params.step, tables, compiledScales.back());
+    }
+
+    // Tasks of CASCADE_TASK_ROWS scan rows, scale by scale
+    struct ScanTask { int scale; int rowBegin; int rowEnd; };
+    std::vector<ScanTask> tasks;
+    for (size_t scale = 0; scale < compiledScales.size(); scale++)
+    {
+        const CompiledScale& compiledScale = compiledScales[scale];
+        const int rowCount = (imageHeight - compiledScale.windowHeight) / compiledScale.step + 1;
+        for (int row = 0; row < rowCount; row += CASCADE_TASK_ROWS)
+        {
+            tasks.push_back({ static_cast<int>(scale), row, std::min(row + CASCADE_TASK_ROWS, rowCount) });
+        }
+    }
+
+    const PixelSumKernels& kernels = PixelSumKernels::Get(p_Params.simdLevel);
+    std::vector<std::vector<PixelSumDetection>> taskDetections(tasks.size());
+    std::atomic<size_t> nextTask(0);
+
+    auto scanTasks = [&]()
+    {
+        std::vector<float> normalization(imageWidth);
+        std::vector<int> passedStages(imageWidth);
+
+        for (size_t task = nextTask++; task < tasks.size(); task = nextTask++)
+        {
+            const CompiledScale& compiledScale = compiledScales[tasks[task].scale];
+            const int runCount = (imageWidth - compiledScale.windowWidth) / compiledScale.step + 1;
+
+            for (int row = tasks[task].rowBegin; row < tasks[task].rowEnd; row++)
+            {
+                const int y = row * compiledScale.step;
+                EvaluateRun(kernels, tables, compiledScale, 0, y, runCount, normalization.data(), passedStages.data());
+
+                for (int i = 0; i < runCount; i++)
+                {
+                    if (passedStages[i] != GetStageCount()) continue;
+
+                    PixelSumDetection detection;
+                    detection.x      = i * compiledScale.step;
+                    detection.y      = y;
+                    detection.width  = compiledScale.windowWidth;
+                    detection.height = compiledScale.windowHeight;
+                    detection.scale  = compiledScale.scale;
+                    taskDetections[task].push_back(detection);
+                }
+            }
+        }
+    };
+
+    unsigned int threadCount = p_Params.threadCount;
+    if (threadCount == 0)
+    {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threadCount = static_cast<unsigned int>(std::min<size_t>(threadCount, tasks.size()));
+
+    std::vector<std::thread> workers;
+    for (unsigned int thread = 1; thread < threadCount; thread++)
+    {
+        workers.emplace_back(scanTasks);
+    }
+
+    scanTasks();
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+
+    // The tasks are ordered by scale and row
+    for (const std::vector<PixelSumDetection>& detections : taskDetections)
+    {
+        p_Detections.insert(p_Detections.end(), detections.begin(), detections.end());
+    }
+
+    return true;
+}
+
+int PixelSumCascade::EvaluateWindow(const PixelSum& p_PixelSum, int p_X, int p_Y, float p_Scale) const
+{
+    if (!m_IsValid || !(p_Scale > 0.0f)) return -1;
+
+    PixelSumQueryTables tables;
+    if (!GetSupportedTables(p_PixelSum, tables)) return -1;
+
+    CompiledScale compiledScale;
+    CompileScale(p_Scale, 1.0f, tables, compiledScale);
+
+    if (p_X < 0 || p_Y < 0 || compiledScale.windowWidth == 0 || compiledScale.windowHeight == 0 ||
+        p_X + compiledScale.windowWidth > tables.sourceTLBR.width() || p_Y + compiledScale.windowHeight > tables.sourceTLBR.height()) return -1;
+
+    float normalization = 0.0f;
+    int passedStages = 0;
+    EvaluateRun(PixelSumKernels::Get(), tables, compiledScale, p_X, p_Y, 1, &normalization, &passedStages);
+
+    return passedStages;
+}
+
+void PixelSumCascade::CompileScale(float p_Scale, float p_Step, const PixelSumQueryTables& p_Tables, CompiledScale& p_CompiledScale) const
+{
+    p_CompiledScale.scale        = p_Scale;
+    p_CompiledScale.windowWidth  = s_ScaleLength(m_WindowWidth, p_Scale);
+    p_CompiledScale.windowHeight = s_ScaleLength(m_WindowHeight, p_Scale);
+    p_CompiledScale.step         = std::max(1, static_cast<int>(p_Step * p_Scale + 0.5f));
+    p_CompiledScale.features.resize(m_Features.size());
+
+    const ptrdiff_t pitch = static_cast<ptrdiff_t>(p_Tables.tablePitch);
+    const ptrdiff_t stride = p_Tables.tableStride;
+
+    for (size_t feature = 0; feature < m_Features.size(); feature++)
+    {
+        const PixelSumHaarFeature& haarFeature = m_Features[feature];
+        PixelSumCascadeFeature& cascadeFeature = p_CompiledScale.features[feature];
+
+        cascadeFeature.rectCount  = haarFeature.rectCount;
+        cascadeFeature.threshold  = haarFeature.threshold;
+        cascadeFeature.leftValue  = haarFeature.leftValue;
+        cascadeFeature.rightValue = haarFeature.rightValue;
+
+        for (int rect = 0; rect < haarFeature.rectCount; rect++)
+        {
+            // Rounded to whole pixels and kept inside the scaled window
+            const PixelSumHaarRect& r = haarFeature.rects[rect];
+            const ptrdiff_t x0 = std::min(s_ScaleLength(r.x, p_Scale), p_CompiledScale.windowWidth);
+            const ptrdiff_t y0 = std::min(s_ScaleLength(r.y, p_Scale), p_CompiledScale.windowHeight);
+            const ptrdiff_t x1 = std::min<ptrdiff_t>(x0 + s_ScaleLength(r.width, p_Scale), p_CompiledScale.windowWidth);
+            const ptrdiff_t y1 = std::min<ptrdiff_t>(y0 + s_ScaleLength(r.height, p_Scale), p_CompiledScale.windowHeight);
+
+            // Relative to entry (x - 1, y - 1) of the window at (x, y): A => (x0, y0), B => (x1, y0), C => (x0, y1), D => (x1, y1)
+            cascadeFeature.corners[rect][0] = y0 * pitch + x0 * stride;
+            cascadeFeature.corners[rect][1] = y0 * pitch + x1 * stride;
+            cascadeFeature.corners[rect][2] = y1 * pitch + x0 * stride;
+            cascadeFeature.corners[rect][3] = y1 * pitch + x1 * stride;
+            cascadeFeature.weights[rect]    = r.weight;
+        }
+    }
+}
+
+void PixelSumCascade::EvaluateRun(const PixelSumKernels& p_Kernels, const PixelSumQueryTables& p_Tables, const CompiledScale& p_CompiledScale, int p_X,
+                                  int p_Y, int p_Count, float* p_Normalization, int* p_PassedStages) const
+{
+    for (int i = 0; i < p_Count; i++)
+    {
+        p_Normalization[i] = s_WindowNormalization(p_Tables, p_X + i * p_CompiledScale.step, p_Y, p_CompiledScale.windowWidth,
+                                                   p_CompiledScale.windowHeight);
+    }
+
+    PixelSumCompiledCascade compiledCascade;
+    compiledCascade.features     = p_CompiledScale.features.data();
+    compiledCascade.stages       = m_Stages.data();
+    compiledCascade.stageCount   = GetStageCount();
+    compiledCascade.windowStride = static_cast<ptrdiff_t>(p_CompiledScale.step) * p_Tables.tableStride;
+
+    // Entry (p_X - 1, p_Y - 1), the zero column and row for the windows on the border
+    const uint32_t* origin = p_Tables.sumAreaTable + p_Tables.tableOrigin + (static_cast<ptrdiff_t>(p_Y) - 1) * static_cast<ptrdiff_t>(p_Tables.tablePitch) +
+                             (static_cast<ptrdiff_t>(p_X) - 1) * p_Tables.tableStride;
+
+    p_Kernels.evaluateCascade(compiledCascade, origin, p_Normalization, p_Count, p_PassedStages);
+}
+
+bool PixelSumCascade::GetSupportedTables(const PixelSum& p_PixelSum, PixelSumQueryTables& p_Tables)
+{
+    // The windows on the border read the zero row and column
+    return p_PixelSum.GetQueryTables(p_Tables) && p_Tables.hasZeroBorder;
+}
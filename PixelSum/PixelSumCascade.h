@@ -0,0 +1,147 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "PixelSum.h"
+#include "PixelSumKernels.h"
+
+// Rectangle of a Haar-like feature in the coordinates of the base window, the feature value is the weighted sum of
+// the pixel sums of its rectangles.
+struct PixelSumHaarRect
+{
+    int   x      = 0;
+    int   y      = 0;
+    int   width  = 0;
+    int   height = 0;
+    float weight = 0.0f;
+};
+
+// Weak classifier (decision stump) of a stage, votes leftValue when the feature value is below threshold x window
+// normalization and rightValue otherwise.
+struct PixelSumHaarFeature
+{
+    PixelSumHaarRect rects[4];
+    int   rectCount  = 0; // 1 to 4
+    float threshold  = 0.0f;
+    float leftValue  = 0.0f;
+    float rightValue = 0.0f;
+};
+
+// A window passes the stage when the sum of the votes of its features is not below the stage threshold.
+struct PixelSumHaarStage
+{
+    std::vector<PixelSumHaarFeature> features;
+    float threshold = 0.0f;
+};
+
+// Viola-Jones style cascade of stages trained on a base window of windowWidth x windowHeight pixels.
+struct PixelSumHaarCascade
+{
+    int windowWidth  = 0;
+    int windowHeight = 0;
+    std::vector<PixelSumHaarStage> stages;
+};
+
+// Scan parameters of PixelSumCascade::Detect(..)
+struct PixelSumDetectionParams
+{
+    float scaleFactor = 1.25f; // Ratio of two consecutive window scales, must be greater than 1
+    float minScale    = 1.0f;  // First window scale
+    float maxScale    = 0.0f;  // Last window scale, 0 scans up to the largest window inside the image
+    float step        = 1.0f;  // Scan step in pixels at scale 1, scaled with the window and rounded, at least 1 pixel
+
+    unsigned int      threadCount = 0;                       // Threads scanning the windows, 0 uses all hardware threads
+    PixelSumSimdLevel simdLevel   = PixelSumSimdLevel::Auto; // Override the CPUID dispatch e.g. for benchmarking
+};
+
+// Window accepted by all the stages of the cascade
+struct PixelSumDetection
+{
+    int   x      = 0;
+    int   y      = 0;
+    int   width  = 0;
+    int   height = 0;
+    float scale  = 0.0f;
+};
+
+//----------------------------------------------------------------------------
+// Haar-like feature cascade evaluation on the summed area table of a PixelSum. For every window scale the cascade
+// is compiled once into corner offsets relative to the window origin against the table pitch, a rectangle sum is
+// then four loads without clipping or address arithmetic. The windows of a scan row are evaluated by the SIMD
+// cascade kernel, one window per lane with early rejection per stage, and the scan rows of all the scales are
+// distributed over the threads.
+//
+// The rectangles of a scaled window are rounded to whole pixels, the weights are used as given. The thresholds of
+// the features are scaled by sqrt(n x S2 - S^2) of the window (n pixels, pixel sum S, squared pixel sum S2), i.e.
+// its standard deviation times its pixel count, when the PixelSum has the squared pixel table
+// (PixelSumSquaredSums::Enabled) and by the pixel count n without it. Flat windows use 1.
+//
+// Requires the padded u32 tables (PixelSumTablePadding::Padded with the wraparound accumulator), planar or
+// interleaved. A rectangle sum must fit in 32 bits.
+//----------------------------------------------------------------------------
+class PixelSumCascade
+{
+public:
+    explicit PixelSumCascade(const PixelSumHaarCascade& p_Cascade);
+
+    /*!
+     * False when the cascade has no stage, an empty base window, a feature without rectangle or more than 4 of
+     * them, or a rectangle outside the base window.
+     */
+    bool IsValid() const { return m_IsValid; }
+
+    int GetStageCount() const { return static_cast<int>(m_Stages.size()); }
+
+    /*!
+     * Scan the image with the windows of every scale and collect the windows accepted by all the stages, ordered
+     * by scale, row and column. Returns false for an invalid cascade or scan parameters, or when the tables of the
+     * PixelSum are not supported.
+     */
+    bool Detect(const PixelSum& p_PixelSum, std::vector<PixelSumDetection>& p_Detections,
+                const PixelSumDetectionParams& p_Params = PixelSumDetectionParams()) const;
+
+    /*!
+     * Number of stages passed by the window of the given scale with the top left pixel (p_X, p_Y), the stage count
+     * when the window is accepted. Meant for a few candidate windows, the cascade is compiled on every call.
+     * Returns -1 when the window is not inside the image or the cascade or tables are not supported.
+     */
+    int EvaluateWindow(const PixelSum& p_PixelSum, int p_X, int p_Y, float p_Scale) const;
+
+private:
+    // Cascade compiled for one window scale
+    struct CompiledScale
+    {
+        float scale        = 0.0f;
+        int   windowWidth  = 0;
+        int   windowHeight = 0;
+        int   step         = 1;
+        std::vector<PixelSumCascadeFeature> features;
+    };
+
+    /*!
+     * Scale the window, the rectangles and the scan step and resolve the rectangle corners to table offsets
+     */
+    void CompileScale(float p_Scale, float p_Step, const PixelSumQueryTables& p_Tables, CompiledScale& p_CompiledScale) const;
+
+    /*!
+     * Evaluate a run of p_Count windows of a scan row, p_Normalization and p_PassedStages hold p_Count entries
+     */
+    void EvaluateRun(const PixelSumKernels& p_Kernels, const PixelSumQueryTables& p_Tables, const CompiledScale& p_CompiledScale, int p_X,
+                     int p_Y, int p_Count, float* p_Normalization, int* p_PassedStages) const;
+
+    /*!
+     * Tables supported by the compiled offsets, see the class description
+     */
+    static bool GetSupportedTables(const PixelSum& p_PixelSum, PixelSumQueryTables& p_Tables);
+
+private:
+    bool m_IsValid = false;
+
+    int m_WindowWidth  = 0;
+    int m_WindowHeight = 0;
+
+    std::vector<PixelSumHaarFeature> m_Features; /*!< Features of all the stages, stage by stage */
+    std::vector<PixelSumCascadeStage> m_Stages;  /*!< Feature range and threshold of every stage, the same for every scale */
+};
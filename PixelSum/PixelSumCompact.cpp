@@ -0,0 +1,219 @@
+#include "PixelSumCompact.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "PixelSumKernels.h"
+#include "TableAllocation.h"
+#include "UtilityFunctions.h"
+
+template<typename LocalT, int TileWidth, int TileHeight, int MaxPixelValue>
+CompactSumAreaTable<LocalT, TileWidth, TileHeight, MaxPixelValue>::~CompactSumAreaTable()
+{
+    Release();
+}
+
+template<typename LocalT, int TileWidth, int TileHeight, int MaxPixelValue>
+void CompactSumAreaTable<LocalT, TileWidth, TileHeight, MaxPixelValue>::Release()
+{
+    s_FreeVirtualMemory(m_TopTable);
+    s_FreeVirtualMemory(m_LeftTable);
+    s_FreeVirtualMemory(m_LocalTable);
+
+    m_Width = m_Height = m_TilesPerRow = m_TilesPerColumn = 0;
+}
+
+template<typename LocalT, int TileWidth, int TileHeight, int MaxPixelValue>
+bool CompactSumAreaTable<LocalT, TileWidth, TileHeight, MaxPixelValue>::Build(const unsigned char* p_PixelBuffer, int p_Width, int p_Height)
+{
+    Release();
+
+    if (!p_PixelBuffer || p_Width <= 0 || p_Height <= 0) return false;
+
+    m_Width = p_Width;
+    m_Height = p_Height;
+    m_TilesPerRow = (p_Width + TileWidth - 1) / TileWidth;
+    m_TilesPerColumn = (p_Height + TileHeight - 1) / TileHeight;
+
+    const size_t width = static_cast<size_t>(m_Width);
+    if (!s_AllocateVirtualMemory(m_TopTable, m_TilesPerColumn * width * sizeof(uint32_t)) ||
+        !s_AllocateVirtualMemory(m_LeftTable, m_Height * static_cast<size_t>(m_TilesPerRow) * sizeof(uint32_t)) ||
+        !s_AllocateVirtualMemory(m_LocalTable, m_Height * width * sizeof(LocalT)))
+    {
+        Release();
+        return false;
+    }
+
+    const PixelSumKernels& kernels = PixelSumKernels::Get();
+    const auto prefixScanRow = (MaxPixelValue == 1) ? kernels.prefixNonZeroRow : kernels.prefixSumRow;
+
+    std::vector<uint32_t> columnSum(width, 0); // S(x, ty - 1), running SAT row above the current tile row
+    std::vector<uint32_t> bandSum(width, 0);   // Sum of rows [ty, y] and columns [0, x]
+    std::vector<uint32_t> rowPrefix(width, 0); // Horizontal prefix of the current row
+
+    for (int tileY = 0; tileY < m_TilesPerColumn; tileY++)
+    {
+        memcpy(m_TopTable + tileY * width, columnSum.data(), width * sizeof(uint32_t));
+        std::fill(bandSum.begin(), bandSum.end(), 0);
+
+        const int rowBegin = tileY * TileHeight;
+        const int rowEnd = std::min(rowBegin + TileHeight, m_Height);
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            prefixScanRow(p_PixelBuffer + row * width, rowPrefix.data(), m_Width);
+            kernels.addRow(bandSum.data(), rowPrefix.data(), m_Width);
+
+            uint32_t* leftRow = m_LeftTable + row * static_cast<size_t>(m_TilesPerRow);
+            LocalT* localRow = m_LocalTable + row * width;
+            for (int tileX = 0; tileX < m_TilesPerRow; tileX++)
+            {
+                const int colBegin = tileX * TileWidth;
+                const int colEnd = std::min(colBegin + TileWidth, m_Width);
+                const uint32_t left = (tileX == 0) ? 0 : bandSum[colBegin - 1];
+
+                leftRow[tileX] = left;
+                for (int col = colBegin; col < colEnd; col++)
+                {
+                    localRow[col] = static_cast<LocalT>(bandSum[col] - left);
+                }
+            }
+        }
+
+        // S(x, last row of the tile row) becomes the top of the next tile row
+        kernels.addRow(columnSum.data(), bandSum.data(), m_Width);
+    }
+
+    return true;
+}
+
+template<typename LocalT, int TileWidth, int TileHeight, int MaxPixelValue>
+bool CompactSumAreaTable<LocalT, TileWidth, TileHeight, MaxPixelValue>::CopyFrom(const CompactSumAreaTable& p_Table)
+{
+    Release();
+
+    if (!p_Table.m_LocalTable) return false;
+
+    m_Width = p_Table.m_Width;
+    m_Height = p_Table.m_Height;
+    m_TilesPerRow = p_Table.m_TilesPerRow;
+    m_TilesPerColumn = p_Table.m_TilesPerColumn;
+
+    const size_t topCount = m_TilesPerColumn * static_cast<size_t>(m_Width);
+    const size_t leftCount = m_Height * static_cast<size_t>(m_TilesPerRow);
+    const size_t localCount = m_Height * static_cast<size_t>(m_Width);
+    if (!s_AllocateVirtualMemory(m_TopTable, topCount * sizeof(uint32_t)) ||
+        !s_AllocateVirtualMemory(m_LeftTable, leftCount * sizeof(uint32_t)) ||
+        !s_AllocateVirtualMemory(m_LocalTable, localCount * sizeof(LocalT)))
+    {
+        Release();
+        return false;
+    }
+
+    memcpy(m_TopTable, p_Table.m_TopTable, topCount * sizeof(uint32_t));
+    memcpy(m_LeftTable, p_Table.m_LeftTable, leftCount * sizeof(uint32_t));
+    memcpy(m_LocalTable, p_Table.m_LocalTable, localCount * sizeof(LocalT));
+
+    return true;
+}
+
+template<typename LocalT, int TileWidth, int TileHeight, int MaxPixelValue>
+size_t CompactSumAreaTable<LocalT, TileWidth, TileHeight, MaxPixelValue>::MemoryByteSize() const
+{
+    return m_TilesPerColumn * static_cast<size_t>(m_Width) * sizeof(uint32_t) +
+           m_Height * static_cast<size_t>(m_TilesPerRow) * sizeof(uint32_t) +
+           m_Height * static_cast<size_t>(m_Width) * sizeof(LocalT);
+}
+
+template class CompactSumAreaTable<uint16_t, 16, 16, 255>;
+template class CompactSumAreaTable<uint8_t, 16, 15, 1>;
+
+PixelSumCompact::PixelSumCompact(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight)
+    : m_SourcePixBufTLBR(0 /*Top Coord*/, 0/*Left Coord*/, p_YHeight - 1/*Bottom Coord*/, p_XWidth - 1/*Right Coord*/)
+{
+    if (p_XWidth <= 0 || p_YHeight <= 0) return;
+
+    ReleaseOnFailure(m_SumAreaTable.Build(p_Buffer, p_XWidth, p_YHeight) && m_SumAreaNonZeroTable.Build(p_Buffer, p_XWidth, p_YHeight));
+}
+
+PixelSumCompact::PixelSumCompact(const PixelSumCompact& p_PixelSum)
+    : m_SourcePixBufTLBR(p_PixelSum.m_SourcePixBufTLBR)
+{
+    ReleaseOnFailure(m_SumAreaTable.CopyFrom(p_PixelSum.m_SumAreaTable) && m_SumAreaNonZeroTable.CopyFrom(p_PixelSum.m_SumAreaNonZeroTable));
+}
+
+PixelSumCompact& PixelSumCompact::operator=(const PixelSumCompact& p_PixelSum)
+{
+    if (this != &p_PixelSum)
+    {
+        m_SourcePixBufTLBR = p_PixelSum.m_SourcePixBufTLBR;
+        ReleaseOnFailure(m_SumAreaTable.CopyFrom(p_PixelSum.m_SumAreaTable) && m_SumAreaNonZeroTable.CopyFrom(p_PixelSum.m_SumAreaNonZeroTable));
+    }
+
+    return *this;
+}
+
+void PixelSumCompact::ReleaseOnFailure(bool p_Success)
+{
+    if (p_Success) return;
+
+    m_SumAreaTable.Release();
+    m_SumAreaNonZeroTable.Release();
+}
+
+unsigned int PixelSumCompact::GetPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!m_SumAreaTable.IsBuilt()) return 0;
+
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaTable);
+}
+
+double PixelSumCompact::GetPixelAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!m_SumAreaTable.IsBuilt()) return 0.0;
+
+    uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+
+    if (searchWindowPixelCount == 0) return 0.0; // Prevent return Nan
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaTable) / static_cast<double>(searchWindowPixelCount);
+}
+
+int PixelSumCompact::GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!m_SumAreaNonZeroTable.IsBuilt()) return 0;
+
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaNonZeroTable);
+}
+
+double PixelSumCompact::GetNonZeroAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!m_SumAreaNonZeroTable.IsBuilt()) return 0.0;
+
+    uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+
+    if (searchWindowPixelCount == 0) return 0.0;
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaNonZeroTable) / static_cast<double>(searchWindowPixelCount);
+}
+
+size_t PixelSumCompact::MemoryByteSize() const
+{
+    return m_SumAreaTable.MemoryByteSize() + m_SumAreaNonZeroTable.MemoryByteSize();
+}
+
+template<typename Table>
+unsigned int PixelSumCompact::ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, const Table& p_Table)
+{
+    // Summed Area => D - C - B + A, At() returns zero for the corners outside the image
+    uint32_t pixelSum = p_Table.At(x1, y1);   // Region D => (x1,     y1)
+    pixelSum -= p_Table.At(x0 - 1, y1);       // Region C => (x0 - 1, y1)
+    pixelSum -= p_Table.At(x1, y0 - 1);       // Region B => (x1,     y0 - 1)
+    pixelSum += p_Table.At(x0 - 1, y0 - 1);   // Region A => (x0 - 1, y0 - 1)
+
+    return pixelSum;
+}
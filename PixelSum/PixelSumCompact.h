@@ -0,0 +1,129 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <limits>
+
+#include "CustomTypes.h"
+
+//----------------------------------------------------------------------------
+// Block relative summed area table. The image is split in tiles of TileWidth x TileHeight pixels and the
+// SAT entry S(x, y) of a pixel inside the tile with origin (tx, ty) is reconstructed exactly as
+//
+//      S(x, y) = Top(x) + Left(y) + Local(x, y)
+//
+//      Top(x)      => S(x, ty - 1), one u32 row per tile row (zero for the first tile row)
+//      Left(y)     => sum of rows [ty, y] and columns [0, tx - 1], one u32 per tile and row
+//      Local(x, y) => sum of rows [ty, y] and columns [tx, x], stored in LocalT
+//
+// Local entries are bounded by TileWidth * TileHeight * MaxPixelValue, which is checked at compile time.
+//----------------------------------------------------------------------------
+template<typename LocalT, int TileWidth, int TileHeight, int MaxPixelValue>
+class CompactSumAreaTable
+{
+    static_assert(static_cast<uint64_t>(TileWidth) * TileHeight * MaxPixelValue <= std::numeric_limits<LocalT>::max(),
+                  "Tile local sums must fit into the local entry type");
+
+public:
+    CompactSumAreaTable() = default;
+    ~CompactSumAreaTable();
+
+    CompactSumAreaTable(const CompactSumAreaTable&) = delete;
+    CompactSumAreaTable& operator= (const CompactSumAreaTable&) = delete;
+
+    /*!
+     * Allocate the tables from the preallocated virtual memory pools and build them in one pass over the pixel
+     * buffer. For MaxPixelValue == 1 the table counts the non-zero pixels.
+     */
+    bool Build(const unsigned char* p_PixelBuffer, int p_Width, int p_Height);
+
+    /*!
+     * Deep copy of the tables of another instance with the same dimensions
+     */
+    bool CopyFrom(const CompactSumAreaTable& p_Table);
+
+    /*!
+     * False before the first build and after a failed build or copy, the tables have no storage
+     */
+    bool IsBuilt() const { return m_LocalTable != nullptr; }
+
+    /*!
+     * Exact S(x, y), coordinates must be inside the image, S(-1, y) and S(x, -1) are zero.
+     */
+    inline uint32_t At(int p_X, int p_Y) const
+    {
+        if (p_X < 0 || p_Y < 0) return 0;
+
+        const int tileX = p_X / TileWidth;
+        const int tileY = p_Y / TileHeight;
+
+        return m_TopTable[static_cast<size_t>(tileY) * m_Width + p_X] +
+               m_LeftTable[static_cast<size_t>(p_Y) * m_TilesPerRow + tileX] +
+               m_LocalTable[static_cast<size_t>(p_Y) * m_Width + p_X];
+    }
+
+    /*!
+     * Total bytes used by the three tables
+     */
+    size_t MemoryByteSize() const;
+
+    void Release();
+
+private:
+    int m_Width = 0;
+    int m_Height = 0;
+    int m_TilesPerRow = 0;
+    int m_TilesPerColumn = 0;
+
+    uint32_t* m_TopTable   = nullptr; /*!< S(x, ty - 1) for each tile row */
+    uint32_t* m_LeftTable  = nullptr; /*!< Row band prefix left of the tile, for each row and tile */
+    LocalT*   m_LocalTable = nullptr; /*!< Tile local SAT for each pixel */
+};
+
+// Pixel sum: a 16x16 tile of 255s (65280) fits in u16.
+typedef CompactSumAreaTable<uint16_t, 16, 16, 255> CompactPixelSumTable;
+
+// Non-zero count: a 16x15 tile has at most 240 non-zero pixels which fits in u8.
+typedef CompactSumAreaTable<uint8_t, 16, 15, 1> CompactNonZeroTable;
+
+// Memory compact variant of PixelSum, answers the same queries with the same results in O(1) while using
+// roughly half of the memory (about 4 bytes per pixel for both tables instead of 8).
+class PixelSumCompact
+{
+public:
+    PixelSumCompact() = default;
+    PixelSumCompact(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight);
+    ~PixelSumCompact() = default;
+
+    PixelSumCompact(const PixelSumCompact& p_PixelSum);
+    PixelSumCompact& operator= (const PixelSumCompact& p_PixelSum);
+
+    unsigned int GetPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+    double GetPixelAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    int GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+    double GetNonZeroAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Total bytes used by both compact tables
+     */
+    size_t MemoryByteSize() const;
+
+private:
+    /*!
+     * Summed Area(ABCD) => D - C - B + A, see PixelSum::ComputeSumAreaForSearchWindow(..)
+     */
+    template<typename Table>
+    static unsigned int ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, const Table& p_Table);
+
+    /*!
+     * Frees both tables when one of them failed to build or copy, the queries then return 0
+     */
+    void ReleaseOnFailure(bool p_Success);
+
+private:
+    PixBufTLBR_i m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, -1, -1); /*!< Empty image until constructed from a buffer */
+
+    CompactPixelSumTable m_SumAreaTable;        /*!< Compact summed area table for pixel buffer */
+    CompactNonZeroTable  m_SumAreaNonZeroTable; /*!< Compact summed area table for non-zero pixel buffer */
+};
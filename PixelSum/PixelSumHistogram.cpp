@@ -0,0 +1,234 @@
+#include "PixelSumHistogram.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "TableAllocation.h"
+#include "UtilityFunctions.h"
+
+// Tile of the compact decomposition, the 240 pixels of a tile fit a u8 local count
+static constexpr int TILE_WIDTH  = 16;
+static constexpr int TILE_HEIGHT = 15;
+
+static_assert(TILE_WIDTH * TILE_HEIGHT <= 255, "Tile local counts must fit into a u8");
+
+// Entries of the corners at -1, row -1 and column -1 of every table are zero
+alignas(64) static const uint32_t s_ZeroCounts[PixelSumHistogram::MAX_BIN_COUNT] = {};
+alignas(64) static const uint8_t  s_ZeroLocalCounts[PixelSumHistogram::MAX_BIN_COUNT] = {};
+
+// p_Dest[i] += p_Above[i], the local counts of a row on top of the row above inside the tile row
+static void s_AddLocalRow(uint8_t* p_Dest, const uint8_t* p_Above, size_t p_Count)
+{
+    size_t i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        const __m128i above = _mm_loadu_si128((const __m128i*) (p_Above + i));
+        const __m128i dest = _mm_loadu_si128((const __m128i*) (p_Dest + i));
+        _mm_storeu_si128((__m128i*) (p_Dest + i), _mm_add_epi8(dest, above));
+    }
+
+    // Handle left-over
+    for (; i < p_Count; i++)
+    {
+        p_Dest[i] = static_cast<uint8_t>(p_Dest[i] + p_Above[i]);
+    }
+}
+
+PixelSumHistogram::PixelSumHistogram(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, int p_BinCount,
+                                     PixelSumSimdLevel p_SimdLevel)
+    : m_Kernels(PixelSumKernels::Get(p_SimdLevel))
+    , m_SourcePixBufTLBR(0 /*Top Coord*/, 0/*Left Coord*/, p_YHeight - 1/*Bottom Coord*/, p_XWidth - 1/*Right Coord*/)
+    , m_BinCount(p_BinCount)
+{
+    if (p_XWidth <= 0 || p_YHeight <= 0 || p_BinCount <= 0 || p_BinCount > MAX_BIN_COUNT) return;
+
+    for (int value = 0; value < 256; value++)
+    {
+        m_BinOfPixelValue[value] = static_cast<uint8_t>(value * p_BinCount / 256);
+    }
+
+    m_TilesPerRow = (p_XWidth + TILE_WIDTH - 1) / TILE_WIDTH;
+    m_TilesPerColumn = (p_YHeight + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+    // One allocation per table holding all the bins
+    if (!s_AllocateVirtualMemory(m_TopTable, GetTopTableByteSize(p_XWidth, p_YHeight, p_BinCount)) ||
+        !s_AllocateVirtualMemory(m_LeftTable, GetLeftTableByteSize(p_XWidth, p_YHeight, p_BinCount)) ||
+        !s_AllocateVirtualMemory(m_LocalTable, GetLocalTableByteSize(p_XWidth, p_YHeight, p_BinCount)))
+    {
+        Release();
+        return;
+    }
+
+    Rebuild(p_Buffer);
+}
+
+PixelSumHistogram::~PixelSumHistogram()
+{
+    Release();
+}
+
+void PixelSumHistogram::Release()
+{
+    s_FreeVirtualMemory(m_TopTable);
+    s_FreeVirtualMemory(m_LeftTable);
+    s_FreeVirtualMemory(m_LocalTable);
+}
+
+bool PixelSumHistogram::Rebuild(const unsigned char* p_Buffer)
+{
+    if (!p_Buffer || !m_LocalTable) return false;
+
+    const int width = m_SourcePixBufTLBR.width();
+    const int height = m_SourcePixBufTLBR.height();
+    const size_t binCount = static_cast<size_t>(m_BinCount);
+    const size_t localRowCount = static_cast<size_t>(width) * binCount;
+    const size_t leftRowCount = static_cast<size_t>(m_TilesPerRow) * binCount;
+
+    std::vector<uint32_t> columnCounts(localRowCount, 0); // S_b(x, ty - 1), running table row above the current tile row
+    std::vector<uint32_t> rowCounts(binCount, 0);         // Counts of the current row left of the current tile
+    std::vector<uint8_t>  tileCounts(binCount, 0);        // Counts of the current row inside the current tile
+
+    for (int tileY = 0; tileY < m_TilesPerColumn; tileY++)
+    {
+        memcpy(m_TopTable + tileY * localRowCount, columnCounts.data(), localRowCount * sizeof(uint32_t));
+
+        const int rowBegin = tileY * TILE_HEIGHT;
+        const int rowEnd = std::min(rowBegin + TILE_HEIGHT, height);
+        for (int row = rowBegin; row < rowEnd; row++)
+        {
+            const unsigned char* srcRow = p_Buffer + static_cast<size_t>(row) * width;
+            uint32_t* leftRow = m_LeftTable + row * leftRowCount;
+            uint8_t* localRow = m_LocalTable + row * localRowCount;
+            const bool isFirstRow = (row == rowBegin);
+
+            std::fill(rowCounts.begin(), rowCounts.end(), 0);
+            for (int tileX = 0; tileX < m_TilesPerRow; tileX++)
+            {
+                // Left(y) = Left(y - 1) + counts of row y left of the tile
+                uint32_t* leftEntry = leftRow + tileX * binCount;
+                const uint32_t* leftAbove = isFirstRow ? s_ZeroCounts : leftEntry - leftRowCount;
+                for (size_t bin = 0; bin < binCount; bin++)
+                {
+                    leftEntry[bin] = leftAbove[bin] + rowCounts[bin];
+                }
+
+                // Row prefix inside the tile, the tile row above is added for the whole row below
+                std::fill(tileCounts.begin(), tileCounts.end(), 0);
+                const int colBegin = tileX * TILE_WIDTH;
+                const int colEnd = std::min(colBegin + TILE_WIDTH, width);
+                for (int col = colBegin; col < colEnd; col++)
+                {
+                    tileCounts[m_BinOfPixelValue[srcRow[col]]]++;
+                    memcpy(localRow + col * binCount, tileCounts.data(), binCount);
+                }
+
+                for (size_t bin = 0; bin < binCount; bin++)
+                {
+                    rowCounts[bin] += tileCounts[bin];
+                }
+            }
+
+            if (!isFirstRow)
+            {
+                s_AddLocalRow(localRow, localRow - localRowCount, localRowCount);
+            }
+        }
+
+        // S_b(x, last row of the tile row) becomes the top of the next tile row
+        const uint32_t* leftRow = m_LeftTable + (rowEnd - 1) * leftRowCount;
+        const uint8_t* localRow = m_LocalTable + (rowEnd - 1) * localRowCount;
+        for (int col = 0; col < width; col++)
+        {
+            uint32_t* columnEntry = columnCounts.data() + col * binCount;
+            const uint32_t* leftEntry = leftRow + (col / TILE_WIDTH) * binCount;
+            const uint8_t* localEntry = localRow + col * binCount;
+            for (size_t bin = 0; bin < binCount; bin++)
+            {
+                columnEntry[bin] += leftEntry[bin] + localEntry[bin];
+            }
+        }
+    }
+
+    return true;
+}
+
+bool PixelSumHistogram::GetRegionHistogram(int p_X0, int p_Y0, int p_X1, int p_Y1, uint32_t* p_Histogram) const
+{
+    if (!p_Histogram || !m_LocalTable) return false;
+
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR))
+    {
+        memset(p_Histogram, 0, m_BinCount * sizeof(uint32_t));
+        return false;
+    }
+
+    PixelSumHistogramCorners corners;
+    SetCorner(corners, 0, p_X1,     p_Y1);     // Region D => (x1,     y1)
+    SetCorner(corners, 1, p_X0 - 1, p_Y1);     // Region C => (x0 - 1, y1)
+    SetCorner(corners, 2, p_X1,     p_Y0 - 1); // Region B => (x1,     y0 - 1)
+    SetCorner(corners, 3, p_X0 - 1, p_Y0 - 1); // Region A => (x0 - 1, y0 - 1)
+
+    m_Kernels.regionHistogram(corners, m_BinCount, p_Histogram);
+
+    return true;
+}
+
+void PixelSumHistogram::SetCorner(PixelSumHistogramCorners& p_Corners, int p_Corner, int p_X, int p_Y) const
+{
+    if (p_X < 0 || p_Y < 0)
+    {
+        p_Corners.top[p_Corner]   = s_ZeroCounts;
+        p_Corners.left[p_Corner]  = s_ZeroCounts;
+        p_Corners.local[p_Corner] = s_ZeroLocalCounts;
+        return;
+    }
+
+    const size_t binCount = static_cast<size_t>(m_BinCount);
+    const size_t width = static_cast<size_t>(m_SourcePixBufTLBR.width());
+    const size_t tileX = static_cast<size_t>(p_X / TILE_WIDTH);
+    const size_t tileY = static_cast<size_t>(p_Y / TILE_HEIGHT);
+
+    p_Corners.top[p_Corner]   = m_TopTable + (tileY * width + p_X) * binCount;
+    p_Corners.left[p_Corner]  = m_LeftTable + (p_Y * static_cast<size_t>(m_TilesPerRow) + tileX) * binCount;
+    p_Corners.local[p_Corner] = m_LocalTable + (p_Y * width + p_X) * binCount;
+}
+
+size_t PixelSumHistogram::MemoryByteSize() const
+{
+    if (!m_LocalTable) return 0;
+
+    return m_BinCount * GetBinByteSize(m_SourcePixBufTLBR.width(), m_SourcePixBufTLBR.height());
+}
+
+size_t PixelSumHistogram::GetLocalTableByteSize(int p_Width, int p_Height, int p_BinCount)
+{
+    if (p_Width <= 0 || p_Height <= 0 || p_BinCount <= 0) return 0;
+
+    return static_cast<size_t>(p_Width) * p_Height * p_BinCount * sizeof(uint8_t);
+}
+
+size_t PixelSumHistogram::GetTopTableByteSize(int p_Width, int p_Height, int p_BinCount)
+{
+    if (p_Width <= 0 || p_Height <= 0 || p_BinCount <= 0) return 0;
+
+    const size_t tilesPerColumn = (p_Height + TILE_HEIGHT - 1) / TILE_HEIGHT;
+
+    return tilesPerColumn * p_Width * p_BinCount * sizeof(uint32_t);
+}
+
+size_t PixelSumHistogram::GetLeftTableByteSize(int p_Width, int p_Height, int p_BinCount)
+{
+    if (p_Width <= 0 || p_Height <= 0 || p_BinCount <= 0) return 0;
+
+    const size_t tilesPerRow = (p_Width + TILE_WIDTH - 1) / TILE_WIDTH;
+
+    return static_cast<size_t>(p_Height) * tilesPerRow * p_BinCount * sizeof(uint32_t);
+}
+
+size_t PixelSumHistogram::GetBinByteSize(int p_Width, int p_Height)
+{
+    return GetLocalTableByteSize(p_Width, p_Height, 1) + GetTopTableByteSize(p_Width, p_Height, 1) +
+           GetLeftTableByteSize(p_Width, p_Height, 1);
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "CustomTypes.h"
+#include "PixelSumKernels.h"
+
+//----------------------------------------------------------------------------
+// Integral histogram of an 8-bit image: one summed area table per intensity bin, the table of bin b counts the
+// pixels whose value maps to b (bin = value x bin count / 256). The histogram of any region is then the corner
+// combination D - C - B + A of every bin, O(bins) independent of the region size and computed with SIMD across the
+// bins.
+//
+// The per-bin tables use the compact decomposition of PixelSumCompact (see CompactSumAreaTable) with 16x15 tiles:
+//
+//      S_b(x, y) = Top_b(x) + Left_b(y) + Local_b(x, y)
+//
+// A local count is bounded by the 240 pixels of a tile and is stored in a u8, Top and Left are u32. The bins of an
+// entry are adjacent in every table so that a corner of a query is three contiguous runs of bin count entries.
+// Per bin that is W x H bytes of local table plus about W x H / 2 bytes of tile tables, instead of 4 x W x H bytes
+// for a plain u32 table.
+//
+// The three tables are allocated from the preallocated memory pools, their sizes for a bin count are given by
+// GetLocalTableByteSize(..), GetTopTableByteSize(..) and GetLeftTableByteSize(..) for sizing the pools, and are bin
+// count times GetBinByteSize(..) in total.
+//
+// Same conventions as PixelSum: coordinates are inclusive and clamped to the image.
+//----------------------------------------------------------------------------
+class PixelSumHistogram
+{
+public:
+    static constexpr int MAX_BIN_COUNT = 256;
+
+    PixelSumHistogram(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, int p_BinCount = 16,
+                      PixelSumSimdLevel p_SimdLevel = PixelSumSimdLevel::Auto);
+    ~PixelSumHistogram();
+
+    PixelSumHistogram(const PixelSumHistogram&) = delete;
+    PixelSumHistogram& operator= (const PixelSumHistogram&) = delete;
+
+    /*!
+     * Recompute the tables from a new frame of the same dimensions, the allocations are reused. Returns false when
+     * the tables are not allocated.
+     */
+    bool Rebuild(const unsigned char* p_Buffer);
+
+    /*!
+     * 0 when the bin count is not in [1, MAX_BIN_COUNT] or the tables could not be allocated
+     */
+    int GetBinCount() const { return m_LocalTable ? m_BinCount : 0; }
+
+    int GetBinOfPixelValue(unsigned char p_Value) const { return m_BinOfPixelValue[p_Value]; }
+
+    /*!
+     * Pixel count of every bin in the region, p_Histogram holds GetBinCount() entries. Returns false and a zero
+     * histogram when the region is outside the image.
+     */
+    bool GetRegionHistogram(int p_X0, int p_Y0, int p_X1, int p_Y1, uint32_t* p_Histogram) const;
+
+    /*!
+     * Total bytes used by the three tables
+     */
+    size_t MemoryByteSize() const;
+
+    /*!
+     * Size in bytes of a table allocation for a bin count, meant for sizing the preallocated memory pools.
+     */
+    static size_t GetLocalTableByteSize(int p_Width, int p_Height, int p_BinCount);
+    static size_t GetTopTableByteSize(int p_Width, int p_Height, int p_BinCount);
+    static size_t GetLeftTableByteSize(int p_Width, int p_Height, int p_BinCount);
+
+    /*!
+     * Bytes of the three tables per bin
+     */
+    static size_t GetBinByteSize(int p_Width, int p_Height);
+
+private:
+    /*!
+     * Table entries of corner (p_X, p_Y) of a clipped region, corners at -1 point to zeros
+     */
+    void SetCorner(PixelSumHistogramCorners& p_Corners, int p_Corner, int p_X, int p_Y) const;
+
+    void Release();
+
+private:
+    const PixelSumKernels& m_Kernels;
+
+    PixBufTLBR_i m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, -1, -1); /*!< Empty image until constructed from a buffer */
+    int m_BinCount = 0;
+
+    int m_TilesPerRow    = 0;
+    int m_TilesPerColumn = 0;
+
+    uint8_t m_BinOfPixelValue[256] = {};
+
+    // Entry of bin b is at element (index of the tile, row or pixel) x m_BinCount + b
+    uint32_t* m_TopTable   = nullptr; /*!< S_b(x, ty - 1) for each tile row */
+    uint32_t* m_LeftTable  = nullptr; /*!< Row band counts left of the tile, for each row and tile */
+    uint8_t*  m_LocalTable = nullptr; /*!< Tile local counts for each pixel */
+};
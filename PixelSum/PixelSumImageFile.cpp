@@ -0,0 +1,228 @@
+#include "PixelSumImageFile.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MemoryAllocator.h"
+
+// Bytes read for parsing the PGM header, comments included
+static constexpr size_t PGM_HEADER_MAX_SIZE = 1024;
+
+// Next unsigned decimal field of a PGM header, whitespace and comments before it are skipped
+static bool s_ParsePgmField(const unsigned char* p_Header, size_t p_HeaderSize, size_t& p_Offset, int& p_Value)
+{
+    while (p_Offset < p_HeaderSize && (isspace(p_Header[p_Offset]) || p_Header[p_Offset] == '#'))
+    {
+        if (p_Header[p_Offset] == '#')
+        {
+            while (p_Offset < p_HeaderSize && p_Header[p_Offset] != '\n') p_Offset++;
+        }
+        else
+        {
+            p_Offset++;
+        }
+    }
+
+    int64_t value = 0;
+    const size_t digitBegin = p_Offset;
+    while (p_Offset < p_HeaderSize && isdigit(p_Header[p_Offset]) && value <= INT32_MAX)
+    {
+        value = value * 10 + (p_Header[p_Offset++] - '0');
+    }
+
+    p_Value = static_cast<int>(value);
+
+    return p_Offset > digitBegin && value <= INT32_MAX;
+}
+
+// Dimensions and offset of the pixels of a raw or PGM file from its first bytes. The dimensions of a PGM file must
+// match p_Width and p_Height when they are given, the pixels must fit in the file.
+static bool s_ResolveImageLayout(const unsigned char* p_Header, size_t p_HeaderSize, size_t p_FileSize, int& p_Width, int& p_Height,
+                                 size_t& p_PixelOffset)
+{
+    p_PixelOffset = 0;
+
+    if (p_HeaderSize >= 2 && p_Header[0] == 'P' && p_Header[1] == '5')
+    {
+        size_t offset = 2;
+        int width = 0, height = 0, maxValue = 0;
+        if (!s_ParsePgmField(p_Header, p_HeaderSize, offset, width) || !s_ParsePgmField(p_Header, p_HeaderSize, offset, height) ||
+            !s_ParsePgmField(p_Header, p_HeaderSize, offset, maxValue))
+        {
+            return false;
+        }
+
+        // A single whitespace separates the maximum value from the pixels, 16-bit pixels are not supported
+        if (offset >= p_HeaderSize || !isspace(p_Header[offset]) || maxValue <= 0 || maxValue > 255) return false;
+        if ((p_Width != 0 && p_Width != width) || (p_Height != 0 && p_Height != height)) return false;
+
+        p_Width = width;
+        p_Height = height;
+        p_PixelOffset = offset + 1;
+    }
+
+    if (p_Width <= 0 || p_Height <= 0) return false;
+
+    return p_FileSize >= p_PixelOffset && p_FileSize - p_PixelOffset >= static_cast<size_t>(p_Width) * p_Height;
+}
+
+// pread(..) until p_ByteSize bytes are read, short reads are not an error
+static bool s_ReadFully(int p_File, unsigned char* p_Dest, size_t p_ByteSize, off_t p_Offset)
+{
+    while (p_ByteSize > 0)
+    {
+        const ssize_t byteCount = pread(p_File, p_Dest, p_ByteSize, p_Offset);
+        if (byteCount <= 0) return false;
+
+        p_Dest += byteCount;
+        p_ByteSize -= static_cast<size_t>(byteCount);
+        p_Offset += byteCount;
+    }
+
+    return true;
+}
+
+PixelSumImageFile::~PixelSumImageFile()
+{
+    Release();
+}
+
+bool PixelSumImageFile::Map(const char* p_FilePath, int p_Width, int p_Height)
+{
+    Release();
+
+    if (!p_FilePath) return false;
+
+    const int file = open(p_FilePath, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat fileStat;
+    void* mappedAddress = MAP_FAILED;
+    if (fstat(file, &fileStat) == 0 && fileStat.st_size > 0)
+    {
+        mappedAddress = mmap(nullptr, static_cast<size_t>(fileStat.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+    }
+
+    // The mapping keeps its own reference to the file
+    close(file);
+    if (mappedAddress == MAP_FAILED) return false;
+
+    m_MappedAddress = mappedAddress;
+    m_MappedByteSize = static_cast<size_t>(fileStat.st_size);
+
+    const unsigned char* fileBytes = static_cast<const unsigned char*>(mappedAddress);
+    size_t pixelOffset = 0;
+    if (!s_ResolveImageLayout(fileBytes, std::min(m_MappedByteSize, PGM_HEADER_MAX_SIZE), m_MappedByteSize, p_Width, p_Height, pixelOffset))
+    {
+        Release();
+        return false;
+    }
+
+    // The build reads the rows top down exactly once, a large read ahead hides the page faults
+    madvise(mappedAddress, m_MappedByteSize, MADV_SEQUENTIAL);
+
+    m_Pixels = fileBytes + pixelOffset;
+    m_Width = p_Width;
+    m_Height = p_Height;
+
+    return true;
+}
+
+bool PixelSumImageFile::Read(const char* p_FilePath, int p_Width, int p_Height, PixelSum* p_PixelSum, const PixelSumConfig& p_Config)
+{
+    Release();
+
+    if (!p_FilePath) return false;
+
+    const int file = open(p_FilePath, O_RDONLY);
+    if (file < 0) return false;
+
+    struct stat fileStat;
+    unsigned char header[PGM_HEADER_MAX_SIZE];
+    size_t headerSize = 0;
+    size_t pixelOffset = 0;
+    bool isRead = (fstat(file, &fileStat) == 0);
+    if (isRead)
+    {
+        headerSize = std::min(static_cast<size_t>(fileStat.st_size), PGM_HEADER_MAX_SIZE);
+        isRead = s_ReadFully(file, header, headerSize, 0) &&
+                 s_ResolveImageLayout(header, headerSize, static_cast<size_t>(fileStat.st_size), p_Width, p_Height, pixelOffset);
+    }
+
+    const size_t pixelCount = static_cast<size_t>(p_Width) * p_Height;
+    if (isRead)
+    {
+        m_PoolBuffer = static_cast<unsigned char*>(VM::MemoryAllocator::GetInstance().Allocate(pixelCount));
+        isRead = (m_PoolBuffer != nullptr);
+    }
+
+    if (isRead)
+    {
+        const auto readRows = [&](unsigned char* p_Rows, int p_RowBegin, int p_RowEnd)
+        {
+            const size_t rowOffset = static_cast<size_t>(p_RowBegin) * p_Width;
+            return s_ReadFully(file, p_Rows, static_cast<size_t>(p_RowEnd - p_RowBegin) * p_Width, static_cast<off_t>(pixelOffset + rowOffset));
+        };
+
+        if (p_PixelSum)
+        {
+            // Tables without build, they are built band by band from the rows read
+            *p_PixelSum = PixelSum(nullptr, p_Width, p_Height, p_Config);
+            isRead = p_PixelSum->Rebuild(m_PoolBuffer, readRows);
+        }
+        else
+        {
+            isRead = readRows(m_PoolBuffer, 0, p_Height);
+        }
+    }
+
+    close(file);
+
+    if (!isRead)
+    {
+        Release();
+        return false;
+    }
+
+    m_Pixels = m_PoolBuffer;
+    m_Width = p_Width;
+    m_Height = p_Height;
+
+    return true;
+}
+
+void PixelSumImageFile::Wrap(const unsigned char* p_Pixels, int p_Width, int p_Height)
+{
+    Release();
+
+    if (!p_Pixels || p_Width <= 0 || p_Height <= 0) return;
+
+    m_Pixels = p_Pixels;
+    m_Width = p_Width;
+    m_Height = p_Height;
+}
+
+void PixelSumImageFile::Release()
+{
+    if (m_MappedAddress)
+    {
+        munmap(m_MappedAddress, m_MappedByteSize);
+    }
+
+    if (m_PoolBuffer)
+    {
+        VM::MemoryAllocator::GetInstance().Free(m_PoolBuffer);
+    }
+
+    m_Pixels = nullptr;
+    m_Width = 0;
+    m_Height = 0;
+    m_MappedAddress = nullptr;
+    m_MappedByteSize = 0;
+    m_PoolBuffer = nullptr;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "PixelSum.h"
+
+//----------------------------------------------------------------------------
+// 8-bit image source for PixelSum without copy of the pixels: a read-only mapping of a raw or binary PGM (P5) file,
+// or a buffer owned by the caller e.g. shared memory. The tables are built straight from the pixels of the source,
+// a mapped file is read ahead sequentially by the kernel while the build walks down the rows.
+//
+// Files which cannot be mapped (pipes, some network file systems) are read with Read(..) into a buffer of the
+// preallocated memory pools, the rows are read in bands on a reader thread while the tables of the previous bands
+// are built, see PixelSum::Rebuild(unsigned char*, const PixelSumRowReader&).
+//
+// A raw file holds width x height pixels row by row from its first byte. A PGM file has the "P5" header with the
+// width, height and a maximum value of at most 255, followed by the pixels.
+//----------------------------------------------------------------------------
+class PixelSumImageFile
+{
+public:
+    PixelSumImageFile() = default;
+    ~PixelSumImageFile();
+
+    PixelSumImageFile(const PixelSumImageFile&) = delete;
+    PixelSumImageFile& operator= (const PixelSumImageFile&) = delete;
+
+    /*!
+     * Map a PGM file, or a raw file of p_Width x p_Height pixels when it has no PGM header. Returns false and
+     * leaves the source empty when the file cannot be mapped, the header is invalid or the file is too small.
+     */
+    bool Map(const char* p_FilePath, int p_Width = 0, int p_Height = 0);
+
+    /*!
+     * Same files as Map(..) read into a pool buffer. When p_PixelSum is given it is replaced with the tables of the
+     * image for p_Config, built while the file is read. Returns false and leaves the source empty when the file
+     * cannot be read, or the pool buffer or the tables cannot be allocated, the tables are then incomplete.
+     */
+    bool Read(const char* p_FilePath, int p_Width = 0, int p_Height = 0, PixelSum* p_PixelSum = nullptr,
+              const PixelSumConfig& p_Config = PixelSumConfig());
+
+    /*!
+     * Pixels owned by the caller, they must outlive the use of the source.
+     */
+    void Wrap(const unsigned char* p_Pixels, int p_Width, int p_Height);
+
+    /*!
+     * Unmap or free the pixels, the source is empty afterwards.
+     */
+    void Release();
+
+    const unsigned char* GetPixels() const { return m_Pixels; }
+    int GetWidth() const { return m_Width; }
+    int GetHeight() const { return m_Height; }
+
+    bool IsMapped() const { return m_MappedAddress != nullptr; }
+
+private:
+    const unsigned char* m_Pixels = nullptr;
+    int m_Width  = 0;
+    int m_Height = 0;
+
+    void*  m_MappedAddress  = nullptr; /*!< Mapping of the whole file, the pixels start after the PGM header */
+    size_t m_MappedByteSize = 0;
+    unsigned char* m_PoolBuffer = nullptr; /*!< Pixels read by Read(..) */
+};
@@ -0,0 +1,1698 @@
+#include "PixelSumKernels.h"
+
+#include <immintrin.h>
+#include <cstring>
+
+#include "UtilityFunctions.h"
+
+// The kernels are compiled per function for the target instruction set, no global compiler flags are required.
+// The dispatcher makes sure a kernel is only executed on a CPU which supports it.
+#define PIXELSUM_TARGET_AVX2   __attribute__((target("avx2")))
+#define PIXELSUM_TARGET_AVX512 __attribute__((target("avx512f")))
+
+//----------------------------------------------------------------------------
+// Scalar kernels
+//----------------------------------------------------------------------------
+template<bool NonZero>
+static uint32_t s_PrefixScanRowScalar(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count, uint32_t p_Carry)
+{
+    for (int i = 0; i < p_Count; i++)
+    {
+        p_Carry += NonZero ? (p_Src[i] != 0) : p_Src[i];
+        p_Dest[i] = p_Carry;
+    }
+
+    return p_Carry;
+}
+
+static void s_PrefixAccumulateRowScalar(const uint8_t* p_Src, uint32_t* p_ColumnSum, uint32_t* p_ColumnNonZero, int p_Count,
+                                        uint32_t* p_RowSum, uint32_t* p_RowNonZero, int p_Start)
+{
+    uint32_t rowSum = *p_RowSum;
+    uint32_t rowNonZero = *p_RowNonZero;
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        rowSum     += p_Src[i];
+        rowNonZero += (p_Src[i] != 0);
+
+        p_ColumnSum[i]     += rowSum;
+        p_ColumnNonZero[i] += rowNonZero;
+    }
+
+    *p_RowSum = rowSum;
+    *p_RowNonZero = rowNonZero;
+}
+
+static void s_AddRowScalar(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count, int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        p_Dest[i] += p_Src[i];
+    }
+}
+
+static void s_AddRowWideScalar(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count, int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        p_Dest[i] += p_Src[i];
+    }
+}
+
+static void s_AccumulateRowWideScalar(uint64_t* p_Dest, const uint64_t* p_Above, const uint32_t* p_RowPrefix, int p_Count, int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        p_Dest[i] = (p_Above ? p_Above[i] : 0) + p_RowPrefix[i];
+    }
+}
+
+static uint64_t s_AccumulateSquareRowScalar(const uint8_t* p_Src, uint64_t* p_Dest, const uint64_t* p_Above, int p_Count, uint64_t p_RowCarry,
+                                            int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        p_RowCarry += static_cast<uint32_t>(p_Src[i]) * p_Src[i];
+        p_Dest[i] = (p_Above ? p_Above[i] : 0) + p_RowCarry;
+    }
+
+    return p_RowCarry;
+}
+
+static void s_AccumulateChannelRowScalar(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount, int p_ChannelCount,
+                                         uint32_t p_RowSum[4], int p_Start)
+{
+    for (int i = p_Start; i < p_PixelCount; i++)
+    {
+        for (int channel = 0; channel < 4; channel++)
+        {
+            p_RowSum[channel] += (channel < p_ChannelCount) ? p_Src[i * p_ChannelCount + channel] : 0;
+            p_Dest[4 * i + channel] = p_Above[4 * i + channel] + p_RowSum[channel];
+        }
+    }
+}
+
+static void s_AccumulateThresholdRowScalar(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount,
+                                           const uint32_t* p_Thresholds, int p_LaneCount, uint32_t* p_RowCounts, int p_Start)
+{
+    for (int i = p_Start; i < p_PixelCount; i++)
+    {
+        for (int lane = 0; lane < p_LaneCount; lane++)
+        {
+            p_RowCounts[lane] += (p_Src[i] > p_Thresholds[lane]) ? 1 : 0;
+            p_Dest[p_LaneCount * i + lane] = p_Above[p_LaneCount * i + lane] + p_RowCounts[lane];
+        }
+    }
+}
+
+static void s_WindowSumRowScalar(const uint32_t* p_Bottom, const uint32_t* p_Top, int p_WindowWidth, int p_Count, uint32_t* p_Sums, int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        p_Sums[i] = p_Bottom[i + p_WindowWidth] - p_Bottom[i] - p_Top[i + p_WindowWidth] + p_Top[i];
+    }
+}
+
+// Weighted rectangle sums of a feature, the order of the float operations is the one of the SIMD kernels
+static inline float s_CascadeFeatureValueScalar(const PixelSumCascadeFeature& p_Feature, const uint32_t* p_WindowOrigin)
+{
+    float value = 0.0f;
+    for (int rect = 0; rect < p_Feature.rectCount; rect++)
+    {
+        const ptrdiff_t* corners = p_Feature.corners[rect];
+        const uint32_t rectSum = p_WindowOrigin[corners[3]] - p_WindowOrigin[corners[2]] - p_WindowOrigin[corners[1]] + p_WindowOrigin[corners[0]];
+        value += p_Feature.weights[rect] * static_cast<float>(rectSum);
+    }
+
+    return value;
+}
+
+static void s_EvaluateCascadeScalar(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                    int* p_PassedStages, int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        const uint32_t* windowOrigin = p_Origin + i * p_Cascade.windowStride;
+
+        int stage = 0;
+        for (; stage < p_Cascade.stageCount; stage++)
+        {
+            const PixelSumCascadeStage& cascadeStage = p_Cascade.stages[stage];
+            const PixelSumCascadeFeature* features = p_Cascade.features + cascadeStage.featureBegin;
+
+            float stageSum = 0.0f;
+            for (int feature = 0; feature < cascadeStage.featureCount; feature++)
+            {
+                const float value = s_CascadeFeatureValueScalar(features[feature], windowOrigin);
+                stageSum += (value < features[feature].threshold * p_Normalization[i]) ? features[feature].leftValue : features[feature].rightValue;
+            }
+
+            if (stageSum < cascadeStage.threshold) break;
+        }
+
+        p_PassedStages[i] = stage;
+    }
+}
+
+static void s_RegionHistogramScalar(const PixelSumHistogramCorners& p_Corners, int p_BinCount, uint32_t* p_Histogram, int p_Start)
+{
+    for (int bin = p_Start; bin < p_BinCount; bin++)
+    {
+        uint32_t corners[4];
+        for (int k = 0; k < 4; k++)
+        {
+            corners[k] = p_Corners.top[k][bin] + p_Corners.left[k][bin] + p_Corners.local[k][bin];
+        }
+
+        p_Histogram[bin] = corners[0] - corners[1] - corners[2] + corners[3];
+    }
+}
+
+template<bool NonZero>
+static uint32_t s_PrefixScanRowScalarEntry(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count)
+{
+    return s_PrefixScanRowScalar<NonZero>(p_Src, p_Dest, p_Count, 0);
+}
+
+static void s_PrefixAccumulateRowScalarEntry(const uint8_t* p_Src, uint32_t* p_ColumnSum, uint32_t* p_ColumnNonZero, int p_Count,
+                                             uint32_t* p_RowSum, uint32_t* p_RowNonZero)
+{
+    s_PrefixAccumulateRowScalar(p_Src, p_ColumnSum, p_ColumnNonZero, p_Count, p_RowSum, p_RowNonZero, 0);
+}
+
+static void s_AddRowScalarEntry(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count)
+{
+    s_AddRowScalar(p_Dest, p_Src, p_Count, 0);
+}
+
+static void s_AddRowWideScalarEntry(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count)
+{
+    s_AddRowWideScalar(p_Dest, p_Src, p_Count, 0);
+}
+
+static void s_AccumulateRowWideScalarEntry(uint64_t* p_Dest, const uint64_t* p_Above, const uint32_t* p_RowPrefix, int p_Count)
+{
+    s_AccumulateRowWideScalar(p_Dest, p_Above, p_RowPrefix, p_Count, 0);
+}
+
+static uint64_t s_AccumulateSquareRowScalarEntry(const uint8_t* p_Src, uint64_t* p_Dest, const uint64_t* p_Above, int p_Count, uint64_t p_RowCarry)
+{
+    return s_AccumulateSquareRowScalar(p_Src, p_Dest, p_Above, p_Count, p_RowCarry, 0);
+}
+
+static void s_AccumulateChannelRowScalarEntry(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount, int p_ChannelCount)
+{
+    uint32_t rowSum[4] = { 0, 0, 0, 0 };
+    s_AccumulateChannelRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_ChannelCount, rowSum, 0);
+}
+
+static void s_AccumulateThresholdRowScalarEntry(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount,
+                                                const uint32_t* p_Thresholds, int p_LaneCount)
+{
+    uint32_t rowCounts[16] = {};
+    s_AccumulateThresholdRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_Thresholds, p_LaneCount, rowCounts, 0);
+}
+
+static void s_WindowSumRowScalarEntry(const uint32_t* p_Bottom, const uint32_t* p_Top, int p_WindowWidth, int p_Count, uint32_t* p_Sums)
+{
+    s_WindowSumRowScalar(p_Bottom, p_Top, p_WindowWidth, p_Count, p_Sums, 0);
+}
+
+static void s_EvaluateCascadeScalarEntry(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                         int* p_PassedStages)
+{
+    s_EvaluateCascadeScalar(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages, 0);
+}
+
+static void s_RegionHistogramScalarEntry(const PixelSumHistogramCorners& p_Corners, int p_BinCount, uint32_t* p_Histogram)
+{
+    s_RegionHistogramScalar(p_Corners, p_BinCount, p_Histogram, 0);
+}
+
+// Byte shuffle spreading 3 or 4 channel pixels over 4 byte lanes, the missing alpha of RGB pixels reads as 0
+static inline const uint8_t* s_ChannelShuffleMask(int p_ChannelCount)
+{
+    alignas(16) static const uint8_t s_Rgb[16]  = { 0, 1, 2, 0x80, 3, 4, 5, 0x80, 6, 7, 8, 0x80, 9, 10, 11, 0x80 };
+    alignas(16) static const uint8_t s_Rgba[16] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 };
+
+    return (p_ChannelCount == 3) ? s_Rgb : s_Rgba;
+}
+
+// Byte shuffle repeating every pixel over the threshold lanes of its entry, 4 pixels of 4 lanes or 2 pixels of 8 lanes
+static inline const uint8_t* s_ThresholdBroadcastMask(int p_LaneCount)
+{
+    alignas(16) static const uint8_t s_FourLanes[16]  = { 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3 };
+    alignas(16) static const uint8_t s_EightLanes[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1 };
+
+    return (p_LaneCount == 4) ? s_FourLanes : s_EightLanes;
+}
+
+//----------------------------------------------------------------------------
+// SSE2 kernels, 4 lanes of u32
+//----------------------------------------------------------------------------
+
+// In-register inclusive prefix scan with log-step shift and add, carry is broadcasted in all lanes
+static inline __m128i s_ScanSSE2(__m128i p_Values, __m128i& p_Carry)
+{
+    p_Values = _mm_add_epi32(p_Values, _mm_slli_si128(p_Values, 4));
+    p_Values = _mm_add_epi32(p_Values, _mm_slli_si128(p_Values, 8));
+    p_Values = _mm_add_epi32(p_Values, p_Carry);
+    p_Carry  = _mm_shuffle_epi32(p_Values, _MM_SHUFFLE(3, 3, 3, 3));
+
+    return p_Values;
+}
+
+// Widen 16 pixels u8 into four vectors of u32
+static inline void s_WidenSSE2(__m128i p_Pixels, __m128i p_Widened[4])
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i low  = _mm_unpacklo_epi8(p_Pixels, zero);
+    const __m128i high = _mm_unpackhi_epi8(p_Pixels, zero);
+
+    p_Widened[0] = _mm_unpacklo_epi16(low, zero);
+    p_Widened[1] = _mm_unpackhi_epi16(low, zero);
+    p_Widened[2] = _mm_unpacklo_epi16(high, zero);
+    p_Widened[3] = _mm_unpackhi_epi16(high, zero);
+}
+
+template<bool NonZero>
+static uint32_t s_PrefixScanRowSSE2(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i carry = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (p_Src + i));
+        if (NonZero) pixels = _mm_min_epu8(pixels, one);
+
+        __m128i widened[4];
+        s_WidenSSE2(pixels, widened);
+        for (int j = 0; j < 4; j++)
+        {
+            _mm_storeu_si128((__m128i*) (p_Dest + i + 4 * j), s_ScanSSE2(widened[j], carry));
+        }
+    }
+
+    return s_PrefixScanRowScalar<NonZero>(p_Src + i, p_Dest + i, p_Count - i, static_cast<uint32_t>(_mm_cvtsi128_si32(carry)));
+}
+
+static void s_PrefixAccumulateRowSSE2(const uint8_t* p_Src, uint32_t* p_ColumnSum, uint32_t* p_ColumnNonZero, int p_Count,
+                                      uint32_t* p_RowSum, uint32_t* p_RowNonZero)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m128i carrySum = _mm_set1_epi32(static_cast<int>(*p_RowSum));
+    __m128i carryNonZero = _mm_set1_epi32(static_cast<int>(*p_RowNonZero));
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        const __m128i pixels = _mm_loadu_si128((const __m128i*) (p_Src + i));
+
+        __m128i widenedSum[4];
+        __m128i widenedNonZero[4];
+        s_WidenSSE2(pixels, widenedSum);
+        s_WidenSSE2(_mm_min_epu8(pixels, one), widenedNonZero);
+        for (int j = 0; j < 4; j++)
+        {
+            __m128i* columnSum = (__m128i*) (p_ColumnSum + i + 4 * j);
+            __m128i* columnNonZero = (__m128i*) (p_ColumnNonZero + i + 4 * j);
+            _mm_storeu_si128(columnSum, _mm_add_epi32(_mm_loadu_si128(columnSum), s_ScanSSE2(widenedSum[j], carrySum)));
+            _mm_storeu_si128(columnNonZero, _mm_add_epi32(_mm_loadu_si128(columnNonZero), s_ScanSSE2(widenedNonZero[j], carryNonZero)));
+        }
+    }
+
+    *p_RowSum = static_cast<uint32_t>(_mm_cvtsi128_si32(carrySum));
+    *p_RowNonZero = static_cast<uint32_t>(_mm_cvtsi128_si32(carryNonZero));
+
+    // Handle left-over
+    s_PrefixAccumulateRowScalar(p_Src, p_ColumnSum, p_ColumnNonZero, p_Count, p_RowSum, p_RowNonZero, i);
+}
+
+static void s_AddRowSSE2(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count)
+{
+    int i = 0;
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        // Load 128-bit chunks of each array, add each pair of 32-bit integers and store back to destination array
+        __m128i destValues = _mm_loadu_si128((const __m128i*) (p_Dest + i));
+        __m128i srcValues = _mm_loadu_si128((const __m128i*) (p_Src + i));
+        _mm_storeu_si128((__m128i*) (p_Dest + i), _mm_add_epi32(destValues, srcValues));
+    }
+
+    // Handle left-over
+    s_AddRowScalar(p_Dest, p_Src, p_Count, i);
+}
+
+static void s_AddRowWideSSE2(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count)
+{
+    int i = 0;
+    for (; i + 2 <= p_Count; i += 2)
+    {
+        __m128i destValues = _mm_loadu_si128((const __m128i*) (p_Dest + i));
+        __m128i srcValues = _mm_loadu_si128((const __m128i*) (p_Src + i));
+        _mm_storeu_si128((__m128i*) (p_Dest + i), _mm_add_epi64(destValues, srcValues));
+    }
+
+    // Handle left-over
+    s_AddRowWideScalar(p_Dest, p_Src, p_Count, i);
+}
+
+static void s_AccumulateRowWideSSE2(uint64_t* p_Dest, const uint64_t* p_Above, const uint32_t* p_RowPrefix, int p_Count)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        // Zero extend 4 x u32 into 2 x (2 x u64)
+        const __m128i prefix = _mm_loadu_si128((const __m128i*) (p_RowPrefix + i));
+        __m128i low  = _mm_unpacklo_epi32(prefix, zero);
+        __m128i high = _mm_unpackhi_epi32(prefix, zero);
+        if (p_Above)
+        {
+            low  = _mm_add_epi64(low, _mm_loadu_si128((const __m128i*) (p_Above + i)));
+            high = _mm_add_epi64(high, _mm_loadu_si128((const __m128i*) (p_Above + i + 2)));
+        }
+
+        _mm_storeu_si128((__m128i*) (p_Dest + i), low);
+        _mm_storeu_si128((__m128i*) (p_Dest + i + 2), high);
+    }
+
+    // Handle left-over
+    s_AccumulateRowWideScalar(p_Dest, p_Above, p_RowPrefix, p_Count, i);
+}
+
+static uint64_t s_AccumulateSquareRowSSE2(const uint8_t* p_Src, uint64_t* p_Dest, const uint64_t* p_Above, int p_Count, uint64_t p_RowCarry)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        // 255 x 255 fits in u16 and the prefix of 16 squares in u32, only the row carry needs 64 bits
+        const __m128i pixels = _mm_loadu_si128((const __m128i*) (p_Src + i));
+        const __m128i low  = _mm_unpacklo_epi8(pixels, zero);
+        const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        const __m128i squares[2] = { _mm_mullo_epi16(low, low), _mm_mullo_epi16(high, high) };
+
+        const __m128i rowCarry = _mm_set1_epi64x(static_cast<long long>(p_RowCarry));
+        __m128i blockCarry = zero;
+        for (int j = 0; j < 4; j++)
+        {
+            const __m128i squares32 = (j % 2) ? _mm_unpackhi_epi16(squares[j / 2], zero) : _mm_unpacklo_epi16(squares[j / 2], zero);
+            const __m128i prefix = s_ScanSSE2(squares32, blockCarry);
+
+            __m128i prefixLow  = _mm_add_epi64(_mm_unpacklo_epi32(prefix, zero), rowCarry);
+            __m128i prefixHigh = _mm_add_epi64(_mm_unpackhi_epi32(prefix, zero), rowCarry);
+            if (p_Above)
+            {
+                prefixLow  = _mm_add_epi64(prefixLow, _mm_loadu_si128((const __m128i*) (p_Above + i + 4 * j)));
+                prefixHigh = _mm_add_epi64(prefixHigh, _mm_loadu_si128((const __m128i*) (p_Above + i + 4 * j + 2)));
+            }
+
+            _mm_storeu_si128((__m128i*) (p_Dest + i + 4 * j), prefixLow);
+            _mm_storeu_si128((__m128i*) (p_Dest + i + 4 * j + 2), prefixHigh);
+        }
+
+        p_RowCarry += static_cast<uint32_t>(_mm_cvtsi128_si32(blockCarry));
+    }
+
+    // Handle left-over
+    return s_AccumulateSquareRowScalar(p_Src, p_Dest, p_Above, p_Count, p_RowCarry, i);
+}
+
+static void s_AccumulateChannelRowSSE2(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount, int p_ChannelCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i channelMask = _mm_cmplt_epi32(_mm_setr_epi32(0, 1, 2, 3), _mm_set1_epi32(p_ChannelCount));
+    __m128i rowSum = zero;
+
+    // One pixel per lane group, 4 bytes are loaded so the last RGB pixel of the row is left to the scalar loop
+    int i = 0;
+    for (; (p_PixelCount - i) * p_ChannelCount >= 4; i++)
+    {
+        int pixelBytes;
+        memcpy(&pixelBytes, p_Src + i * p_ChannelCount, sizeof(pixelBytes));
+
+        __m128i pixel = _mm_cvtsi32_si128(pixelBytes);
+        pixel = _mm_and_si128(_mm_unpacklo_epi16(_mm_unpacklo_epi8(pixel, zero), zero), channelMask);
+
+        rowSum = _mm_add_epi32(rowSum, pixel);
+        _mm_storeu_si128((__m128i*) (p_Dest + 4 * i), _mm_add_epi32(_mm_loadu_si128((const __m128i*) (p_Above + 4 * i)), rowSum));
+    }
+
+    // Handle left-over
+    alignas(16) uint32_t rowSumLanes[4];
+    _mm_store_si128((__m128i*) rowSumLanes, rowSum);
+    s_AccumulateChannelRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_ChannelCount, rowSumLanes, i);
+}
+
+static void s_AccumulateThresholdRowSSE2(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount,
+                                         const uint32_t* p_Thresholds, int p_LaneCount)
+{
+    const int chunkCount = p_LaneCount / 4;
+
+    __m128i thresholds[4];
+    __m128i rowCounts[4];
+    for (int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        thresholds[chunk] = _mm_loadu_si128((const __m128i*) (p_Thresholds + 4 * chunk));
+        rowCounts[chunk] = _mm_setzero_si128();
+    }
+
+    // One pixel per iteration broadcasted to all the lanes, a passed compare is -1 and is subtracted
+    for (int i = 0; i < p_PixelCount; i++)
+    {
+        const __m128i pixel = _mm_set1_epi32(p_Src[i]);
+        for (int chunk = 0; chunk < chunkCount; chunk++)
+        {
+            const ptrdiff_t entry = static_cast<ptrdiff_t>(i) * p_LaneCount + 4 * chunk;
+
+            rowCounts[chunk] = _mm_sub_epi32(rowCounts[chunk], _mm_cmpgt_epi32(pixel, thresholds[chunk]));
+            _mm_storeu_si128((__m128i*) (p_Dest + entry), _mm_add_epi32(_mm_loadu_si128((const __m128i*) (p_Above + entry)), rowCounts[chunk]));
+        }
+    }
+}
+
+static void s_WindowSumRowSSE2(const uint32_t* p_Bottom, const uint32_t* p_Top, int p_WindowWidth, int p_Count, uint32_t* p_Sums)
+{
+    int i = 0;
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        const __m128i d = _mm_loadu_si128((const __m128i*) (p_Bottom + i + p_WindowWidth));
+        const __m128i c = _mm_loadu_si128((const __m128i*) (p_Bottom + i));
+        const __m128i b = _mm_loadu_si128((const __m128i*) (p_Top + i + p_WindowWidth));
+        const __m128i a = _mm_loadu_si128((const __m128i*) (p_Top + i));
+
+        _mm_storeu_si128((__m128i*) (p_Sums + i), _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(d, c), b), a));
+    }
+
+    // Handle left-over
+    s_WindowSumRowScalar(p_Bottom, p_Top, p_WindowWidth, p_Count, p_Sums, i);
+}
+
+// u32 to float with a single rounding like the scalar conversion, both 16-bit halves convert exactly
+static inline __m128 s_ConvertU32ToFloatSSE2(__m128i p_Values)
+{
+    const __m128 high = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(p_Values, 16)), _mm_set1_ps(65536.0f));
+    const __m128 low  = _mm_cvtepi32_ps(_mm_and_si128(p_Values, _mm_set1_epi32(0xFFFF)));
+
+    return _mm_add_ps(high, low);
+}
+
+// Table entries at the same offset of 4 consecutive windows, SSE2 has no gathers
+template<bool Contiguous>
+static inline __m128i s_LoadCascadeEntriesSSE2(const uint32_t* p_Entry, ptrdiff_t p_WindowStride)
+{
+    if (Contiguous) return _mm_loadu_si128((const __m128i*) p_Entry);
+
+    return _mm_setr_epi32(static_cast<int>(p_Entry[0]), static_cast<int>(p_Entry[p_WindowStride]),
+                          static_cast<int>(p_Entry[2 * p_WindowStride]), static_cast<int>(p_Entry[3 * p_WindowStride]));
+}
+
+template<bool Contiguous>
+static void s_EvaluateCascadeSSE2(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                  int* p_PassedStages)
+{
+    const ptrdiff_t windowStride = p_Cascade.windowStride;
+
+    int i = 0;
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        const uint32_t* windowOrigin = p_Origin + i * windowStride;
+        const __m128 normalization = _mm_loadu_ps(p_Normalization + i);
+        __m128i active = _mm_set1_epi32(-1);
+        __m128i passedStages = _mm_setzero_si128();
+
+        for (int stage = 0; stage < p_Cascade.stageCount; stage++)
+        {
+            const PixelSumCascadeStage& cascadeStage = p_Cascade.stages[stage];
+            __m128 stageSum = _mm_setzero_ps();
+
+            for (int feature = 0; feature < cascadeStage.featureCount; feature++)
+            {
+                const PixelSumCascadeFeature& cascadeFeature = p_Cascade.features[cascadeStage.featureBegin + feature];
+
+                __m128 value = _mm_setzero_ps();
+                for (int rect = 0; rect < cascadeFeature.rectCount; rect++)
+                {
+                    const ptrdiff_t* corners = cascadeFeature.corners[rect];
+                    const __m128i a = s_LoadCascadeEntriesSSE2<Contiguous>(windowOrigin + corners[0], windowStride);
+                    const __m128i b = s_LoadCascadeEntriesSSE2<Contiguous>(windowOrigin + corners[1], windowStride);
+                    const __m128i c = s_LoadCascadeEntriesSSE2<Contiguous>(windowOrigin + corners[2], windowStride);
+                    const __m128i d = s_LoadCascadeEntriesSSE2<Contiguous>(windowOrigin + corners[3], windowStride);
+                    const __m128i rectSum = _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(d, c), b), a);
+
+                    value = _mm_add_ps(value, _mm_mul_ps(_mm_set1_ps(cascadeFeature.weights[rect]), s_ConvertU32ToFloatSSE2(rectSum)));
+                }
+
+                const __m128 isLeft = _mm_cmplt_ps(value, _mm_mul_ps(_mm_set1_ps(cascadeFeature.threshold), normalization));
+                const __m128 vote = _mm_or_ps(_mm_and_ps(isLeft, _mm_set1_ps(cascadeFeature.leftValue)),
+                                              _mm_andnot_ps(isLeft, _mm_set1_ps(cascadeFeature.rightValue)));
+                stageSum = _mm_add_ps(stageSum, vote);
+            }
+
+            // Rejected windows stay rejected, the stage loop ends once all the windows are rejected
+            active = _mm_and_si128(active, _mm_castps_si128(_mm_cmpnlt_ps(stageSum, _mm_set1_ps(cascadeStage.threshold))));
+            passedStages = _mm_sub_epi32(passedStages, active);
+            if (_mm_movemask_epi8(active) == 0) break;
+        }
+
+        _mm_storeu_si128((__m128i*) (p_PassedStages + i), passedStages);
+    }
+
+    // Handle left-over
+    s_EvaluateCascadeScalar(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages, i);
+}
+
+static void s_EvaluateCascadeSSE2Entry(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                       int* p_PassedStages)
+{
+    if (p_Cascade.windowStride == 1) s_EvaluateCascadeSSE2<true>(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages);
+    else                             s_EvaluateCascadeSSE2<false>(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages);
+}
+
+static void s_RegionHistogramSSE2(const PixelSumHistogramCorners& p_Corners, int p_BinCount, uint32_t* p_Histogram)
+{
+    const __m128i zero = _mm_setzero_si128();
+
+    int i = 0;
+    for (; i + 4 <= p_BinCount; i += 4)
+    {
+        __m128i corners[4];
+        for (int k = 0; k < 4; k++)
+        {
+            int localBytes;
+            memcpy(&localBytes, p_Corners.local[k] + i, sizeof(localBytes));
+            const __m128i local = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(localBytes), zero), zero);
+
+            corners[k] = _mm_add_epi32(_mm_add_epi32(_mm_loadu_si128((const __m128i*) (p_Corners.top[k] + i)),
+                                                     _mm_loadu_si128((const __m128i*) (p_Corners.left[k] + i))), local);
+        }
+
+        _mm_storeu_si128((__m128i*) (p_Histogram + i), _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(corners[0], corners[1]), corners[2]), corners[3]));
+    }
+
+    // Handle left-over
+    s_RegionHistogramScalar(p_Corners, p_BinCount, p_Histogram, i);
+}
+
+//----------------------------------------------------------------------------
+// AVX2 kernels, 8 lanes of u32
+//----------------------------------------------------------------------------
+PIXELSUM_TARGET_AVX2
+static inline __m256i s_ScanAVX2(__m256i p_Values, __m256i& p_Carry)
+{
+    // Scan within each 128-bit lane
+    p_Values = _mm256_add_epi32(p_Values, _mm256_slli_si256(p_Values, 4));
+    p_Values = _mm256_add_epi32(p_Values, _mm256_slli_si256(p_Values, 8));
+
+    // Propagate the total of the low lane into the high lane
+    const __m256i lowLaneTotal = _mm256_shuffle_epi32(p_Values, _MM_SHUFFLE(3, 3, 3, 3));
+    p_Values = _mm256_add_epi32(p_Values, _mm256_permute2x128_si256(lowLaneTotal, lowLaneTotal, 0x08));
+
+    p_Values = _mm256_add_epi32(p_Values, p_Carry);
+    p_Carry  = _mm256_permutevar8x32_epi32(p_Values, _mm256_set1_epi32(7));
+
+    return p_Values;
+}
+
+template<bool NonZero>
+PIXELSUM_TARGET_AVX2
+static uint32_t s_PrefixScanRowAVX2(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m256i carry = _mm256_setzero_si256();
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (p_Src + i));
+        if (NonZero) pixels = _mm_min_epu8(pixels, one);
+
+        const __m256i low  = _mm256_cvtepu8_epi32(pixels);
+        const __m256i high = _mm256_cvtepu8_epi32(_mm_srli_si128(pixels, 8));
+        _mm256_storeu_si256((__m256i*) (p_Dest + i), s_ScanAVX2(low, carry));
+        _mm256_storeu_si256((__m256i*) (p_Dest + i + 8), s_ScanAVX2(high, carry));
+    }
+
+    return s_PrefixScanRowScalar<NonZero>(p_Src + i, p_Dest + i, p_Count - i, static_cast<uint32_t>(_mm256_cvtsi256_si32(carry)));
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_PrefixAccumulateRowAVX2(const uint8_t* p_Src, uint32_t* p_ColumnSum, uint32_t* p_ColumnNonZero, int p_Count,
+                                      uint32_t* p_RowSum, uint32_t* p_RowNonZero)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m256i carrySum = _mm256_set1_epi32(static_cast<int>(*p_RowSum));
+    __m256i carryNonZero = _mm256_set1_epi32(static_cast<int>(*p_RowNonZero));
+
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        const __m128i pixels = _mm_loadl_epi64((const __m128i*) (p_Src + i));
+
+        __m256i* columnSum = (__m256i*) (p_ColumnSum + i);
+        __m256i* columnNonZero = (__m256i*) (p_ColumnNonZero + i);
+        _mm256_storeu_si256(columnSum, _mm256_add_epi32(_mm256_loadu_si256(columnSum),
+                                                        s_ScanAVX2(_mm256_cvtepu8_epi32(pixels), carrySum)));
+        _mm256_storeu_si256(columnNonZero, _mm256_add_epi32(_mm256_loadu_si256(columnNonZero),
+                                                            s_ScanAVX2(_mm256_cvtepu8_epi32(_mm_min_epu8(pixels, one)), carryNonZero)));
+    }
+
+    *p_RowSum = static_cast<uint32_t>(_mm256_cvtsi256_si32(carrySum));
+    *p_RowNonZero = static_cast<uint32_t>(_mm256_cvtsi256_si32(carryNonZero));
+
+    // Handle left-over
+    s_PrefixAccumulateRowScalar(p_Src, p_ColumnSum, p_ColumnNonZero, p_Count, p_RowSum, p_RowNonZero, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_AddRowAVX2(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count)
+{
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        __m256i destValues = _mm256_loadu_si256((const __m256i*) (p_Dest + i));
+        __m256i srcValues = _mm256_loadu_si256((const __m256i*) (p_Src + i));
+        _mm256_storeu_si256((__m256i*) (p_Dest + i), _mm256_add_epi32(destValues, srcValues));
+    }
+
+    // Handle left-over
+    s_AddRowScalar(p_Dest, p_Src, p_Count, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_AddRowWideAVX2(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count)
+{
+    int i = 0;
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        __m256i destValues = _mm256_loadu_si256((const __m256i*) (p_Dest + i));
+        __m256i srcValues = _mm256_loadu_si256((const __m256i*) (p_Src + i));
+        _mm256_storeu_si256((__m256i*) (p_Dest + i), _mm256_add_epi64(destValues, srcValues));
+    }
+
+    // Handle left-over
+    s_AddRowWideScalar(p_Dest, p_Src, p_Count, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_AccumulateRowWideAVX2(uint64_t* p_Dest, const uint64_t* p_Above, const uint32_t* p_RowPrefix, int p_Count)
+{
+    int i = 0;
+    for (; i + 4 <= p_Count; i += 4)
+    {
+        __m256i values = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*) (p_RowPrefix + i)));
+        if (p_Above) values = _mm256_add_epi64(values, _mm256_loadu_si256((const __m256i*) (p_Above + i)));
+
+        _mm256_storeu_si256((__m256i*) (p_Dest + i), values);
+    }
+
+    // Handle left-over
+    s_AccumulateRowWideScalar(p_Dest, p_Above, p_RowPrefix, p_Count, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static uint64_t s_AccumulateSquareRowAVX2(const uint8_t* p_Src, uint64_t* p_Dest, const uint64_t* p_Above, int p_Count, uint64_t p_RowCarry)
+{
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        // Squares in u16, block prefix in u32, widened to u64 with the row carry
+        const __m128i pixels = _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i*) (p_Src + i)));
+        __m256i blockCarry = _mm256_setzero_si256();
+        const __m256i prefix = s_ScanAVX2(_mm256_cvtepu16_epi32(_mm_mullo_epi16(pixels, pixels)), blockCarry);
+
+        const __m256i rowCarry = _mm256_set1_epi64x(static_cast<long long>(p_RowCarry));
+        __m256i prefixLow  = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(prefix)), rowCarry);
+        __m256i prefixHigh = _mm256_add_epi64(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(prefix, 1)), rowCarry);
+        if (p_Above)
+        {
+            prefixLow  = _mm256_add_epi64(prefixLow, _mm256_loadu_si256((const __m256i*) (p_Above + i)));
+            prefixHigh = _mm256_add_epi64(prefixHigh, _mm256_loadu_si256((const __m256i*) (p_Above + i + 4)));
+        }
+
+        _mm256_storeu_si256((__m256i*) (p_Dest + i), prefixLow);
+        _mm256_storeu_si256((__m256i*) (p_Dest + i + 4), prefixHigh);
+
+        p_RowCarry += static_cast<uint32_t>(_mm256_cvtsi256_si32(blockCarry));
+    }
+
+    // Handle left-over
+    return s_AccumulateSquareRowScalar(p_Src, p_Dest, p_Above, p_Count, p_RowCarry, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_AccumulateChannelRowAVX2(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount, int p_ChannelCount)
+{
+    const __m128i shuffle = _mm_load_si128((const __m128i*) s_ChannelShuffleMask(p_ChannelCount));
+    __m256i rowSum = _mm256_setzero_si256();
+
+    // Two pixels per iteration, one per 128-bit lane. 8 bytes are loaded, the row tail is left to the scalar loop.
+    int i = 0;
+    for (; (p_PixelCount - i) * p_ChannelCount >= 8; i += 2)
+    {
+        const __m128i pixels = _mm_shuffle_epi8(_mm_loadl_epi64((const __m128i*) (p_Src + i * p_ChannelCount)), shuffle);
+        __m256i values = _mm256_cvtepu8_epi32(pixels);
+
+        // Prefix of the two pixels, then the channel sums of the pixels on the left
+        values = _mm256_add_epi32(values, _mm256_permute2x128_si256(values, values, 0x08));
+        values = _mm256_add_epi32(values, rowSum);
+        rowSum = _mm256_permute2x128_si256(values, values, 0x11);
+
+        _mm256_storeu_si256((__m256i*) (p_Dest + 4 * i), _mm256_add_epi32(values, _mm256_loadu_si256((const __m256i*) (p_Above + 4 * i))));
+    }
+
+    // Handle left-over
+    alignas(16) uint32_t rowSumLanes[4];
+    _mm_store_si128((__m128i*) rowSumLanes, _mm256_castsi256_si128(rowSum));
+    s_AccumulateChannelRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_ChannelCount, rowSumLanes, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_AccumulateThresholdRowAVX2(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount,
+                                         const uint32_t* p_Thresholds, int p_LaneCount)
+{
+    const __m256i one = _mm256_set1_epi32(1);
+
+    if (p_LaneCount == 4)
+    {
+        // Two pixels per iteration, one per 128-bit lane, the row tail is left to the scalar loop
+        const __m128i broadcast = _mm_load_si128((const __m128i*) s_ThresholdBroadcastMask(4));
+        const __m256i thresholds = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*) p_Thresholds));
+        __m256i rowCounts = _mm256_setzero_si256();
+
+        int i = 0;
+        for (; i + 2 <= p_PixelCount; i += 2)
+        {
+            uint16_t pixelBytes;
+            memcpy(&pixelBytes, p_Src + i, sizeof(pixelBytes));
+
+            const __m256i pixels = _mm256_cvtepu8_epi32(_mm_shuffle_epi8(_mm_cvtsi32_si128(pixelBytes), broadcast));
+            __m256i values = _mm256_and_si256(_mm256_cmpgt_epi32(pixels, thresholds), one);
+
+            // Prefix of the two pixels, then the counts of the pixels on the left
+            values = _mm256_add_epi32(values, _mm256_permute2x128_si256(values, values, 0x08));
+            values = _mm256_add_epi32(values, rowCounts);
+            rowCounts = _mm256_permute2x128_si256(values, values, 0x11);
+
+            _mm256_storeu_si256((__m256i*) (p_Dest + 4 * i), _mm256_add_epi32(values, _mm256_loadu_si256((const __m256i*) (p_Above + 4 * i))));
+        }
+
+        // Handle left-over
+        alignas(16) uint32_t rowCountLanes[4];
+        _mm_store_si128((__m128i*) rowCountLanes, _mm256_castsi256_si128(rowCounts));
+        s_AccumulateThresholdRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_Thresholds, p_LaneCount, rowCountLanes, i);
+        return;
+    }
+
+    if (p_LaneCount % 8 != 0)
+    {
+        s_AccumulateThresholdRowSSE2(p_Src, p_Dest, p_Above, p_PixelCount, p_Thresholds, p_LaneCount);
+        return;
+    }
+
+    const int chunkCount = p_LaneCount / 8;
+
+    __m256i thresholds[2];
+    __m256i rowCounts[2];
+    for (int chunk = 0; chunk < chunkCount; chunk++)
+    {
+        thresholds[chunk] = _mm256_loadu_si256((const __m256i*) (p_Thresholds + 8 * chunk));
+        rowCounts[chunk] = _mm256_setzero_si256();
+    }
+
+    // One pixel per iteration broadcasted to all the lanes
+    for (int i = 0; i < p_PixelCount; i++)
+    {
+        const __m256i pixel = _mm256_set1_epi32(p_Src[i]);
+        for (int chunk = 0; chunk < chunkCount; chunk++)
+        {
+            const ptrdiff_t entry = static_cast<ptrdiff_t>(i) * p_LaneCount + 8 * chunk;
+
+            rowCounts[chunk] = _mm256_sub_epi32(rowCounts[chunk], _mm256_cmpgt_epi32(pixel, thresholds[chunk]));
+            _mm256_storeu_si256((__m256i*) (p_Dest + entry), _mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (p_Above + entry)), rowCounts[chunk]));
+        }
+    }
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_WindowSumRowAVX2(const uint32_t* p_Bottom, const uint32_t* p_Top, int p_WindowWidth, int p_Count, uint32_t* p_Sums)
+{
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        const __m256i d = _mm256_loadu_si256((const __m256i*) (p_Bottom + i + p_WindowWidth));
+        const __m256i c = _mm256_loadu_si256((const __m256i*) (p_Bottom + i));
+        const __m256i b = _mm256_loadu_si256((const __m256i*) (p_Top + i + p_WindowWidth));
+        const __m256i a = _mm256_loadu_si256((const __m256i*) (p_Top + i));
+
+        _mm256_storeu_si256((__m256i*) (p_Sums + i), _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(d, c), b), a));
+    }
+
+    // Handle left-over
+    s_WindowSumRowScalar(p_Bottom, p_Top, p_WindowWidth, p_Count, p_Sums, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static inline __m256 s_ConvertU32ToFloatAVX2(__m256i p_Values)
+{
+    const __m256 high = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(p_Values, 16)), _mm256_set1_ps(65536.0f));
+    const __m256 low  = _mm256_cvtepi32_ps(_mm256_and_si256(p_Values, _mm256_set1_epi32(0xFFFF)));
+
+    return _mm256_add_ps(high, low);
+}
+
+template<bool Contiguous>
+PIXELSUM_TARGET_AVX2
+static inline __m256i s_LoadCascadeEntriesAVX2(const uint32_t* p_Entry, __m256i p_WindowOffsets)
+{
+    if (Contiguous) return _mm256_loadu_si256((const __m256i*) p_Entry);
+
+    return _mm256_i32gather_epi32(reinterpret_cast<const int*>(p_Entry), p_WindowOffsets, 4);
+}
+
+template<bool Contiguous>
+PIXELSUM_TARGET_AVX2
+static void s_EvaluateCascadeAVX2(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                  int* p_PassedStages)
+{
+    const ptrdiff_t windowStride = p_Cascade.windowStride;
+    const __m256i windowOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(static_cast<int>(windowStride)));
+
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        const uint32_t* windowOrigin = p_Origin + i * windowStride;
+        const __m256 normalization = _mm256_loadu_ps(p_Normalization + i);
+        __m256i active = _mm256_set1_epi32(-1);
+        __m256i passedStages = _mm256_setzero_si256();
+
+        for (int stage = 0; stage < p_Cascade.stageCount; stage++)
+        {
+            const PixelSumCascadeStage& cascadeStage = p_Cascade.stages[stage];
+            __m256 stageSum = _mm256_setzero_ps();
+
+            for (int feature = 0; feature < cascadeStage.featureCount; feature++)
+            {
+                const PixelSumCascadeFeature& cascadeFeature = p_Cascade.features[cascadeStage.featureBegin + feature];
+
+                __m256 value = _mm256_setzero_ps();
+                for (int rect = 0; rect < cascadeFeature.rectCount; rect++)
+                {
+                    const ptrdiff_t* corners = cascadeFeature.corners[rect];
+                    const __m256i a = s_LoadCascadeEntriesAVX2<Contiguous>(windowOrigin + corners[0], windowOffsets);
+                    const __m256i b = s_LoadCascadeEntriesAVX2<Contiguous>(windowOrigin + corners[1], windowOffsets);
+                    const __m256i c = s_LoadCascadeEntriesAVX2<Contiguous>(windowOrigin + corners[2], windowOffsets);
+                    const __m256i d = s_LoadCascadeEntriesAVX2<Contiguous>(windowOrigin + corners[3], windowOffsets);
+                    const __m256i rectSum = _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(d, c), b), a);
+
+                    value = _mm256_add_ps(value, _mm256_mul_ps(_mm256_set1_ps(cascadeFeature.weights[rect]), s_ConvertU32ToFloatAVX2(rectSum)));
+                }
+
+                const __m256 isLeft = _mm256_cmp_ps(value, _mm256_mul_ps(_mm256_set1_ps(cascadeFeature.threshold), normalization), _CMP_LT_OQ);
+                stageSum = _mm256_add_ps(stageSum, _mm256_blendv_ps(_mm256_set1_ps(cascadeFeature.rightValue), _mm256_set1_ps(cascadeFeature.leftValue), isLeft));
+            }
+
+            // Rejected windows stay rejected, the stage loop ends once all the windows are rejected
+            active = _mm256_and_si256(active, _mm256_castps_si256(_mm256_cmp_ps(stageSum, _mm256_set1_ps(cascadeStage.threshold), _CMP_NLT_UQ)));
+            passedStages = _mm256_sub_epi32(passedStages, active);
+            if (_mm256_testz_si256(active, active)) break;
+        }
+
+        _mm256_storeu_si256((__m256i*) (p_PassedStages + i), passedStages);
+    }
+
+    // Handle left-over
+    s_EvaluateCascadeScalar(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages, i);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_EvaluateCascadeAVX2Entry(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                       int* p_PassedStages)
+{
+    if (p_Cascade.windowStride == 1) s_EvaluateCascadeAVX2<true>(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages);
+    else                             s_EvaluateCascadeAVX2<false>(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages);
+}
+
+PIXELSUM_TARGET_AVX2
+static void s_RegionHistogramAVX2(const PixelSumHistogramCorners& p_Corners, int p_BinCount, uint32_t* p_Histogram)
+{
+    int i = 0;
+    for (; i + 8 <= p_BinCount; i += 8)
+    {
+        __m256i corners[4];
+        for (int k = 0; k < 4; k++)
+        {
+            const __m256i local = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*) (p_Corners.local[k] + i)));
+
+            corners[k] = _mm256_add_epi32(_mm256_add_epi32(_mm256_loadu_si256((const __m256i*) (p_Corners.top[k] + i)),
+                                                           _mm256_loadu_si256((const __m256i*) (p_Corners.left[k] + i))), local);
+        }
+
+        _mm256_storeu_si256((__m256i*) (p_Histogram + i),
+                            _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(corners[0], corners[1]), corners[2]), corners[3]));
+    }
+
+    // Handle left-over
+    s_RegionHistogramScalar(p_Corners, p_BinCount, p_Histogram, i);
+}
+
+//----------------------------------------------------------------------------
+// AVX-512 kernels, 16 lanes of u32
+//----------------------------------------------------------------------------
+PIXELSUM_TARGET_AVX512
+static inline __m512i s_ScanAVX512(__m512i p_Values, __m512i& p_Carry)
+{
+    // alignr with zero shifts the whole register left by N lanes, shifted in lanes are zero
+    const __m512i zero = _mm512_setzero_si512();
+    p_Values = _mm512_add_epi32(p_Values, _mm512_alignr_epi32(p_Values, zero, 16 - 1));
+    p_Values = _mm512_add_epi32(p_Values, _mm512_alignr_epi32(p_Values, zero, 16 - 2));
+    p_Values = _mm512_add_epi32(p_Values, _mm512_alignr_epi32(p_Values, zero, 16 - 4));
+    p_Values = _mm512_add_epi32(p_Values, _mm512_alignr_epi32(p_Values, zero, 16 - 8));
+
+    p_Values = _mm512_add_epi32(p_Values, p_Carry);
+    p_Carry  = _mm512_permutexvar_epi32(_mm512_set1_epi32(15), p_Values);
+
+    return p_Values;
+}
+
+template<bool NonZero>
+PIXELSUM_TARGET_AVX512
+static uint32_t s_PrefixScanRowAVX512(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m512i carry = _mm512_setzero_si512();
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        __m128i pixels = _mm_loadu_si128((const __m128i*) (p_Src + i));
+        if (NonZero) pixels = _mm_min_epu8(pixels, one);
+
+        _mm512_storeu_si512(p_Dest + i, s_ScanAVX512(_mm512_cvtepu8_epi32(pixels), carry));
+    }
+
+    return s_PrefixScanRowScalar<NonZero>(p_Src + i, p_Dest + i, p_Count - i, static_cast<uint32_t>(_mm512_cvtsi512_si32(carry)));
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_PrefixAccumulateRowAVX512(const uint8_t* p_Src, uint32_t* p_ColumnSum, uint32_t* p_ColumnNonZero, int p_Count,
+                                        uint32_t* p_RowSum, uint32_t* p_RowNonZero)
+{
+    const __m128i one = _mm_set1_epi8(1);
+    __m512i carrySum = _mm512_set1_epi32(static_cast<int>(*p_RowSum));
+    __m512i carryNonZero = _mm512_set1_epi32(static_cast<int>(*p_RowNonZero));
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        const __m128i pixels = _mm_loadu_si128((const __m128i*) (p_Src + i));
+
+        const __m512i scannedSum = s_ScanAVX512(_mm512_cvtepu8_epi32(pixels), carrySum);
+        const __m512i scannedNonZero = s_ScanAVX512(_mm512_cvtepu8_epi32(_mm_min_epu8(pixels, one)), carryNonZero);
+
+        _mm512_storeu_si512(p_ColumnSum + i, _mm512_add_epi32(_mm512_loadu_si512(p_ColumnSum + i), scannedSum));
+        _mm512_storeu_si512(p_ColumnNonZero + i, _mm512_add_epi32(_mm512_loadu_si512(p_ColumnNonZero + i), scannedNonZero));
+    }
+
+    *p_RowSum = static_cast<uint32_t>(_mm512_cvtsi512_si32(carrySum));
+    *p_RowNonZero = static_cast<uint32_t>(_mm512_cvtsi512_si32(carryNonZero));
+
+    // Handle left-over
+    s_PrefixAccumulateRowScalar(p_Src, p_ColumnSum, p_ColumnNonZero, p_Count, p_RowSum, p_RowNonZero, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_AddRowAVX512(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count)
+{
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        __m512i destValues = _mm512_loadu_si512(p_Dest + i);
+        __m512i srcValues = _mm512_loadu_si512(p_Src + i);
+        _mm512_storeu_si512(p_Dest + i, _mm512_add_epi32(destValues, srcValues));
+    }
+
+    // Handle left-over
+    s_AddRowScalar(p_Dest, p_Src, p_Count, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_AddRowWideAVX512(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count)
+{
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        __m512i destValues = _mm512_loadu_si512(p_Dest + i);
+        __m512i srcValues = _mm512_loadu_si512(p_Src + i);
+        _mm512_storeu_si512(p_Dest + i, _mm512_add_epi64(destValues, srcValues));
+    }
+
+    // Handle left-over
+    s_AddRowWideScalar(p_Dest, p_Src, p_Count, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_AccumulateRowWideAVX512(uint64_t* p_Dest, const uint64_t* p_Above, const uint32_t* p_RowPrefix, int p_Count)
+{
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        __m512i values = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*) (p_RowPrefix + i)));
+        if (p_Above) values = _mm512_add_epi64(values, _mm512_loadu_si512(p_Above + i));
+
+        _mm512_storeu_si512(p_Dest + i, values);
+    }
+
+    // Handle left-over
+    s_AccumulateRowWideScalar(p_Dest, p_Above, p_RowPrefix, p_Count, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static uint64_t s_AccumulateSquareRowAVX512(const uint8_t* p_Src, uint64_t* p_Dest, const uint64_t* p_Above, int p_Count, uint64_t p_RowCarry)
+{
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        const __m256i pixels = _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i*) (p_Src + i)));
+        __m512i blockCarry = _mm512_setzero_si512();
+        const __m512i prefix = s_ScanAVX512(_mm512_cvtepu16_epi32(_mm256_mullo_epi16(pixels, pixels)), blockCarry);
+
+        const __m512i rowCarry = _mm512_set1_epi64(static_cast<long long>(p_RowCarry));
+        __m512i prefixLow  = _mm512_add_epi64(_mm512_cvtepu32_epi64(_mm512_castsi512_si256(prefix)), rowCarry);
+        __m512i prefixHigh = _mm512_add_epi64(_mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(prefix, 1)), rowCarry);
+        if (p_Above)
+        {
+            prefixLow  = _mm512_add_epi64(prefixLow, _mm512_loadu_si512(p_Above + i));
+            prefixHigh = _mm512_add_epi64(prefixHigh, _mm512_loadu_si512(p_Above + i + 8));
+        }
+
+        _mm512_storeu_si512(p_Dest + i, prefixLow);
+        _mm512_storeu_si512(p_Dest + i + 8, prefixHigh);
+
+        p_RowCarry += static_cast<uint32_t>(_mm512_cvtsi512_si32(blockCarry));
+    }
+
+    // Handle left-over
+    return s_AccumulateSquareRowScalar(p_Src, p_Dest, p_Above, p_Count, p_RowCarry, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_AccumulateChannelRowAVX512(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount, int p_ChannelCount)
+{
+    const __m128i shuffle = _mm_load_si128((const __m128i*) s_ChannelShuffleMask(p_ChannelCount));
+    const __m512i zero = _mm512_setzero_si512();
+    __m512i rowSum = zero;
+
+    // Four pixels per iteration, one per 128-bit lane. 16 bytes are loaded, the row tail is left to the scalar loop.
+    int i = 0;
+    for (; (p_PixelCount - i) * p_ChannelCount >= 16; i += 4)
+    {
+        const __m128i pixels = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*) (p_Src + i * p_ChannelCount)), shuffle);
+        __m512i values = _mm512_cvtepu8_epi32(pixels);
+
+        // Scan across the 128-bit lanes, i.e. pixel by pixel with all the channels at once
+        values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 16 - 4));
+        values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 16 - 8));
+        values = _mm512_add_epi32(values, rowSum);
+        rowSum = _mm512_shuffle_i32x4(values, values, _MM_SHUFFLE(3, 3, 3, 3));
+
+        _mm512_storeu_si512(p_Dest + 4 * i, _mm512_add_epi32(values, _mm512_loadu_si512(p_Above + 4 * i)));
+    }
+
+    // Handle left-over
+    alignas(16) uint32_t rowSumLanes[4];
+    _mm_store_si128((__m128i*) rowSumLanes, _mm512_castsi512_si128(rowSum));
+    s_AccumulateChannelRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_ChannelCount, rowSumLanes, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_AccumulateThresholdRowAVX512(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount,
+                                           const uint32_t* p_Thresholds, int p_LaneCount)
+{
+    if (p_LaneCount == 12)
+    {
+        s_AccumulateThresholdRowAVX2(p_Src, p_Dest, p_Above, p_PixelCount, p_Thresholds, p_LaneCount);
+        return;
+    }
+
+    const __m512i zero = _mm512_setzero_si512();
+    const __m512i one = _mm512_set1_epi32(1);
+
+    if (p_LaneCount == 16)
+    {
+        // One pixel per iteration broadcasted to all the lanes
+        const __m512i thresholds = _mm512_loadu_si512(p_Thresholds);
+        __m512i rowCounts = zero;
+
+        for (int i = 0; i < p_PixelCount; i++)
+        {
+            const __mmask16 passed = _mm512_cmpgt_epi32_mask(_mm512_set1_epi32(p_Src[i]), thresholds);
+            rowCounts = _mm512_mask_add_epi32(rowCounts, passed, rowCounts, one);
+            _mm512_storeu_si512(p_Dest + 16 * i, _mm512_add_epi32(_mm512_loadu_si512(p_Above + 16 * i), rowCounts));
+        }
+        return;
+    }
+
+    // 4 pixels of 4 lanes or 2 pixels of 8 lanes per iteration, the row tail is left to the scalar loop
+    const int pixelsPerIteration = 16 / p_LaneCount;
+    const __m128i broadcast = _mm_load_si128((const __m128i*) s_ThresholdBroadcastMask(p_LaneCount));
+    const __m512i thresholds = (p_LaneCount == 4) ? _mm512_broadcast_i32x4(_mm_loadu_si128((const __m128i*) p_Thresholds))
+                                                  : _mm512_broadcast_i64x4(_mm256_loadu_si256((const __m256i*) p_Thresholds));
+    __m512i rowCounts = zero;
+
+    int i = 0;
+    for (; i + pixelsPerIteration <= p_PixelCount; i += pixelsPerIteration)
+    {
+        int pixelBytes = 0;
+        memcpy(&pixelBytes, p_Src + i, pixelsPerIteration);
+
+        const __m512i pixels = _mm512_cvtepu8_epi32(_mm_shuffle_epi8(_mm_cvtsi32_si128(pixelBytes), broadcast));
+        __m512i values = _mm512_maskz_mov_epi32(_mm512_cmpgt_epi32_mask(pixels, thresholds), one);
+
+        // Scan across the entries, i.e. pixel by pixel with all the thresholds at once
+        if (p_LaneCount == 4)
+        {
+            values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 16 - 4));
+            values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 16 - 8));
+            values = _mm512_add_epi32(values, rowCounts);
+            rowCounts = _mm512_shuffle_i32x4(values, values, _MM_SHUFFLE(3, 3, 3, 3));
+        }
+        else
+        {
+            values = _mm512_add_epi32(values, _mm512_alignr_epi32(values, zero, 16 - 8));
+            values = _mm512_add_epi32(values, rowCounts);
+            rowCounts = _mm512_shuffle_i32x4(values, values, _MM_SHUFFLE(3, 2, 3, 2));
+        }
+
+        _mm512_storeu_si512(p_Dest + p_LaneCount * i, _mm512_add_epi32(values, _mm512_loadu_si512(p_Above + p_LaneCount * i)));
+    }
+
+    // Handle left-over
+    alignas(64) uint32_t rowCountLanes[16];
+    _mm512_store_si512(rowCountLanes, rowCounts);
+    s_AccumulateThresholdRowScalar(p_Src, p_Dest, p_Above, p_PixelCount, p_Thresholds, p_LaneCount, rowCountLanes, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_WindowSumRowAVX512(const uint32_t* p_Bottom, const uint32_t* p_Top, int p_WindowWidth, int p_Count, uint32_t* p_Sums)
+{
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        const __m512i d = _mm512_loadu_si512(p_Bottom + i + p_WindowWidth);
+        const __m512i c = _mm512_loadu_si512(p_Bottom + i);
+        const __m512i b = _mm512_loadu_si512(p_Top + i + p_WindowWidth);
+        const __m512i a = _mm512_loadu_si512(p_Top + i);
+
+        _mm512_storeu_si512(p_Sums + i, _mm512_add_epi32(_mm512_sub_epi32(_mm512_sub_epi32(d, c), b), a));
+    }
+
+    // Handle left-over
+    s_WindowSumRowScalar(p_Bottom, p_Top, p_WindowWidth, p_Count, p_Sums, i);
+}
+
+template<bool Contiguous>
+PIXELSUM_TARGET_AVX512
+static inline __m512i s_LoadCascadeEntriesAVX512(const uint32_t* p_Entry, __m512i p_WindowOffsets)
+{
+    if (Contiguous) return _mm512_loadu_si512(p_Entry);
+
+    return _mm512_i32gather_epi32(p_WindowOffsets, p_Entry, 4);
+}
+
+template<bool Contiguous>
+PIXELSUM_TARGET_AVX512
+static void s_EvaluateCascadeAVX512(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                    int* p_PassedStages)
+{
+    const ptrdiff_t windowStride = p_Cascade.windowStride;
+    const __m512i windowOffsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                                     _mm512_set1_epi32(static_cast<int>(windowStride)));
+    const __m512i one = _mm512_set1_epi32(1);
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        const uint32_t* windowOrigin = p_Origin + i * windowStride;
+        const __m512 normalization = _mm512_loadu_ps(p_Normalization + i);
+        __mmask16 active = 0xFFFF;
+        __m512i passedStages = _mm512_setzero_si512();
+
+        for (int stage = 0; stage < p_Cascade.stageCount; stage++)
+        {
+            const PixelSumCascadeStage& cascadeStage = p_Cascade.stages[stage];
+            __m512 stageSum = _mm512_setzero_ps();
+
+            for (int feature = 0; feature < cascadeStage.featureCount; feature++)
+            {
+                const PixelSumCascadeFeature& cascadeFeature = p_Cascade.features[cascadeStage.featureBegin + feature];
+
+                __m512 value = _mm512_setzero_ps();
+                for (int rect = 0; rect < cascadeFeature.rectCount; rect++)
+                {
+                    const ptrdiff_t* corners = cascadeFeature.corners[rect];
+                    const __m512i a = s_LoadCascadeEntriesAVX512<Contiguous>(windowOrigin + corners[0], windowOffsets);
+                    const __m512i b = s_LoadCascadeEntriesAVX512<Contiguous>(windowOrigin + corners[1], windowOffsets);
+                    const __m512i c = s_LoadCascadeEntriesAVX512<Contiguous>(windowOrigin + corners[2], windowOffsets);
+                    const __m512i d = s_LoadCascadeEntriesAVX512<Contiguous>(windowOrigin + corners[3], windowOffsets);
+                    const __m512i rectSum = _mm512_add_epi32(_mm512_sub_epi32(_mm512_sub_epi32(d, c), b), a);
+
+                    value = _mm512_add_ps(value, _mm512_mul_ps(_mm512_set1_ps(cascadeFeature.weights[rect]), _mm512_cvtepu32_ps(rectSum)));
+                }
+
+                const __mmask16 isLeft = _mm512_cmp_ps_mask(value, _mm512_mul_ps(_mm512_set1_ps(cascadeFeature.threshold), normalization), _CMP_LT_OQ);
+                stageSum = _mm512_add_ps(stageSum, _mm512_mask_blend_ps(isLeft, _mm512_set1_ps(cascadeFeature.rightValue), _mm512_set1_ps(cascadeFeature.leftValue)));
+            }
+
+            // Rejected windows stay rejected, the stage loop ends once all the windows are rejected
+            active &= _mm512_cmp_ps_mask(stageSum, _mm512_set1_ps(cascadeStage.threshold), _CMP_NLT_UQ);
+            passedStages = _mm512_mask_add_epi32(passedStages, active, passedStages, one);
+            if (active == 0) break;
+        }
+
+        _mm512_storeu_si512(p_PassedStages + i, passedStages);
+    }
+
+    // Handle left-over
+    s_EvaluateCascadeScalar(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_EvaluateCascadeAVX512Entry(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                                         int* p_PassedStages)
+{
+    if (p_Cascade.windowStride == 1) s_EvaluateCascadeAVX512<true>(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages);
+    else                             s_EvaluateCascadeAVX512<false>(p_Cascade, p_Origin, p_Normalization, p_Count, p_PassedStages);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_RegionHistogramAVX512(const PixelSumHistogramCorners& p_Corners, int p_BinCount, uint32_t* p_Histogram)
+{
+    int i = 0;
+    for (; i + 16 <= p_BinCount; i += 16)
+    {
+        __m512i corners[4];
+        for (int k = 0; k < 4; k++)
+        {
+            const __m512i local = _mm512_cvtepu8_epi32(_mm_loadu_si128((const __m128i*) (p_Corners.local[k] + i)));
+
+            corners[k] = _mm512_add_epi32(_mm512_add_epi32(_mm512_loadu_si512(p_Corners.top[k] + i), _mm512_loadu_si512(p_Corners.left[k] + i)), local);
+        }
+
+        _mm512_storeu_si512(p_Histogram + i, _mm512_add_epi32(_mm512_sub_epi32(_mm512_sub_epi32(corners[0], corners[1]), corners[2]), corners[3]));
+    }
+
+    // Handle left-over
+    s_RegionHistogramScalar(p_Corners, p_BinCount, p_Histogram, i);
+}
+
+//----------------------------------------------------------------------------
+// Batched region query kernels
+//----------------------------------------------------------------------------
+
+// Regions ahead of the current one whose corners are prefetched
+static constexpr int QUERY_PREFETCH_DISTANCE = 16;
+
+// Prefetch the four corners of a region, coordinates are only roughly clamped since a prefetch never faults
+static inline void s_PrefetchRegionCorners(const PixelSumQueryTables& p_Tables, const PixelBufferCoords_i& p_Region)
+{
+    const int stride = p_Tables.tableStride;
+    const size_t x0 = p_Tables.tableOrigin + static_cast<size_t>(g_Clamp(p_Region.x0 - 1, 0, p_Tables.sourceTLBR.right)) * stride;
+    const size_t x1 = p_Tables.tableOrigin + static_cast<size_t>(g_Clamp(p_Region.x1, 0, p_Tables.sourceTLBR.right)) * stride;
+    const size_t row0 = static_cast<size_t>(g_Clamp(p_Region.y0 - 1, 0, p_Tables.sourceTLBR.bottom)) * p_Tables.tablePitch;
+    const size_t row1 = static_cast<size_t>(g_Clamp(p_Region.y1, 0, p_Tables.sourceTLBR.bottom)) * p_Tables.tablePitch;
+
+    const uint32_t* tables[] = { p_Tables.sumAreaTable, p_Tables.nonZeroTable };
+    for (const uint32_t* table : tables)
+    {
+        if (!table) continue;
+
+        _mm_prefetch(reinterpret_cast<const char*>(table + row0 + x0), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(table + row0 + x1), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(table + row1 + x0), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(table + row1 + x1), _MM_HINT_T0);
+    }
+
+    if (p_Tables.squaredTable)
+    {
+        // Planar table, the columns are the ones of a stride of 1
+        const uint64_t* table = p_Tables.squaredTable + p_Tables.squaredTableOrigin;
+        const size_t col0 = static_cast<size_t>(g_Clamp(p_Region.x0 - 1, 0, p_Tables.sourceTLBR.right));
+        const size_t col1 = static_cast<size_t>(g_Clamp(p_Region.x1, 0, p_Tables.sourceTLBR.right));
+        const size_t squaredRow0 = static_cast<size_t>(g_Clamp(p_Region.y0 - 1, 0, p_Tables.sourceTLBR.bottom)) * p_Tables.squaredTablePitch;
+        const size_t squaredRow1 = static_cast<size_t>(g_Clamp(p_Region.y1, 0, p_Tables.sourceTLBR.bottom)) * p_Tables.squaredTablePitch;
+
+        _mm_prefetch(reinterpret_cast<const char*>(table + squaredRow0 + col0), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(table + squaredRow0 + col1), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(table + squaredRow1 + col0), _MM_HINT_T0);
+        _mm_prefetch(reinterpret_cast<const char*>(table + squaredRow1 + col1), _MM_HINT_T0);
+    }
+}
+
+template<typename T>
+static inline T s_SumAreaForClippedWindow(const PixelSumQueryTables& p_Tables, const T* p_Table, size_t p_Pitch, size_t p_Origin, int p_Stride,
+                                          int x0, int y0, int x1, int y1)
+{
+    const T* table = p_Table + p_Origin;
+    const ptrdiff_t pitch = static_cast<ptrdiff_t>(p_Pitch);
+    const ptrdiff_t stride = p_Stride;
+
+    const ptrdiff_t rowY1 = y1 * pitch;
+    const ptrdiff_t rowY0 = (y0 - 1) * pitch;
+    const ptrdiff_t colX1 = x1 * stride;
+    const ptrdiff_t colX0 = (x0 - 1) * stride;
+
+    // Summed Area => D - C - B + A, the zero border makes all the corners readable
+    const bool hasC = p_Tables.hasZeroBorder || x0 > 0;
+    const bool hasB = p_Tables.hasZeroBorder || y0 > 0;
+
+    T pixelSum = table[rowY1 + colX1];                              // Region D => (x1,     y1)
+    if (hasC)          pixelSum -= table[rowY1 + colX0];            // Region C => (x0 - 1, y1)
+    if (hasB)          pixelSum -= table[rowY0 + colX1];            // Region B => (x1,     y0 - 1)
+    if (hasC && hasB)  pixelSum += table[rowY0 + colX0];            // Region A => (x0 - 1, y0 - 1)
+
+    return pixelSum;
+}
+
+static void s_QueryRegionsScalar(const PixelSumQueryTables& p_Tables, const PixelBufferCoords_i* p_Regions, int p_Count,
+                                 uint32_t* p_Sums, uint32_t* p_NonZeroCounts, uint64_t* p_SquaredSums, uint64_t* p_PixelCounts, int p_Start)
+{
+    for (int i = p_Start; i < p_Count; i++)
+    {
+        if (i + QUERY_PREFETCH_DISTANCE < p_Count) s_PrefetchRegionCorners(p_Tables, p_Regions[i + QUERY_PREFETCH_DISTANCE]);
+
+        int x0 = p_Regions[i].x0, y0 = p_Regions[i].y0, x1 = p_Regions[i].x1, y1 = p_Regions[i].y1;
+        p_PixelCounts[i] = s_ValidateSearchWindowClipCoords(x0, y0, x1, y1, p_Tables.sourceTLBR);
+
+        const bool isValid = (p_PixelCounts[i] != 0);
+        if (p_Tables.sumAreaTable)
+        {
+            p_Sums[i] = isValid ? s_SumAreaForClippedWindow(p_Tables, p_Tables.sumAreaTable, p_Tables.tablePitch, p_Tables.tableOrigin,
+                                                            p_Tables.tableStride, x0, y0, x1, y1) : 0;
+        }
+        if (p_Tables.nonZeroTable)
+        {
+            p_NonZeroCounts[i] = isValid ? s_SumAreaForClippedWindow(p_Tables, p_Tables.nonZeroTable, p_Tables.tablePitch, p_Tables.tableOrigin,
+                                                                     p_Tables.tableStride, x0, y0, x1, y1) : 0;
+        }
+        if (p_Tables.squaredTable)
+        {
+            p_SquaredSums[i] = isValid ? s_SumAreaForClippedWindow(p_Tables, p_Tables.squaredTable, p_Tables.squaredTablePitch,
+                                                                   p_Tables.squaredTableOrigin, 1, x0, y0, x1, y1) : 0;
+        }
+    }
+}
+
+static void s_QueryRegionsScalarEntry(const PixelSumQueryTables& p_Tables, const PixelBufferCoords_i* p_Regions, int p_Count,
+                                      uint32_t* p_Sums, uint32_t* p_NonZeroCounts, uint64_t* p_SquaredSums, uint64_t* p_PixelCounts)
+{
+    s_QueryRegionsScalar(p_Tables, p_Regions, p_Count, p_Sums, p_NonZeroCounts, p_SquaredSums, p_PixelCounts, 0);
+}
+
+// PixelBufferCoords_i layout is { y0, x0, y1, x1 }, regions are de-interleaved with strided gathers
+static constexpr int REGION_STRIDE = sizeof(PixelBufferCoords_i) / sizeof(int);
+static constexpr int REGION_Y0 = 0;
+static constexpr int REGION_X0 = 1;
+static constexpr int REGION_Y1 = 2;
+static constexpr int REGION_X1 = 3;
+
+PIXELSUM_TARGET_AVX2
+static void s_QueryRegionsAVX2(const PixelSumQueryTables& p_Tables, const PixelBufferCoords_i* p_Regions, int p_Count,
+                               uint32_t* p_Sums, uint32_t* p_NonZeroCounts, uint64_t* p_SquaredSums, uint64_t* p_PixelCounts)
+{
+    const PixBufTLBR_i& tlbr = p_Tables.sourceTLBR;
+    const __m256i zero   = _mm256_setzero_si256();
+    const __m256i one    = _mm256_set1_epi32(1);
+    const __m256i right  = _mm256_set1_epi32(tlbr.right);
+    const __m256i bottom = _mm256_set1_epi32(tlbr.bottom);
+    const __m256i pitch  = _mm256_set1_epi32(static_cast<int>(p_Tables.tablePitch));
+    const __m256i origin = _mm256_set1_epi32(static_cast<int>(p_Tables.tableOrigin));
+    const __m256i stride = _mm256_set1_epi32(p_Tables.tableStride);
+    const __m256i squaredPitch  = _mm256_set1_epi32(static_cast<int>(p_Tables.squaredTablePitch));
+    const __m256i squaredOrigin = _mm256_set1_epi32(static_cast<int>(p_Tables.squaredTableOrigin));
+    const __m256i zeroBorder = p_Tables.hasZeroBorder ? _mm256_set1_epi32(-1) : zero;
+    const __m256i regionOffsets = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_epi32(REGION_STRIDE));
+    const __m256i imageValid = (tlbr.right < 0 || tlbr.bottom < 0) ? zero : _mm256_set1_epi32(-1);
+
+    int i = 0;
+    for (; i + 8 <= p_Count; i += 8)
+    {
+        for (int j = 0; j < 8 && i + QUERY_PREFETCH_DISTANCE + j < p_Count; j++)
+        {
+            s_PrefetchRegionCorners(p_Tables, p_Regions[i + QUERY_PREFETCH_DISTANCE + j]);
+        }
+
+        const int* regionBase = reinterpret_cast<const int*>(p_Regions + i);
+        __m256i x0 = _mm256_i32gather_epi32(regionBase + REGION_X0, regionOffsets, 4);
+        __m256i y0 = _mm256_i32gather_epi32(regionBase + REGION_Y0, regionOffsets, 4);
+        __m256i x1 = _mm256_i32gather_epi32(regionBase + REGION_X1, regionOffsets, 4);
+        __m256i y1 = _mm256_i32gather_epi32(regionBase + REGION_Y1, regionOffsets, 4);
+
+        // Reject windows completely outside the buffer (tested before the swap like the scalar validation)
+        __m256i invalid = _mm256_or_si256(_mm256_or_si256(_mm256_cmpgt_epi32(zero, x1), _mm256_cmpgt_epi32(x0, right)),
+                                          _mm256_or_si256(_mm256_cmpgt_epi32(zero, y1), _mm256_cmpgt_epi32(y0, bottom)));
+        const __m256i valid = _mm256_andnot_si256(invalid, imageValid);
+
+        // Swap reversed coordinates, pixel count is computed before clamping
+        const __m256i xa = _mm256_min_epi32(x0, x1), xb = _mm256_max_epi32(x0, x1);
+        const __m256i ya = _mm256_min_epi32(y0, y1), yb = _mm256_max_epi32(y0, y1);
+        // Extents fit in u32, the product needs 64 bits
+        const __m256i extentX = _mm256_and_si256(_mm256_add_epi32(_mm256_sub_epi32(xb, xa), one), valid);
+        const __m256i extentY = _mm256_add_epi32(_mm256_sub_epi32(yb, ya), one);
+        const __m256i pixelCountLow  = _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_castsi256_si128(extentX)),
+                                                        _mm256_cvtepu32_epi64(_mm256_castsi256_si128(extentY)));
+        const __m256i pixelCountHigh = _mm256_mul_epu32(_mm256_cvtepu32_epi64(_mm256_extracti128_si256(extentX, 1)),
+                                                        _mm256_cvtepu32_epi64(_mm256_extracti128_si256(extentY, 1)));
+        _mm256_storeu_si256((__m256i*) (p_PixelCounts + i), pixelCountLow);
+        _mm256_storeu_si256((__m256i*) (p_PixelCounts + i + 4), pixelCountHigh);
+
+        x0 = _mm256_min_epi32(_mm256_max_epi32(xa, zero), right);
+        x1 = _mm256_min_epi32(_mm256_max_epi32(xb, zero), right);
+        y0 = _mm256_min_epi32(_mm256_max_epi32(ya, zero), bottom);
+        y1 = _mm256_min_epi32(_mm256_max_epi32(yb, zero), bottom);
+
+        // Corner indices and masks, corners on the left/top border are zero unless the tables have a zero border
+        const __m256i rowY1 = _mm256_add_epi32(origin, _mm256_mullo_epi32(y1, pitch));
+        const __m256i rowY0 = _mm256_add_epi32(origin, _mm256_mullo_epi32(_mm256_sub_epi32(y0, one), pitch));
+        const __m256i colX1 = _mm256_mullo_epi32(x1, stride);
+        const __m256i colX0 = _mm256_mullo_epi32(_mm256_sub_epi32(x0, one), stride);
+        const __m256i indexD = _mm256_add_epi32(rowY1, colX1);
+        const __m256i indexC = _mm256_add_epi32(rowY1, colX0);
+        const __m256i indexB = _mm256_add_epi32(rowY0, colX1);
+        const __m256i indexA = _mm256_add_epi32(rowY0, colX0);
+        const __m256i maskC = _mm256_and_si256(valid, _mm256_or_si256(zeroBorder, _mm256_cmpgt_epi32(x0, zero)));
+        const __m256i maskB = _mm256_and_si256(valid, _mm256_or_si256(zeroBorder, _mm256_cmpgt_epi32(y0, zero)));
+        const __m256i maskA = _mm256_and_si256(maskC, maskB);
+
+        const uint32_t* tables[] = { p_Tables.sumAreaTable, p_Tables.nonZeroTable };
+        uint32_t* outputs[] = { p_Sums, p_NonZeroCounts };
+        for (int t = 0; t < 2; t++)
+        {
+            if (!tables[t]) continue;
+
+            const int* table = reinterpret_cast<const int*>(tables[t]);
+            const __m256i d = _mm256_mask_i32gather_epi32(zero, table, indexD, valid, 4);
+            const __m256i c = _mm256_mask_i32gather_epi32(zero, table, indexC, maskC, 4);
+            const __m256i b = _mm256_mask_i32gather_epi32(zero, table, indexB, maskB, 4);
+            const __m256i a = _mm256_mask_i32gather_epi32(zero, table, indexA, maskA, 4);
+
+            const __m256i sum = _mm256_add_epi32(_mm256_sub_epi32(_mm256_sub_epi32(d, c), b), a);
+            _mm256_storeu_si256((__m256i*) (outputs[t] + i), sum);
+        }
+
+        if (p_Tables.squaredTable)
+        {
+            // Same corners in the planar squared table, the u64 entries are gathered four at a time
+            const __m256i squaredY1 = _mm256_add_epi32(squaredOrigin, _mm256_mullo_epi32(y1, squaredPitch));
+            const __m256i squaredY0 = _mm256_add_epi32(squaredOrigin, _mm256_mullo_epi32(_mm256_sub_epi32(y0, one), squaredPitch));
+            const __m256i squaredX0 = _mm256_sub_epi32(x0, one);
+            const __m256i squaredIndices[] = { _mm256_add_epi32(squaredY1, x1), _mm256_add_epi32(squaredY1, squaredX0),
+                                               _mm256_add_epi32(squaredY0, x1), _mm256_add_epi32(squaredY0, squaredX0) };
+            const __m256i squaredMasks[] = { valid, maskC, maskB, maskA };
+
+            const long long* table = reinterpret_cast<const long long*>(p_Tables.squaredTable);
+            for (int h = 0; h < 2; h++)
+            {
+                __m256i corners[4];
+                for (int k = 0; k < 4; k++)
+                {
+                    const __m128i index = h ? _mm256_extracti128_si256(squaredIndices[k], 1) : _mm256_castsi256_si128(squaredIndices[k]);
+                    const __m128i mask  = h ? _mm256_extracti128_si256(squaredMasks[k], 1) : _mm256_castsi256_si128(squaredMasks[k]);
+                    corners[k] = _mm256_mask_i32gather_epi64(_mm256_setzero_si256(), table, index, _mm256_cvtepi32_epi64(mask), 8);
+                }
+
+                const __m256i sum = _mm256_add_epi64(_mm256_sub_epi64(_mm256_sub_epi64(corners[0], corners[1]), corners[2]), corners[3]);
+                _mm256_storeu_si256((__m256i*) (p_SquaredSums + i + 4 * h), sum);
+            }
+        }
+    }
+
+    // Handle left-over
+    s_QueryRegionsScalar(p_Tables, p_Regions, p_Count, p_Sums, p_NonZeroCounts, p_SquaredSums, p_PixelCounts, i);
+}
+
+PIXELSUM_TARGET_AVX512
+static void s_QueryRegionsAVX512(const PixelSumQueryTables& p_Tables, const PixelBufferCoords_i* p_Regions, int p_Count,
+                                 uint32_t* p_Sums, uint32_t* p_NonZeroCounts, uint64_t* p_SquaredSums, uint64_t* p_PixelCounts)
+{
+    const PixBufTLBR_i& tlbr = p_Tables.sourceTLBR;
+    const __m512i zero   = _mm512_setzero_si512();
+    const __m512i one    = _mm512_set1_epi32(1);
+    const __m512i right  = _mm512_set1_epi32(tlbr.right);
+    const __m512i bottom = _mm512_set1_epi32(tlbr.bottom);
+    const __m512i pitch  = _mm512_set1_epi32(static_cast<int>(p_Tables.tablePitch));
+    const __m512i origin = _mm512_set1_epi32(static_cast<int>(p_Tables.tableOrigin));
+    const __m512i stride = _mm512_set1_epi32(p_Tables.tableStride);
+    const __m512i squaredPitch  = _mm512_set1_epi32(static_cast<int>(p_Tables.squaredTablePitch));
+    const __m512i squaredOrigin = _mm512_set1_epi32(static_cast<int>(p_Tables.squaredTableOrigin));
+    const __mmask16 zeroBorder = p_Tables.hasZeroBorder ? 0xFFFF : 0;
+    const __m512i regionOffsets = _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                                                     _mm512_set1_epi32(REGION_STRIDE));
+    const __mmask16 imageValid = (tlbr.right < 0 || tlbr.bottom < 0) ? 0 : 0xFFFF;
+
+    int i = 0;
+    for (; i + 16 <= p_Count; i += 16)
+    {
+        for (int j = 0; j < 16 && i + QUERY_PREFETCH_DISTANCE + j < p_Count; j++)
+        {
+            s_PrefetchRegionCorners(p_Tables, p_Regions[i + QUERY_PREFETCH_DISTANCE + j]);
+        }
+
+        const int* regionBase = reinterpret_cast<const int*>(p_Regions + i);
+        __m512i x0 = _mm512_i32gather_epi32(regionOffsets, regionBase + REGION_X0, 4);
+        __m512i y0 = _mm512_i32gather_epi32(regionOffsets, regionBase + REGION_Y0, 4);
+        __m512i x1 = _mm512_i32gather_epi32(regionOffsets, regionBase + REGION_X1, 4);
+        __m512i y1 = _mm512_i32gather_epi32(regionOffsets, regionBase + REGION_Y1, 4);
+
+        // Reject windows completely outside the buffer (tested before the swap like the scalar validation)
+        const __mmask16 invalid = _mm512_cmplt_epi32_mask(x1, zero) | _mm512_cmpgt_epi32_mask(x0, right) |
+                                  _mm512_cmplt_epi32_mask(y1, zero) | _mm512_cmpgt_epi32_mask(y0, bottom);
+        const __mmask16 valid = imageValid & ~invalid;
+
+        // Swap reversed coordinates, pixel count is computed before clamping
+        const __m512i xa = _mm512_min_epi32(x0, x1), xb = _mm512_max_epi32(x0, x1);
+        const __m512i ya = _mm512_min_epi32(y0, y1), yb = _mm512_max_epi32(y0, y1);
+        // Extents fit in u32, the product needs 64 bits
+        const __m512i extentX = _mm512_maskz_mov_epi32(valid, _mm512_add_epi32(_mm512_sub_epi32(xb, xa), one));
+        const __m512i extentY = _mm512_add_epi32(_mm512_sub_epi32(yb, ya), one);
+        const __m512i pixelCountLow  = _mm512_mul_epu32(_mm512_cvtepu32_epi64(_mm512_castsi512_si256(extentX)),
+                                                        _mm512_cvtepu32_epi64(_mm512_castsi512_si256(extentY)));
+        const __m512i pixelCountHigh = _mm512_mul_epu32(_mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(extentX, 1)),
+                                                        _mm512_cvtepu32_epi64(_mm512_extracti64x4_epi64(extentY, 1)));
+        _mm512_storeu_si512(p_PixelCounts + i, pixelCountLow);
+        _mm512_storeu_si512(p_PixelCounts + i + 8, pixelCountHigh);
+
+        x0 = _mm512_min_epi32(_mm512_max_epi32(xa, zero), right);
+        x1 = _mm512_min_epi32(_mm512_max_epi32(xb, zero), right);
+        y0 = _mm512_min_epi32(_mm512_max_epi32(ya, zero), bottom);
+        y1 = _mm512_min_epi32(_mm512_max_epi32(yb, zero), bottom);
+
+        // Corner indices and masks, corners on the left/top border are zero unless the tables have a zero border
+        const __m512i rowY1 = _mm512_add_epi32(origin, _mm512_mullo_epi32(y1, pitch));
+        const __m512i rowY0 = _mm512_add_epi32(origin, _mm512_mullo_epi32(_mm512_sub_epi32(y0, one), pitch));
+        const __m512i colX1 = _mm512_mullo_epi32(x1, stride);
+        const __m512i colX0 = _mm512_mullo_epi32(_mm512_sub_epi32(x0, one), stride);
+        const __m512i indexD = _mm512_add_epi32(rowY1, colX1);
+        const __m512i indexC = _mm512_add_epi32(rowY1, colX0);
+        const __m512i indexB = _mm512_add_epi32(rowY0, colX1);
+        const __m512i indexA = _mm512_add_epi32(rowY0, colX0);
+        const __mmask16 maskC = valid & (zeroBorder | _mm512_cmpgt_epi32_mask(x0, zero));
+        const __mmask16 maskB = valid & (zeroBorder | _mm512_cmpgt_epi32_mask(y0, zero));
+        const __mmask16 maskA = maskC & maskB;
+
+        const uint32_t* tables[] = { p_Tables.sumAreaTable, p_Tables.nonZeroTable };
+        uint32_t* outputs[] = { p_Sums, p_NonZeroCounts };
+        for (int t = 0; t < 2; t++)
+        {
+            if (!tables[t]) continue;
+
+            const __m512i d = _mm512_mask_i32gather_epi32(zero, valid, indexD, tables[t], 4);
+            const __m512i c = _mm512_mask_i32gather_epi32(zero, maskC, indexC, tables[t], 4);
+            const __m512i b = _mm512_mask_i32gather_epi32(zero, maskB, indexB, tables[t], 4);
+            const __m512i a = _mm512_mask_i32gather_epi32(zero, maskA, indexA, tables[t], 4);
+
+            const __m512i sum = _mm512_add_epi32(_mm512_sub_epi32(_mm512_sub_epi32(d, c), b), a);
+            _mm512_storeu_si512(outputs[t] + i, sum);
+        }
+
+        if (p_Tables.squaredTable)
+        {
+            // Same corners in the planar squared table, the u64 entries are gathered eight at a time
+            const __m512i squaredY1 = _mm512_add_epi32(squaredOrigin, _mm512_mullo_epi32(y1, squaredPitch));
+            const __m512i squaredY0 = _mm512_add_epi32(squaredOrigin, _mm512_mullo_epi32(_mm512_sub_epi32(y0, one), squaredPitch));
+            const __m512i squaredX0 = _mm512_sub_epi32(x0, one);
+            const __m512i squaredIndices[] = { _mm512_add_epi32(squaredY1, x1), _mm512_add_epi32(squaredY1, squaredX0),
+                                               _mm512_add_epi32(squaredY0, x1), _mm512_add_epi32(squaredY0, squaredX0) };
+            const __mmask16 squaredMasks[] = { valid, maskC, maskB, maskA };
+
+            for (int h = 0; h < 2; h++)
+            {
+                __m512i corners[4];
+                for (int k = 0; k < 4; k++)
+                {
+                    const __m256i index = h ? _mm512_extracti64x4_epi64(squaredIndices[k], 1) : _mm512_castsi512_si256(squaredIndices[k]);
+                    const __mmask8 mask = static_cast<__mmask8>(squaredMasks[k] >> (8 * h));
+                    corners[k] = _mm512_mask_i32gather_epi64(zero, mask, index, p_Tables.squaredTable, 8);
+                }
+
+                const __m512i sum = _mm512_add_epi64(_mm512_sub_epi64(_mm512_sub_epi64(corners[0], corners[1]), corners[2]), corners[3]);
+                _mm512_storeu_si512(p_SquaredSums + i + 8 * h, sum);
+            }
+        }
+    }
+
+    // Handle left-over
+    s_QueryRegionsScalar(p_Tables, p_Regions, p_Count, p_Sums, p_NonZeroCounts, p_SquaredSums, p_PixelCounts, i);
+}
+
+//----------------------------------------------------------------------------
+// Runtime dispatch
+//----------------------------------------------------------------------------
+static const PixelSumKernels s_KernelTable[] =
+{
+    // SSE2 has no gathers, batched queries use the scalar kernel
+    { s_PrefixScanRowScalarEntry<false>, s_PrefixScanRowScalarEntry<true>, s_PrefixAccumulateRowScalarEntry, s_AddRowScalarEntry, s_AddRowWideScalarEntry, s_AccumulateRowWideScalarEntry, s_AccumulateSquareRowScalarEntry, s_AccumulateChannelRowScalarEntry, s_AccumulateThresholdRowScalarEntry, s_WindowSumRowScalarEntry, s_EvaluateCascadeScalarEntry, s_RegionHistogramScalarEntry, s_QueryRegionsScalarEntry, PixelSumSimdLevel::Scalar, "Scalar" },
+    { s_PrefixScanRowSSE2<false>,        s_PrefixScanRowSSE2<true>,        s_PrefixAccumulateRowSSE2,        s_AddRowSSE2,        s_AddRowWideSSE2,        s_AccumulateRowWideSSE2,        s_AccumulateSquareRowSSE2,        s_AccumulateChannelRowSSE2,        s_AccumulateThresholdRowSSE2,        s_WindowSumRowSSE2,        s_EvaluateCascadeSSE2Entry,   s_RegionHistogramSSE2,        s_QueryRegionsScalarEntry, PixelSumSimdLevel::SSE2,   "SSE2"   },
+    { s_PrefixScanRowAVX2<false>,        s_PrefixScanRowAVX2<true>,        s_PrefixAccumulateRowAVX2,        s_AddRowAVX2,        s_AddRowWideAVX2,        s_AccumulateRowWideAVX2,        s_AccumulateSquareRowAVX2,        s_AccumulateChannelRowAVX2,        s_AccumulateThresholdRowAVX2,        s_WindowSumRowAVX2,        s_EvaluateCascadeAVX2Entry,   s_RegionHistogramAVX2,        s_QueryRegionsAVX2,        PixelSumSimdLevel::AVX2,   "AVX2"   },
+    { s_PrefixScanRowAVX512<false>,      s_PrefixScanRowAVX512<true>,      s_PrefixAccumulateRowAVX512,      s_AddRowAVX512,      s_AddRowWideAVX512,      s_AccumulateRowWideAVX512,      s_AccumulateSquareRowAVX512,      s_AccumulateChannelRowAVX512,      s_AccumulateThresholdRowAVX512,      s_WindowSumRowAVX512,      s_EvaluateCascadeAVX512Entry, s_RegionHistogramAVX512,      s_QueryRegionsAVX512,      PixelSumSimdLevel::AVX512, "AVX512" },
+};
+
+bool PixelSumKernels::IsSupported(PixelSumSimdLevel p_Level)
+{
+    switch (p_Level)
+    {
+    case PixelSumSimdLevel::Auto:
+    case PixelSumSimdLevel::Scalar: return true;
+    case PixelSumSimdLevel::SSE2:   return __builtin_cpu_supports("sse2");
+    case PixelSumSimdLevel::AVX2:   return __builtin_cpu_supports("avx2");
+    case PixelSumSimdLevel::AVX512: return __builtin_cpu_supports("avx512f");
+    }
+
+    return false;
+}
+
+const PixelSumKernels& PixelSumKernels::Get()
+{
+    static const PixelSumKernels& s_BestKernels = []() -> const PixelSumKernels&
+    {
+        if (IsSupported(PixelSumSimdLevel::AVX512)) return s_KernelTable[3];
+        if (IsSupported(PixelSumSimdLevel::AVX2))   return s_KernelTable[2];
+        if (IsSupported(PixelSumSimdLevel::SSE2))   return s_KernelTable[1];
+
+        return s_KernelTable[0];
+    }();
+
+    return s_BestKernels;
+}
+
+const PixelSumKernels& PixelSumKernels::Get(PixelSumSimdLevel p_Level)
+{
+    if (p_Level == PixelSumSimdLevel::Auto || !IsSupported(p_Level)) return Get();
+
+    return s_KernelTable[static_cast<int>(p_Level) - static_cast<int>(PixelSumSimdLevel::Scalar)];
+}
@@ -0,0 +1,183 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "CustomTypes.h"
+
+// Instruction set used by the summed area table kernels.
+enum class PixelSumSimdLevel
+{
+    Auto,   // Best instruction set supported by the host CPU
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512,
+};
+
+// Summed area tables and source extent consumed by the batched region query kernels.
+struct PixelSumQueryTables
+{
+    const uint32_t* sumAreaTable = nullptr; // nullptr skips the pixel sums
+    const uint32_t* nonZeroTable = nullptr; // nullptr skips the non-zero counts
+    PixBufTLBR_i    sourceTLBR;
+    int             tableStride  = 1;       // Elements between two table entries, 2 for the interleaved layout
+    size_t          tablePitch   = 0;       // Elements between two table rows
+    size_t          tableOrigin  = 0;       // Element offset of the entry of pixel (0, 0)
+    bool            hasZeroBorder = false;  // Row -1 and column -1 are readable zeros, corners are never masked
+
+    // Squared pixel table, nullptr when it is not built or skips the squared sums. Always planar, same padding as
+    // the tables above.
+    const uint64_t* squaredTable       = nullptr;
+    size_t          squaredTablePitch  = 0;
+    size_t          squaredTableOrigin = 0;
+};
+
+// Weak classifier of a Haar cascade compiled for one window scale and one table geometry. The corners of every
+// rectangle are element offsets relative to the table entry above and left of the window, i.e. of pixel (x - 1,
+// y - 1) for the window at (x, y).
+struct PixelSumCascadeFeature
+{
+    ptrdiff_t corners[4][4] = {};   // A, B, C, D of every rectangle
+    float     weights[4]    = {};
+    int       rectCount     = 0;
+    float     threshold     = 0.0f; // Scaled by the window normalization
+    float     leftValue     = 0.0f; // Added to the stage sum when the feature value is below the scaled threshold
+    float     rightValue    = 0.0f; // Added otherwise
+};
+
+// Stage of a compiled cascade, the features [featureBegin, featureBegin + featureCount) vote for the window
+struct PixelSumCascadeStage
+{
+    int   featureBegin = 0;
+    int   featureCount = 0;
+    float threshold    = 0.0f;      // The window is rejected when the stage sum is below it
+};
+
+// Cascade compiled for one window scale, consumed by the cascade evaluation kernels.
+struct PixelSumCompiledCascade
+{
+    const PixelSumCascadeFeature* features = nullptr;
+    const PixelSumCascadeStage*   stages   = nullptr;
+    int       stageCount   = 0;
+    ptrdiff_t windowStride = 1;     // Elements between the origins of two consecutive windows of a run
+};
+
+// Corners D, C, B, A of a region of a compact integral histogram (see PixelSumHistogram), the entry of bin b of
+// corner k is top[k][b] + left[k][b] + local[k][b]. Corners outside the image point to zeros.
+struct PixelSumHistogramCorners
+{
+    const uint32_t* top[4]   = {};
+    const uint32_t* left[4]  = {};
+    const uint8_t*  local[4] = {};
+};
+
+// Table of the SIMD kernels used for building the summed area tables (SAT). The kernels are compiled for all
+// the supported instruction sets and the best one for the host is chosen once at startup through CPUID.
+struct PixelSumKernels
+{
+    /*!
+     * Inclusive horizontal prefix sum of a row of pixels (u8 widened to u32), returns the row total.
+     */
+    uint32_t (*prefixSumRow)(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count);
+
+    /*!
+     * Inclusive horizontal prefix count of the non-zero pixels of a row, returns the row total.
+     */
+    uint32_t (*prefixNonZeroRow)(const uint8_t* p_Src, uint32_t* p_Dest, int p_Count);
+
+    /*!
+     * Fused build helper, adds the horizontal prefix of pixel sum and non-zero count (continuing from the
+     * row carries) into the running column accumulators. The row carries are updated with the row totals.
+     */
+    void (*prefixAccumulateRow)(const uint8_t* p_Src, uint32_t* p_ColumnSum, uint32_t* p_ColumnNonZero, int p_Count,
+                                uint32_t* p_RowSum, uint32_t* p_RowNonZero);
+
+    /*!
+     * Vertical pass helper, adds the source array into the destination array.
+     */
+    void (*addRow)(uint32_t* p_Dest, const uint32_t* p_Src, int p_Count);
+
+    /*!
+     * 64-bit accumulator version of addRow(..).
+     */
+    void (*addRowWide)(uint64_t* p_Dest, const uint64_t* p_Src, int p_Count);
+
+    /*!
+     * 64-bit accumulator row build, widens the u32 horizontal prefix of a row and adds the SAT row above it,
+     * p_Above can be nullptr for the first row.
+     */
+    void (*accumulateRowWide)(uint64_t* p_Dest, const uint64_t* p_Above, const uint32_t* p_RowPrefix, int p_Count);
+
+    /*!
+     * Squared pixel table row build, p_Dest = p_Above + p_RowCarry + inclusive prefix of the squared pixels. The
+     * squares are summed in u32 blocks and accumulated in u64. p_Above can be nullptr for the first row, or
+     * p_Dest for accumulating into running column sums. Returns the row carry for the next segment of the row.
+     */
+    uint64_t (*accumulateSquareRow)(const uint8_t* p_Src, uint64_t* p_Dest, const uint64_t* p_Above, int p_Count, uint64_t p_RowCarry);
+
+    /*!
+     * Multi-channel row build, p_Src holds p_PixelCount pixels of 3 or 4 interleaved channels. Every pixel is
+     * spread over 4 u32 lanes, one per channel (the 4th lane of RGB stays 0), and p_Dest = p_Above + horizontal
+     * prefix of the pixels. p_Above is the zero row for the first row.
+     */
+    void (*accumulateChannelRow)(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount, int p_ChannelCount);
+
+    /*!
+     * Threshold count row build, every pixel is compared to the p_LaneCount thresholds of p_Thresholds (4, 8, 12
+     * or 16 lanes) and p_Dest = p_Above + horizontal prefix of the (pixel > threshold) flags, one u32 lane per
+     * threshold. p_Above is the zero row for the first row.
+     */
+    void (*accumulateThresholdRow)(const uint8_t* p_Src, uint32_t* p_Dest, const uint32_t* p_Above, int p_PixelCount,
+                                   const uint32_t* p_Thresholds, int p_LaneCount);
+
+    /*!
+     * Box filter row helper, sums of p_Count horizontally adjacent windows of p_WindowWidth columns between two SAT
+     * rows: p_Sums[i] = p_Bottom[i + p_WindowWidth] - p_Bottom[i] - p_Top[i + p_WindowWidth] + p_Top[i]. The row
+     * pointers address the column left of the first window.
+     */
+    void (*windowSumRow)(const uint32_t* p_Bottom, const uint32_t* p_Top, int p_WindowWidth, int p_Count, uint32_t* p_Sums);
+
+    /*!
+     * Cascade evaluation of a run of p_Count windows, window i has the origin p_Origin + i x windowStride (see
+     * PixelSumCascadeFeature) and the normalization p_Normalization[i]. Writes the number of stages every window
+     * passed, the stage count for an accepted window. The SIMD kernels evaluate one window per lane and leave a
+     * stage loop as soon as all of their windows are rejected. The feature values are u32 rectangle sums converted
+     * to float and weighted in rectangle order, the results are identical for every kernel.
+     */
+    void (*evaluateCascade)(const PixelSumCompiledCascade& p_Cascade, const uint32_t* p_Origin, const float* p_Normalization, int p_Count,
+                            int* p_PassedStages);
+
+    /*!
+     * Region histogram of a compact integral histogram, p_Histogram[b] = D - C - B + A of the reconstructed entries
+     * of bin b. The bins are processed in SIMD chunks, the u8 local entries are widened to u32 on load.
+     */
+    void (*regionHistogram)(const PixelSumHistogramCorners& p_Corners, int p_BinCount, uint32_t* p_Histogram);
+
+    /*!
+     * Batched region query, clips every region exactly like s_ValidateSearchWindowClipCoords and evaluates
+     * D - C - B + A for the requested tables, the squared pixel table included when it is set. Writes the pixel
+     * count of each (unclamped) region, 0 when the region is invalid. Corners of the upcoming regions are prefetched to hide the random access latency.
+     * The SIMD kernels use 32-bit gather indices, tables of more than INT32_MAX elements need the scalar kernel.
+     */
+    void (*queryRegions)(const PixelSumQueryTables& p_Tables, const PixelBufferCoords_i* p_Regions, int p_Count,
+                         uint32_t* p_Sums, uint32_t* p_NonZeroCounts, uint64_t* p_SquaredSums, uint64_t* p_PixelCounts);
+
+    PixelSumSimdLevel level;
+    const char* name;
+
+    /*!
+     * Kernels for the best instruction set supported by the host CPU, selected once on the first call.
+     */
+    static const PixelSumKernels& Get();
+
+    /*!
+     * Kernels for the requested instruction set, falls back to Get() when the host does not support it.
+     */
+    static const PixelSumKernels& Get(PixelSumSimdLevel p_Level);
+
+    /*!
+     * Check if the host CPU can execute the kernels of the given instruction set.
+     */
+    static bool IsSupported(PixelSumSimdLevel p_Level);
+};
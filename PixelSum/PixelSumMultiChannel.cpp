@@ -0,0 +1,129 @@
+#include "PixelSumMultiChannel.h"
+
+#include <immintrin.h>
+
+#include "MemoryAllocator.h"
+#include "UtilityFunctions.h"
+
+// u32 lanes of a table entry, one per channel
+static constexpr size_t CHANNEL_LANES = 4;
+
+PixelSumMultiChannel::PixelSumMultiChannel(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, int p_ChannelCount,
+                                           PixelSumSimdLevel p_SimdLevel)
+    : m_Kernels(PixelSumKernels::Get(p_SimdLevel))
+    , m_SourcePixBufTLBR(0 /*Top Coord*/, 0/*Left Coord*/, p_YHeight - 1/*Bottom Coord*/, p_XWidth - 1/*Right Coord*/)
+    , m_ChannelCount(p_ChannelCount)
+{
+    if (p_XWidth <= 0 || p_YHeight <= 0 || (p_ChannelCount != 3 && p_ChannelCount != 4)) return;
+
+    s_ResolvePaddedTableGeometry(p_XWidth, p_YHeight, CHANNEL_LANES, sizeof(uint32_t), m_TablePitch, m_TableOrigin, m_TableElementCount);
+
+    // A single allocation from the preallocated memory pools for all the channels
+    m_SumAreaTable = static_cast<uint32_t*>(VM::MemoryAllocator::GetInstance().Allocate(m_TableElementCount * sizeof(uint32_t)));
+    if (!m_SumAreaTable) return;
+
+    s_ClearPaddedTableBorder(m_SumAreaTable, m_TablePitch, m_TableOrigin, p_YHeight);
+
+    Rebuild(p_Buffer);
+}
+
+PixelSumMultiChannel::~PixelSumMultiChannel()
+{
+    if (m_SumAreaTable)
+    {
+        VM::MemoryAllocator::GetInstance().Free(m_SumAreaTable);
+    }
+
+    m_SumAreaTable = nullptr;
+}
+
+bool PixelSumMultiChannel::Rebuild(const unsigned char* p_Buffer)
+{
+    if (!p_Buffer || !m_SumAreaTable) return false;
+
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+    const size_t srcRowBytes = static_cast<size_t>(srcPixBufWidth) * m_ChannelCount;
+
+    // Single pass, the horizontal prefix of every channel is added to the SAT row above (the zero row for row 0)
+    for (int row = 0; row < m_SourcePixBufTLBR.height(); row++)
+    {
+        m_Kernels.accumulateChannelRow(p_Buffer + static_cast<size_t>(row) * srcRowBytes, TableRow(row), TableRow(row - 1),
+                                       srcPixBufWidth, m_ChannelCount);
+    }
+
+    return true;
+}
+
+unsigned int PixelSumMultiChannel::GetPixelSum(int p_Channel, int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!m_SumAreaTable || p_Channel < 0 || p_Channel >= m_ChannelCount) return 0;
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    // A single channel is four scalar loads
+    const uint32_t* topRow = TableRow(p_Y0 - 1) + p_Channel;
+    const uint32_t* bottomRow = TableRow(p_Y1) + p_Channel;
+    const ptrdiff_t x0Left = (static_cast<ptrdiff_t>(p_X0) - 1) * CHANNEL_LANES;
+    const ptrdiff_t x1Col  = static_cast<ptrdiff_t>(p_X1) * CHANNEL_LANES;
+
+    return bottomRow[x1Col] - bottomRow[x0Left] - topRow[x1Col] + topRow[x0Left];
+}
+
+double PixelSumMultiChannel::GetPixelAverage(int p_Channel, int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    if (!m_SumAreaTable || p_Channel < 0 || p_Channel >= m_ChannelCount) return 0.0;
+
+    int x0 = p_X0, y0 = p_Y0, x1 = p_X1, y1 = p_Y1;
+    const uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(x0, y0, x1, y1, m_SourcePixBufTLBR);
+
+    if (searchWindowPixelCount == 0) return 0.0; // Prevent return Nan
+
+    return GetPixelSum(p_Channel, p_X0, p_Y0, p_X1, p_Y1) / static_cast<double>(searchWindowPixelCount);
+}
+
+PixelSumChannelStats PixelSumMultiChannel::GetRegionStats(int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    PixelSumChannelStats channelStats;
+    if (!m_SumAreaTable) return channelStats;
+
+    const uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+    if (searchWindowPixelCount == 0) return channelStats;
+
+    alignas(16) uint32_t pixelSums[CHANNEL_LANES];
+    ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, pixelSums);
+
+    // The 4th lane of an RGB table is always 0, all the lanes are copied without a channel loop
+    const double pixelCount = static_cast<double>(searchWindowPixelCount);
+    for (size_t lane = 0; lane < CHANNEL_LANES; lane++)
+    {
+        channelStats.pixelSums[lane]     = pixelSums[lane];
+        channelStats.pixelAverages[lane] = pixelSums[lane] / pixelCount;
+    }
+
+    return channelStats;
+}
+
+size_t PixelSumMultiChannel::GetTableByteSize(int p_Width, int p_Height)
+{
+    if (p_Width <= 0 || p_Height <= 0) return 0;
+
+    size_t pitch = 0, origin = 0, elementCount = 0;
+    s_ResolvePaddedTableGeometry(p_Width, p_Height, CHANNEL_LANES, sizeof(uint32_t), pitch, origin, elementCount);
+
+    return elementCount * sizeof(uint32_t);
+}
+
+void PixelSumMultiChannel::ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, uint32_t p_Sums[4]) const
+{
+    const uint32_t* topRow = TableRow(y0 - 1);
+    const uint32_t* bottomRow = TableRow(y1);
+    const ptrdiff_t x0Left = (static_cast<ptrdiff_t>(x0) - 1) * CHANNEL_LANES;
+    const ptrdiff_t x1Col  = static_cast<ptrdiff_t>(x1) * CHANNEL_LANES;
+
+    // Entries are 16 byte aligned, every corner is a single load of all the channels
+    const __m128i d = _mm_load_si128((const __m128i*) (bottomRow + x1Col));   // Region D => (x1,     y1)
+    const __m128i c = _mm_load_si128((const __m128i*) (bottomRow + x0Left));  // Region C => (x0 - 1, y1)
+    const __m128i b = _mm_load_si128((const __m128i*) (topRow + x1Col));      // Region B => (x1,     y0 - 1)
+    const __m128i a = _mm_load_si128((const __m128i*) (topRow + x0Left));     // Region A => (x0 - 1, y0 - 1)
+
+    _mm_store_si128((__m128i*) p_Sums, _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(d, c), b), a));
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "CustomTypes.h"
+#include "PixelSumKernels.h"
+
+// Sums and averages of all the channels of a region returned by a single query, channels past the channel count
+// are 0.
+struct PixelSumChannelStats
+{
+    unsigned int pixelSums[4]     = { 0, 0, 0, 0 };
+    double       pixelAverages[4] = { 0.0, 0.0, 0.0, 0.0 };
+};
+
+//----------------------------------------------------------------------------
+// Summed area tables of an interleaved 3 or 4 channel 8-bit image (RGB, RGBA), e.g. a colour camera frame. All the
+// channel tables are built with a single read of the pixel buffer into one allocation: the entry of a pixel holds
+// the SAT of every channel in four adjacent u32 (16 bytes, RGB leaves the 4th one at 0), the SIMD lanes of the
+// build map to the channels. A query of all the channels loads one 16 byte entry per corner.
+//
+// Same conventions as PixelSum: coordinates are inclusive and clamped to the image, the averages are taken over
+// the unclamped region and the wraparound u32 entries are exact whenever the region sum of a channel fits in
+// 32 bits. The table is padded with a zero row and a zero column, the queries are branch free.
+//----------------------------------------------------------------------------
+class PixelSumMultiChannel
+{
+public:
+    PixelSumMultiChannel(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, int p_ChannelCount,
+                         PixelSumSimdLevel p_SimdLevel = PixelSumSimdLevel::Auto);
+    ~PixelSumMultiChannel();
+
+    PixelSumMultiChannel(const PixelSumMultiChannel&) = delete;
+    PixelSumMultiChannel& operator= (const PixelSumMultiChannel&) = delete;
+
+    /*!
+     * Recompute the table from a new frame of the same dimensions and channel count, the allocation is reused.
+     * Returns false when the table is not allocated.
+     */
+    bool Rebuild(const unsigned char* p_Buffer);
+
+    int GetChannelCount() const { return m_ChannelCount; }
+
+    /*!
+     * Region sum and average of a single channel, 0 for a channel outside [0, channel count).
+     */
+    unsigned int GetPixelSum(int p_Channel, int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+    double GetPixelAverage(int p_Channel, int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Sums and averages of all the channels with a single clip and four 16 byte corner loads.
+     */
+    PixelSumChannelStats GetRegionStats(int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Size in bytes of the table allocation, meant for sizing the preallocated memory pools.
+     */
+    static size_t GetTableByteSize(int p_Width, int p_Height);
+
+private:
+    /*!
+     * Summed Area(ABCD) => D - C - B + A of all the channels of a clipped window, see
+     * PixelSum::ComputeSumAreaForSearchWindow(..).
+     */
+    void ComputeSumAreaForSearchWindow(int x0, int y0, int x1, int y1, uint32_t p_Sums[4]) const;
+
+    /*!
+     * Entry of pixel (0, p_Row), row -1 is the zero row
+     */
+    uint32_t* TableRow(int p_Row) const
+    {
+        return m_SumAreaTable + m_TableOrigin + static_cast<ptrdiff_t>(p_Row) * static_cast<ptrdiff_t>(m_TablePitch);
+    }
+
+private:
+    const PixelSumKernels& m_Kernels;
+
+    PixBufTLBR_i m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, -1, -1); /*!< Empty image until constructed from a buffer */
+    int m_ChannelCount = 0;
+
+    // Entry (x, y) of channel c is at element m_TableOrigin + y * m_TablePitch + 4 * x + c
+    size_t m_TablePitch        = 0; /*!< Elements between two table rows */
+    size_t m_TableOrigin       = 0; /*!< Element offset of the entry of pixel (0, 0) */
+    size_t m_TableElementCount = 0; /*!< Elements of the table allocation */
+
+    uint32_t* m_SumAreaTable = nullptr; /*!< Summed area tables of all the channels, one 16 byte entry per pixel */
+};
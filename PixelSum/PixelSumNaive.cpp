@@ -24,12 +24,12 @@ int PixelSumNaive::GetPixelSum(int p_X0, int p_Y0, int p_X1, int p_Y1) const
     int searchWidowHeight = std::min((p_Y1 - p_Y0) + 1, pixelBufferHeight);
 
     unsigned char* searchWindowCurrentPixel = nullptr;
-    unsigned char* searchWindowTopLeftPixel = m_Buffer + (p_Y0 * pixelBufferWidth + p_X0);
+    unsigned char* searchWindowTopLeftPixel = m_Buffer + (static_cast<size_t>(p_Y0) * pixelBufferWidth + p_X0);
 
     int pixelSum = 0;
     for (int row = 0; row < searchWidowHeight; row++)
     {
-        searchWindowCurrentPixel = searchWindowTopLeftPixel + (row * pixelBufferWidth);
+        searchWindowCurrentPixel = searchWindowTopLeftPixel + (static_cast<size_t>(row) * pixelBufferWidth);
         for (int col = 0; col < searchWidowWidth; col++)
         {
             pixelSum += *searchWindowCurrentPixel;
@@ -51,12 +51,12 @@ int PixelSumNaive::GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const
     int searchWidowHeight = std::min((p_Y1 - p_Y0) + 1, pixelBufferHeight);
 
     unsigned char* searchWindowCurrentPixel = nullptr;
-    unsigned char* searchWindowTopLeftPixel = m_Buffer + (p_Y0 * pixelBufferWidth + p_X0);
+    unsigned char* searchWindowTopLeftPixel = m_Buffer + (static_cast<size_t>(p_Y0) * pixelBufferWidth + p_X0);
 
     int nonZeroSum = 0;
     for (int row = 0; row < searchWidowHeight; row++)
     {
-        searchWindowCurrentPixel = searchWindowTopLeftPixel + (row * pixelBufferWidth);
+        searchWindowCurrentPixel = searchWindowTopLeftPixel + (static_cast<size_t>(row) * pixelBufferWidth);
         for (int col = 0; col < searchWidowWidth; col++)
         {
             nonZeroSum += (*searchWindowCurrentPixel == 0 ? 0 : 1);
@@ -69,7 +69,7 @@ int PixelSumNaive::GetNonZeroCount(int p_X0, int p_Y0, int p_X1, int p_Y1) const
 
 double PixelSumNaive::GetPixelAverage(int p_X0, int p_Y0, int p_X1, int p_Y1) const
 {
-    uint32_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
+    uint64_t searchWindowPixelCount = s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR);
 
     if (searchWindowPixelCount == 0) return 0.0; // Prevent return Nan
 
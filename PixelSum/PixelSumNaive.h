@@ -15,5 +15,5 @@ public:
 
 private:
     unsigned char* m_Buffer = nullptr;
-    PixBufTLBR_i m_SourcePixBufTLBR;
+    PixBufTLBR_i m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, -1, -1); /*!< Empty image until constructed from a buffer */
 };
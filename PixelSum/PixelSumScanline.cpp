@@ -0,0 +1,137 @@
+#include "PixelSumScanline.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "MemoryAllocator.h"
+
+// Ring rows are aligned to a cache line, the zero column is the last entry of a leading line
+static constexpr size_t RING_LINE_ELEMENTS = 64 / sizeof(uint32_t);
+
+PixelSumScanline::PixelSumScanline(int p_Width, int p_RowCapacity, PixelSumSimdLevel p_SimdLevel)
+    : m_Kernels(PixelSumKernels::Get(p_SimdLevel))
+    , m_Width(p_Width)
+    , m_RowCapacity(p_RowCapacity)
+{
+    if (p_Width <= 0 || p_RowCapacity <= 0) return;
+
+    m_RingRowCount = static_cast<size_t>(p_RowCapacity) + 1;
+    m_RingPitch = RING_LINE_ELEMENTS + (static_cast<size_t>(p_Width) + RING_LINE_ELEMENTS - 1) / RING_LINE_ELEMENTS * RING_LINE_ELEMENTS;
+    m_RingOrigin = RING_LINE_ELEMENTS;
+
+    // Both rings are allocated once from the preallocated memory pools
+    const size_t ringByteSize = m_RingRowCount * m_RingPitch * sizeof(uint32_t);
+    m_SumAreaRing = static_cast<uint32_t*>(VM::MemoryAllocator::GetInstance().Allocate(ringByteSize));
+    m_SumAreaNonZeroRing = static_cast<uint32_t*>(VM::MemoryAllocator::GetInstance().Allocate(ringByteSize));
+
+    // Zero row above the stream and zero column of every row, the pixel entries are overwritten by every row
+    if (m_SumAreaRing) memset(m_SumAreaRing, 0, ringByteSize);
+    if (m_SumAreaNonZeroRing) memset(m_SumAreaNonZeroRing, 0, ringByteSize);
+}
+
+PixelSumScanline::~PixelSumScanline()
+{
+    if (m_SumAreaRing)
+    {
+        VM::MemoryAllocator::GetInstance().Free(m_SumAreaRing);
+    }
+
+    if (m_SumAreaNonZeroRing)
+    {
+        VM::MemoryAllocator::GetInstance().Free(m_SumAreaNonZeroRing);
+    }
+
+    m_SumAreaRing = nullptr;
+    m_SumAreaNonZeroRing = nullptr;
+}
+
+bool PixelSumScanline::PushRow(const unsigned char* p_Row)
+{
+    if (!p_Row || !m_SumAreaRing || !m_SumAreaNonZeroRing) return false;
+
+    // The new row takes the slot of the row which was just above the oldest queryable row
+    uint32_t* rings[] = { m_SumAreaRing, m_SumAreaNonZeroRing };
+    uint32_t (*prefixScanRows[])(const uint8_t*, uint32_t*, int) = { m_Kernels.prefixSumRow, m_Kernels.prefixNonZeroRow };
+    for (int ring = 0; ring < 2; ring++)
+    {
+        uint32_t* sumAreaRow = const_cast<uint32_t*>(RingRow(rings[ring], m_RowCount));
+        prefixScanRows[ring](p_Row, sumAreaRow, m_Width);
+        m_Kernels.addRow(sumAreaRow, RingRow(rings[ring], m_RowCount - 1), m_Width);
+    }
+
+    m_RowCount++;
+
+    return true;
+}
+
+int64_t PixelSumScanline::FirstRow() const
+{
+    return std::max<int64_t>(0, m_RowCount - m_RowCapacity);
+}
+
+unsigned int PixelSumScanline::GetPixelSum(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const
+{
+    if (!ClipSearchWindow(p_X0, p_Y0, p_X1, p_Y1)) return 0;
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaRing);
+}
+
+double PixelSumScanline::GetPixelAverage(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const
+{
+    const uint64_t searchWindowPixelCount = ClipSearchWindow(p_X0, p_Y0, p_X1, p_Y1);
+
+    if (searchWindowPixelCount == 0) return 0.0; // Prevent return Nan
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaRing) / static_cast<double>(searchWindowPixelCount);
+}
+
+int PixelSumScanline::GetNonZeroCount(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const
+{
+    if (!ClipSearchWindow(p_X0, p_Y0, p_X1, p_Y1)) return 0;
+
+    return static_cast<int>(ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaNonZeroRing));
+}
+
+double PixelSumScanline::GetNonZeroAverage(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const
+{
+    const uint64_t searchWindowPixelCount = ClipSearchWindow(p_X0, p_Y0, p_X1, p_Y1);
+
+    if (searchWindowPixelCount == 0) return 0.0;
+
+    return ComputeSumAreaForSearchWindow(p_X0, p_Y0, p_X1, p_Y1, m_SumAreaNonZeroRing) / static_cast<double>(searchWindowPixelCount);
+}
+
+uint64_t PixelSumScanline::ClipSearchWindow(int& x0, int64_t& y0, int& x1, int64_t& y1) const
+{
+    if (!m_SumAreaRing || !m_SumAreaNonZeroRing || m_RowCount == 0) return 0;
+
+    // Same rules as s_ValidateSearchWindowClipCoords, the window is checked before the coordinates are ordered
+    const int64_t firstRow = FirstRow();
+    const int64_t lastRow = LastRow();
+    if (x1 < 0 || x0 >= m_Width || y1 < firstRow || y0 > lastRow) return 0;
+
+    if (x1 < x0) { std::swap(x0, x1); }
+    if (y1 < y0) { std::swap(y0, y1); }
+
+    // Must compute the search window total pixel before clamping
+    const uint64_t searchWindowTotalPixels = static_cast<uint64_t>(static_cast<int64_t>(x1) - x0 + 1) * static_cast<uint64_t>(y1 - y0 + 1);
+
+    x0 = std::max(x0, 0);
+    x1 = std::min(x1, m_Width - 1);
+    y0 = std::max(y0, firstRow);
+    y1 = std::min(y1, lastRow);
+
+    return searchWindowTotalPixels;
+}
+
+uint32_t PixelSumScanline::ComputeSumAreaForSearchWindow(int x0, int64_t y0, int x1, int64_t y1, const uint32_t* p_Ring) const
+{
+    const uint32_t* topRow = RingRow(p_Ring, y0 - 1);
+    const uint32_t* bottomRow = RingRow(p_Ring, y1);
+
+    // Summed Area => D - C - B + A, modular arithmetic cancels the running sums of the rows above the window
+    return bottomRow[x1]        // Region D => (x1,     y1)
+         - bottomRow[x0 - 1]    // Region C => (x0 - 1, y1)
+         - topRow[x1]           // Region B => (x1,     y0 - 1)
+         + topRow[x0 - 1];      // Region A => (x0 - 1, y0 - 1)
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+
+#include "PixelSumKernels.h"
+
+//----------------------------------------------------------------------------
+// Summed area tables of an endless stream of rows, e.g. a line-scan camera. The rows are pushed one at a time and
+// the last p_RowCapacity rows stay queryable, rows are addressed by their index in the stream (0, 1, 2, ...).
+//
+// The tables are a ring of row capacity + 1 SAT rows, the extra row holds S(x, y0 - 1) of the oldest queryable
+// row. Entries are the running sums since the start of the stream modulo 2^32: the wraparound arithmetic rebases
+// the accumulators implicitly, D - C - B + A of a window in the ring is exact whenever the window sum fits in
+// 32 bits, however long the stream runs. Memory is allocated once.
+//
+// Rows which already left the ring are treated like rows outside the image, the window is clamped to the rows
+// in the ring. Like PixelSum, the averages are taken over the unclamped window.
+//----------------------------------------------------------------------------
+class PixelSumScanline
+{
+public:
+    PixelSumScanline(int p_Width, int p_RowCapacity, PixelSumSimdLevel p_SimdLevel = PixelSumSimdLevel::Auto);
+    ~PixelSumScanline();
+
+    PixelSumScanline(const PixelSumScanline&) = delete;
+    PixelSumScanline& operator= (const PixelSumScanline&) = delete;
+
+    /*!
+     * Append the next row of width pixels, the oldest row leaves the ring once it is full.
+     * Returns false when the ring could not be allocated.
+     */
+    bool PushRow(const unsigned char* p_Row);
+
+    /*!
+     * Index of the oldest queryable row and of the last pushed row, LastRow() is -1 before the first row.
+     */
+    int64_t FirstRow() const;
+    int64_t LastRow() const { return m_RowCount - 1; }
+
+    unsigned int GetPixelSum(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const;
+    double GetPixelAverage(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const;
+
+    int GetNonZeroCount(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const;
+    double GetNonZeroAverage(int p_X0, int64_t p_Y0, int p_X1, int64_t p_Y1) const;
+
+private:
+    /*!
+     * Clip the window to the image width and the rows in the ring, returns the unclamped pixel count or 0 when
+     * the window is outside.
+     */
+    uint64_t ClipSearchWindow(int& x0, int64_t& y0, int& x1, int64_t& y1) const;
+
+    /*!
+     * Summed Area(ABCD) => D - C - B + A of a clipped window, see PixelSum::ComputeSumAreaForSearchWindow(..).
+     * Row y0 - 1 and column x0 - 1 are always readable, no branches.
+     */
+    uint32_t ComputeSumAreaForSearchWindow(int x0, int64_t y0, int x1, int64_t y1, const uint32_t* p_Ring) const;
+
+    /*!
+     * Entry of pixel (0, p_Row) in a ring, p_Row can be -1 i.e. the zero row above the stream.
+     */
+    const uint32_t* RingRow(const uint32_t* p_Ring, int64_t p_Row) const
+    {
+        return p_Ring + static_cast<size_t>(static_cast<uint64_t>(p_Row + 1) % m_RingRowCount) * m_RingPitch + m_RingOrigin;
+    }
+
+private:
+    const PixelSumKernels& m_Kernels;
+
+    int m_Width = 0;
+    int m_RowCapacity = 0;
+    int64_t m_RowCount = 0; /*!< Rows pushed since the start of the stream */
+
+    size_t m_RingRowCount = 0; /*!< Row capacity + 1 */
+    size_t m_RingPitch = 0;    /*!< Elements between two ring rows, rows start on a cache line */
+    size_t m_RingOrigin = 0;   /*!< Element offset of pixel 0 in a row, the entry before it is the zero column */
+
+    uint32_t* m_SumAreaRing = nullptr;        /*!< Ring of summed area table rows for pixel buffer */
+    uint32_t* m_SumAreaNonZeroRing = nullptr; /*!< Ring of summed area table rows for non-zero pixels */
+};
@@ -0,0 +1,143 @@
+#include "PixelSumStream.h"
+
+#include <algorithm>
+
+PixelSumStream::Snapshot& PixelSumStream::Snapshot::operator=(Snapshot&& p_Snapshot)
+{
+    if (this != &p_Snapshot)
+    {
+        Release();
+        m_Slot = p_Snapshot.m_Slot;
+        p_Snapshot.m_Slot = nullptr;
+    }
+
+    return *this;
+}
+
+void PixelSumStream::Snapshot::Release()
+{
+    if (m_Slot)
+    {
+        m_Slot->readerCount.fetch_sub(1);
+    }
+
+    m_Slot = nullptr;
+}
+
+PixelSumStream::PixelSumStream(int p_XWidth, int p_YHeight, const PixelSumConfig& p_Config, int p_BufferCount)
+{
+    // One slot is published, at least one more is needed for building the next frame
+    const int bufferCount = std::max(2, p_BufferCount);
+
+    // The tables are allocated once without a pixel buffer and rebuilt in place for every frame
+    m_Slots.reserve(bufferCount);
+    for (int slot = 0; slot < bufferCount; slot++)
+    {
+        m_Slots.emplace_back(new Slot());
+        m_Slots.back()->pixelSum.reset(new PixelSum(nullptr, p_XWidth, p_YHeight, p_Config));
+    }
+
+    m_BuildThread = std::thread(&PixelSumStream::BuildLoop, this);
+}
+
+PixelSumStream::~PixelSumStream()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+        m_IsStopping = true;
+    }
+
+    m_Condition.notify_all();
+    m_BuildThread.join();
+}
+
+uint64_t PixelSumStream::SubmitFrame(const unsigned char* p_Frame)
+{
+    uint64_t frameId = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_Mutex);
+
+        // A frame still pending is replaced, its id is complete once this frame is published
+        m_PendingFrame = p_Frame;
+        m_PendingFrameId = frameId = ++m_SubmittedFrameId;
+    }
+
+    m_Condition.notify_all();
+
+    return frameId;
+}
+
+void PixelSumStream::WaitForFrame(uint64_t p_FrameId)
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    m_Condition.wait(lock, [&]() { return m_IsStopping || m_PublishedFrameId.load() >= p_FrameId; });
+}
+
+PixelSumStream::Snapshot PixelSumStream::Acquire() const
+{
+    while (true)
+    {
+        Slot* slot = m_PublishedSlot.load();
+        if (!slot) return Snapshot();
+
+        // Announce the reader, then make sure the slot was not retired in between. A retired slot may already be
+        // rebuilding, back off without touching its tables and retry with the newly published one.
+        slot->readerCount.fetch_add(1);
+        if (m_PublishedSlot.load() == slot) return Snapshot(slot);
+
+        slot->readerCount.fetch_sub(1);
+    }
+}
+
+uint64_t PixelSumStream::PublishedFrameId() const
+{
+    return m_PublishedFrameId.load();
+}
+
+void PixelSumStream::BuildLoop()
+{
+    std::unique_lock<std::mutex> lock(m_Mutex);
+    while (true)
+    {
+        m_Condition.wait(lock, [&]() { return m_IsStopping || m_PendingFrame; });
+        if (m_IsStopping) return;
+
+        const unsigned char* frame = m_PendingFrame;
+        const uint64_t frameId = m_PendingFrameId;
+        m_PendingFrame = nullptr;
+
+        lock.unlock();
+
+        Slot* slot = AcquireFreeSlot();
+        const bool isBuilt = slot && slot->pixelSum->Rebuild(frame);
+        if (isBuilt)
+        {
+            slot->frameId.store(frameId);
+
+            // The tables are complete before the pointer is visible to the readers, the previous slot retires
+            m_PublishedSlot.store(slot);
+        }
+
+        lock.lock();
+
+        // A failed build still completes the frame, the waiting threads keep the previous frame
+        m_PublishedFrameId.store(frameId);
+        m_Condition.notify_all();
+    }
+}
+
+PixelSumStream::Slot* PixelSumStream::AcquireFreeSlot()
+{
+    while (true)
+    {
+        const Slot* publishedSlot = m_PublishedSlot.load();
+        for (const std::unique_ptr<Slot>& slot : m_Slots)
+        {
+            // Readers only enter the published slot, a retired slot without readers stays free
+            if (slot.get() != publishedSlot && slot->readerCount.load() == 0) return slot.get();
+        }
+
+        // All the retired slots are still read, wait for the grace period to end
+        std::this_thread::yield();
+    }
+}
@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "PixelSum.h"
+
+//----------------------------------------------------------------------------
+// Streaming front end for continuous video feeds. The stream owns a small ring of PixelSum instances whose tables
+// are allocated once from the preallocated memory pools. Frames are built on a background thread into a slot
+// nobody reads, then published with an atomic pointer swap (RCU style):
+//
+//      Writer: rebuild free slot -> publish (atomic store) -> slot of the previous frame retires
+//      Reader: load published slot -> reader count + 1 -> re-check published -> query -> reader count - 1
+//
+// Readers never take a lock and never see a half built table. A retired slot is reused only once its reader
+// count dropped to zero, i.e. after the grace period of the readers which acquired it while it was published.
+//----------------------------------------------------------------------------
+class PixelSumStream
+{
+    struct Slot
+    {
+        std::unique_ptr<PixelSum> pixelSum;
+        std::atomic<uint64_t> frameId{ 0 };
+        std::atomic<int> readerCount{ 0 };
+    };
+
+public:
+    // Read access to a published frame, the frame tables are not recycled while the snapshot is alive.
+    class Snapshot
+    {
+    public:
+        Snapshot() = default;
+        ~Snapshot() { Release(); }
+
+        Snapshot(Snapshot&& p_Snapshot) : m_Slot(p_Snapshot.m_Slot) { p_Snapshot.m_Slot = nullptr; }
+        Snapshot& operator= (Snapshot&& p_Snapshot);
+
+        Snapshot(const Snapshot&) = delete;
+        Snapshot& operator= (const Snapshot&) = delete;
+
+        const PixelSum* operator->() const { return m_Slot->pixelSum.get(); }
+        const PixelSum& operator*() const { return *m_Slot->pixelSum; }
+        explicit operator bool() const { return m_Slot != nullptr; }
+
+        /*!
+         * Id returned by SubmitFrame(..) for the frame of this snapshot
+         */
+        uint64_t FrameId() const { return m_Slot ? m_Slot->frameId.load() : 0; }
+
+        void Release();
+
+    private:
+        friend class PixelSumStream;
+        explicit Snapshot(Slot* p_Slot) : m_Slot(p_Slot) {}
+
+        Slot* m_Slot = nullptr;
+    };
+
+    /*!
+     * Allocate the tables of p_BufferCount frames. Two buffers are enough when readers release their snapshots
+     * before the next frame is built, with a third one the writer never waits for a slow reader of frame N - 1.
+     */
+    PixelSumStream(int p_XWidth, int p_YHeight, const PixelSumConfig& p_Config = PixelSumConfig(), int p_BufferCount = 3);
+
+    /*!
+     * Stops the background build, all the snapshots must be released before.
+     */
+    ~PixelSumStream();
+
+    PixelSumStream(const PixelSumStream&) = delete;
+    PixelSumStream& operator= (const PixelSumStream&) = delete;
+
+    /*!
+     * Queue a frame for the background build and return its id (1, 2, ...). The frame must stay valid until a
+     * frame with the same or a later id is published. When the previous frame is still waiting to be built it is
+     * dropped in favour of this one, a live feed is only interested in the latest frame.
+     */
+    uint64_t SubmitFrame(const unsigned char* p_Frame);
+
+    /*!
+     * Block the calling thread until the frame p_FrameId, or a later one, is published.
+     */
+    void WaitForFrame(uint64_t p_FrameId);
+
+    /*!
+     * Latest published frame, lock-free. Empty until the first frame is published.
+     */
+    Snapshot Acquire() const;
+
+    /*!
+     * Id of the latest published frame, 0 before the first one.
+     */
+    uint64_t PublishedFrameId() const;
+
+private:
+    /*!
+     * Background build loop, builds the pending frame into a free slot and publishes it.
+     */
+    void BuildLoop();
+
+    /*!
+     * Slot which is neither published nor read, waits for the readers of the retired slots.
+     */
+    Slot* AcquireFreeSlot();
+
+private:
+    std::vector<std::unique_ptr<Slot>> m_Slots;
+    std::atomic<Slot*> m_PublishedSlot{ nullptr };
+    std::atomic<uint64_t> m_PublishedFrameId{ 0 };
+
+    // Writer side state, readers never touch it
+    std::mutex m_Mutex;
+    std::condition_variable m_Condition;
+    const unsigned char* m_PendingFrame = nullptr;
+    uint64_t m_PendingFrameId = 0;
+    uint64_t m_SubmittedFrameId = 0;
+    bool m_IsStopping = false;
+
+    std::thread m_BuildThread;
+};
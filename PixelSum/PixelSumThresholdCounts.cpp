@@ -0,0 +1,130 @@
+#include "PixelSumThresholdCounts.h"
+
+#include <immintrin.h>
+#include <algorithm>
+#include <cstring>
+
+#include "MemoryAllocator.h"
+#include "UtilityFunctions.h"
+
+// Thresholds padded to whole SSE2 lanes
+static int s_ResolveLaneCount(int p_ThresholdCount)
+{
+    return (p_ThresholdCount + 3) / 4 * 4;
+}
+
+PixelSumThresholdCounts::PixelSumThresholdCounts(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight,
+                                                 const std::vector<unsigned char>& p_Thresholds, PixelSumSimdLevel p_SimdLevel)
+    : m_Kernels(PixelSumKernels::Get(p_SimdLevel))
+    , m_SourcePixBufTLBR(0 /*Top Coord*/, 0/*Left Coord*/, p_YHeight - 1/*Bottom Coord*/, p_XWidth - 1/*Right Coord*/)
+{
+    std::vector<unsigned char> thresholds(p_Thresholds);
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+
+    if (p_XWidth <= 0 || p_YHeight <= 0 || thresholds.empty() || thresholds.size() > MAX_THRESHOLD_COUNT) return;
+
+    m_LaneCount = s_ResolveLaneCount(static_cast<int>(thresholds.size()));
+    for (int lane = 0; lane < MAX_THRESHOLD_COUNT; lane++)
+    {
+        // No pixel is above 255
+        m_LaneThresholds[lane] = (lane < static_cast<int>(thresholds.size())) ? thresholds[lane] : 255;
+    }
+
+    s_ResolvePaddedTableGeometry(p_XWidth, p_YHeight, m_LaneCount, sizeof(uint32_t), m_TablePitch, m_TableOrigin, m_TableElementCount);
+
+    // A single allocation from the preallocated memory pools for all the thresholds
+    m_CountTable = static_cast<uint32_t*>(VM::MemoryAllocator::GetInstance().Allocate(m_TableElementCount * sizeof(uint32_t)));
+    if (!m_CountTable) return;
+
+    m_Thresholds = thresholds;
+
+    s_ClearPaddedTableBorder(m_CountTable, m_TablePitch, m_TableOrigin, p_YHeight);
+
+    Rebuild(p_Buffer);
+}
+
+PixelSumThresholdCounts::~PixelSumThresholdCounts()
+{
+    if (m_CountTable)
+    {
+        VM::MemoryAllocator::GetInstance().Free(m_CountTable);
+    }
+
+    m_CountTable = nullptr;
+}
+
+bool PixelSumThresholdCounts::Rebuild(const unsigned char* p_Buffer)
+{
+    if (!p_Buffer || !m_CountTable) return false;
+
+    const int srcPixBufWidth = m_SourcePixBufTLBR.width();
+
+    // Single pass, the horizontal prefix of every threshold is added to the table row above (the zero row for row 0)
+    for (int row = 0; row < m_SourcePixBufTLBR.height(); row++)
+    {
+        m_Kernels.accumulateThresholdRow(p_Buffer + static_cast<size_t>(row) * srcPixBufWidth, TableRow(row), TableRow(row - 1),
+                                         srcPixBufWidth, m_LaneThresholds, m_LaneCount);
+    }
+
+    return true;
+}
+
+int PixelSumThresholdCounts::GetCountAbove(unsigned char p_Threshold, int p_X0, int p_Y0, int p_X1, int p_Y1) const
+{
+    const auto threshold = std::lower_bound(m_Thresholds.begin(), m_Thresholds.end(), p_Threshold);
+    if (threshold == m_Thresholds.end() || *threshold != p_Threshold) return -1;
+
+    if (!m_CountTable || !s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR)) return 0;
+
+    // A single threshold is four scalar loads
+    const ptrdiff_t lane = threshold - m_Thresholds.begin();
+    const uint32_t* topRow = TableRow(p_Y0 - 1) + lane;
+    const uint32_t* bottomRow = TableRow(p_Y1) + lane;
+    const ptrdiff_t x0Left = (static_cast<ptrdiff_t>(p_X0) - 1) * m_LaneCount;
+    const ptrdiff_t x1Col  = static_cast<ptrdiff_t>(p_X1) * m_LaneCount;
+
+    return static_cast<int>(bottomRow[x1Col] - bottomRow[x0Left] - topRow[x1Col] + topRow[x0Left]);
+}
+
+bool PixelSumThresholdCounts::GetCountsAbove(int p_X0, int p_Y0, int p_X1, int p_Y1, uint32_t* p_Counts) const
+{
+    if (!p_Counts || !m_CountTable) return false;
+
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, m_SourcePixBufTLBR))
+    {
+        memset(p_Counts, 0, m_Thresholds.size() * sizeof(uint32_t));
+        return false;
+    }
+
+    const uint32_t* topRow = TableRow(p_Y0 - 1);
+    const uint32_t* bottomRow = TableRow(p_Y1);
+    const ptrdiff_t x0Left = (static_cast<ptrdiff_t>(p_X0) - 1) * m_LaneCount;
+    const ptrdiff_t x1Col  = static_cast<ptrdiff_t>(p_X1) * m_LaneCount;
+
+    // Entries are 16 byte aligned, every corner is one load per 4 thresholds
+    alignas(16) uint32_t counts[MAX_THRESHOLD_COUNT];
+    for (int lane = 0; lane < m_LaneCount; lane += 4)
+    {
+        const __m128i d = _mm_load_si128((const __m128i*) (bottomRow + x1Col + lane));   // Region D => (x1,     y1)
+        const __m128i c = _mm_load_si128((const __m128i*) (bottomRow + x0Left + lane));  // Region C => (x0 - 1, y1)
+        const __m128i b = _mm_load_si128((const __m128i*) (topRow + x1Col + lane));      // Region B => (x1,     y0 - 1)
+        const __m128i a = _mm_load_si128((const __m128i*) (topRow + x0Left + lane));     // Region A => (x0 - 1, y0 - 1)
+
+        _mm_store_si128((__m128i*) (counts + lane), _mm_add_epi32(_mm_sub_epi32(_mm_sub_epi32(d, c), b), a));
+    }
+
+    memcpy(p_Counts, counts, m_Thresholds.size() * sizeof(uint32_t));
+
+    return true;
+}
+
+size_t PixelSumThresholdCounts::GetTableByteSize(int p_Width, int p_Height, int p_ThresholdCount)
+{
+    if (p_Width <= 0 || p_Height <= 0 || p_ThresholdCount <= 0 || p_ThresholdCount > MAX_THRESHOLD_COUNT) return 0;
+
+    size_t pitch = 0, origin = 0, elementCount = 0;
+    s_ResolvePaddedTableGeometry(p_Width, p_Height, s_ResolveLaneCount(p_ThresholdCount), sizeof(uint32_t), pitch, origin, elementCount);
+
+    return elementCount * sizeof(uint32_t);
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <stdint.h>
+#include <cstddef>
+#include <vector>
+
+#include "CustomTypes.h"
+#include "PixelSumKernels.h"
+
+//----------------------------------------------------------------------------
+// Count tables of the pixels above a set of intensity thresholds, a generalisation of the non-zero count table of
+// PixelSum (threshold 0) for e.g. defect detection at several contrast levels over the same windows. The thresholds
+// are configured at construction and the tables of all of them are built with a single read of the pixel buffer:
+// the entry of a pixel holds the count of every threshold in adjacent u32 lanes, the SIMD lanes of the build
+// compare a pixel with all the thresholds at once. The lanes are padded to a multiple of 4 with thresholds that
+// never pass.
+//
+// Same conventions as PixelSum: coordinates are inclusive and clamped to the image and the table is padded with a
+// zero row and a zero column, the queries are branch free. A count never exceeds the pixel count of the image, the
+// u32 entries are exact for any region.
+//----------------------------------------------------------------------------
+class PixelSumThresholdCounts
+{
+public:
+    static constexpr int MAX_THRESHOLD_COUNT = 16;
+
+    /*!
+     * The thresholds are sorted and duplicates are removed. The tables are not allocated for no threshold or more
+     * than MAX_THRESHOLD_COUNT distinct ones.
+     */
+    PixelSumThresholdCounts(const unsigned char* p_Buffer, int p_XWidth, int p_YHeight, const std::vector<unsigned char>& p_Thresholds,
+                            PixelSumSimdLevel p_SimdLevel = PixelSumSimdLevel::Auto);
+    ~PixelSumThresholdCounts();
+
+    PixelSumThresholdCounts(const PixelSumThresholdCounts&) = delete;
+    PixelSumThresholdCounts& operator= (const PixelSumThresholdCounts&) = delete;
+
+    /*!
+     * Recompute the tables from a new frame of the same dimensions, the allocation is reused. Returns false when
+     * the tables are not allocated.
+     */
+    bool Rebuild(const unsigned char* p_Buffer);
+
+    /*!
+     * Distinct thresholds in ascending order, the order of the counts of GetCountsAbove(..). Empty when the tables
+     * are not allocated.
+     */
+    const std::vector<unsigned char>& GetThresholds() const { return m_Thresholds; }
+
+    /*!
+     * Count of the pixels of the region whose value is greater than p_Threshold, -1 when p_Threshold is not one
+     * of the configured thresholds.
+     */
+    int GetCountAbove(unsigned char p_Threshold, int p_X0, int p_Y0, int p_X1, int p_Y1) const;
+
+    /*!
+     * Counts of all the thresholds with a single clip, p_Counts holds GetThresholds().size() entries. Returns false
+     * and zero counts when the region is outside the image.
+     */
+    bool GetCountsAbove(int p_X0, int p_Y0, int p_X1, int p_Y1, uint32_t* p_Counts) const;
+
+    /*!
+     * Size in bytes of the table allocation, meant for sizing the preallocated memory pools.
+     */
+    static size_t GetTableByteSize(int p_Width, int p_Height, int p_ThresholdCount);
+
+private:
+    /*!
+     * Entry of pixel (0, p_Row), row -1 is the zero row
+     */
+    uint32_t* TableRow(int p_Row) const
+    {
+        return m_CountTable + m_TableOrigin + static_cast<ptrdiff_t>(p_Row) * static_cast<ptrdiff_t>(m_TablePitch);
+    }
+
+private:
+    const PixelSumKernels& m_Kernels;
+
+    PixBufTLBR_i m_SourcePixBufTLBR = PixBufTLBR_i(0, 0, -1, -1); /*!< Empty image until constructed from a buffer */
+
+    std::vector<unsigned char> m_Thresholds;
+    int m_LaneCount = 0;                                 /*!< u32 lanes of an entry, thresholds padded to a multiple of 4 */
+    uint32_t m_LaneThresholds[MAX_THRESHOLD_COUNT] = {}; /*!< Threshold of every lane, 255 for the padding */
+
+    // Entry (x, y) of threshold t is at element m_TableOrigin + y * m_TablePitch + m_LaneCount * x + t
+    size_t m_TablePitch        = 0; /*!< Elements between two table rows */
+    size_t m_TableOrigin       = 0; /*!< Element offset of the entry of pixel (0, 0) */
+    size_t m_TableElementCount = 0; /*!< Elements of the table allocation */
+
+    uint32_t* m_CountTable = nullptr; /*!< Count tables of all the thresholds, one entry of m_LaneCount u32 per pixel */
+};
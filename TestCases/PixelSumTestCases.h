@@ -1,10 +1,31 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <numeric>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <sys/mman.h>
+
 #include "TestCaseHelper.h"
 
+#include "VirtualMemoryPool.h"
+
 #include "PixelBuffer.h"
 #include "PixelSumNaive.h"
 #include "PixelSum.h"
+#include "PixelSumCompact.h"
+#include "PixelSumStream.h"
+#include "PixelSumScanline.h"
+#include "PixelSumMultiChannel.h"
+#include "PixelSumCascade.h"
+#include "PixelSumHistogram.h"
+#include "PixelSumThresholdCounts.h"
+#include "PixelSumImageFile.h"
 #include "ScopedTimer.h"
 #include "UtilityFunctions.h"
 
@@ -16,14 +37,48 @@ const static int IMAGE_HEIGHT = CORRECT_IMAGE_DIMENSION(4096); // clamp the imag
 const static int IMAGE_BOTTOM = (IMAGE_HEIGHT - 1);
 const static int IMAGE_RIGHT  = (IMAGE_WIDTH  - 1);
 
+// Image beyond the former 4096x4096 limit, the sum of a full image of 255s needs more than 32 bits.
+const static int LARGE_IMAGE_WIDTH  = 8192;
+const static int LARGE_IMAGE_HEIGHT = 8192;
+
+// Bins of the integral histogram of a full size image
+const static int HISTOGRAM_BIN_COUNT = 16;
+
+// Intensity thresholds of the count tables of a full size image
+const static std::vector<unsigned char> COUNT_THRESHOLDS = { 32, 128, 200 };
+
 // Preallocate the memory for our pixel buffer and summed area matrix.
-void PreallocateMemoryVirtualMemory(uint32_t p_MaxImageCount, uint32_t p_MaxSummedAreaPixelBuffer, uint32_t p_MaxSummedAreaNonZero)
+void PreallocateMemoryVirtualMemory(uint32_t p_MaxImageCount, uint32_t p_MaxSummedAreaPixelBuffer, uint32_t p_MaxSummedAreaNonZero,
+                                    uint32_t p_MaxSummedAreaInterleaved, uint32_t p_MaxCompactTileTables, uint32_t p_MaxCompactLocalTables,
+                                    uint32_t p_MaxLargeSummedArea, uint32_t p_MaxSummedAreaPacked, uint32_t p_MaxHistogramTables,
+                                    uint32_t p_MaxThresholdCountTables, uint32_t p_MaxSummedAreaPadded)
 {
+    PixelSumConfig paddedConfig;
+    paddedConfig.tablePadding = PixelSumTablePadding::Padded;
+
+    PixelSumConfig interleavedConfig;
+    interleavedConfig.tableLayout = PixelSumTableLayout::Interleaved;
+
+    PixelSumConfig wideConfig;
+    wideConfig.accumulator = PixelSumAccumulator::Wide64;
+
+    // Padded tables are a little larger than width x height entries, the pools are sized by PixelSum
     std::vector<VM::UserMemoryRequirementConfig> userMemoryRequirement =
     {
         { IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(uint8_t) , p_MaxImageCount            },
-        { IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(uint32_t), p_MaxSummedAreaPixelBuffer },
-        { IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(uint32_t), p_MaxSummedAreaNonZero     },
+        { PixelSum::GetTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT), p_MaxSummedAreaPixelBuffer },
+        { PixelSum::GetTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT), p_MaxSummedAreaNonZero     },
+        { PixelSum::GetTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT, interleavedConfig), p_MaxSummedAreaInterleaved },
+        { IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(uint32_t), p_MaxSummedAreaPacked },           // Packed tables and large images
+        { PixelSum::GetTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT, paddedConfig), p_MaxSummedAreaPadded },
+        { IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(uint32_t) / 8, p_MaxCompactTileTables },      // Top and left tables
+        { IMAGE_WIDTH * IMAGE_HEIGHT * sizeof(uint16_t), p_MaxCompactLocalTables },         // 16 bit local table
+        { PixelSum::GetTableByteSize(LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT), p_MaxLargeSummedArea },             // Wraparound tables
+        { PixelSum::GetTableByteSize(LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT, wideConfig), p_MaxLargeSummedArea }, // Wide tables
+        { PixelSumHistogram::GetLocalTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT, HISTOGRAM_BIN_COUNT), p_MaxHistogramTables }, // Integral histogram
+        { PixelSumHistogram::GetTopTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT, HISTOGRAM_BIN_COUNT), p_MaxHistogramTables },
+        { PixelSumHistogram::GetLeftTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT, HISTOGRAM_BIN_COUNT), p_MaxHistogramTables },
+        { PixelSumThresholdCounts::GetTableByteSize(IMAGE_WIDTH, IMAGE_HEIGHT, static_cast<int>(COUNT_THRESHOLDS.size())), p_MaxThresholdCountTables },
     };
     VM::MemoryAllocator::GetInstance().ConfigureMemory(userMemoryRequirement);
 }
@@ -364,30 +419,192 @@ void NanReturnValueTest()
     delete pixelSumNaiveImp;
 }
 
-// Test case to check no Nan value is returned by GetPixelAverage() or GetNonZeroAverage() function
-void SATPlusAllocationPerformanceTest()
+// Fused tiled build must produce exactly the same tables as the two pass build, odd dimensions are used
+// so that the last column tile and the non-temporal store tail are exercised.
+void FusedVsTwoPassBuildTest()
 {
+    const int width  = IMAGE_WIDTH - 3;
+    const int height = IMAGE_HEIGHT - 5;
+
     Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 0);
 
-    // Fill full pixel buffer with value 1
-    const size_t dataSize = IMAGE_WIDTH * IMAGE_HEIGHT;
-    PixelSum* pixelSum = nullptr;
-    s_FillDataWithContinousNumberStartingWith(dataSize, image->GetPixelBufferPtr(), 2);
+    PixelSumConfig twoPassConfig;
+    twoPassConfig.buildMode = PixelSumBuildMode::TwoPass;
 
-    for (int i = 0; i < 8; i++)
+    PixelSumConfig fusedConfig;
+    fusedConfig.buildMode = PixelSumBuildMode::FusedTiled;
+
+    PixelSum* pixelSumTwoPass = new PixelSum(image->GetPixelBufferPtr(), width, height, twoPassConfig);
+    PixelSum* pixelSumFused = new PixelSum(image->GetPixelBufferPtr(), width, height, fusedConfig);
+
+    EXPECT_EQ(pixelSumFused->GetPixelSum(0, 0, width - 1, height - 1),
+              pixelSumTwoPass->GetPixelSum(0, 0, width - 1, height - 1), "Fused build full image pixel sum");
+
+    EXPECT_EQ(pixelSumFused->GetNonZeroCount(0, 0, width - 1, height - 1),
+              pixelSumTwoPass->GetNonZeroCount(0, 0, width - 1, height - 1), "Fused build full image non-zero count");
+
+    for (int i = 0; i < 20; i++)
     {
-        const int width = (IMAGE_WIDTH >> i);
-        const int height = (IMAGE_HEIGHT >> i);
+        std::srand(i * 100);
+        int x0 = std::rand() % width;
+        int y0 = std::rand() % height;
+        int x1 = x0 + (std::rand() % (width >> 2));
+        int y1 = y0 + (std::rand() % (height >> 2));
 
-        if (width * height <= 0) break;
+        EXPECT_EQ(pixelSumFused->GetPixelSum(x0, y0, x1, y1),
+                  pixelSumTwoPass->GetPixelSum(x0, y0, x1, y1), "Fused build random search window pixel sum");
 
-        std::cout << "Performance test includes 2 allocations and 2 SAT creation for (a) Pixel buffer SAT (b) Non-zero element" << std::endl;
-        std::cout << "Image Size: Width = " << width << ", Height = " << height << std::endl;
+        EXPECT_EQ(pixelSumFused->GetNonZeroAverage(x0, y0, x1, y1),
+                  pixelSumTwoPass->GetNonZeroAverage(x0, y0, x1, y1), "Fused build random search window non-zero average");
+    }
+
+    delete image;
+    delete pixelSumTwoPass;
+    delete pixelSumFused;
+}
+
+// Every SIMD kernel supported by the host must produce exactly the same tables as the scalar kernels,
+// widths are chosen to hit the vector body and the scalar left-over of each kernel. Single column and
+// single row images are checked against the direct pixel sum so that they cannot pass by returning 0.
+void SimdKernelsVsScalarTest()
+{
+    const int widths[] = { 1, 7, 16, 33, 1000, IMAGE_WIDTH - 1 };
+    const int heights[] = { 67, 1 };
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 1);
+    const unsigned char* pixels = image->GetPixelBufferPtr();
+
+    const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::SSE2, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
+    const PixelSumBuildMode buildModes[] = { PixelSumBuildMode::TwoPass, PixelSumBuildMode::FusedTiled };
+
+    for (int height : heights)
+    {
+        for (int width : widths)
+        {
+            PixelSumConfig scalarConfig;
+            scalarConfig.simdLevel = PixelSumSimdLevel::Scalar;
+            scalarConfig.buildMode = PixelSumBuildMode::TwoPass;
+            PixelSum* pixelSumScalar = new PixelSum(pixels, width, height, scalarConfig);
+
+            unsigned int expectedSum = 0;
+            int expectedNonZeroCount = 0;
+            for (int i = 0; i < width * height; i++)
+            {
+                expectedSum += pixels[i];
+                expectedNonZeroCount += (pixels[i] != 0);
+            }
+
+            std::cout << "Scalar kernel, Width = " << width << ", Height = " << height << std::endl;
+            EXPECT_EQ(pixelSumScalar->GetPixelSum(0, 0, width - 1, height - 1), expectedSum, "Scalar kernel full image pixel sum");
+            EXPECT_EQ(pixelSumScalar->GetNonZeroCount(0, 0, width - 1, height - 1), expectedNonZeroCount, "Scalar kernel full image non-zero count");
+
+            for (PixelSumSimdLevel simdLevel : simdLevels)
+            {
+                if (!PixelSumKernels::IsSupported(simdLevel)) continue;
+
+                for (PixelSumBuildMode buildMode : buildModes)
+                {
+                    PixelSumConfig config;
+                    config.simdLevel = simdLevel;
+                    config.buildMode = buildMode;
+                    PixelSum* pixelSum = new PixelSum(pixels, width, height, config);
+
+                    bool isIdentical = (pixelSum->GetPixelSum(0, 0, width - 1, height - 1) == expectedSum);
+                    for (int y = 0; y < height; y++)
+                    {
+                        for (int x = 0; x < width; x += 3)
+                        {
+                            isIdentical &= (pixelSum->GetPixelSum(x, y, width - 1, height - 1) == pixelSumScalar->GetPixelSum(x, y, width - 1, height - 1));
+                            isIdentical &= (pixelSum->GetNonZeroCount(0, 0, x, y) == pixelSumScalar->GetNonZeroCount(0, 0, x, y));
+                        }
+                    }
+
+                    std::cout << "Kernel: " << PixelSumKernels::Get(simdLevel).name << ", Width = " << width << ", Height = " << height << std::endl;
+                    EXPECT_EQ(isIdentical, true, "SIMD kernel SAT matches scalar kernel SAT");
+
+                    delete pixelSum;
+                }
+            }
+
+            delete pixelSumScalar;
+        }
+    }
+
+    delete image;
+}
+
+// Parallel band build must be bit-identical to the single threaded build for both build modes,
+// thread counts which do not divide the image height are included.
+void ParallelBuildVsSerialTest()
+{
+    const int width  = IMAGE_WIDTH - 1;
+    const int height = IMAGE_HEIGHT - 3;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 0);
+
+    PixelSumConfig serialConfig;
+    serialConfig.threadCount = 1;
+    PixelSum* pixelSumSerial = new PixelSum(image->GetPixelBufferPtr(), width, height, serialConfig);
+
+    const unsigned int threadCounts[] = { 2, 3, 7, 16 };
+    const PixelSumBuildMode buildModes[] = { PixelSumBuildMode::TwoPass, PixelSumBuildMode::FusedTiled };
+
+    for (PixelSumBuildMode buildMode : buildModes)
+    {
+        for (unsigned int threadCount : threadCounts)
+        {
+            PixelSumConfig config;
+            config.buildMode = buildMode;
+            config.threadCount = threadCount;
+            PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+            // Sparse grid of table corners, every band boundary and carry is crossed
+            bool isIdentical = true;
+            for (int y = 0; y < height; y += 7)
+            {
+                for (int x = 0; x < width; x += 61)
+                {
+                    isIdentical &= (pixelSum->GetPixelSum(0, 0, x, y) == pixelSumSerial->GetPixelSum(0, 0, x, y));
+                    isIdentical &= (pixelSum->GetNonZeroCount(0, 0, x, y) == pixelSumSerial->GetNonZeroCount(0, 0, x, y));
+                }
+            }
+
+            std::cout << "Thread count: " << threadCount << std::endl;
+            EXPECT_EQ(isIdentical, true, "Parallel SAT build matches serial SAT build");
+
+            EXPECT_EQ(pixelSum->GetPixelSum(0, 0, width - 1, height - 1),
+                      pixelSumSerial->GetPixelSum(0, 0, width - 1, height - 1), "Parallel SAT build full image pixel sum");
+
+            delete pixelSum;
+        }
+    }
+
+    delete pixelSumSerial;
+    delete image;
+}
+
+// Compare the build time of the SAT construction for increasing thread counts.
+void SATThreadScalingPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
 
+    const unsigned int maxThreadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threadCount = 1; threadCount <= maxThreadCount; threadCount <<= 1)
+    {
+        PixelSumConfig config;
+        config.threadCount = threadCount;
+
+        std::cout << "SAT thread count: " << threadCount << ", Image Size: Width = " << IMAGE_WIDTH << ", Height = " << IMAGE_HEIGHT << std::endl;
+
+        PixelSum* pixelSum = nullptr;
         {
             DefaultResults results;
             ScopedTimer Timer(results);
-            pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height);
+            pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
         }
 
         delete pixelSum;
@@ -396,31 +613,3771 @@ void SATPlusAllocationPerformanceTest()
     delete image;
 }
 
-void TestCaseEntry()
+// Compare the build time of the SAT construction for every SIMD kernel supported by the host.
+void SATSimdLevelPerformanceTest()
 {
-    constexpr int MAX_IMAGE_COUNT              = 10;
-    constexpr int MAX_SUMMED_AREA_PIXEL_BUFFER = MAX_IMAGE_COUNT * 2;
-    constexpr int MAX_SUMMED_AREA_NON_ZERO     = MAX_SUMMED_AREA_PIXEL_BUFFER;
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
 
-    PreallocateMemoryVirtualMemory(MAX_IMAGE_COUNT, MAX_SUMMED_AREA_PIXEL_BUFFER, MAX_SUMMED_AREA_NON_ZERO);
+    const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::Scalar, PixelSumSimdLevel::SSE2, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
 
-    TEST_CASE(ConfigureMemoryTest);
+    for (PixelSumSimdLevel simdLevel : simdLevels)
+    {
+        if (!PixelSumKernels::IsSupported(simdLevel)) continue;
 
-    TEST_CASE(MemoryLeakTest);
-    TEST_CASE(MemoryLeakTestCopyCtor);
-    TEST_CASE(MemoryLeakTestPixelSumAssignOperator);
+        PixelSumConfig config;
+        config.simdLevel = simdLevel;
 
-    TEST_CASE(GetPixelSumInvalidRangeTest);
-    TEST_CASE(GetPixelSumVsNaiveSumAreaResult);
+        std::cout << "SAT kernel: " << PixelSumKernels::Get(simdLevel).name << ", Image Size: Width = " << IMAGE_WIDTH << ", Height = " << IMAGE_HEIGHT << std::endl;
 
-    TEST_CASE(GetPixelAverage);
-    TEST_CASE(GetPixelAverageVsNaiveSumAreaResult);
+        PixelSum* pixelSum = nullptr;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+        }
 
-    TEST_CASE(CopyConstructor);
-    TEST_CASE(AssignmentOperator);
+        delete pixelSum;
+    }
 
-    TEST_CASE(NonZeroCountElementsCounts);
-    TEST_CASE(NanReturnValueTest);
+    delete image;
+}
+
+// Compare the build time of the two pass and the fused tiled SAT construction.
+void SATBuildModePerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    const PixelSumBuildMode buildModes[] = { PixelSumBuildMode::TwoPass, PixelSumBuildMode::FusedTiled };
+    const char* buildModeNames[] = { "TwoPass", "FusedTiled" };
+
+    for (int mode = 0; mode < 2; mode++)
+    {
+        PixelSumConfig config;
+        config.buildMode = buildModes[mode];
+
+        std::cout << "SAT build mode: " << buildModeNames[mode] << ", Image Size: Width = " << IMAGE_WIDTH << ", Height = " << IMAGE_HEIGHT << std::endl;
+
+        PixelSum* pixelSum = nullptr;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+        }
+
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+// Search windows starting on the first row or the first column only have some of the A, B, C corners.
+void SearchWindowOnImageBorderTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 1);
+    PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+    PixelSumNaive* pixelSumNaiveImp = new PixelSumNaive(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    EXPECT_EQ(pixelSum->GetPixelSum(3, 0, 5, 4), static_cast<unsigned int>(pixelSumNaiveImp->GetPixelSum(3, 0, 5, 4)), "Search window on the first row");
+    EXPECT_EQ(pixelSum->GetPixelSum(0, 3, 5, 4), static_cast<unsigned int>(pixelSumNaiveImp->GetPixelSum(0, 3, 5, 4)), "Search window on the first column");
+    EXPECT_EQ(pixelSum->GetPixelSum(0, 0, 5, 4), static_cast<unsigned int>(pixelSumNaiveImp->GetPixelSum(0, 0, 5, 4)), "Search window on the first row and column");
+    EXPECT_EQ(pixelSum->GetNonZeroCount(IMAGE_RIGHT, 0, IMAGE_RIGHT, IMAGE_BOTTOM),
+              pixelSumNaiveImp->GetNonZeroCount(IMAGE_RIGHT, 0, IMAGE_RIGHT, IMAGE_BOTTOM), "Non-zero count of the last column");
+
+    delete image;
+    delete pixelSum;
+    delete pixelSumNaiveImp;
+}
+
+// Fill random regions, a part of them reversed, partially or completely outside the image
+static void s_FillRandomRegions(std::vector<PixelBufferCoords_i>& p_Regions, int p_MaxExtent)
+{
+    std::srand(1234);
+    for (PixelBufferCoords_i& region : p_Regions)
+    {
+        region.x0 = (std::rand() % (IMAGE_WIDTH + 64)) - 32;
+        region.y0 = (std::rand() % (IMAGE_HEIGHT + 64)) - 32;
+        region.x1 = region.x0 + (std::rand() % (2 * p_MaxExtent)) - (p_MaxExtent >> 2);
+        region.y1 = region.y0 + (std::rand() % (2 * p_MaxExtent)) - (p_MaxExtent >> 2);
+    }
+}
+
+// Squared pixel sum and variance of a region with a naive scan, over the unclamped region like PixelSum
+static void s_NaiveSquaredSumAndVariance(const unsigned char* p_Pixels, int p_Width, int p_Height, PixelBufferCoords_i p_Region,
+                                         uint64_t& p_SquaredSum, double& p_Variance)
+{
+    p_SquaredSum = 0;
+    p_Variance = 0.0;
+
+    PixelBufferCoords_i& r = p_Region;
+    if (r.x1 < 0 || r.x0 >= p_Width || r.y1 < 0 || r.y0 >= p_Height) return;
+    if (r.x1 < r.x0) std::swap(r.x0, r.x1);
+    if (r.y1 < r.y0) std::swap(r.y0, r.y1);
+
+    const uint64_t pixelCount = static_cast<uint64_t>(r.x1 - r.x0 + 1) * static_cast<uint64_t>(r.y1 - r.y0 + 1);
+    uint64_t pixelSum = 0;
+    for (int y = std::max(r.y0, 0); y <= std::min(r.y1, p_Height - 1); y++)
+    {
+        for (int x = std::max(r.x0, 0); x <= std::min(r.x1, p_Width - 1); x++)
+        {
+            const uint64_t pixel = p_Pixels[static_cast<size_t>(y) * p_Width + x];
+            pixelSum += pixel;
+            p_SquaredSum += pixel * pixel;
+        }
+    }
+
+    const unsigned __int128 numerator = static_cast<unsigned __int128>(pixelCount) * p_SquaredSum - static_cast<unsigned __int128>(pixelSum) * pixelSum;
+    p_Variance = static_cast<double>(numerator) / static_cast<double>(pixelCount) / static_cast<double>(pixelCount);
+}
+
+// Rectangle rotated by 45 degrees, see PixelSum::GetRotatedPixelSum(..)
+struct TiltedRect
+{
+    int x, y, width, height;
+};
+
+// Pixel sum of a rotated rectangle with a naive scan of its 2 x width x height pixels
+static unsigned int s_NaiveRotatedSum(const unsigned char* p_Pixels, int p_Width, int p_Height, const TiltedRect& p_Rect)
+{
+    unsigned int pixelSum = 0;
+    for (int i = 0; i < 2 * p_Rect.width; i++)
+    {
+        // Steps down-right (i) and down-left (j) of the same parity land on pixels
+        for (int j = (i & 1); j < 2 * p_Rect.height; j += 2)
+        {
+            const int x = p_Rect.x + (i - j) / 2;
+            const int y = p_Rect.y + (i + j) / 2;
+            if (x >= 0 && x < p_Width && y >= 0 && y < p_Height)
+            {
+                pixelSum += p_Pixels[static_cast<size_t>(y) * p_Width + x];
+            }
+        }
+    }
+
+    return pixelSum;
+}
+
+// Stage sum of the window at (p_X, p_Y) of the given scale, evaluated with the individual PixelSum queries in the
+// float operation order of PixelSumCascade. The rectangles are rounded like the compiled cascade.
+static float s_QueryCascadeStageSum(const PixelSum& p_PixelSum, const PixelSumHaarCascade& p_Cascade, int p_Stage, int p_X, int p_Y, float p_Scale,
+                                    bool p_NormalizeVariance)
+{
+    auto scaleLength = [p_Scale](int p_Length) { return static_cast<int>(p_Length * p_Scale + 0.5f); };
+    const int windowWidth = scaleLength(p_Cascade.windowWidth);
+    const int windowHeight = scaleLength(p_Cascade.windowHeight);
+
+    const uint64_t pixelCount = static_cast<uint64_t>(windowWidth) * windowHeight;
+    float normalization = static_cast<float>(pixelCount);
+    if (p_NormalizeVariance)
+    {
+        const uint64_t pixelSum = p_PixelSum.GetPixelSum64(p_X, p_Y, p_X + windowWidth - 1, p_Y + windowHeight - 1);
+        const uint64_t squaredSum = p_PixelSum.GetSquaredPixelSum(p_X, p_Y, p_X + windowWidth - 1, p_Y + windowHeight - 1);
+        const unsigned __int128 spread = static_cast<unsigned __int128>(pixelCount) * squaredSum - static_cast<unsigned __int128>(pixelSum) * pixelSum;
+        normalization = (spread > 0) ? static_cast<float>(std::sqrt(static_cast<double>(spread))) : 1.0f;
+    }
+
+    float stageSum = 0.0f;
+    for (const PixelSumHaarFeature& feature : p_Cascade.stages[p_Stage].features)
+    {
+        float value = 0.0f;
+        for (int rect = 0; rect < feature.rectCount; rect++)
+        {
+            const PixelSumHaarRect& r = feature.rects[rect];
+            const int x0 = std::min(scaleLength(r.x), windowWidth);
+            const int y0 = std::min(scaleLength(r.y), windowHeight);
+            const int x1 = std::min(x0 + scaleLength(r.width), windowWidth);
+            const int y1 = std::min(y0 + scaleLength(r.height), windowHeight);
+
+            const unsigned int rectSum = (x1 > x0 && y1 > y0) ? p_PixelSum.GetPixelSum(p_X + x0, p_Y + y0, p_X + x1 - 1, p_Y + y1 - 1) : 0;
+            value += r.weight * static_cast<float>(rectSum);
+        }
+
+        stageSum += (value < feature.threshold * normalization) ? feature.leftValue : feature.rightValue;
+    }
+
+    return stageSum;
+}
+
+// Number of stages passed by a window, see s_QueryCascadeStageSum(..)
+static int s_QueryCascadeWindow(const PixelSum& p_PixelSum, const PixelSumHaarCascade& p_Cascade, int p_X, int p_Y, float p_Scale,
+                                bool p_NormalizeVariance)
+{
+    int stage = 0;
+    for (; stage < static_cast<int>(p_Cascade.stages.size()); stage++)
+    {
+        if (s_QueryCascadeStageSum(p_PixelSum, p_Cascade, stage, p_X, p_Y, p_Scale, p_NormalizeVariance) < p_Cascade.stages[stage].threshold) break;
+    }
+
+    return stage;
+}
+
+// Random cascade of balanced two and three rectangle features on a 20 x 20 window. The threshold of every stage is
+// the median stage sum of the scale 1 windows passing the previous stages, i.e. every stage rejects about half of
+// the windows like a trained cascade.
+static PixelSumHaarCascade s_RandomHaarCascade(const PixelSum& p_PixelSum, int p_Width, int p_Height, const std::vector<int>& p_StageSizes,
+                                               bool p_NormalizeVariance)
+{
+    PixelSumHaarCascade cascade;
+    cascade.windowWidth = 20;
+    cascade.windowHeight = 20;
+
+    auto randomFloat = [](float p_Min, float p_Max) { return p_Min + (p_Max - p_Min) * (std::rand() % 10001) / 10000.0f; };
+
+    // Windows the thresholds are trained on
+    std::vector<std::pair<int, int>> windows;
+    for (int y = 0; y + cascade.windowHeight <= p_Height; y += 3)
+    {
+        for (int x = 0; x + cascade.windowWidth <= p_Width; x += 3)
+        {
+            windows.emplace_back(x, y);
+        }
+    }
+
+    for (int stageSize : p_StageSizes)
+    {
+        PixelSumHaarStage stage;
+        for (int i = 0; i < stageSize; i++)
+        {
+            // Zero mean on a flat window, the last rectangle balances the others
+            PixelSumHaarFeature feature;
+            feature.rectCount = 2 + std::rand() % 2;
+            float weightedArea = 0.0f;
+            for (int rect = 0; rect < feature.rectCount; rect++)
+            {
+                PixelSumHaarRect& r = feature.rects[rect];
+                r.width  = 1 + std::rand() % 10;
+                r.height = 1 + std::rand() % 10;
+                r.x      = std::rand() % (cascade.windowWidth - r.width + 1);
+                r.y      = std::rand() % (cascade.windowHeight - r.height + 1);
+                r.weight = (rect + 1 < feature.rectCount) ? randomFloat(0.5f, 2.0f) : -weightedArea / (r.width * r.height);
+                weightedArea += r.weight * r.width * r.height;
+            }
+
+            feature.threshold  = randomFloat(-0.05f, 0.05f);
+            feature.leftValue  = randomFloat(-1.0f, 1.0f);
+            feature.rightValue = randomFloat(-1.0f, 1.0f);
+            stage.features.push_back(feature);
+        }
+        cascade.stages.push_back(stage);
+
+        const int stageIndex = static_cast<int>(cascade.stages.size()) - 1;
+        std::vector<float> stageSums;
+        for (const std::pair<int, int>& window : windows)
+        {
+            stageSums.push_back(s_QueryCascadeStageSum(p_PixelSum, cascade, stageIndex, window.first, window.second, 1.0f, p_NormalizeVariance));
+        }
+
+        if (stageSums.empty()) break;
+        std::nth_element(stageSums.begin(), stageSums.begin() + stageSums.size() / 2, stageSums.end());
+        cascade.stages.back().threshold = stageSums[stageSums.size() / 2];
+
+        // Train the next stage on the windows passing this one
+        std::vector<std::pair<int, int>> passedWindows;
+        for (const std::pair<int, int>& window : windows)
+        {
+            if (s_QueryCascadeStageSum(p_PixelSum, cascade, stageIndex, window.first, window.second, 1.0f, p_NormalizeVariance) >=
+                cascade.stages.back().threshold)
+            {
+                passedWindows.push_back(window);
+            }
+        }
+        windows.swap(passedWindows);
+    }
+
+    return cascade;
+}
+
+// Histogram of a region by scanning its pixels, the region is clipped like the PixelSumHistogram queries
+static std::vector<uint32_t> s_NaiveRegionHistogram(const unsigned char* p_Buffer, int p_Width, int p_Height, int p_BinCount,
+                                                    int p_X0, int p_Y0, int p_X1, int p_Y1)
+{
+    std::vector<uint32_t> histogram(p_BinCount, 0);
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, PixBufTLBR_i(0, 0, p_Height - 1, p_Width - 1))) return histogram;
+
+    for (int y = p_Y0; y <= p_Y1; y++)
+    {
+        for (int x = p_X0; x <= p_X1; x++)
+        {
+            histogram[p_Buffer[static_cast<size_t>(y) * p_Width + x] * p_BinCount / 256]++;
+        }
+    }
+
+    return histogram;
+}
+
+// Count of the pixels of a region above a threshold, the region is clipped like the PixelSumThresholdCounts queries
+static int s_NaiveCountAbove(const unsigned char* p_Buffer, int p_Width, int p_Height, unsigned char p_Threshold, int p_X0, int p_Y0,
+                             int p_X1, int p_Y1)
+{
+    if (!s_ValidateSearchWindowClipCoords(p_X0, p_Y0, p_X1, p_Y1, PixBufTLBR_i(0, 0, p_Height - 1, p_Width - 1))) return 0;
+
+    int count = 0;
+    for (int y = p_Y0; y <= p_Y1; y++)
+    {
+        for (int x = p_X0; x <= p_X1; x++)
+        {
+            count += (p_Buffer[static_cast<size_t>(y) * p_Width + x] > p_Threshold) ? 1 : 0;
+        }
+    }
+
+    return count;
+}
+
+// Overwrite one byte of a file in place, a corrupted table file
+static void s_CorruptFileByte(const char* p_FilePath, long p_Offset)
+{
+    FILE* file = fopen(p_FilePath, "r+b");
+    if (!file) return;
+
+    fseek(file, p_Offset, SEEK_SET);
+    const int byte = fgetc(file);
+    fseek(file, p_Offset, SEEK_SET);
+    fputc(byte ^ 0x5A, file);
+    fclose(file);
+}
+
+// Write a raw 8-bit file, or a PGM file when p_PgmHeader is given
+static void s_WriteImageFile(const char* p_FilePath, const unsigned char* p_Pixels, size_t p_PixelCount, const char* p_PgmHeader = nullptr)
+{
+    FILE* file = fopen(p_FilePath, "wb");
+    if (!file) return;
+
+    if (p_PgmHeader) fputs(p_PgmHeader, file);
+    fwrite(p_Pixels, 1, p_PixelCount, file);
+    fclose(file);
+}
+
+#if defined(__linux__)
+// Pages of an allocation which are in memory
+static size_t s_ResidentPageCount(const VM::PageAllocation& p_Allocation, size_t p_BasePageSize)
+{
+    std::vector<unsigned char> residency(p_Allocation.size / p_BasePageSize, 0);
+    if (mincore(p_Allocation.baseAddress, p_Allocation.size, residency.data()) != 0) return 0;
+
+    return static_cast<size_t>(std::count_if(residency.begin(), residency.end(), [](unsigned char p_Page) { return (p_Page & 1) != 0; }));
+}
+#endif
+
+// Pools of small blocks, cached per thread, and of a few large blocks which bypass the caches
+static std::vector<VM::VMPoolConfig> s_ConcurrentPoolConfig()
+{
+    return { { 64, VM_MEM_MB(2) }, { 512, VM_MEM_MB(4) }, { VM_MEM_KB(4), VM_MEM_MB(8) }, { VM_MEM_MB(1), VM_MEM_MB(32) } };
+}
+
+// p_OpCount allocations and frees of random sizes with a window of live blocks, whose tags are checked before the
+// free. Allocations of p_AllocationSizes are made with p_Allocate, frees with p_Free. Returns the corrupted blocks.
+template<typename Allocate, typename Free>
+static int s_AllocatorWorkload(unsigned int p_Seed, int p_OpCount, const std::vector<size_t>& p_AllocationSizes, const Allocate& p_Allocate,
+                               const Free& p_Free)
+{
+    struct LiveBlock
+    {
+        uint64_t* pointer;
+        size_t    size;
+        uint64_t  tag;
+    };
+
+    LiveBlock liveBlocks[16] = {};
+    int corruptedCount = 0;
+    for (int op = 0; op < p_OpCount; op++)
+    {
+        p_Seed = p_Seed * 1103515245u + 12345u;
+        LiveBlock& liveBlock = liveBlocks[(p_Seed >> 16) % 16];
+        if (liveBlock.pointer)
+        {
+            const size_t lastWord = liveBlock.size / sizeof(uint64_t) - 1;
+            if (liveBlock.pointer[0] != liveBlock.tag || liveBlock.pointer[lastWord] != ~liveBlock.tag) corruptedCount++;
+
+            p_Free(liveBlock.pointer);
+            liveBlock.pointer = nullptr;
+            continue;
+        }
+
+        liveBlock.size = p_AllocationSizes[(p_Seed >> 8) % p_AllocationSizes.size()];
+        liveBlock.pointer = static_cast<uint64_t*>(p_Allocate(liveBlock.size));
+        if (!liveBlock.pointer) continue;
+
+        liveBlock.tag = (static_cast<uint64_t>(p_Seed) << 32) | static_cast<uint32_t>(op);
+        liveBlock.pointer[0] = liveBlock.tag;
+        liveBlock.pointer[liveBlock.size / sizeof(uint64_t) - 1] = ~liveBlock.tag;
+    }
+
+    for (LiveBlock& liveBlock : liveBlocks)
+    {
+        if (liveBlock.pointer) p_Free(liveBlock.pointer);
+    }
+
+    return corruptedCount;
+}
+
+// Options of the configuration matrix, a table engine is checked with the base configuration and with each of the
+// selected options changed alone
+enum PixelSumConfigOption : unsigned int
+{
+    CONFIG_BUILD_MODE  = 1 << 0,    // Two pass build
+    CONFIG_PADDING     = 1 << 1,    // Padded tables
+    CONFIG_LAYOUT      = 1 << 2,    // Interleaved tables
+    CONFIG_ACCUMULATOR = 1 << 3,    // u64 tables
+    CONFIG_LAZY        = 1 << 4,    // Lazy build
+    CONFIG_SIMD        = 1 << 5,    // Scalar, SSE2 and AVX2 kernels
+    CONFIG_SHARING     = 1 << 6,    // Copy on write tables
+    CONFIG_ALL         = (1 << 7) - 1,
+};
+
+// Calls p_Check with the base configuration, then with every selected option of the configuration matrix
+template<typename Check>
+static void s_ForEachPixelSumConfig(const PixelSumConfig& p_BaseConfig, unsigned int p_Options, Check p_Check)
+{
+    struct ConfigVariation
+    {
+        unsigned int option;
+        const char*  name;
+        void (*apply)(PixelSumConfig& p_Config);
+    };
+
+    const ConfigVariation variations[] =
+    {
+        { 0,                  "Base",            [](PixelSumConfig&) {} },
+        { CONFIG_BUILD_MODE,  "TwoPass",         [](PixelSumConfig& c) { c.buildMode    = PixelSumBuildMode::TwoPass; } },
+        { CONFIG_PADDING,     "Padded",          [](PixelSumConfig& c) { c.tablePadding = PixelSumTablePadding::Padded; } },
+        { CONFIG_LAYOUT,      "Interleaved",     [](PixelSumConfig& c) { c.tableLayout  = PixelSumTableLayout::Interleaved; } },
+        { CONFIG_ACCUMULATOR, "Wide64",          [](PixelSumConfig& c) { c.accumulator  = PixelSumAccumulator::Wide64; } },
+        { CONFIG_LAZY,        "Lazy",            [](PixelSumConfig& c) { c.buildTiming  = PixelSumBuildTiming::Lazy; } },
+        { CONFIG_SIMD,        "Scalar kernel",   [](PixelSumConfig& c) { c.simdLevel    = PixelSumSimdLevel::Scalar; } },
+        { CONFIG_SIMD,        "SSE2 kernel",     [](PixelSumConfig& c) { c.simdLevel    = PixelSumSimdLevel::SSE2; } },
+        { CONFIG_SIMD,        "AVX2 kernel",     [](PixelSumConfig& c) { c.simdLevel    = PixelSumSimdLevel::AVX2; } },
+        { CONFIG_SHARING,     "CopyOnWrite",     [](PixelSumConfig& c) { c.tableSharing = PixelSumTableSharing::CopyOnWrite; } },
+    };
+
+    for (const ConfigVariation& variation : variations)
+    {
+        if (variation.option && !(variation.option & p_Options)) continue;
+
+        PixelSumConfig config = p_BaseConfig;
+        variation.apply(config);
+
+        std::cout << "Config: " << variation.name << ", Kernel: " << PixelSumKernels::Get(config.simdLevel).name << std::endl;
+        p_Check(config);
+    }
+}
+
+// Batched region queries must match the individual queries for every SIMD kernel supported by the host.
+void BatchQueryVsSingleQueryTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillHalfPixelBufferWithConstValue(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 7);
+
+    const size_t regionCount = 10007;
+    std::vector<PixelBufferCoords_i> regions(regionCount);
+    s_FillRandomRegions(regions, 256);
+
+    std::vector<unsigned int> pixelSums(regionCount);
+    std::vector<double> pixelAverages(regionCount);
+    std::vector<int> nonZeroCounts(regionCount);
+    std::vector<double> nonZeroAverages(regionCount);
+
+    PixelSumBatchOutput output;
+    output.pixelSums       = pixelSums.data();
+    output.pixelAverages   = pixelAverages.data();
+    output.nonZeroCounts   = nonZeroCounts.data();
+    output.nonZeroAverages = nonZeroAverages.data();
+
+    const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::Scalar, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
+    for (PixelSumSimdLevel simdLevel : simdLevels)
+    {
+        if (!PixelSumKernels::IsSupported(simdLevel)) continue;
+
+        PixelSumConfig config;
+        config.simdLevel = simdLevel;
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+        pixelSum->GetRegionsBatch(regions.data(), regionCount, output);
+
+        bool isIdentical = true;
+        for (size_t i = 0; i < regionCount; i++)
+        {
+            const PixelBufferCoords_i& region = regions[i];
+            isIdentical &= (pixelSums[i] == pixelSum->GetPixelSum(region.x0, region.y0, region.x1, region.y1));
+            isIdentical &= (pixelAverages[i] == pixelSum->GetPixelAverage(region.x0, region.y0, region.x1, region.y1));
+            isIdentical &= (nonZeroCounts[i] == pixelSum->GetNonZeroCount(region.x0, region.y0, region.x1, region.y1));
+            isIdentical &= (nonZeroAverages[i] == pixelSum->GetNonZeroAverage(region.x0, region.y0, region.x1, region.y1));
+        }
+
+        std::cout << "Kernel: " << PixelSumKernels::Get(simdLevel).name << std::endl;
+        EXPECT_EQ(isIdentical, true, "Batched region query matches the individual queries");
+
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+// Compare a million individual region queries against one batched query.
+void BatchQueryPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+    PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    const size_t regionCount = 1 << 20;
+    std::vector<PixelBufferCoords_i> regions(regionCount);
+    s_FillRandomRegions(regions, 64);
+
+    std::vector<unsigned int> pixelSums(regionCount);
+    std::vector<int> nonZeroCounts(regionCount);
+
+    std::cout << "Individual queries, GetPixelSum() + GetNonZeroCount(), Region count = " << regionCount << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (size_t i = 0; i < regionCount; i++)
+        {
+            const PixelBufferCoords_i& region = regions[i];
+            pixelSums[i] = pixelSum->GetPixelSum(region.x0, region.y0, region.x1, region.y1);
+            nonZeroCounts[i] = pixelSum->GetNonZeroCount(region.x0, region.y0, region.x1, region.y1);
+        }
+    }
+
+    PixelSumBatchOutput output;
+    output.pixelSums     = pixelSums.data();
+    output.nonZeroCounts = nonZeroCounts.data();
+
+    std::cout << "Batched query, GetRegionsBatch(), Region count = " << regionCount << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum->GetRegionsBatch(regions.data(), regionCount, output);
+    }
+
+    delete image;
+    delete pixelSum;
+}
+
+// Interleaved table layout must answer all the queries exactly like the planar layout, GetRegionStats()
+// must match the individual queries.
+void InterleavedLayoutVsPlanarTest()
+{
+    const int width  = IMAGE_WIDTH - 1;
+    const int height = IMAGE_HEIGHT - 2;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 0);
+
+    PixelSum* pixelSumPlanar = new PixelSum(image->GetPixelBufferPtr(), width, height);
+
+    const unsigned int threadCounts[] = { 1, 3 };
+    for (unsigned int threadCount : threadCounts)
+    {
+        PixelSumConfig config;
+        config.tableLayout = PixelSumTableLayout::Interleaved;
+        config.threadCount = threadCount;
+        PixelSum* pixelSumInterleaved = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+        // Copy must preserve the layout
+        PixelSum* pixelSumCopy = new PixelSum(*pixelSumInterleaved);
+
+        std::vector<PixelBufferCoords_i> regions(1000);
+        s_FillRandomRegions(regions, 512);
+
+        std::vector<unsigned int> pixelSums(regions.size());
+        std::vector<double> nonZeroAverages(regions.size());
+        PixelSumBatchOutput output;
+        output.pixelSums       = pixelSums.data();
+        output.nonZeroAverages = nonZeroAverages.data();
+        pixelSumInterleaved->GetRegionsBatch(regions.data(), regions.size(), output);
+
+        bool isIdentical = true;
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const PixelBufferCoords_i& r = regions[i];
+            const PixelSumRegionStats stats = pixelSumCopy->GetRegionStats(r.x0, r.y0, r.x1, r.y1);
+
+            isIdentical &= (stats.pixelSum == pixelSumPlanar->GetPixelSum(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (stats.pixelAverage == pixelSumPlanar->GetPixelAverage(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (stats.nonZeroCount == pixelSumPlanar->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (stats.nonZeroAverage == pixelSumPlanar->GetNonZeroAverage(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelSums[i] == stats.pixelSum);
+            isIdentical &= (nonZeroAverages[i] == stats.nonZeroAverage);
+        }
+
+        std::cout << "Thread count: " << threadCount << std::endl;
+        EXPECT_EQ(isIdentical, true, "Interleaved layout region statistics match the planar layout");
+
+        delete pixelSumCopy;
+        delete pixelSumInterleaved;
+    }
+
+    delete pixelSumPlanar;
+    delete image;
+}
+
+// Compact block relative tables must answer all the queries exactly like PixelSum, including the image border,
+// partial tiles and saturated tiles.
+void CompactVsPixelSumTest()
+{
+    const int width  = IMAGE_WIDTH - 3;
+    const int height = IMAGE_HEIGHT - 5;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    const unsigned char fillValues[] = { 0, 255 };
+    for (unsigned char fillValue : fillValues)
+    {
+        if (fillValue == 0)
+        {
+            s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 0);
+        }
+        else
+        {
+            s_FillHalfPixelBufferWithConstValue(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), fillValue);
+        }
+
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height);
+        PixelSumCompact* pixelSumCompact = new PixelSumCompact(image->GetPixelBufferPtr(), width, height);
+        PixelSumCompact* pixelSumCompactCopy = new PixelSumCompact(*pixelSumCompact);
+
+        std::vector<PixelBufferCoords_i> regions(10000);
+        s_FillRandomRegions(regions, 512);
+        regions.push_back({ 0, 0, width - 1, height - 1 });
+        regions.push_back({ 15, 14, 16, 15 });
+        regions.push_back({ width - 1, 0, width - 1, height - 1 });
+
+        bool isIdentical = true;
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            isIdentical &= (pixelSumCompactCopy->GetPixelSum(r.x0, r.y0, r.x1, r.y1) == pixelSum->GetPixelSum(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelSumCompactCopy->GetPixelAverage(r.x0, r.y0, r.x1, r.y1) == pixelSum->GetPixelAverage(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelSumCompactCopy->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1) == pixelSum->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelSumCompactCopy->GetNonZeroAverage(r.x0, r.y0, r.x1, r.y1) == pixelSum->GetNonZeroAverage(r.x0, r.y0, r.x1, r.y1));
+        }
+
+        std::cout << "Fill value: " << static_cast<int>(fillValue) << std::endl;
+        EXPECT_EQ(isIdentical, true, "Compact summed area tables match PixelSum");
+
+        delete pixelSumCompactCopy;
+        delete pixelSumCompact;
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+// Compact tables of a full size image must use about half of the 8 bytes per pixel used by PixelSum.
+void CompactMemoryFootprintTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 1);
+
+    PixelSumCompact* pixelSumCompact = nullptr;
+    {
+        std::cout << "Compact SAT build, Image Size: Width = " << IMAGE_WIDTH << ", Height = " << IMAGE_HEIGHT << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSumCompact = new PixelSumCompact(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+    }
+
+    const size_t pixelSumByteSize = static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT * sizeof(uint32_t) * 2;
+    const double ratio = pixelSumCompact->MemoryByteSize() / static_cast<double>(pixelSumByteSize);
+
+    std::cout << "PixelSum tables: " << pixelSumByteSize << " bytes, PixelSumCompact tables: "
+              << pixelSumCompact->MemoryByteSize() << " bytes, Ratio: " << ratio << std::endl;
+    EXPECT_EQ(ratio < 0.51, true, "Compact tables use about half of the memory");
+
+    delete pixelSumCompact;
+    delete image;
+}
+
+// Compact tables without a pixel buffer or without pool memory left answer every query with 0, copies of them too.
+void CompactAllocationFailureTest()
+{
+    PixelSumCompact nullBufferCompact(nullptr, 64, 64);
+    EXPECT_EQ(nullBufferCompact.GetPixelSum(0, 0, 63, 63), 0u, "Pixel sum without pixel buffer");
+    EXPECT_EQ(nullBufferCompact.GetNonZeroCount(0, 0, 63, 63), 0, "Non-zero count without pixel buffer");
+    EXPECT_EQ(nullBufferCompact.MemoryByteSize(), 0u, "No tables without pixel buffer");
+
+    PixelSumCompact nullBufferCopy(nullBufferCompact);
+    EXPECT_EQ(nullBufferCopy.GetPixelAverage(0, 0, 63, 63), 0.0, "Copy of the tables without pixel buffer");
+
+    // The pools hold the compact tables of a few full size images only
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    memset(image->GetPixelBufferPtr(), 1, static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT);
+
+    std::vector<std::unique_ptr<PixelSumCompact>> pixelSumCompacts;
+    while (pixelSumCompacts.size() < 16)
+    {
+        pixelSumCompacts.emplace_back(new PixelSumCompact(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT));
+        if (pixelSumCompacts.back()->MemoryByteSize() == 0) break;
+    }
+
+    const PixelSumCompact& failedCompact = *pixelSumCompacts.back();
+    EXPECT_EQ(failedCompact.MemoryByteSize(), 0u, "Pools exhausted");
+    EXPECT_EQ(failedCompact.GetPixelSum(0, 0, IMAGE_WIDTH - 1, IMAGE_HEIGHT - 1), 0u, "Pixel sum without pool memory");
+    EXPECT_EQ(failedCompact.GetNonZeroAverage(0, 0, IMAGE_WIDTH - 1, IMAGE_HEIGHT - 1), 0.0, "Non-zero average without pool memory");
+
+    PixelSumCompact failedCopy(*pixelSumCompacts.front());
+    EXPECT_EQ(failedCopy.GetPixelSum(0, 0, IMAGE_WIDTH - 1, IMAGE_HEIGHT - 1), 0u, "Copy without pool memory");
+    EXPECT_EQ(failedCopy.GetNonZeroCount(0, 0, IMAGE_WIDTH - 1, IMAGE_HEIGHT - 1), 0, "Copy without pool memory");
+
+    pixelSumCompacts.clear();
+    delete image;
+}
+
+// Compare four individual queries against GetRegionStats() for the planar and interleaved layout.
+void RegionStatsPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    const size_t regionCount = 1 << 20;
+    std::vector<PixelBufferCoords_i> regions(regionCount);
+    s_FillRandomRegions(regions, 64);
+
+    const PixelSumTableLayout tableLayouts[] = { PixelSumTableLayout::Planar, PixelSumTableLayout::Interleaved };
+    const char* tableLayoutNames[] = { "Planar", "Interleaved" };
+
+    for (int layout = 0; layout < 2; layout++)
+    {
+        PixelSumConfig config;
+        config.tableLayout = tableLayouts[layout];
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+        uint64_t checksumQueries = 0;
+        uint64_t checksumStats = 0;
+        std::cout << tableLayoutNames[layout] << " layout, four individual queries, Region count = " << regionCount << std::endl;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (const PixelBufferCoords_i& r : regions)
+            {
+                checksumQueries += pixelSum->GetPixelSum(r.x0, r.y0, r.x1, r.y1) + pixelSum->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1) +
+                                   static_cast<uint64_t>(pixelSum->GetPixelAverage(r.x0, r.y0, r.x1, r.y1)) +
+                                   static_cast<uint64_t>(pixelSum->GetNonZeroAverage(r.x0, r.y0, r.x1, r.y1));
+            }
+        }
+
+        std::cout << tableLayoutNames[layout] << " layout, GetRegionStats(), Region count = " << regionCount << std::endl;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (const PixelBufferCoords_i& r : regions)
+            {
+                const PixelSumRegionStats stats = pixelSum->GetRegionStats(r.x0, r.y0, r.x1, r.y1);
+                checksumStats += stats.pixelSum + stats.nonZeroCount +
+                                 static_cast<uint64_t>(stats.pixelAverage) + static_cast<uint64_t>(stats.nonZeroAverage);
+            }
+        }
+
+        EXPECT_EQ(checksumQueries, checksumStats, "Region statistics checksum");
+
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+// Fill random regions inside a large image, extents up to the full image
+static void s_FillRandomLargeRegions(std::vector<PixelBufferCoords_i>& p_Regions)
+{
+    std::srand(4321);
+    for (PixelBufferCoords_i& region : p_Regions)
+    {
+        region.x0 = std::rand() % LARGE_IMAGE_WIDTH;
+        region.y0 = std::rand() % LARGE_IMAGE_HEIGHT;
+        region.x1 = std::rand() % LARGE_IMAGE_WIDTH;
+        region.y1 = std::rand() % LARGE_IMAGE_HEIGHT;
+    }
+}
+
+// Sums beyond 32 bits are exact with the wide accumulator, the wraparound accumulator returns them modulo 2^32
+// and stays exact for every region whose sum fits in 32 bits.
+void WideAccumulatorTest()
+{
+    // Coordinates beyond the float precision are kept, the dimensions of the largest image do not overflow
+    const PixBufTLBR_i largestImage(0, 0, 16777217, INT32_MAX - 1);
+    EXPECT_EQ(largestImage.bottom, 16777217, "Coordinate above 2^24");
+    EXPECT_EQ(largestImage.width(), static_cast<int64_t>(INT32_MAX), "Width of 2^31-1 pixels");
+    EXPECT_EQ(PixBufTLBR_i(0, 0, INT32_MAX, 0).height(), static_cast<int64_t>(1) << 31, "Height past the int range");
+
+    const uint64_t pixelCount = static_cast<uint64_t>(LARGE_IMAGE_WIDTH) * LARGE_IMAGE_HEIGHT;
+    const int right  = LARGE_IMAGE_WIDTH - 1;
+    const int bottom = LARGE_IMAGE_HEIGHT - 1;
+
+    Image* image = new Image(LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT);
+    s_FillFullPixelBufferWithConstValue(pixelCount, image->GetPixelBufferPtr(), 255);
+
+    const unsigned int threadCounts[] = { 1, 3 };
+    for (unsigned int threadCount : threadCounts)
+    {
+        PixelSumConfig config;
+        config.accumulator = PixelSumAccumulator::Wide64;
+        config.threadCount = threadCount;
+        PixelSum* pixelSumWide = new PixelSum(image->GetPixelBufferPtr(), LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT, config);
+
+        std::cout << "Thread count: " << threadCount << std::endl;
+        EXPECT_EQ(pixelSumWide->GetPixelSum64(0, 0, right, bottom) == 255 * pixelCount, true, "Wide full image sum beyond 32 bits");
+        EXPECT_EQ(pixelSumWide->GetNonZeroCount64(0, 0, right, bottom) == pixelCount, true, "Wide full image non-zero count");
+        EXPECT_EQ(pixelSumWide->GetPixelSum64(1, 1, right, bottom) == 255 * (pixelCount - LARGE_IMAGE_WIDTH - bottom), true,
+                  "Wide sum with all four corners");
+        EXPECT_FLOAT_EQ(pixelSumWide->GetPixelAverage(-10, -10, right + 10, bottom + 10),
+                        255.0 * pixelCount / ((LARGE_IMAGE_WIDTH + 20.0) * (LARGE_IMAGE_HEIGHT + 20.0)), "Wide average of a clipped window");
+
+        delete pixelSumWide;
+    }
+
+    PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT);
+    EXPECT_EQ(pixelSum->GetPixelSum64(0, 0, right, bottom) == ((255 * pixelCount) & 0xFFFFFFFFull), true, "Wraparound full image sum modulo 2^32");
+    EXPECT_EQ(pixelSum->GetPixelSum(100, 200, 4099, 4199), 255u * 4000u * 4000u, "Wraparound region sum below 2^32 is exact");
+
+    // The wraparound averages divide the sum modulo 2^32, regions summing beyond it are off
+    EXPECT_FLOAT_EQ(pixelSum->GetPixelAverage(100, 200, 4099, 4199), 255.0, "Wraparound average of a sum below 2^32");
+    EXPECT_FLOAT_EQ(pixelSum->GetPixelAverage(0, 0, right, bottom), ((255 * pixelCount) & 0xFFFFFFFFull) / static_cast<double>(pixelCount),
+                    "Wraparound average of a sum beyond 2^32");
+    EXPECT_EQ(pixelSum->GetRegionStats(0, 0, right, bottom).pixelAverage == 255.0, false, "Wraparound region stats beyond 2^32");
+    delete pixelSum;
+
+    // Random regions, the wraparound results are the low 32 bits of the wide results
+    s_FillDataWithContinousNumberStartingWith(pixelCount, image->GetPixelBufferPtr(), 3);
+
+    PixelSumConfig config;
+    config.accumulator = PixelSumAccumulator::Wide64;
+    PixelSum* pixelSumWide = new PixelSum(image->GetPixelBufferPtr(), LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT, config);
+    pixelSum = new PixelSum(image->GetPixelBufferPtr(), LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT);
+
+    std::vector<PixelBufferCoords_i> regions(10000);
+    s_FillRandomLargeRegions(regions);
+
+    std::vector<double> pixelAverages(regions.size());
+    PixelSumBatchOutput output;
+    output.pixelAverages = pixelAverages.data();
+    pixelSumWide->GetRegionsBatch(regions.data(), regions.size(), output);
+
+    bool isIdentical = true;
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        const PixelBufferCoords_i& r = regions[i];
+        const uint64_t wideSum = pixelSumWide->GetPixelSum64(r.x0, r.y0, r.x1, r.y1);
+
+        isIdentical &= (pixelSum->GetPixelSum64(r.x0, r.y0, r.x1, r.y1) == (wideSum & 0xFFFFFFFFull));
+        isIdentical &= (pixelSum->GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1) == pixelSumWide->GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1));
+        isIdentical &= (pixelAverages[i] == pixelSumWide->GetPixelAverage(r.x0, r.y0, r.x1, r.y1));
+        if (wideSum <= 0xFFFFFFFFull)
+        {
+            isIdentical &= (pixelSum->GetPixelAverage(r.x0, r.y0, r.x1, r.y1) == pixelSumWide->GetPixelAverage(r.x0, r.y0, r.x1, r.y1));
+        }
+    }
+    EXPECT_EQ(isIdentical, true, "Wraparound results are the wide results modulo 2^32");
+
+    delete pixelSumWide;
+    delete pixelSum;
+    delete image;
+}
+
+// Compare build time, query time and memory of the wraparound and the wide accumulator on a large image.
+void AccumulatorWidthPerformanceTest()
+{
+    Image* image = new Image(LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(static_cast<size_t>(LARGE_IMAGE_WIDTH) * LARGE_IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    std::vector<PixelBufferCoords_i> regions(1 << 20);
+    s_FillRandomLargeRegions(regions);
+
+    const PixelSumAccumulator accumulators[] = { PixelSumAccumulator::Wraparound32, PixelSumAccumulator::Wide64 };
+    for (PixelSumAccumulator accumulator : accumulators)
+    {
+        const bool isWide = (accumulator == PixelSumAccumulator::Wide64);
+        const size_t tablesByteSize = static_cast<size_t>(LARGE_IMAGE_WIDTH) * LARGE_IMAGE_HEIGHT * 2 * (isWide ? sizeof(uint64_t) : sizeof(uint32_t));
+
+        std::cout << "Accumulator: " << (isWide ? "Wide64" : "Wraparound32") << ", Image Size: Width = " << LARGE_IMAGE_WIDTH
+                  << ", Height = " << LARGE_IMAGE_HEIGHT << ", Tables: " << (tablesByteSize >> 20) << " MB" << std::endl;
+
+        PixelSumConfig config;
+        config.accumulator = accumulator;
+        PixelSum* pixelSum = nullptr;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            pixelSum = new PixelSum(image->GetPixelBufferPtr(), LARGE_IMAGE_WIDTH, LARGE_IMAGE_HEIGHT, config);
+        }
+
+        std::cout << "GetPixelSum64() + GetNonZeroCount64(), Region count = " << regions.size() << std::endl;
+        uint64_t checksum = 0;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (const PixelBufferCoords_i& r : regions)
+            {
+                checksum += pixelSum->GetPixelSum64(r.x0, r.y0, r.x1, r.y1) + pixelSum->GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1);
+            }
+        }
+        std::cout << "Checksum: " << checksum << std::endl;
+
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+// Padded tables must answer all the queries exactly like the packed tables for every layout, accumulator and
+// build mode, including the windows on the image border.
+void PaddedVsPackedTablesTest()
+{
+    const int width  = IMAGE_WIDTH - 5;
+    const int height = IMAGE_HEIGHT - 3;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 0);
+
+    std::vector<PixelBufferCoords_i> regions(1000);
+    s_FillRandomRegions(regions, 512);
+    regions.push_back({ 0, 0, 0, 0 });
+    regions.push_back({ 0, 7, width - 1, 9 });
+    regions.push_back({ 7, 0, 9, height - 1 });
+
+    PixelSumConfig configs[5];
+    configs[1].tableLayout = PixelSumTableLayout::Interleaved;
+    configs[2].buildMode   = PixelSumBuildMode::TwoPass;
+    configs[3].accumulator = PixelSumAccumulator::Wide64;
+    configs[4].threadCount = 3;
+
+    for (PixelSumConfig& config : configs)
+    {
+        config.tablePadding = PixelSumTablePadding::Packed;
+        PixelSum* pixelSumPacked = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+        config.tablePadding = PixelSumTablePadding::Padded;
+        PixelSum* pixelSumPadded = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+        PixelSum* pixelSumCopy = new PixelSum(*pixelSumPadded);
+
+        std::vector<double> pixelAverages(regions.size());
+        std::vector<int> nonZeroCounts(regions.size());
+        PixelSumBatchOutput output;
+        output.pixelAverages = pixelAverages.data();
+        output.nonZeroCounts = nonZeroCounts.data();
+        pixelSumCopy->GetRegionsBatch(regions.data(), regions.size(), output);
+
+        bool isIdentical = true;
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const PixelBufferCoords_i& r = regions[i];
+            isIdentical &= (pixelSumCopy->GetPixelSum64(r.x0, r.y0, r.x1, r.y1) == pixelSumPacked->GetPixelSum64(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelSumCopy->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1) == pixelSumPacked->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelAverages[i] == pixelSumPacked->GetPixelAverage(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (nonZeroCounts[i] == pixelSumPacked->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1));
+        }
+        EXPECT_EQ(isIdentical, true, "Padded tables match the packed tables");
+
+        delete pixelSumCopy;
+        delete pixelSumPadded;
+        delete pixelSumPacked;
+    }
+
+    delete image;
+}
+
+// Random query latency of the packed (branches on the image border) and padded (four unconditional loads)
+// tables. Every query depends on the result of the previous one, so the loads of two queries do not overlap.
+void QueryLatencyPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    const size_t regionCount = 1 << 20;
+    std::vector<PixelBufferCoords_i> regions(regionCount);
+    s_FillRandomRegions(regions, 64);
+
+    const PixelSumTablePadding tablePaddings[] = { PixelSumTablePadding::Packed, PixelSumTablePadding::Padded };
+    for (PixelSumTablePadding tablePadding : tablePaddings)
+    {
+        PixelSumConfig config;
+        config.tablePadding = tablePadding;
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+        std::cout << "Table padding: " << (tablePadding == PixelSumTablePadding::Padded ? "Padded" : "Packed")
+                  << ", dependent GetPixelSum(), Region count = " << regionCount << std::endl;
+
+        unsigned int checksum = 0;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (const PixelBufferCoords_i& r : regions)
+            {
+                const int dependency = static_cast<int>(checksum & 1u);
+                checksum += pixelSum->GetPixelSum(r.x0 + dependency, r.y0, r.x1, r.y1);
+            }
+        }
+        std::cout << "Checksum: " << checksum << std::endl;
+
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+// Rebuilding the tables of a new frame vs updating the dirty regions of the previous frame. The update touches the
+// bottom-right quadrant of the dirty regions, a small region near the bottom of the frame is the best case.
+void UpdateRegionPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    PixelSum* pixelSum = nullptr;
+    {
+        std::cout << "Rebuild, Image = " << IMAGE_WIDTH << " x " << IMAGE_HEIGHT << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+    }
+
+    const int regionOrigins[] = { 0, IMAGE_WIDTH / 2, IMAGE_WIDTH - 64 };
+    for (int regionOrigin : regionOrigins)
+    {
+        // A 64 x 64 cursor and an overlapping 64 x 16 overlay
+        PixelBufferCoords_i regions[2];
+        regions[0].x0 = regionOrigin; regions[0].y0 = regionOrigin;      regions[0].x1 = regionOrigin + 63; regions[0].y1 = regionOrigin + 63;
+        regions[1].x0 = regionOrigin; regions[1].y0 = regionOrigin + 48; regions[1].x1 = regionOrigin + 63; regions[1].y1 = regionOrigin + 63;
+        for (int y = regionOrigin; y < regionOrigin + 64; y++)
+        {
+            memset(image->GetPixelBufferPtr() + static_cast<size_t>(y) * IMAGE_WIDTH + regionOrigin, y & 0xff, 64);
+        }
+
+        std::cout << "UpdateRegions(), dirty regions at (" << regionOrigin << ", " << regionOrigin << ")" << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum->UpdateRegions(regions, 2, image->GetPixelBufferPtr());
+    }
+
+    delete pixelSum;
+    delete image;
+}
+
+// Frame rate of a stream compared with constructing a PixelSum per frame, then the same stream while a reader keeps
+// querying the latest published frame. On a single core host the reader shares the core with the build.
+void StreamPerformanceTest()
+{
+    const int frameCount = 30;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    {
+        std::cout << "PixelSum per frame, Frame count = " << frameCount << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+        }
+    }
+
+    PixelSumStream* stream = new PixelSumStream(IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::atomic<bool> isReading(false);
+    std::atomic<bool> isStopping(false);
+    std::atomic<size_t> queryCount(0);
+    std::atomic<unsigned int> checksum(0);
+    std::thread reader([&]()
+    {
+        while (!isStopping.load())
+        {
+            PixelSumStream::Snapshot snapshot = stream->Acquire();
+            if (!isReading.load() || !snapshot)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+
+            unsigned int pixelSum = 0;
+            for (int i = 0; i < 1000; i++) pixelSum += snapshot->GetPixelSum(i, i, i + 64, i + 64);
+
+            checksum += pixelSum;
+            queryCount += 1000;
+        }
+    });
+
+    for (int pass = 0; pass < 2; pass++)
+    {
+        isReading = (pass == 1);
+        std::cout << "PixelSumStream, Frame count = " << frameCount << (isReading ? ", with a reader" : "") << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int frame = 0; frame < frameCount; frame++)
+        {
+            stream->WaitForFrame(stream->SubmitFrame(image->GetPixelBufferPtr()));
+        }
+    }
+
+    isStopping = true;
+    reader.join();
+    std::cout << "Queries served while streaming: " << queryCount.load() << ", Checksum: " << checksum.load() << std::endl;
+
+    delete stream;
+    delete image;
+}
+
+// Rows per second of a line-scan stream, each row is pushed and queried with a window over the last 64 rows.
+void ScanlinePushRowPerformanceTest()
+{
+    const int rowCount = 4 * IMAGE_HEIGHT;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    PixelSumScanline* scanline = new PixelSumScanline(IMAGE_WIDTH, 1000);
+
+    std::cout << "PushRow(), Width = " << IMAGE_WIDTH << ", Row count = " << rowCount << std::endl;
+
+    unsigned int checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int row = 0; row < rowCount; row++)
+        {
+            scanline->PushRow(image->GetPixelBufferPtr() + static_cast<size_t>(row % IMAGE_HEIGHT) * IMAGE_WIDTH);
+            checksum += scanline->GetPixelSum(row % 1024, row - 63, (row % 1024) + 255, row);
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    delete scanline;
+    delete image;
+}
+
+// Construction plus a few header band queries, eager vs lazy tables.
+void LazyBuildPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    const PixelSumBuildTiming buildTimings[] = { PixelSumBuildTiming::Eager, PixelSumBuildTiming::Lazy };
+    for (PixelSumBuildTiming buildTiming : buildTimings)
+    {
+        PixelSumConfig config;
+        config.buildTiming = buildTiming;
+
+        std::cout << "Build timing: " << (buildTiming == PixelSumBuildTiming::Lazy ? "Lazy" : "Eager")
+                  << ", 100 GetPixelSum() in the top 10% of the image" << std::endl;
+
+        unsigned int checksum = 0;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+
+            PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+            for (int i = 0; i < 100; i++)
+            {
+                checksum += pixelSum.GetPixelSum(i * 37, i * 4, i * 37 + 100, i * 4 + 8);
+            }
+        }
+        std::cout << "Checksum: " << checksum << std::endl;
+    }
+
+    delete image;
+}
+
+// Passing the tables to the next pipeline stage, deep copy vs copy-on-write vs move.
+void CopyVsSharePerformanceTest()
+{
+    const int copyCount = 20;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    const PixelSumTableSharing tableSharings[] = { PixelSumTableSharing::DeepCopy, PixelSumTableSharing::CopyOnWrite };
+    for (PixelSumTableSharing tableSharing : tableSharings)
+    {
+        PixelSumConfig config;
+        config.tableSharing = tableSharing;
+        PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+        std::cout << "Table sharing: " << (tableSharing == PixelSumTableSharing::CopyOnWrite ? "CopyOnWrite" : "DeepCopy")
+                  << ", Copy count = " << copyCount << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int i = 0; i < copyCount; i++)
+        {
+            PixelSum pixelSumCopy(pixelSum);
+        }
+    }
+
+    {
+        PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+
+        std::cout << "Move, Move count = " << copyCount << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int i = 0; i < copyCount; i++)
+        {
+            PixelSum pixelSumMoved(std::move(pixelSum));
+            pixelSum = std::move(pixelSumMoved);
+        }
+    }
+
+    delete image;
+}
+
+// Local mean and standard deviation of a 31x31 window around every pixel of a band, as used by an adaptive
+// (Sauvola) threshold: naive scan vs single O(1) queries vs one batched query.
+void VariancePerformanceTest()
+{
+    const int radius = 15;
+    const int bandHeight = 64;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 2);
+
+    const PixelSumSquaredSums squaredSumsOptions[] = { PixelSumSquaredSums::Disabled, PixelSumSquaredSums::Enabled };
+    for (PixelSumSquaredSums squaredSums : squaredSumsOptions)
+    {
+        PixelSumConfig config;
+        config.squaredSums = squaredSums;
+
+        std::cout << "Build, squared pixel table: " << (squaredSums == PixelSumSquaredSums::Enabled ? "Enabled" : "Disabled") << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+    }
+
+    PixelSumConfig config;
+    config.squaredSums = PixelSumSquaredSums::Enabled;
+    PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+    std::vector<PixelBufferCoords_i> windows;
+    windows.reserve(static_cast<size_t>(IMAGE_WIDTH) * bandHeight);
+    for (int y = 0; y < bandHeight; y++)
+    {
+        for (int x = 0; x < IMAGE_WIDTH; x++)
+        {
+            windows.push_back(PixelBufferCoords_i(y - radius, x - radius, y + radius, x + radius));
+        }
+    }
+
+    std::cout << "Naive scan, Window count = " << windows.size() << std::endl;
+    double checksum = 0.0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (const PixelBufferCoords_i& window : windows)
+        {
+            uint64_t squaredSum = 0;
+            double variance = 0.0;
+            s_NaiveSquaredSumAndVariance(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, window, squaredSum, variance);
+            checksum += variance;
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    std::cout << "GetPixelVariance(), Window count = " << windows.size() << std::endl;
+    checksum = 0.0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (const PixelBufferCoords_i& window : windows)
+        {
+            checksum += pixelSum.GetPixelVariance(window.x0, window.y0, window.x1, window.y1);
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    std::cout << "GetRegionsBatch(), Window count = " << windows.size() << std::endl;
+    std::vector<double> averages(windows.size());
+    std::vector<double> variances(windows.size());
+    PixelSumBatchOutput output;
+    output.pixelAverages  = averages.data();
+    output.pixelVariances = variances.data();
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum.GetRegionsBatch(windows.data(), windows.size(), output);
+    }
+
+    checksum = 0.0;
+    for (double variance : variances) checksum += variance;
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    delete image;
+}
+
+// Colour camera frame: de-interleaving the RGBA planes and building one PixelSum per channel vs a single multi
+// channel build, then the per channel queries vs one all channel query per region.
+void MultiChannelPerformanceTest()
+{
+    const int width  = 1920;
+    const int height = 1080;
+    const int channelCount = 4;
+
+    std::vector<unsigned char> interleaved(static_cast<size_t>(width) * height * channelCount);
+    s_FillDataWithContinousNumberStartingWith(static_cast<int>(interleaved.size()), interleaved.data(), 3);
+
+    std::cout << "De-interleave + " << channelCount << " PixelSum builds" << std::endl;
+    {
+        std::vector<unsigned char> plane(static_cast<size_t>(width) * height);
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int channel = 0; channel < channelCount; channel++)
+        {
+            for (size_t i = 0; i < plane.size(); i++) plane[i] = interleaved[i * channelCount + channel];
+            PixelSum pixelSum(plane.data(), width, height);
+        }
+    }
+
+    std::cout << "PixelSumMultiChannel build" << std::endl;
+    PixelSumMultiChannel* multiChannel = nullptr;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        multiChannel = new PixelSumMultiChannel(interleaved.data(), width, height, channelCount);
+    }
+
+    std::cout << "PixelSumMultiChannel Rebuild()" << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        multiChannel->Rebuild(interleaved.data());
+    }
+
+    std::vector<PixelBufferCoords_i> regions(1000000);
+    std::srand(97);
+    for (PixelBufferCoords_i& region : regions)
+    {
+        region.x0 = std::rand() % width;
+        region.y0 = std::rand() % height;
+        region.x1 = region.x0 + std::rand() % 64;
+        region.y1 = region.y0 + std::rand() % 64;
+    }
+
+    std::cout << "GetPixelAverage() per channel, Region count = " << regions.size() << std::endl;
+    double checksum = 0.0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            for (int channel = 0; channel < channelCount; channel++)
+            {
+                checksum += multiChannel->GetPixelAverage(channel, r.x0, r.y0, r.x1, r.y1);
+            }
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    std::cout << "GetRegionStats() all channels, Region count = " << regions.size() << std::endl;
+    checksum = 0.0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            const PixelSumChannelStats stats = multiChannel->GetRegionStats(r.x0, r.y0, r.x1, r.y1);
+            checksum += stats.pixelAverages[0] + stats.pixelAverages[1] + stats.pixelAverages[2] + stats.pixelAverages[3];
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    delete multiChannel;
+}
+
+// Tilted Haar feature rectangles: naive scan of the rotated pixels vs the O(1) rotated table query, and the build
+// cost of the rotated tables.
+void RotatedSumPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 5);
+
+    const PixelSumRotatedSums rotatedSumsOptions[] = { PixelSumRotatedSums::Disabled, PixelSumRotatedSums::Enabled };
+    for (PixelSumRotatedSums rotatedSums : rotatedSumsOptions)
+    {
+        PixelSumConfig config;
+        config.rotatedSums = rotatedSums;
+
+        std::cout << "Build, rotated tables: " << (rotatedSums == PixelSumRotatedSums::Enabled ? "Enabled" : "Disabled") << std::endl;
+
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+    }
+
+    PixelSumConfig config;
+    config.rotatedSums = PixelSumRotatedSums::Enabled;
+    PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+    std::vector<TiltedRect> rects(200000);
+    std::srand(531);
+    for (TiltedRect& rect : rects)
+    {
+        rect.x      = std::rand() % IMAGE_WIDTH;
+        rect.y      = std::rand() % IMAGE_HEIGHT;
+        rect.width  = 1 + std::rand() % 24;
+        rect.height = 1 + std::rand() % 24;
+    }
+
+    std::cout << "Naive scan, Rectangle count = " << rects.size() << std::endl;
+    uint64_t checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (const TiltedRect& rect : rects)
+        {
+            checksum += s_NaiveRotatedSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, rect);
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    std::cout << "GetRotatedPixelSum(), Rectangle count = " << rects.size() << std::endl;
+    checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (const TiltedRect& rect : rects)
+        {
+            checksum += pixelSum.GetRotatedPixelSum(rect.x, rect.y, rect.width, rect.height);
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    delete image;
+}
+
+// Dense local mean of every pixel, e.g. the background estimate of an adaptive threshold: one GetPixelAverage()
+// call per pixel vs the box filter engine with its float and u8 outputs, both on one thread.
+void BoxFilterPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 5);
+
+    PixelSumConfig config;
+    config.threadCount = 1;
+    PixelSum pixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+    const int windowSize = 31;
+    const size_t pixelCount = static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT;
+    std::vector<float> averages(pixelCount);
+    std::vector<unsigned char> averagesU8(pixelCount);
+
+    std::cout << "GetPixelAverage() per pixel, Window = " << windowSize << "x" << windowSize << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (int y = 0; y < IMAGE_HEIGHT; y++)
+        {
+            for (int x = 0; x < IMAGE_WIDTH; x++)
+            {
+                const int x0 = x - windowSize / 2;
+                const int y0 = y - windowSize / 2;
+                averages[static_cast<size_t>(y) * IMAGE_WIDTH + x] =
+                    static_cast<float>(pixelSum.GetPixelAverage(x0, y0, x0 + windowSize - 1, y0 + windowSize - 1));
+            }
+        }
+    }
+    std::cout << "Checksum: " << std::accumulate(averages.begin(), averages.end(), 0.0) << std::endl;
+
+    std::cout << "ComputeBoxFilter() float output" << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum.ComputeBoxFilter(windowSize, windowSize, 1, averages.data());
+    }
+    std::cout << "Checksum: " << std::accumulate(averages.begin(), averages.end(), 0.0) << std::endl;
+
+    std::cout << "ComputeBoxFilter() u8 output" << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum.ComputeBoxFilter(windowSize, windowSize, 1, averagesU8.data());
+    }
+    std::cout << "Checksum: " << std::accumulate(averagesU8.begin(), averagesU8.end(), 0.0) << std::endl;
+
+    delete image;
+}
+
+// Cascade scan of all the scales: stage by stage evaluation with individual PixelSum queries per window vs the
+// compiled cascade with one thread and with all the hardware threads.
+void CascadePerformanceTest()
+{
+    const int width  = 1024;
+    const int height = 1024;
+
+    Image* image = new Image(width, height);
+    std::srand(4242);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    PixelSumConfig config;
+    config.tablePadding = PixelSumTablePadding::Padded;
+    config.squaredSums = PixelSumSquaredSums::Enabled;
+    PixelSum pixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+    const PixelSumHaarCascade haarCascade = s_RandomHaarCascade(pixelSum, 256, 256, { 3, 6, 10, 15, 20 }, true);
+    const PixelSumCascade cascade(haarCascade);
+    const PixelSumDetectionParams params;
+
+    std::cout << "Individual queries per window" << std::endl;
+    size_t detectionCount = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (float scale = params.minScale; ; scale *= params.scaleFactor)
+        {
+            const int windowSize = static_cast<int>(haarCascade.windowWidth * scale + 0.5f);
+            const int scanStep = std::max(1, static_cast<int>(params.step * scale + 0.5f));
+            if (windowSize > width || windowSize > height) break;
+
+            for (int y = 0; y + windowSize <= height; y += scanStep)
+            {
+                for (int x = 0; x + windowSize <= width; x += scanStep)
+                {
+                    detectionCount += (s_QueryCascadeWindow(pixelSum, haarCascade, x, y, scale, true) == cascade.GetStageCount());
+                }
+            }
+        }
+    }
+    std::cout << "Detections: " << detectionCount << std::endl;
+
+    const unsigned int threadCounts[] = { 1, 0 };
+    for (unsigned int threadCount : threadCounts)
+    {
+        PixelSumDetectionParams threadParams;
+        threadParams.threadCount = threadCount;
+
+        std::cout << "PixelSumCascade::Detect(), Thread count = " << (threadCount ? threadCount : std::thread::hardware_concurrency()) << std::endl;
+        std::vector<PixelSumDetection> detections;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            cascade.Detect(pixelSum, detections, threadParams);
+        }
+        std::cout << "Detections: " << detections.size() << std::endl;
+    }
+
+    delete image;
+}
+
+// Histograms of random regions, e.g. the candidate windows of a histogram based tracker: scan of the pixels of
+// every region vs the integral histogram.
+void HistogramPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::srand(8642);
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    const int regionCount = 20000;
+    std::vector<int> regions; // x0, y0, x1, y1
+    for (int i = 0; i < regionCount; i++)
+    {
+        const int x0 = std::rand() % IMAGE_WIDTH;
+        const int y0 = std::rand() % IMAGE_HEIGHT;
+        regions.push_back(x0);
+        regions.push_back(y0);
+        regions.push_back(x0 + 32 + std::rand() % 96);
+        regions.push_back(y0 + 32 + std::rand() % 96);
+    }
+
+    std::cout << "Pixel scan per region, Bins = " << HISTOGRAM_BIN_COUNT << ", Regions = " << regionCount << std::endl;
+    uint64_t checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (size_t i = 0; i < regions.size(); i += 4)
+        {
+            const std::vector<uint32_t> histogram = s_NaiveRegionHistogram(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, HISTOGRAM_BIN_COUNT,
+                                                                           regions[i], regions[i + 1], regions[i + 2], regions[i + 3]);
+            checksum += histogram[i % HISTOGRAM_BIN_COUNT];
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    std::cout << "PixelSumHistogram build" << std::endl;
+    PixelSumHistogram* histogram = nullptr;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        histogram = new PixelSumHistogram(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, HISTOGRAM_BIN_COUNT);
+    }
+    std::cout << "Memory: " << histogram->MemoryByteSize() / (1024 * 1024) << " MB" << std::endl;
+
+    std::cout << "PixelSumHistogram::GetRegionHistogram()" << std::endl;
+    checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        uint32_t regionHistogram[HISTOGRAM_BIN_COUNT];
+        for (size_t i = 0; i < regions.size(); i += 4)
+        {
+            histogram->GetRegionHistogram(regions[i], regions[i + 1], regions[i + 2], regions[i + 3], regionHistogram);
+            checksum += regionHistogram[i % HISTOGRAM_BIN_COUNT];
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    delete histogram;
+    delete image;
+}
+
+// Counts above several thresholds over the same windows: one PixelSum per threshold on a thresholded copy of the
+// image vs the count tables of all the thresholds built in one pass.
+void ThresholdCountsPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::srand(3579);
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    const int regionCount = 1000000;
+    std::vector<int> regions; // x0, y0, x1, y1
+    for (int i = 0; i < regionCount; i++)
+    {
+        const int x0 = std::rand() % IMAGE_WIDTH;
+        const int y0 = std::rand() % IMAGE_HEIGHT;
+        regions.push_back(x0);
+        regions.push_back(y0);
+        regions.push_back(x0 + std::rand() % 64);
+        regions.push_back(y0 + std::rand() % 64);
+    }
+
+    std::cout << "Thresholded image and PixelSum per threshold, Thresholds = " << COUNT_THRESHOLDS.size() << std::endl;
+    std::vector<Image*> thresholdedImages;
+    std::vector<PixelSum*> pixelSums;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (unsigned char threshold : COUNT_THRESHOLDS)
+        {
+            Image* thresholdedImage = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+            for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+            {
+                thresholdedImage->GetPixelBufferPtr()[i] = (image->GetPixelBufferPtr()[i] > threshold) ? 1 : 0;
+            }
+
+            thresholdedImages.push_back(thresholdedImage);
+            pixelSums.push_back(new PixelSum(thresholdedImage->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT));
+        }
+    }
+
+    std::cout << "GetNonZeroCount() per threshold, Regions = " << regionCount << std::endl;
+    uint64_t checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (size_t i = 0; i < regions.size(); i += 4)
+        {
+            for (const PixelSum* pixelSum : pixelSums)
+            {
+                checksum += pixelSum->GetNonZeroCount(regions[i], regions[i + 1], regions[i + 2], regions[i + 3]);
+            }
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    for (PixelSum* pixelSum : pixelSums) delete pixelSum;
+    for (Image* thresholdedImage : thresholdedImages) delete thresholdedImage;
+
+    std::cout << "PixelSumThresholdCounts build" << std::endl;
+    PixelSumThresholdCounts* thresholdCounts = nullptr;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        thresholdCounts = new PixelSumThresholdCounts(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, COUNT_THRESHOLDS);
+    }
+
+    std::cout << "PixelSumThresholdCounts::GetCountsAbove()" << std::endl;
+    checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        uint32_t counts[PixelSumThresholdCounts::MAX_THRESHOLD_COUNT];
+        for (size_t i = 0; i < regions.size(); i += 4)
+        {
+            thresholdCounts->GetCountsAbove(regions[i], regions[i + 1], regions[i + 2], regions[i + 3], counts);
+            checksum = std::accumulate(counts, counts + COUNT_THRESHOLDS.size(), checksum);
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    delete thresholdCounts;
+    delete image;
+}
+
+// Start up of a process needing the tables of a full size image: build from the pixels vs mapping a saved table
+// file, with the header or the full verification. The first query pass includes the page faults of the mapping.
+void MappedLoadPerformanceTest()
+{
+    const char* filePath = "PixelSumTables.tmp";
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::srand(1357);
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    const int regionCount = 1000000;
+    std::vector<int> regions; // x0, y0, x1, y1
+    for (int i = 0; i < regionCount; i++)
+    {
+        const int x0 = std::rand() % IMAGE_WIDTH;
+        const int y0 = std::rand() % IMAGE_HEIGHT;
+        regions.push_back(x0);
+        regions.push_back(y0);
+        regions.push_back(x0 + std::rand() % 64);
+        regions.push_back(y0 + std::rand() % 64);
+    }
+
+    std::cout << "PixelSum build, Image Size: Width = " << IMAGE_WIDTH << ", Height = " << IMAGE_HEIGHT << std::endl;
+    PixelSum* pixelSum = nullptr;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+    }
+
+    std::cout << "SaveTables()" << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        pixelSum->SaveTables(filePath);
+    }
+
+    const PixelSumFileVerification verifications[] = { PixelSumFileVerification::Header, PixelSumFileVerification::Full };
+    for (PixelSumFileVerification verification : verifications)
+    {
+        std::cout << "MapTables(), Verification = " << ((verification == PixelSumFileVerification::Full) ? "Full" : "Header") << std::endl;
+        PixelSum mappedPixelSum;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            mappedPixelSum.MapTables(filePath, verification);
+        }
+
+        std::cout << "First GetPixelSum() pass on the mapping, Regions = " << regionCount << std::endl;
+        uint64_t checksum = 0;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (size_t i = 0; i < regions.size(); i += 4)
+            {
+                checksum += mappedPixelSum.GetPixelSum(regions[i], regions[i + 1], regions[i + 2], regions[i + 3]);
+            }
+        }
+        std::cout << "Checksum: " << checksum << std::endl;
+    }
+
+    std::cout << "GetPixelSum() pass on the built tables, Regions = " << regionCount << std::endl;
+    uint64_t checksum = 0;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        for (size_t i = 0; i < regions.size(); i += 4)
+        {
+            checksum += pixelSum->GetPixelSum(regions[i], regions[i + 1], regions[i + 2], regions[i + 3]);
+        }
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    remove(filePath);
+
+    delete pixelSum;
+    delete image;
+}
+
+// Tables of a full size image stored in a file: read into an image and build, build from the mapped file, and read
+// band by band while the tables are built. The file is in the page cache, the copy of the pixels is measured.
+void ImageFileLoadPerformanceTest()
+{
+    const size_t pixelCount = static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT;
+    const char* filePath = "PixelSumImage.raw";
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::srand(4680);
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+    s_WriteImageFile(filePath, image->GetPixelBufferPtr(), pixelCount);
+
+    uint64_t checksum = 0;
+    std::cout << "fread() into an Image and PixelSum build, Image Size: Width = " << IMAGE_WIDTH << ", Height = " << IMAGE_HEIGHT << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        FILE* file = fopen(filePath, "rb");
+        Image* readImage = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+        checksum += fread(readImage->GetPixelBufferPtr(), 1, pixelCount, file);
+        fclose(file);
+
+        PixelSum pixelSum(readImage->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+        checksum += pixelSum.GetPixelSum(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM);
+        delete readImage;
+    }
+
+    std::cout << "PixelSumImageFile::Map() and PixelSum build from the mapping" << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        PixelSumImageFile imageFile;
+        imageFile.Map(filePath, IMAGE_WIDTH, IMAGE_HEIGHT);
+
+        PixelSum pixelSum(imageFile.GetPixels(), IMAGE_WIDTH, IMAGE_HEIGHT);
+        checksum += pixelSum.GetPixelSum(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM);
+    }
+
+    std::cout << "PixelSumImageFile::Read() with the build overlapping the read" << std::endl;
+    {
+        DefaultResults results;
+        ScopedTimer Timer(results);
+        PixelSumImageFile imageFile;
+        PixelSum pixelSum;
+        imageFile.Read(filePath, IMAGE_WIDTH, IMAGE_HEIGHT, &pixelSum);
+        checksum += pixelSum.GetPixelSum(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM);
+    }
+    std::cout << "Checksum: " << checksum << std::endl;
+
+    remove(filePath);
+
+    delete image;
+}
+
+// Page configurations of a 64 MB table: allocation including the prefault, first build of the table i.e. the page
+// faults when not prefaulted, and random corner lookups whose TLB misses the huge pages avoid.
+void PageConfigPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    std::srand(6802);
+    for (int i = 0; i < IMAGE_WIDTH * IMAGE_HEIGHT; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    const int queryCount = 4000000;
+    std::vector<uint32_t> cornerOffsets(queryCount);
+    for (uint32_t& cornerOffset : cornerOffsets)
+    {
+        cornerOffset = static_cast<uint32_t>((std::rand() % IMAGE_HEIGHT) * IMAGE_WIDTH + std::rand() % IMAGE_WIDTH);
+    }
+
+    struct PageConfigCase
+    {
+        const char* name;
+        VM::VMPageSize pageSize;
+        VM::VMPrefault prefault;
+    };
+    const PageConfigCase pageConfigCases[] =
+    {
+        { "Default pages",                  VM::VMPageSize::Default,     VM::VMPrefault::None     },
+        { "Default pages, MAP_POPULATE",    VM::VMPageSize::Default,     VM::VMPrefault::Populate },
+        { "Default pages, touched",         VM::VMPageSize::Default,     VM::VMPrefault::Touch    },
+        { "Transparent huge pages",         VM::VMPageSize::Transparent, VM::VMPrefault::None     },
+        { "Transparent huge pages, touched",VM::VMPageSize::Transparent, VM::VMPrefault::Touch    },
+        { "2 MB huge pages, MAP_POPULATE",  VM::VMPageSize::Huge2MB,     VM::VMPrefault::Populate },
+    };
+
+    const PixelSumKernels& kernels = PixelSumKernels::Get(PixelSumSimdLevel::Auto);
+    VM::VirtualMemory virtualMemory;
+    for (const PageConfigCase& pageConfigCase : pageConfigCases)
+    {
+        VM::VMPageConfig pageConfig;
+        pageConfig.pageSize = pageConfigCase.pageSize;
+        pageConfig.prefault = pageConfigCase.prefault;
+
+        std::cout << pageConfigCase.name << ", VmAllocate() of the table" << std::endl;
+        VM::PageAllocation allocation;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            virtualMemory.VmAllocate(static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT * sizeof(uint32_t), &allocation, pageConfig);
+        }
+
+        // Planar summed area table rows, the row prefix added to the row above
+        uint32_t* table = static_cast<uint32_t*>(allocation.baseAddress);
+        std::cout << "First build of the table" << std::endl;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (int row = 0; row < IMAGE_HEIGHT; row++)
+            {
+                uint32_t* tableRow = table + static_cast<size_t>(row) * IMAGE_WIDTH;
+                kernels.prefixSumRow(image->GetPixelBufferPtr() + static_cast<size_t>(row) * IMAGE_WIDTH, tableRow, IMAGE_WIDTH);
+                if (row > 0) kernels.addRow(tableRow, tableRow - IMAGE_WIDTH, IMAGE_WIDTH);
+            }
+        }
+
+        std::cout << "Random table lookups, Lookups = " << queryCount << std::endl;
+        uint64_t checksum = 0;
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (uint32_t cornerOffset : cornerOffsets)
+            {
+                checksum += table[cornerOffset];
+            }
+        }
+        std::cout << "Checksum: " << checksum << std::endl;
+
+        virtualMemory.VmFree(&allocation);
+    }
+
+    delete image;
+}
+
+// Allocate and free throughput of the pools from 1 to the hardware threads, against the same pools behind a
+// global mutex
+void AllocatorThroughputPerformanceTest()
+{
+    const int opCount = 2000000;
+    const std::vector<size_t> allocationSizes = { 40, 64, 300, 512, 4000 };
+    const int hardwareThreadCount = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    std::vector<int> threadCounts = { 1, 2, 4 };
+    if (hardwareThreadCount > 4) threadCounts.push_back(hardwareThreadCount);
+
+    for (int mutexPass = 0; mutexPass < 2; mutexPass++)
+    {
+        for (int threadCount : threadCounts)
+        {
+            VM::VirtualMemoryPool virtualMemoryPool(s_ConcurrentPoolConfig());
+            std::mutex poolMutex;
+            const auto allocate = [&](size_t p_Size)
+            {
+                if (!mutexPass) return virtualMemoryPool.AllocateVirtualMemory(p_Size);
+
+                std::lock_guard<std::mutex> lock(poolMutex);
+                return virtualMemoryPool.AllocateVirtualMemory(p_Size);
+            };
+            const auto free = [&](void* p_Pointer)
+            {
+                if (!mutexPass) return virtualMemoryPool.FreeVirtualMemory(p_Pointer);
+
+                std::lock_guard<std::mutex> lock(poolMutex);
+                virtualMemoryPool.FreeVirtualMemory(p_Pointer);
+            };
+
+            std::cout << (mutexPass ? "Global mutex" : "Thread caches and lock-free stacks") << ", Threads = " << threadCount
+                      << ", Allocations and frees = " << opCount << " per thread" << std::endl;
+            {
+                DefaultResults results;
+                ScopedTimer Timer(results);
+
+                std::vector<std::thread> workers;
+                for (int thread = 1; thread < threadCount; thread++)
+                {
+                    workers.emplace_back([&, thread]() { s_AllocatorWorkload(1 + thread, opCount, allocationSizes, allocate, free); });
+                }
+
+                s_AllocatorWorkload(1, opCount, allocationSizes, allocate, free);
+
+                for (std::thread& worker : workers)
+                {
+                    worker.join();
+                }
+            }
+        }
+    }
+}
+
+// Allocate and free cost of a 4 KB pool as the pool count grows, with and without its thread caches. The other pools
+// are split below and above it, the routing is constant time.
+void PoolRoutingPerformanceTest()
+{
+    const int opCount = 2000000;
+    const size_t blockSize = VM_MEM_KB(4);
+    const int poolCounts[] = { 2, 8, 20 };
+
+    // 4096 blocks get a cache of 16 blocks per thread, 64 blocks are not cached
+    const size_t blockCounts[] = { 4096, 64 };
+    for (size_t blockCount : blockCounts)
+    {
+        for (int poolCount : poolCounts)
+        {
+            // Pools of 2^(12 - poolCount / 2) bytes and up, a block each but the 4 KB pool
+            std::vector<VM::VMPoolConfig> poolConfigs;
+            for (int pool = 0; pool < poolCount; pool++)
+            {
+                const size_t poolSize = size_t(1) << (12 - poolCount / 2 + pool);
+                poolConfigs.push_back({ poolSize, (poolSize == blockSize) ? blockCount * blockSize : poolSize });
+            }
+
+            VM::VirtualMemoryPool virtualMemoryPool(poolConfigs);
+
+            std::cout << "Pools = " << poolCount << ", Block size = " << blockSize << ", Blocks = " << blockCount
+                      << ((blockCount == 4096) ? " (thread cached)" : " (not thread cached)") << ", Allocations and frees = " << opCount << std::endl;
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            for (int op = 0; op < opCount; op++)
+            {
+                virtualMemoryPool.FreeVirtualMemory(virtualMemoryPool.AllocateVirtualMemory(blockSize));
+            }
+        }
+    }
+}
+
+// Dirty regions of a frame, overlapping each other, on the image border and partially outside the image
+static std::vector<PixelBufferCoords_i> s_DirtyRegions(int p_Width, int p_Height)
+{
+    std::vector<PixelBufferCoords_i> regions(6);
+    regions[0].x0 = 100;          regions[0].y0 = 200;           regions[0].x1 = 163;          regions[0].y1 = 263;
+    regions[1].x0 = 150;          regions[1].y0 = 250;           regions[1].x1 = 300;          regions[1].y1 = 270;  // Overlaps 0
+    regions[2].x0 = 164;          regions[2].y0 = 210;           regions[2].x1 = 170;          regions[2].y1 = 220;  // Touches 0
+    regions[3].x0 = -10;          regions[3].y0 = 0;             regions[3].x1 = 20;           regions[3].y1 = 5;
+    regions[4].x0 = p_Width - 30; regions[4].y0 = p_Height - 40; regions[4].x1 = p_Width + 30; regions[4].y1 = p_Height + 5;
+    regions[5].x0 = 2000;         regions[5].y0 = 1000;          regions[5].x1 = 2100;         regions[5].y1 = 1000;
+    return regions;
+}
+
+// Updating the dirty regions of an existing PixelSum must give exactly the tables of a PixelSum built from the
+// new frame, for every layout and accumulator.
+void UpdateRegionVsRebuildTest()
+{
+    const int width  = IMAGE_WIDTH - 5;
+    const int height = IMAGE_HEIGHT - 3;
+
+    Image* image = new Image(width, height);
+    s_FillDataWithContinousNumberStartingWith(width * height, image->GetPixelBufferPtr(), 0);
+
+    // New frame, the dirty regions get a different pattern with plenty of zeros
+    Image* frame = new Image(width, height);
+    memcpy(frame->GetPixelBufferPtr(), image->GetPixelBufferPtr(), static_cast<size_t>(width) * height);
+
+    const std::vector<PixelBufferCoords_i> dirtyRegions = s_DirtyRegions(width, height);
+    for (const PixelBufferCoords_i& r : dirtyRegions)
+    {
+        for (int y = std::max(r.y0, 0); y <= std::min(r.y1, height - 1); y++)
+        {
+            for (int x = std::max(r.x0, 0); x <= std::min(r.x1, width - 1); x++)
+            {
+                frame->GetPixelBufferPtr()[static_cast<size_t>(y) * width + x] = static_cast<unsigned char>((x * 7 + y * 3) % 5 ? x ^ y : 0);
+            }
+        }
+    }
+
+    // New pixels of a single region laid out for the region, partially outside the image
+    PixelBufferCoords_i singleRegion;
+    singleRegion.x0 = width - 8; singleRegion.y0 = 40; singleRegion.x1 = width + 8; singleRegion.y1 = 47;
+    std::vector<unsigned char> singleRegionPixels(17 * 8);
+    for (size_t i = 0; i < singleRegionPixels.size(); i++)
+    {
+        singleRegionPixels[i] = static_cast<unsigned char>(i * 13);
+        const int x = singleRegion.x0 + static_cast<int>(i % 17);
+        const int y = singleRegion.y0 + static_cast<int>(i / 17);
+        if (x < width) frame->GetPixelBufferPtr()[static_cast<size_t>(y) * width + x] = singleRegionPixels[i];
+    }
+
+    std::vector<PixelBufferCoords_i> regions(1000);
+    s_FillRandomRegions(regions, 512);
+    regions.push_back({ 0, 0, height - 1, width - 1 });
+
+    PixelSumConfig configs[5];
+    configs[1].tableLayout  = PixelSumTableLayout::Interleaved;
+    configs[2].accumulator  = PixelSumAccumulator::Wide64;
+    configs[3].tablePadding = PixelSumTablePadding::Padded;
+    configs[4].threadCount  = 3;
+
+    for (const PixelSumConfig& config : configs)
+    {
+        PixelSum* pixelSumRebuilt = new PixelSum(frame->GetPixelBufferPtr(), width, height, config);
+
+        PixelSum* pixelSumUpdated = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+        EXPECT_EQ(pixelSumUpdated->UpdateRegions(dirtyRegions.data(), dirtyRegions.size(), frame->GetPixelBufferPtr()), true, "Dirty regions applied");
+        EXPECT_EQ(pixelSumUpdated->UpdateRegion(singleRegion.x0, singleRegion.y0, singleRegion.x1, singleRegion.y1, singleRegionPixels.data()), true,
+                  "Single region applied");
+
+        bool isIdentical = true;
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            isIdentical &= (pixelSumUpdated->GetPixelSum64(r.x0, r.y0, r.x1, r.y1) == pixelSumRebuilt->GetPixelSum64(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (pixelSumUpdated->GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1) == pixelSumRebuilt->GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1));
+        }
+        EXPECT_EQ(isIdentical, true, "Updated tables match the rebuilt tables");
+
+        EXPECT_EQ(pixelSumUpdated->UpdateRegion(width, 0, width + 10, 10, singleRegionPixels.data()), false, "Region outside the image");
+
+        delete pixelSumUpdated;
+        delete pixelSumRebuilt;
+    }
+
+    delete frame;
+    delete image;
+}
+
+// Readers of a stream keep querying their snapshot while the next frames are built and published, every snapshot
+// must show one complete frame.
+void StreamSnapshotTest()
+{
+    const unsigned char frameValues[] = { 0, 5, 9 };
+    std::vector<Image*> frames;
+    for (unsigned char frameValue : frameValues)
+    {
+        frames.push_back(new Image(IMAGE_WIDTH, IMAGE_HEIGHT));
+        memset(frames.back()->GetPixelBufferPtr(), frameValue, static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT);
+    }
+
+    PixelSumStream* stream = new PixelSumStream(IMAGE_WIDTH, IMAGE_HEIGHT);
+    EXPECT_EQ(static_cast<bool>(stream->Acquire()), false, "No snapshot before the first frame");
+
+    // Snapshots of the older frames stay valid while the newer frames are published
+    std::vector<PixelSumStream::Snapshot> snapshots;
+    for (size_t frame = 0; frame < frames.size(); frame++)
+    {
+        const uint64_t frameId = stream->SubmitFrame(frames[frame]->GetPixelBufferPtr());
+        stream->WaitForFrame(frameId);
+        snapshots.push_back(stream->Acquire());
+
+        EXPECT_EQ(snapshots.back().FrameId(), frameId, "Snapshot of the published frame");
+    }
+
+    for (size_t frame = 0; frame < frames.size(); frame++)
+    {
+        EXPECT_EQ(snapshots[frame]->GetPixelSum64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM),
+                  static_cast<uint64_t>(frameValues[frame]) * IMAGE_WIDTH * IMAGE_HEIGHT, "Snapshot keeps its frame");
+    }
+    snapshots.clear();
+
+    // Concurrent readers, the average of the whole image and of the last rows must be the value of the frame
+    std::vector<unsigned char> frameValueById(64, 0);
+    std::atomic<bool> isStopping(false);
+    std::atomic<int> inconsistentSnapshots(0);
+    std::atomic<int> snapshotCount(0);
+
+    auto reader = [&]()
+    {
+        while (!isStopping.load())
+        {
+            PixelSumStream::Snapshot snapshot = stream->Acquire();
+            const double expectedAverage = frameValueById[snapshot.FrameId()];
+            if (snapshot->GetPixelAverage(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM) != expectedAverage ||
+                snapshot->GetPixelAverage(IMAGE_RIGHT - 15, IMAGE_BOTTOM - 15, IMAGE_RIGHT, IMAGE_BOTTOM) != expectedAverage ||
+                snapshot->GetNonZeroCount(0, IMAGE_BOTTOM, IMAGE_RIGHT, IMAGE_BOTTOM) != (expectedAverage ? IMAGE_WIDTH : 0))
+            {
+                inconsistentSnapshots++;
+            }
+            snapshotCount++;
+        }
+    };
+
+    for (int i = 1; i <= 3; i++) frameValueById[i] = frameValues[i - 1];
+
+    std::thread readers[] = { std::thread(reader), std::thread(reader) };
+    for (size_t frame = 0; frame < 30; frame++)
+    {
+        // Frames 1 to 3 were published above
+        const size_t frameIndex = frame % frames.size();
+        frameValueById[4 + frame] = frameValues[frameIndex];
+        stream->WaitForFrame(stream->SubmitFrame(frames[frameIndex]->GetPixelBufferPtr()));
+    }
+
+    isStopping = true;
+    for (std::thread& thread : readers) thread.join();
+
+    EXPECT_EQ(inconsistentSnapshots.load(), 0, "Readers never see a partially built frame");
+    EXPECT_EQ(snapshotCount.load() > 0, true, "Readers query while frames are published");
+
+    delete stream;
+    for (Image* frame : frames) delete frame;
+}
+
+// Rows pushed one at a time must answer the same queries as a PixelSum of the whole image for the rows still in
+// the ring, windows reaching rows which already left the ring are clamped to the ring.
+void ScanlineVsPixelSumTest()
+{
+    const int rowCapacity = 1000;
+
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 3);
+    PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    PixelSumScanline* scanline = new PixelSumScanline(IMAGE_WIDTH, rowCapacity);
+    EXPECT_EQ(scanline->GetPixelSum(0, 0, 10, 10), 0u, "Empty stream");
+
+    std::vector<PixelBufferCoords_i> regions(1000);
+    s_FillRandomRegions(regions, 256);
+
+    bool isIdentical = true;
+    for (int row = 0; row < IMAGE_HEIGHT; row++)
+    {
+        scanline->PushRow(image->GetPixelBufferPtr() + static_cast<size_t>(row) * IMAGE_WIDTH);
+
+        // Check the queries every few hundred rows, the regions are moved into the rows of the ring
+        if (row % 700 != 0 && row != IMAGE_BOTTOM) continue;
+
+        const int64_t firstRow = scanline->FirstRow();
+        const int64_t rowCount = scanline->LastRow() - firstRow + 1;
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            const int y0 = static_cast<int>(firstRow + (std::abs(r.y0) % rowCount));
+            const int y1 = std::min(y0 + std::abs(r.y1 - r.y0), static_cast<int>(scanline->LastRow()));
+
+            isIdentical &= (scanline->GetPixelSum(r.x0, y0, r.x1, y1) == pixelSum->GetPixelSum(r.x0, y0, r.x1, y1));
+            isIdentical &= (scanline->GetPixelAverage(r.x0, y0, r.x1, y1) == pixelSum->GetPixelAverage(r.x0, y0, r.x1, y1));
+            isIdentical &= (scanline->GetNonZeroCount(r.x0, y0, r.x1, y1) == pixelSum->GetNonZeroCount(r.x0, y0, r.x1, y1));
+        }
+    }
+    EXPECT_EQ(isIdentical, true, "Scanline queries match PixelSum");
+
+    EXPECT_EQ(scanline->FirstRow(), static_cast<int64_t>(IMAGE_HEIGHT - rowCapacity), "Oldest row in the ring");
+    EXPECT_EQ(scanline->GetPixelSum(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM),
+              pixelSum->GetPixelSum(0, IMAGE_HEIGHT - rowCapacity, IMAGE_RIGHT, IMAGE_BOTTOM), "Rows which left the ring are clamped");
+    EXPECT_EQ(scanline->GetPixelSum(0, 0, IMAGE_RIGHT, IMAGE_HEIGHT - rowCapacity - 1), 0u, "Window of rows which left the ring");
+
+    delete scanline;
+    delete pixelSum;
+    delete image;
+}
+
+// A long stream of saturated rows, the running sums wrap around many times while the window sums stay exact.
+void ScanlineEndlessStreamTest()
+{
+    const int width = 64;
+    const int rowCapacity = 16;
+    std::vector<unsigned char> row(width, 255);
+
+    PixelSumScanline* scanline = new PixelSumScanline(width, rowCapacity);
+    for (int i = 0; i < 1000000; i++)
+    {
+        row[i % width] = static_cast<unsigned char>(i & 1 ? 255 : 0);
+        scanline->PushRow(row.data());
+        row[i % width] = 255;
+    }
+
+    // The last row has a zero at column 63 (i = 999999 is odd, the pixel of i = 999998 is 0 at column 62)
+    const int64_t lastRow = scanline->LastRow();
+    EXPECT_EQ(lastRow, static_cast<int64_t>(999999), "Row index of the last row");
+    EXPECT_EQ(scanline->GetPixelSum(0, lastRow - 1, width - 1, lastRow), static_cast<unsigned int>((2 * width - 1) * 255), "Window sum after wraparound");
+    EXPECT_EQ(scanline->GetNonZeroCount(0, lastRow - rowCapacity + 1, width - 1, lastRow), rowCapacity * width - rowCapacity / 2,
+              "Non-zero count after wraparound");
+
+    delete scanline;
+}
+
+// Lazy tables answer like the eager ones and are built only as far as the queries reach. The pixel buffer is changed
+// behind the back of the lazy PixelSum (not allowed in real use) to detect which rows were built before.
+void LazyBuildTest()
+{
+    const int width  = IMAGE_WIDTH - 5;
+    const int height = IMAGE_HEIGHT - 3;
+    const int bandHeight = 300;
+
+    Image* image = new Image(width, height);
+    s_FillDataWithContinousNumberStartingWith(width * height, image->GetPixelBufferPtr(), 0);
+
+    Image* changedImage = new Image(width, height);
+    memcpy(changedImage->GetPixelBufferPtr(), image->GetPixelBufferPtr(), static_cast<size_t>(width) * height);
+    memset(changedImage->GetPixelBufferPtr() + static_cast<size_t>(2 * bandHeight) * width, 0, static_cast<size_t>(height - 2 * bandHeight) * width);
+
+    PixelSum* pixelSumEager = new PixelSum(image->GetPixelBufferPtr(), width, height);
+    PixelSum* pixelSumChanged = new PixelSum(changedImage->GetPixelBufferPtr(), width, height);
+
+    PixelSumConfig configs[3];
+    configs[1].accumulator  = PixelSumAccumulator::Wide64;
+    configs[2].tablePadding = PixelSumTablePadding::Padded;
+
+    for (PixelSumConfig& config : configs)
+    {
+        config.buildTiming = PixelSumBuildTiming::Lazy;
+        config.tableLayout = PixelSumTableLayout::Interleaved; // Ignored, lazy tables are planar
+
+        Image* lazyImage = new Image(width, height);
+        memcpy(lazyImage->GetPixelBufferPtr(), image->GetPixelBufferPtr(), static_cast<size_t>(width) * height);
+        PixelSum* pixelSumLazy = new PixelSum(lazyImage->GetPixelBufferPtr(), width, height, config);
+
+        // Header band, pixel sums only
+        EXPECT_EQ(pixelSumLazy->GetPixelSum64(0, 0, width - 1, bandHeight - 1), pixelSumEager->GetPixelSum64(0, 0, width - 1, bandHeight - 1),
+                  "Pixel sum of the header band");
+        EXPECT_EQ(pixelSumLazy->GetPixelAverage(10, 20, 30, bandHeight - 1), pixelSumEager->GetPixelAverage(10, 20, 30, bandHeight - 1),
+                  "Pixel average of the header band");
+
+        // The rows below the band and the non-zero table are built from the changed pixels
+        memcpy(lazyImage->GetPixelBufferPtr(), changedImage->GetPixelBufferPtr(), static_cast<size_t>(width) * height);
+
+        EXPECT_EQ(pixelSumLazy->GetNonZeroCount64(0, 0, width - 1, height - 1), pixelSumChanged->GetNonZeroCount64(0, 0, width - 1, height - 1),
+                  "Non-zero table built on the first non-zero query");
+        EXPECT_EQ(pixelSumLazy->GetPixelSum64(0, 0, width - 1, height - 1), pixelSumChanged->GetPixelSum64(0, 0, width - 1, height - 1),
+                  "Pixel sum table extended on demand");
+
+        PixelSum pixelSumCopy(*pixelSumLazy);
+        EXPECT_EQ(pixelSumCopy.GetNonZeroAverage(0, 5, width - 1, height - 1), pixelSumChanged->GetNonZeroAverage(0, 5, width - 1, height - 1),
+                  "Copy of a lazy PixelSum");
+
+        delete pixelSumLazy;
+        delete lazyImage;
+    }
+
+    delete pixelSumChanged;
+    delete pixelSumEager;
+    delete changedImage;
+    delete image;
+}
+
+// Several threads query a lazy PixelSum at the same time, the tables are extended while other threads read them.
+void LazyBuildConcurrentReadersTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 7);
+
+    PixelSum* pixelSumEager = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    PixelSumConfig config;
+    config.buildTiming = PixelSumBuildTiming::Lazy;
+    PixelSum* pixelSumLazy = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+
+    std::vector<PixelBufferCoords_i> regions(20000);
+    s_FillRandomRegions(regions, 64);
+
+    // Every thread walks down the image in a different order
+    std::atomic<int> mismatchCount(0);
+    auto reader = [&](int p_Thread)
+    {
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const PixelBufferCoords_i& r = regions[(i * (2 * p_Thread + 1)) % regions.size()];
+            if (pixelSumLazy->GetPixelSum(r.x0, r.y0, r.x1, r.y1) != pixelSumEager->GetPixelSum(r.x0, r.y0, r.x1, r.y1) ||
+                pixelSumLazy->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1) != pixelSumEager->GetNonZeroCount(r.x0, r.y0, r.x1, r.y1))
+            {
+                mismatchCount++;
+            }
+        }
+    };
+
+    std::thread readers[] = { std::thread(reader, 0), std::thread(reader, 1), std::thread(reader, 2), std::thread(reader, 3) };
+    for (std::thread& thread : readers) thread.join();
+
+    EXPECT_EQ(mismatchCount.load(), 0, "Concurrent readers of lazy tables");
+
+    delete pixelSumLazy;
+    delete pixelSumEager;
+    delete image;
+}
+
+static PixelSum s_MakePixelSum(const unsigned char* p_Buffer, const PixelSumConfig& p_Config)
+{
+    PixelSum pixelSum(p_Buffer, IMAGE_WIDTH, IMAGE_HEIGHT, p_Config);
+    return pixelSum;
+}
+
+// Moving a PixelSum, e.g. returning it from a function or growing a vector, transfers the tables without allocation.
+void MoveSemanticsTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 1);
+
+    PixelSum* pixelSumReference = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT);
+    const uint64_t pixelSum = pixelSumReference->GetPixelSum64(3, 5, IMAGE_RIGHT, IMAGE_BOTTOM);
+    const uint64_t nonZeroCount = pixelSumReference->GetNonZeroCount64(3, 5, IMAGE_RIGHT, IMAGE_BOTTOM);
+
+    VM::MemoryAllocator& memoryAllocator = VM::MemoryAllocator::GetInstance();
+
+    PixelSumConfig configs[2];
+    configs[1].tableLayout = PixelSumTableLayout::Interleaved;
+    for (const PixelSumConfig& config : configs)
+    {
+        std::vector<PixelSum> pixelSums;
+        pixelSums.push_back(s_MakePixelSum(image->GetPixelBufferPtr(), config));
+        const size_t inUsedMemory = memoryAllocator.InUsedMemory();
+
+        // The vector reallocates and moves its elements
+        pixelSums.emplace_back();
+        pixelSums.emplace_back();
+        EXPECT_EQ(memoryAllocator.InUsedMemory(), inUsedMemory, "Vector growth moves the tables");
+        EXPECT_EQ(pixelSums[0].GetPixelSum64(3, 5, IMAGE_RIGHT, IMAGE_BOTTOM), pixelSum, "Moved pixel sum table");
+        EXPECT_EQ(pixelSums[0].GetNonZeroCount64(3, 5, IMAGE_RIGHT, IMAGE_BOTTOM), nonZeroCount, "Moved non-zero table");
+
+        pixelSums[2] = std::move(pixelSums[0]);
+        EXPECT_EQ(memoryAllocator.InUsedMemory(), inUsedMemory, "Move assignment");
+        EXPECT_EQ(pixelSums[2].GetPixelSum64(3, 5, IMAGE_RIGHT, IMAGE_BOTTOM), pixelSum, "Move assigned pixel sum table");
+
+        pixelSums.clear();
+        EXPECT_EQ(memoryAllocator.InUsedMemory() < inUsedMemory, true, "Tables freed once");
+    }
+
+    delete pixelSumReference;
+    delete image;
+}
+
+// Copies of a copy-on-write PixelSum share the tables until one of them is updated.
+void CopyOnWriteTablesTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+    s_FillDataWithContinousNumberStartingWith(IMAGE_WIDTH * IMAGE_HEIGHT, image->GetPixelBufferPtr(), 1);
+
+    VM::MemoryAllocator& memoryAllocator = VM::MemoryAllocator::GetInstance();
+
+    PixelSumConfig configs[3];
+    configs[1].accumulator = PixelSumAccumulator::Wide64;
+    configs[2].buildTiming = PixelSumBuildTiming::Lazy;
+
+    for (PixelSumConfig& config : configs)
+    {
+        config.tableSharing = PixelSumTableSharing::CopyOnWrite;
+
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), IMAGE_WIDTH, IMAGE_HEIGHT, config);
+        const uint64_t sum = pixelSum->GetPixelSum64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM);
+        const size_t inUsedMemory = memoryAllocator.InUsedMemory();
+
+        PixelSum* pixelSumCopy = new PixelSum(*pixelSum);
+        PixelSum pixelSumAssigned;
+        pixelSumAssigned = *pixelSumCopy;
+        EXPECT_EQ(memoryAllocator.InUsedMemory(), inUsedMemory, "Copies share the tables");
+        EXPECT_EQ(pixelSumCopy->GetNonZeroCount64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM),
+                  pixelSum->GetNonZeroCount64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM), "Shared non-zero table");
+
+        // The updated copy gets its own tables, the others keep the original frame
+        std::vector<unsigned char> blackPixels(16 * 16, 0);
+        pixelSumCopy->UpdateRegion(0, 0, 15, 15, blackPixels.data());
+        EXPECT_EQ(memoryAllocator.InUsedMemory() > inUsedMemory, true, "Update detaches the tables");
+        EXPECT_EQ(pixelSum->GetPixelSum64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM), sum, "Original keeps its tables");
+        EXPECT_EQ(pixelSumAssigned.GetPixelSum64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM), sum, "Assigned copy keeps its tables");
+        EXPECT_EQ(pixelSumCopy->GetPixelSum64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM),
+                  sum - pixelSum->GetPixelSum64(0, 0, 15, 15), "Updated copy");
+
+        // The last owner of the shared tables frees them
+        delete pixelSum;
+        EXPECT_EQ(pixelSumAssigned.GetPixelSum64(0, 0, IMAGE_RIGHT, IMAGE_BOTTOM), sum, "Shared tables outlive the original");
+
+        delete pixelSumCopy;
+    }
+
+    delete image;
+}
+
+// Region variance from the squared pixel table against a naive scan, for every table configuration, through the
+// single, stats and batched queries, and after a dirty region update.
+void VarianceVsNaiveTest()
+{
+    const int width  = 1021;
+    const int height = 603;
+
+    Image* image = new Image(width, height);
+    std::srand(4321);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    // The changed frame differs from the image inside the dirty regions only
+    const std::vector<PixelBufferCoords_i> dirtyRegions = s_DirtyRegions(width, height);
+    Image* changedImage = new Image(width, height);
+    memcpy(changedImage->GetPixelBufferPtr(), image->GetPixelBufferPtr(), static_cast<size_t>(width) * height);
+    for (const PixelBufferCoords_i& r : dirtyRegions)
+    {
+        for (int y = std::max(r.y0, 0); y <= std::min(r.y1, height - 1); y++)
+        {
+            for (int x = std::max(r.x0, 0); x <= std::min(r.x1, width - 1); x++)
+            {
+                changedImage->GetPixelBufferPtr()[static_cast<size_t>(y) * width + x] = static_cast<unsigned char>(std::rand());
+            }
+        }
+    }
+
+    std::vector<PixelBufferCoords_i> regions(2000);
+    for (PixelBufferCoords_i& region : regions)
+    {
+        region.x0 = (std::rand() % (width + 64)) - 32;
+        region.y0 = (std::rand() % (height + 64)) - 32;
+        region.x1 = region.x0 + (std::rand() % 300) - 40;
+        region.y1 = region.y0 + (std::rand() % 300) - 40;
+    }
+    regions[0] = PixelBufferCoords_i(0, 0, height - 1, width - 1);
+    regions[1] = PixelBufferCoords_i(-5, -5, height + 5, width + 5);
+
+    std::vector<uint64_t> naiveSquaredSums(regions.size());
+    std::vector<double> naiveVariances(regions.size());
+    std::vector<uint64_t> changedSquaredSums(regions.size());
+    std::vector<double> changedVariances(regions.size());
+    for (size_t i = 0; i < regions.size(); i++)
+    {
+        s_NaiveSquaredSumAndVariance(image->GetPixelBufferPtr(), width, height, regions[i], naiveSquaredSums[i], naiveVariances[i]);
+        s_NaiveSquaredSumAndVariance(changedImage->GetPixelBufferPtr(), width, height, regions[i], changedSquaredSums[i], changedVariances[i]);
+    }
+
+    std::vector<double> variances(regions.size());
+    std::vector<double> stdDevs(regions.size());
+    PixelSumBatchOutput output;
+    output.pixelVariances = variances.data();
+    output.pixelStdDevs   = stdDevs.data();
+
+    PixelSumConfig baseConfig;
+    baseConfig.squaredSums = PixelSumSquaredSums::Enabled;
+    baseConfig.threadCount = 4; // Two bands, the squared table gets its band carries
+
+    s_ForEachPixelSumConfig(baseConfig, CONFIG_ALL, [&](const PixelSumConfig& config)
+    {
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+        pixelSum->GetRegionsBatch(regions.data(), regions.size(), output);
+
+        bool isSquaredSumIdentical = true;
+        bool isVarianceIdentical = true;
+        bool isBatchIdentical = true;
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const PixelBufferCoords_i& r = regions[i];
+            isSquaredSumIdentical &= (pixelSum->GetSquaredPixelSum(r.x0, r.y0, r.x1, r.y1) == naiveSquaredSums[i]);
+            isVarianceIdentical &= (pixelSum->GetPixelVariance(r.x0, r.y0, r.x1, r.y1) == naiveVariances[i]);
+            isVarianceIdentical &= (pixelSum->GetPixelStdDev(r.x0, r.y0, r.x1, r.y1) == std::sqrt(naiveVariances[i]));
+            isVarianceIdentical &= (pixelSum->GetRegionStats(r.x0, r.y0, r.x1, r.y1).pixelVariance == naiveVariances[i]);
+            isBatchIdentical &= (variances[i] == naiveVariances[i]) && (stdDevs[i] == std::sqrt(naiveVariances[i]));
+        }
+
+        EXPECT_EQ(isSquaredSumIdentical, true, "Squared pixel sums match the naive scan");
+        EXPECT_EQ(isVarianceIdentical, true, "Variances match the naive scan");
+        EXPECT_EQ(isBatchIdentical, true, "Batched variances match the naive scan");
+
+        // The copy shares or copies the squared table, the update patches it
+        PixelSum pixelSumCopy(*pixelSum);
+        pixelSumCopy.UpdateRegions(dirtyRegions.data(), dirtyRegions.size(), changedImage->GetPixelBufferPtr());
+        for (const PixelBufferCoords_i& r : dirtyRegions)
+        {
+            std::vector<unsigned char> newPixels;
+            const int x0 = std::max(r.x0, 0), x1 = std::min(r.x1, width - 1), y0 = std::max(r.y0, 0), y1 = std::min(r.y1, height - 1);
+            for (int y = y0; y <= y1; y++)
+            {
+                for (int x = x0; x <= x1; x++) newPixels.push_back(changedImage->GetPixelBufferPtr()[static_cast<size_t>(y) * width + x]);
+            }
+            if (!newPixels.empty()) pixelSum->UpdateRegion(x0, y0, x1, y1, newPixels.data());
+        }
+
+        bool isUpdateIdentical = true;
+        for (size_t i = 0; i < regions.size(); i++)
+        {
+            const PixelBufferCoords_i& r = regions[i];
+            isUpdateIdentical &= (pixelSumCopy.GetSquaredPixelSum(r.x0, r.y0, r.x1, r.y1) == changedSquaredSums[i]);
+            isUpdateIdentical &= (pixelSumCopy.GetPixelVariance(r.x0, r.y0, r.x1, r.y1) == changedVariances[i]);
+            isUpdateIdentical &= (pixelSum->GetPixelVariance(r.x0, r.y0, r.x1, r.y1) == changedVariances[i]);
+        }
+        EXPECT_EQ(isUpdateIdentical, true, "Variances after the dirty region update");
+
+        delete pixelSum;
+    });
+
+    // Without the squared pixel table the variance is not available
+    PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height);
+    EXPECT_EQ(pixelSum->GetPixelVariance(0, 0, width - 1, height - 1), 0.0, "Variance without the squared pixel table");
+    EXPECT_EQ(pixelSum->GetSquaredPixelSum(0, 0, width - 1, height - 1), 0u, "Squared sum without the squared pixel table");
+
+    // Constant regions have no variance
+    memset(image->GetPixelBufferPtr(), 200, static_cast<size_t>(width) * height);
+    PixelSumConfig config;
+    config.squaredSums = PixelSumSquaredSums::Enabled;
+    PixelSum* pixelSumConstant = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+    EXPECT_EQ(pixelSumConstant->GetPixelVariance(3, 4, 500, 600), 0.0, "Variance of a constant region");
+    EXPECT_EQ(pixelSumConstant->GetPixelStdDev(0, 0, width - 1, height - 1), 0.0, "Standard deviation of a constant image");
+
+    delete pixelSumConstant;
+    delete pixelSum;
+    delete changedImage;
+    delete image;
+}
+
+// Every channel of an interleaved RGB / RGBA image must match a PixelSum built from the de-interleaved plane of that
+// channel, for every SIMD level. The odd width leaves a scalar tail after the vector loops.
+void MultiChannelVsPixelSumTest()
+{
+    const int width  = 641;
+    const int height = 479;
+
+    std::srand(2468);
+    std::vector<PixelBufferCoords_i> regions(2000);
+    for (PixelBufferCoords_i& region : regions)
+    {
+        region.x0 = (std::rand() % (width + 64)) - 32;
+        region.y0 = (std::rand() % (height + 64)) - 32;
+        region.x1 = region.x0 + (std::rand() % 300) - 40;
+        region.y1 = region.y0 + (std::rand() % 300) - 40;
+    }
+    regions[0] = PixelBufferCoords_i(0, 0, height - 1, width - 1);
+    regions[1] = PixelBufferCoords_i(-5, -5, height + 5, width + 5);
+    regions[2] = PixelBufferCoords_i(height + 1, width + 1, height + 9, width + 9);
+
+    const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::Scalar, PixelSumSimdLevel::SSE2, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
+    const int channelCounts[] = { 3, 4 };
+    for (int channelCount : channelCounts)
+    {
+        std::vector<unsigned char> interleaved(static_cast<size_t>(width) * height * channelCount);
+        for (unsigned char& value : interleaved) value = static_cast<unsigned char>(std::rand());
+
+        std::vector<PixelSum*> planeSums;
+        std::vector<unsigned char> plane(static_cast<size_t>(width) * height);
+        for (int channel = 0; channel < channelCount; channel++)
+        {
+            for (size_t i = 0; i < plane.size(); i++) plane[i] = interleaved[i * channelCount + channel];
+            planeSums.push_back(new PixelSum(plane.data(), width, height));
+        }
+
+        for (PixelSumSimdLevel simdLevel : simdLevels)
+        {
+            PixelSumMultiChannel multiChannel(interleaved.data(), width, height, channelCount, simdLevel);
+
+            bool isSumIdentical = true;
+            bool isStatsIdentical = true;
+            for (const PixelBufferCoords_i& r : regions)
+            {
+                const PixelSumChannelStats stats = multiChannel.GetRegionStats(r.x0, r.y0, r.x1, r.y1);
+                for (int channel = 0; channel < channelCount; channel++)
+                {
+                    const unsigned int expectedSum = planeSums[channel]->GetPixelSum(r.x0, r.y0, r.x1, r.y1);
+                    const double expectedAverage = planeSums[channel]->GetPixelAverage(r.x0, r.y0, r.x1, r.y1);
+                    isSumIdentical &= (multiChannel.GetPixelSum(channel, r.x0, r.y0, r.x1, r.y1) == expectedSum);
+                    isSumIdentical &= (multiChannel.GetPixelAverage(channel, r.x0, r.y0, r.x1, r.y1) == expectedAverage);
+                    isStatsIdentical &= (stats.pixelSums[channel] == expectedSum) && (stats.pixelAverages[channel] == expectedAverage);
+                }
+                for (int channel = channelCount; channel < 4; channel++)
+                {
+                    isStatsIdentical &= (stats.pixelSums[channel] == 0) && (stats.pixelAverages[channel] == 0.0);
+                }
+            }
+
+            std::cout << "Kernel: " << PixelSumKernels::Get(simdLevel).name << ", Channels: " << channelCount << std::endl;
+            EXPECT_EQ(isSumIdentical, true, "Channel sums match the per plane PixelSum");
+            EXPECT_EQ(isStatsIdentical, true, "All channel stats match the per plane PixelSum");
+            EXPECT_EQ(multiChannel.GetPixelSum(channelCount, 0, 0, width - 1, height - 1), 0u, "Channel outside the channel count");
+            EXPECT_EQ(multiChannel.GetPixelSum(-1, 0, 0, width - 1, height - 1), 0u, "Negative channel");
+        }
+
+        // Rebuild from the next frame reuses the table
+        for (unsigned char& value : interleaved) value = static_cast<unsigned char>(255 - value);
+        PixelSumMultiChannel multiChannel(interleaved.data(), width, height, channelCount);
+        multiChannel.Rebuild(interleaved.data());
+        const uint64_t fullImageSum = static_cast<uint64_t>(width) * height;
+        bool isRebuildIdentical = true;
+        for (int channel = 0; channel < channelCount; channel++)
+        {
+            isRebuildIdentical &= (multiChannel.GetPixelSum(channel, 0, 0, width - 1, height - 1) + planeSums[channel]->GetPixelSum(0, 0, width - 1, height - 1) == fullImageSum * 255);
+        }
+        EXPECT_EQ(isRebuildIdentical, true, "Rebuild from the inverted frame");
+
+        for (PixelSum* planeSum : planeSums) delete planeSum;
+    }
+
+    // Only 3 and 4 channels are supported
+    std::vector<unsigned char> grey(static_cast<size_t>(width) * height, 7);
+    PixelSumMultiChannel greyMultiChannel(grey.data(), width, height, 1);
+    EXPECT_EQ(greyMultiChannel.GetPixelSum(0, 0, 0, width - 1, height - 1), 0u, "Unsupported channel count");
+    EXPECT_EQ(greyMultiChannel.Rebuild(grey.data()), false, "Rebuild with an unsupported channel count");
+}
+
+// Rotated rectangle sums must match a naive scan for every configuration, including rectangles crossing or outside
+// the image border, after a dirty region update and with three build bands.
+void RotatedVsNaiveTest()
+{
+    const int width  = 1021;
+    const int height = 803;
+
+    Image* image = new Image(width, height);
+    std::srand(8642);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    const std::vector<PixelBufferCoords_i> dirtyRegions = s_DirtyRegions(width, height);
+    Image* changedImage = new Image(width, height);
+    memcpy(changedImage->GetPixelBufferPtr(), image->GetPixelBufferPtr(), static_cast<size_t>(width) * height);
+    for (const PixelBufferCoords_i& r : dirtyRegions)
+    {
+        for (int y = std::max(r.y0, 0); y <= std::min(r.y1, height - 1); y++)
+        {
+            for (int x = std::max(r.x0, 0); x <= std::min(r.x1, width - 1); x++)
+            {
+                changedImage->GetPixelBufferPtr()[static_cast<size_t>(y) * width + x] = static_cast<unsigned char>(std::rand());
+            }
+        }
+    }
+
+    std::vector<TiltedRect> rects(3000);
+    for (TiltedRect& rect : rects)
+    {
+        rect.x      = (std::rand() % (width + 160)) - 80;
+        rect.y      = (std::rand() % (height + 160)) - 120;
+        rect.width  = 1 + std::rand() % 80;
+        rect.height = 1 + std::rand() % 80;
+    }
+    rects[0] = { 0, 0, 1, 1 };
+    rects[1] = { width - 1, height - 1, 1, 1 };
+    rects[2] = { width / 2, -width, width + height, width + height }; // Covers the whole image
+    rects[3] = { -200, height / 2, 50, 50 };                          // Left of the image
+    rects[4] = { width + 10, height / 2, 30, 5 };                     // Right of the image
+    rects[5] = { width / 3, height - 3, 200, 300 };                   // Mostly below the image
+
+    std::vector<unsigned int> naiveSums(rects.size());
+    std::vector<unsigned int> changedSums(rects.size());
+    for (size_t i = 0; i < rects.size(); i++)
+    {
+        naiveSums[i] = s_NaiveRotatedSum(image->GetPixelBufferPtr(), width, height, rects[i]);
+        changedSums[i] = s_NaiveRotatedSum(changedImage->GetPixelBufferPtr(), width, height, rects[i]);
+    }
+
+    PixelSumConfig baseConfig;
+    baseConfig.rotatedSums = PixelSumRotatedSums::Enabled;
+    baseConfig.threadCount = 4; // Three bands, the carry of the last band goes through the second one
+
+    s_ForEachPixelSumConfig(baseConfig, CONFIG_ALL, [&](const PixelSumConfig& config)
+    {
+        PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+        bool isRotatedIdentical = true;
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            const TiltedRect& r = rects[i];
+            isRotatedIdentical &= (pixelSum->GetRotatedPixelSum(r.x, r.y, r.width, r.height) == naiveSums[i]);
+        }
+
+        EXPECT_EQ(isRotatedIdentical, true, "Rotated rectangle sums match the naive scan");
+        EXPECT_EQ(pixelSum->GetRotatedPixelSum(10, 10, 0, 5), 0u, "Rotated rectangle without width");
+        EXPECT_EQ(pixelSum->GetRotatedPixelSum(10, 10, 5, -1), 0u, "Rotated rectangle with a negative height");
+
+        // The copy shares or copies the rotated tables, the update patches the copy only
+        PixelSum pixelSumCopy(*pixelSum);
+        pixelSumCopy.UpdateRegions(dirtyRegions.data(), dirtyRegions.size(), changedImage->GetPixelBufferPtr());
+
+        bool isUpdateIdentical = true;
+        bool isSourceUnchanged = true;
+        for (size_t i = 0; i < rects.size(); i++)
+        {
+            const TiltedRect& r = rects[i];
+            isUpdateIdentical &= (pixelSumCopy.GetRotatedPixelSum(r.x, r.y, r.width, r.height) == changedSums[i]);
+            isSourceUnchanged &= (pixelSum->GetRotatedPixelSum(r.x, r.y, r.width, r.height) == naiveSums[i]);
+        }
+        EXPECT_EQ(isUpdateIdentical, true, "Rotated rectangle sums after the dirty region update");
+        EXPECT_EQ(isSourceUnchanged, true, "Rotated rectangle sums of the source of the updated copy");
+
+        delete pixelSum;
+    });
+
+    // Without the rotated tables the tilted queries are not available
+    PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height);
+    EXPECT_EQ(pixelSum->GetRotatedPixelSum(width / 2, 0, 10, 10), 0u, "Rotated sum without the rotated tables");
+
+    delete pixelSum;
+    delete changedImage;
+    delete image;
+}
+
+// Box filter outputs must match the averages of the individual queries for every configuration, with windows on
+// the image border, larger than the image and with a stride.
+void BoxFilterVsAverageTest()
+{
+    const int width  = 1021;
+    const int height = 803;
+
+    Image* image = new Image(width, height);
+    std::srand(2468);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    struct BoxFilterCase { int windowWidth, windowHeight, stride; };
+    const BoxFilterCase cases[] = { { 1, 1, 1 }, { 7, 5, 1 }, { 32, 17, 1 }, { width + 500, 3, 1 }, { 7, 5, 3 }, { 40, height + 9, 16 } };
+
+    PixelSumConfig baseConfig;
+    baseConfig.threadCount = 4;
+
+    PixelSum referencePixelSum(image->GetPixelBufferPtr(), width, height);
+
+    for (const BoxFilterCase& boxCase : cases)
+    {
+        // Expected outputs from the individual queries
+        const int outputWidth = (width - 1) / boxCase.stride + 1;
+        const int outputHeight = (height - 1) / boxCase.stride + 1;
+        const size_t outputCount = static_cast<size_t>(outputWidth) * outputHeight;
+        const uint64_t n = static_cast<uint64_t>(boxCase.windowWidth) * boxCase.windowHeight;
+
+        std::vector<float> expectedAverages(outputCount);
+        std::vector<unsigned char> expectedAveragesU8(outputCount);
+        std::vector<uint16_t> expectedAveragesU16(outputCount);
+        for (int oy = 0; oy < outputHeight; oy++)
+        {
+            for (int ox = 0; ox < outputWidth; ox++)
+            {
+                const int x0 = ox * boxCase.stride - boxCase.windowWidth / 2;
+                const int y0 = oy * boxCase.stride - boxCase.windowHeight / 2;
+                const int x1 = x0 + boxCase.windowWidth - 1;
+                const int y1 = y0 + boxCase.windowHeight - 1;
+                const uint64_t sum = referencePixelSum.GetPixelSum(x0, y0, x1, y1);
+                const size_t i = static_cast<size_t>(oy) * outputWidth + ox;
+
+                expectedAverages[i]    = static_cast<float>(referencePixelSum.GetPixelAverage(x0, y0, x1, y1));
+                expectedAveragesU8[i]  = static_cast<unsigned char>((sum + n / 2) / n);
+                expectedAveragesU16[i] = static_cast<uint16_t>((sum * 256 + n / 2) / n);
+            }
+        }
+
+        std::cout << "Window: " << boxCase.windowWidth << "x" << boxCase.windowHeight << ", Stride: " << boxCase.stride << std::endl;
+        s_ForEachPixelSumConfig(baseConfig, CONFIG_ALL, [&](const PixelSumConfig& config)
+        {
+            PixelSum* pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+            std::vector<float> averages(outputCount, -1.0f);
+            std::vector<unsigned char> averagesU8(outputCount);
+            std::vector<uint16_t> averagesU16(outputCount);
+
+            EXPECT_EQ(pixelSum->ComputeBoxFilter(boxCase.windowWidth, boxCase.windowHeight, boxCase.stride, averages.data()), true, "Box filter float output");
+            EXPECT_EQ(pixelSum->ComputeBoxFilter(boxCase.windowWidth, boxCase.windowHeight, boxCase.stride, averagesU8.data()), true, "Box filter u8 output");
+            EXPECT_EQ(pixelSum->ComputeBoxFilter(boxCase.windowWidth, boxCase.windowHeight, boxCase.stride, averagesU16.data()), true, "Box filter u16 output");
+
+            EXPECT_EQ(averages == expectedAverages, true, "Box filter float output matches GetPixelAverage()");
+            EXPECT_EQ(averagesU8 == expectedAveragesU8, true, "Box filter u8 output is the rounded average");
+            EXPECT_EQ(averagesU16 == expectedAveragesU16, true, "Box filter u16 output is the rounded 8.8 average");
+
+            delete pixelSum;
+        });
+    }
+
+    float output = 0.0f;
+    EXPECT_EQ(referencePixelSum.ComputeBoxFilter(0, 5, 1, &output), false, "Box filter without window width");
+    EXPECT_EQ(referencePixelSum.ComputeBoxFilter(5, 5, 0, &output), false, "Box filter without stride");
+    EXPECT_EQ(referencePixelSum.ComputeBoxFilter(5, 5, 1, static_cast<float*>(nullptr)), false, "Box filter without output");
+
+    PixelSum emptyPixelSum;
+    EXPECT_EQ(emptyPixelSum.ComputeBoxFilter(5, 5, 1, &output), false, "Box filter without tables");
+
+    delete image;
+}
+
+// Cascade detections must match the stage by stage evaluation with individual queries for every SIMD kernel, table
+// layout and thread count, with and without variance normalization and with a scan step (gathered windows).
+void CascadeVsQueryTest()
+{
+    const int width  = 157;
+    const int height = 131;
+
+    Image* image = new Image(width, height);
+    std::srand(1357);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+    }
+
+    const bool normalizeVarianceOptions[] = { false, true };
+    for (bool normalizeVariance : normalizeVarianceOptions)
+    {
+        PixelSumConfig referenceConfig;
+        referenceConfig.tablePadding = PixelSumTablePadding::Padded;
+        referenceConfig.squaredSums = normalizeVariance ? PixelSumSquaredSums::Enabled : PixelSumSquaredSums::Disabled;
+        PixelSum referencePixelSum(image->GetPixelBufferPtr(), width, height, referenceConfig);
+
+        const PixelSumHaarCascade haarCascade = s_RandomHaarCascade(referencePixelSum, width, height, { 2, 3, 5, 8 }, normalizeVariance);
+        const PixelSumCascade cascade(haarCascade);
+        EXPECT_EQ(cascade.IsValid(), true, "Random cascade is valid");
+
+        const float steps[] = { 1.0f, 2.0f };
+        for (float step : steps)
+        {
+            // Expected detections, scale by scale in scan order
+            PixelSumDetectionParams params;
+            params.step = step;
+
+            std::vector<PixelSumDetection> expectedDetections;
+            bool isWindowIdentical = true;
+            for (float scale = params.minScale; ; scale *= params.scaleFactor)
+            {
+                const int windowWidth = static_cast<int>(haarCascade.windowWidth * scale + 0.5f);
+                const int windowHeight = static_cast<int>(haarCascade.windowHeight * scale + 0.5f);
+                const int scanStep = std::max(1, static_cast<int>(step * scale + 0.5f));
+                if (windowWidth > width || windowHeight > height) break;
+
+                for (int y = 0; y + windowHeight <= height; y += scanStep)
+                {
+                    for (int x = 0; x + windowWidth <= width; x += scanStep)
+                    {
+                        const int passedStages = s_QueryCascadeWindow(referencePixelSum, haarCascade, x, y, scale, normalizeVariance);
+                        if (step == 1.0f && (x + y) % 7 == 0)
+                        {
+                            isWindowIdentical &= (cascade.EvaluateWindow(referencePixelSum, x, y, scale) == passedStages);
+                        }
+
+                        if (passedStages == static_cast<int>(haarCascade.stages.size()))
+                        {
+                            PixelSumDetection detection;
+                            detection.x = x;
+                            detection.y = y;
+                            detection.width = windowWidth;
+                            detection.height = windowHeight;
+                            detection.scale = scale;
+                            expectedDetections.push_back(detection);
+                        }
+                    }
+                }
+            }
+            std::cout << "Variance normalization: " << normalizeVariance << ", Step: " << step << ", Detections: " << expectedDetections.size() << std::endl;
+            EXPECT_EQ(isWindowIdentical, true, "EvaluateWindow() matches the individual queries");
+            EXPECT_EQ(expectedDetections.empty(), false, "Some windows pass all the stages");
+
+            // The cascade needs the padded u32 tables, the detection kernels are chosen by the detection parameters
+            const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::Scalar, PixelSumSimdLevel::SSE2, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
+            s_ForEachPixelSumConfig(referenceConfig, CONFIG_LAYOUT | CONFIG_LAZY | CONFIG_SHARING, [&](const PixelSumConfig& config)
+            {
+                PixelSum pixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+                for (PixelSumSimdLevel simdLevel : simdLevels)
+                {
+                    params.simdLevel = simdLevel;
+                    params.threadCount = (simdLevel == PixelSumSimdLevel::AVX2) ? 3 : 1;
+
+                    std::vector<PixelSumDetection> detections;
+                    EXPECT_EQ(cascade.Detect(pixelSum, detections, params), true, "Detect()");
+
+                    bool isIdentical = (detections.size() == expectedDetections.size());
+                    for (size_t i = 0; isIdentical && i < detections.size(); i++)
+                    {
+                        const PixelSumDetection& a = detections[i];
+                        const PixelSumDetection& b = expectedDetections[i];
+                        isIdentical = (a.x == b.x && a.y == b.y && a.width == b.width && a.height == b.height && a.scale == b.scale);
+                    }
+
+                    std::cout << "Detection kernel: " << PixelSumKernels::Get(simdLevel).name << std::endl;
+                    EXPECT_EQ(isIdentical, true, "Detections match the individual queries");
+                }
+            });
+        }
+    }
+
+    // Tables without the zero border or with u64 entries and invalid cascades are rejected
+    PixelSumHaarCascade haarCascade;
+    haarCascade.windowWidth = 10;
+    haarCascade.windowHeight = 10;
+    haarCascade.stages.resize(1);
+    haarCascade.stages[0].features.resize(1);
+    haarCascade.stages[0].features[0].rectCount = 1;
+    haarCascade.stages[0].features[0].rects[0].width = 10;
+    haarCascade.stages[0].features[0].rects[0].height = 10;
+    haarCascade.stages[0].features[0].rects[0].weight = 1.0f;
+    const PixelSumCascade cascade(haarCascade);
+    EXPECT_EQ(cascade.IsValid(), true, "Single rectangle cascade");
+
+    PixelSumConfig packedConfig;
+    packedConfig.tablePadding = PixelSumTablePadding::Packed;
+    PixelSumConfig wideConfig;
+    wideConfig.accumulator = PixelSumAccumulator::Wide64;
+    wideConfig.tablePadding = PixelSumTablePadding::Padded;
+    PixelSumConfig paddedConfig;
+    paddedConfig.tablePadding = PixelSumTablePadding::Padded;
+    PixelSum packedPixelSum(image->GetPixelBufferPtr(), width, height, packedConfig);
+    PixelSum widePixelSum(image->GetPixelBufferPtr(), width, height, wideConfig);
+    PixelSum pixelSum(image->GetPixelBufferPtr(), width, height, paddedConfig);
+
+    std::vector<PixelSumDetection> detections;
+    EXPECT_EQ(cascade.Detect(packedPixelSum, detections), false, "Detect() on packed tables");
+    EXPECT_EQ(cascade.Detect(widePixelSum, detections), false, "Detect() on wide tables");
+    EXPECT_EQ(cascade.EvaluateWindow(pixelSum, width - 5, 0, 1.0f), -1, "Window outside the image");
+
+    PixelSumDetectionParams params;
+    params.scaleFactor = 1.0f;
+    EXPECT_EQ(cascade.Detect(pixelSum, detections, params), false, "Detect() without scale progression");
+
+    haarCascade.stages[0].features[0].rects[0].width = 11;
+    EXPECT_EQ(PixelSumCascade(haarCascade).IsValid(), false, "Rectangle outside the window");
+    haarCascade.stages[0].features[0].rectCount = 5;
+    EXPECT_EQ(PixelSumCascade(haarCascade).IsValid(), false, "Too many rectangles");
+
+    delete image;
+}
+
+void HistogramVsNaiveTest()
+{
+    // Partial tiles on the right and bottom borders
+    const int width  = 203;
+    const int height = 157;
+
+    Image* image = new Image(width, height);
+    Image* nextImage = new Image(width, height);
+    std::srand(2468);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+        nextImage->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand() % 64); // Low contrast frame
+    }
+
+    // Saturated rows and columns fill the first and the last bin of whole tiles
+    memset(image->GetPixelBufferPtr() + 30 * width, 255, 20 * width);
+    for (int y = 0; y < height; y++)
+    {
+        memset(image->GetPixelBufferPtr() + y * width + 100, 0, 40);
+    }
+
+    std::vector<int> regions; // x0, y0, x1, y1
+    for (int i = 0; i < 300; i++)
+    {
+        regions.push_back(std::rand() % (width + 40) - 20);
+        regions.push_back(std::rand() % (height + 40) - 20);
+        regions.push_back(std::rand() % (width + 40) - 20);
+        regions.push_back(std::rand() % (height + 40) - 20);
+    }
+    const int fixedRegions[] = { 0, 0, width - 1, height - 1,   // Whole image
+                                 5, 7, 5, 7,                    // Single pixel
+                                 width - 1, height - 1, 0, 0,   // Swapped corners
+                                 15, 14, 16, 15,                // Across the corner of four tiles
+                                 -100, -100, 1000, 1000 };      // Clamped to the whole image
+    regions.insert(regions.end(), std::begin(fixedRegions), std::end(fixedRegions));
+
+    const int binCounts[] = { 1, 5, 8, 16, 32, 100, 256 };
+    const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::Scalar, PixelSumSimdLevel::SSE2, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
+    for (int binCount : binCounts)
+    {
+        for (PixelSumSimdLevel simdLevel : simdLevels)
+        {
+            PixelSumHistogram histogram(image->GetPixelBufferPtr(), width, height, binCount, simdLevel);
+            EXPECT_EQ(histogram.GetBinCount(), binCount, "Tables allocated");
+            EXPECT_EQ(histogram.MemoryByteSize(), binCount * PixelSumHistogram::GetBinByteSize(width, height), "Memory per bin");
+
+            Image* frames[] = { image, nextImage };
+            bool isIdentical = true;
+            for (Image* frame : frames)
+            {
+                EXPECT_EQ(histogram.Rebuild(frame->GetPixelBufferPtr()), true, "Rebuild()");
+
+                std::vector<uint32_t> regionHistogram(binCount);
+                for (size_t i = 0; i < regions.size(); i += 4)
+                {
+                    histogram.GetRegionHistogram(regions[i], regions[i + 1], regions[i + 2], regions[i + 3], regionHistogram.data());
+                    isIdentical &= (regionHistogram == s_NaiveRegionHistogram(frame->GetPixelBufferPtr(), width, height, binCount,
+                                                                              regions[i], regions[i + 1], regions[i + 2], regions[i + 3]));
+                }
+            }
+
+            std::cout << "Bins: " << binCount << ", Kernel: " << PixelSumKernels::Get(simdLevel).name << std::endl;
+            EXPECT_EQ(isIdentical, true, "Region histograms match the naive histograms");
+        }
+    }
+
+    // Regions outside the image and invalid bin counts
+    PixelSumHistogram histogram(image->GetPixelBufferPtr(), width, height, 8);
+    std::vector<uint32_t> regionHistogram(8, 1);
+    EXPECT_EQ(histogram.GetRegionHistogram(width, 0, width + 10, 10, regionHistogram.data()), false, "Region right of the image");
+    EXPECT_EQ(regionHistogram == std::vector<uint32_t>(8, 0), true, "Zero histogram outside the image");
+    EXPECT_EQ(histogram.GetRegionHistogram(-10, -10, -1, -1, regionHistogram.data()), false, "Region above the image");
+    EXPECT_EQ(histogram.GetBinOfPixelValue(255), 7, "Last bin");
+
+    EXPECT_EQ(PixelSumHistogram(image->GetPixelBufferPtr(), width, height, 0).GetBinCount(), 0, "No bin");
+    EXPECT_EQ(PixelSumHistogram(image->GetPixelBufferPtr(), width, height, PixelSumHistogram::MAX_BIN_COUNT + 1).GetBinCount(), 0, "Too many bins");
+
+    delete nextImage;
+    delete image;
+}
+
+void ThresholdCountsVsNaiveTest()
+{
+    const int width  = 203;
+    const int height = 157;
+
+    Image* image = new Image(width, height);
+    Image* nextImage = new Image(width, height);
+    std::srand(9753);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+        nextImage->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand() % 64); // Low contrast frame
+    }
+
+    // Saturated and black bands, every threshold passes or fails on whole rows and columns
+    memset(image->GetPixelBufferPtr() + 30 * width, 255, 20 * width);
+    for (int y = 0; y < height; y++)
+    {
+        memset(image->GetPixelBufferPtr() + y * width + 100, 0, 40);
+    }
+
+    std::vector<int> regions; // x0, y0, x1, y1
+    for (int i = 0; i < 200; i++)
+    {
+        regions.push_back(std::rand() % (width + 40) - 20);
+        regions.push_back(std::rand() % (height + 40) - 20);
+        regions.push_back(std::rand() % (width + 40) - 20);
+        regions.push_back(std::rand() % (height + 40) - 20);
+    }
+    const int fixedRegions[] = { 0, 0, width - 1, height - 1,   // Whole image
+                                 5, 7, 5, 7,                    // Single pixel
+                                 width - 1, height - 1, 0, 0,   // Swapped corners
+                                 -100, -100, 1000, 1000 };      // Clamped to the whole image
+    regions.insert(regions.end(), std::begin(fixedRegions), std::end(fixedRegions));
+
+    // 4, 8, 12 and 16 lanes, unsorted with duplicates, 0 and 255
+    std::vector<std::vector<unsigned char>> thresholdSets = { { 0 }, { 0, 32, 128, 200 }, { 200, 32, 32, 0, 128 }, { 255, 254, 1 } };
+    for (int thresholdCount : { 7, 8, 11, 12, 16 })
+    {
+        std::vector<unsigned char> thresholds;
+        for (int i = 0; i < thresholdCount; i++)
+        {
+            thresholds.push_back(static_cast<unsigned char>(i * 255 / (thresholdCount - 1)));
+        }
+        thresholdSets.push_back(thresholds);
+    }
+
+    PixelSum pixelSum(image->GetPixelBufferPtr(), width, height);
+
+    const PixelSumSimdLevel simdLevels[] = { PixelSumSimdLevel::Scalar, PixelSumSimdLevel::SSE2, PixelSumSimdLevel::AVX2, PixelSumSimdLevel::AVX512 };
+    for (const std::vector<unsigned char>& thresholds : thresholdSets)
+    {
+        std::vector<unsigned char> sortedThresholds(thresholds);
+        std::sort(sortedThresholds.begin(), sortedThresholds.end());
+        sortedThresholds.erase(std::unique(sortedThresholds.begin(), sortedThresholds.end()), sortedThresholds.end());
+
+        for (PixelSumSimdLevel simdLevel : simdLevels)
+        {
+            PixelSumThresholdCounts thresholdCounts(image->GetPixelBufferPtr(), width, height, thresholds, simdLevel);
+            EXPECT_EQ(thresholdCounts.GetThresholds() == sortedThresholds, true, "Thresholds sorted without duplicates");
+
+            // Threshold 0 is the non-zero count of PixelSum
+            bool isNonZeroIdentical = true;
+            if (sortedThresholds[0] == 0)
+            {
+                for (size_t i = 0; i < regions.size(); i += 4)
+                {
+                    isNonZeroIdentical &= (thresholdCounts.GetCountAbove(0, regions[i], regions[i + 1], regions[i + 2], regions[i + 3]) ==
+                                           pixelSum.GetNonZeroCount(regions[i], regions[i + 1], regions[i + 2], regions[i + 3]));
+                }
+            }
+
+            Image* frames[] = { image, nextImage };
+            bool isIdentical = true;
+            for (Image* frame : frames)
+            {
+                EXPECT_EQ(thresholdCounts.Rebuild(frame->GetPixelBufferPtr()), true, "Rebuild()");
+
+                std::vector<uint32_t> counts(sortedThresholds.size());
+                for (size_t i = 0; i < regions.size(); i += 4)
+                {
+                    thresholdCounts.GetCountsAbove(regions[i], regions[i + 1], regions[i + 2], regions[i + 3], counts.data());
+                    for (size_t t = 0; t < sortedThresholds.size(); t++)
+                    {
+                        const int expectedCount = s_NaiveCountAbove(frame->GetPixelBufferPtr(), width, height, sortedThresholds[t],
+                                                                     regions[i], regions[i + 1], regions[i + 2], regions[i + 3]);
+                        isIdentical &= (thresholdCounts.GetCountAbove(sortedThresholds[t], regions[i], regions[i + 1], regions[i + 2], regions[i + 3]) ==
+                                        expectedCount);
+                        isIdentical &= (static_cast<int>(counts[t]) == expectedCount);
+                    }
+                }
+            }
+
+            std::cout << "Thresholds: " << sortedThresholds.size() << ", Kernel: " << PixelSumKernels::Get(simdLevel).name << std::endl;
+            EXPECT_EQ(isNonZeroIdentical, true, "Threshold 0 matches GetNonZeroCount()");
+            EXPECT_EQ(isIdentical, true, "Counts match the naive counts");
+        }
+    }
+
+    // Regions outside the image, thresholds that are not configured and invalid threshold sets
+    PixelSumThresholdCounts thresholdCounts(image->GetPixelBufferPtr(), width, height, { 32, 128 });
+    std::vector<uint32_t> counts(2, 1);
+    EXPECT_EQ(thresholdCounts.GetCountsAbove(width, 0, width + 10, 10, counts.data()), false, "Region right of the image");
+    EXPECT_EQ(counts == std::vector<uint32_t>(2, 0), true, "Zero counts outside the image");
+    EXPECT_EQ(thresholdCounts.GetCountAbove(32, -10, -10, -1, -1), 0, "Region above the image");
+    EXPECT_EQ(thresholdCounts.GetCountAbove(64, 0, 0, 10, 10), -1, "Threshold not configured");
+
+    EXPECT_EQ(PixelSumThresholdCounts(image->GetPixelBufferPtr(), width, height, {}).GetThresholds().empty(), true, "No threshold");
+    std::vector<unsigned char> tooManyThresholds(PixelSumThresholdCounts::MAX_THRESHOLD_COUNT + 1);
+    std::iota(tooManyThresholds.begin(), tooManyThresholds.end(), 0);
+    EXPECT_EQ(PixelSumThresholdCounts(image->GetPixelBufferPtr(), width, height, tooManyThresholds).GetThresholds().empty(), true, "Too many thresholds");
+
+    delete nextImage;
+    delete image;
+}
+
+// Tables saved to a file and mapped back must answer every query like the built tables, for every table
+// configuration. Updates of a mapped PixelSum go to its own tables and never to the file, damaged files and files of
+// another version are rejected.
+void FileMapVsBuildTest()
+{
+    const int width  = 1021;
+    const int height = 603;
+    const char* filePath = "PixelSumTables.tmp";
+
+    Image* image = new Image(width, height);
+    Image* nextImage = new Image(width, height);
+    std::srand(2468);
+    for (int i = 0; i < width * height; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand());
+        nextImage->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand() % 8);
+    }
+
+    std::vector<PixelBufferCoords_i> regions(2000);
+    for (PixelBufferCoords_i& region : regions)
+    {
+        region.x0 = (std::rand() % (width + 64)) - 32;
+        region.y0 = (std::rand() % (height + 64)) - 32;
+        region.x1 = region.x0 + (std::rand() % 300) - 40;
+        region.y1 = region.y0 + (std::rand() % 300) - 40;
+    }
+
+    // Saving completes the lazy tables
+    const auto checkFileMap = [&](const PixelSumConfig& config)
+    {
+        PixelSum pixelSum(image->GetPixelBufferPtr(), width, height, config);
+        EXPECT_EQ(pixelSum.SaveTables(filePath), true, "SaveTables()");
+
+        PixelSum mappedPixelSum;
+        EXPECT_EQ(mappedPixelSum.MapTables(filePath, PixelSumFileVerification::Full), true, "MapTables()");
+        EXPECT_EQ(mappedPixelSum.IsMapped(), true, "Tables are mapped");
+
+        bool isIdentical = true;
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            isIdentical &= (mappedPixelSum.GetPixelSum64(r.x0, r.y0, r.x1, r.y1) == pixelSum.GetPixelSum64(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (mappedPixelSum.GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1) == pixelSum.GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (mappedPixelSum.GetPixelVariance(r.x0, r.y0, r.x1, r.y1) == pixelSum.GetPixelVariance(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (mappedPixelSum.GetRotatedPixelSum(r.x0, r.y0, r.x1 & 0xFF, r.y1 & 0xFF) ==
+                            pixelSum.GetRotatedPixelSum(r.x0, r.y0, r.x1 & 0xFF, r.y1 & 0xFF));
+        }
+        EXPECT_EQ(isIdentical, true, "Mapped tables match the built tables");
+
+        // Copies share the mapping, an update moves the tables of the updated PixelSum to the memory pools
+        {
+            PixelSum mappedCopy(mappedPixelSum);
+            EXPECT_EQ(mappedCopy.IsMapped(), true, "Copy shares the mapping");
+            std::vector<unsigned char> blackPixels(16 * 16, 0);
+            EXPECT_EQ(mappedCopy.UpdateRegion(0, 0, 15, 15, blackPixels.data()), true, "UpdateRegion()");
+            EXPECT_EQ(mappedCopy.IsMapped(), false, "Update detaches the tables");
+            EXPECT_EQ(mappedCopy.GetPixelSum64(0, 0, width - 1, height - 1),
+                      pixelSum.GetPixelSum64(0, 0, width - 1, height - 1) - pixelSum.GetPixelSum64(0, 0, 15, 15), "Updated copy");
+        }
+
+        EXPECT_EQ(mappedPixelSum.Rebuild(nextImage->GetPixelBufferPtr()), true, "Rebuild()");
+        EXPECT_EQ(mappedPixelSum.IsMapped(), false, "Rebuild detaches the tables");
+        const uint64_t nextSum = std::accumulate(nextImage->GetPixelBufferPtr(), nextImage->GetPixelBufferPtr() + width * height, uint64_t(0));
+        EXPECT_EQ(mappedPixelSum.GetPixelSum64(0, 0, width - 1, height - 1), nextSum, "Rebuilt tables");
+
+        // The file still holds the first frame
+        PixelSum remappedPixelSum;
+        EXPECT_EQ(remappedPixelSum.MapTables(filePath, PixelSumFileVerification::Full), true, "File is unchanged");
+        EXPECT_EQ(remappedPixelSum.GetPixelSum64(0, 0, width - 1, height - 1), pixelSum.GetPixelSum64(0, 0, width - 1, height - 1), "Remapped tables");
+    };
+
+    PixelSumConfig extraTablesConfig;
+    extraTablesConfig.squaredSums = PixelSumSquaredSums::Enabled;
+    extraTablesConfig.rotatedSums = PixelSumRotatedSums::Enabled;
+    s_ForEachPixelSumConfig(PixelSumConfig(), CONFIG_LAYOUT | CONFIG_PADDING | CONFIG_ACCUMULATOR | CONFIG_LAZY, checkFileMap);
+    s_ForEachPixelSumConfig(extraTablesConfig, 0, checkFileMap);
+
+    // A failed mapping leaves the PixelSum unchanged
+    PixelSum pixelSum(image->GetPixelBufferPtr(), width, height);
+    const uint64_t sum = pixelSum.GetPixelSum64(0, 0, width - 1, height - 1);
+    EXPECT_EQ(pixelSum.MapTables("PixelSumMissingTables.tmp"), false, "Missing file");
+
+    EXPECT_EQ(pixelSum.SaveTables(filePath), true, "SaveTables()");
+    s_CorruptFileByte(filePath, 20); // Width
+    EXPECT_EQ(pixelSum.MapTables(filePath), false, "Corrupted header");
+
+    EXPECT_EQ(pixelSum.SaveTables(filePath), true, "SaveTables()");
+    s_CorruptFileByte(filePath, 8); // Version
+    EXPECT_EQ(pixelSum.MapTables(filePath), false, "Other version");
+
+    // The payload checksum is only verified by the full verification
+    EXPECT_EQ(pixelSum.SaveTables(filePath), true, "SaveTables()");
+    s_CorruptFileByte(filePath, 100000);
+    EXPECT_EQ(pixelSum.MapTables(filePath, PixelSumFileVerification::Full), false, "Corrupted tables");
+    EXPECT_EQ(pixelSum.IsMapped(), false, "Not mapped");
+    EXPECT_EQ(pixelSum.GetPixelSum64(0, 0, width - 1, height - 1), sum, "Tables kept");
+
+    EXPECT_EQ(pixelSum.SaveTables(filePath), true, "SaveTables()");
+    EXPECT_EQ(truncate(filePath, 200000), 0, "truncate()");
+    EXPECT_EQ(pixelSum.MapTables(filePath), false, "Truncated file");
+    EXPECT_EQ(pixelSum.GetPixelSum64(0, 0, width - 1, height - 1), sum, "Tables kept");
+
+    EXPECT_EQ(PixelSum().SaveTables(filePath), false, "No tables to save");
+
+    remove(filePath);
+
+    delete nextImage;
+    delete image;
+}
+
+// Images mapped from raw and PGM files, read band by band while the tables are built, or wrapped in place must
+// give the pixels and the tables of the image they were written from, for every table configuration. Invalid and
+// truncated files are rejected.
+void ImageFileVsImageTest()
+{
+    const int width  = 1021;
+    const int height = 603;
+    const size_t pixelCount = static_cast<size_t>(width) * height;
+    const char* rawFilePath = "PixelSumImage.raw";
+    const char* pgmFilePath = "PixelSumImage.pgm";
+
+    Image* image = new Image(width, height);
+    std::srand(8024);
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        image->GetPixelBufferPtr()[i] = static_cast<unsigned char>(std::rand() % 3 ? std::rand() : 0);
+    }
+
+    s_WriteImageFile(rawFilePath, image->GetPixelBufferPtr(), pixelCount);
+    s_WriteImageFile(pgmFilePath, image->GetPixelBufferPtr(), pixelCount, "P5\n# Reference image\n1021 603\n255\n");
+
+    std::vector<PixelBufferCoords_i> regions(2000);
+    for (PixelBufferCoords_i& region : regions)
+    {
+        region.x0 = (std::rand() % (width + 64)) - 32;
+        region.y0 = (std::rand() % (height + 64)) - 32;
+        region.x1 = region.x0 + (std::rand() % 300) - 40;
+        region.y1 = region.y0 + (std::rand() % 300) - 40;
+    }
+
+    // Mapped files, the tables are built from the mapping
+    PixelSum pixelSum(image->GetPixelBufferPtr(), width, height);
+    PixelSumImageFile rawFile;
+    PixelSumImageFile pgmFile;
+    EXPECT_EQ(rawFile.Map(rawFilePath, width, height), true, "Map() raw file");
+    EXPECT_EQ(pgmFile.Map(pgmFilePath), true, "Map() PGM file");
+    EXPECT_EQ(pgmFile.IsMapped(), true, "PGM file is mapped");
+    EXPECT_EQ(pgmFile.GetWidth() == width && pgmFile.GetHeight() == height, true, "PGM dimensions");
+    EXPECT_EQ(memcmp(rawFile.GetPixels(), image->GetPixelBufferPtr(), pixelCount), 0, "Raw pixels");
+    EXPECT_EQ(memcmp(pgmFile.GetPixels(), image->GetPixelBufferPtr(), pixelCount), 0, "PGM pixels");
+
+    PixelSum mappedPixelSum(pgmFile.GetPixels(), pgmFile.GetWidth(), pgmFile.GetHeight());
+    bool isIdentical = true;
+    for (const PixelBufferCoords_i& r : regions)
+    {
+        isIdentical &= (mappedPixelSum.GetPixelSum(r.x0, r.y0, r.x1, r.y1) == pixelSum.GetPixelSum(r.x0, r.y0, r.x1, r.y1));
+        isIdentical &= (mappedPixelSum.GetNonZeroCount(r.x0, r.y0, r.x1, r.y1) == pixelSum.GetNonZeroCount(r.x0, r.y0, r.x1, r.y1));
+    }
+    EXPECT_EQ(isIdentical, true, "Tables of the mapped file");
+
+    // Streaming read, the band carries are added while the file is read
+    const auto checkRead = [&](const PixelSumConfig& config)
+    {
+        PixelSum expectedPixelSum(image->GetPixelBufferPtr(), width, height, config);
+
+        PixelSumImageFile readFile;
+        PixelSum readPixelSum;
+        EXPECT_EQ(readFile.Read(pgmFilePath, 0, 0, &readPixelSum, config), true, "Read() with PixelSum");
+        EXPECT_EQ(readFile.IsMapped(), false, "Read file is not mapped");
+        EXPECT_EQ(memcmp(readFile.GetPixels(), image->GetPixelBufferPtr(), pixelCount), 0, "Read pixels");
+
+        isIdentical = true;
+        for (const PixelBufferCoords_i& r : regions)
+        {
+            isIdentical &= (readPixelSum.GetPixelSum64(r.x0, r.y0, r.x1, r.y1) == expectedPixelSum.GetPixelSum64(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (readPixelSum.GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1) == expectedPixelSum.GetNonZeroCount64(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (readPixelSum.GetPixelVariance(r.x0, r.y0, r.x1, r.y1) == expectedPixelSum.GetPixelVariance(r.x0, r.y0, r.x1, r.y1));
+            isIdentical &= (readPixelSum.GetRotatedPixelSum(r.x0, r.y0, r.x1 & 0xFF, r.y1 & 0xFF) ==
+                            expectedPixelSum.GetRotatedPixelSum(r.x0, r.y0, r.x1 & 0xFF, r.y1 & 0xFF));
+        }
+        EXPECT_EQ(isIdentical, true, "Tables built while reading match the built tables");
+    };
+
+    PixelSumConfig extraTablesConfig;
+    extraTablesConfig.squaredSums = PixelSumSquaredSums::Enabled;
+    extraTablesConfig.rotatedSums = PixelSumRotatedSums::Enabled;
+    s_ForEachPixelSumConfig(PixelSumConfig(), CONFIG_LAYOUT | CONFIG_PADDING | CONFIG_ACCUMULATOR | CONFIG_LAZY, checkRead);
+    s_ForEachPixelSumConfig(extraTablesConfig, CONFIG_BUILD_MODE, checkRead);
+
+    // Pixels owned by the caller are used in place
+    VM::MemoryAllocator& memoryAllocator = VM::MemoryAllocator::GetInstance();
+    const size_t inUsedMemory = memoryAllocator.InUsedMemory();
+    PixelSumImageFile wrappedFile;
+    wrappedFile.Wrap(image->GetPixelBufferPtr(), width, height);
+    Image wrappedImage(image->GetPixelBufferPtr(), width, height);
+    EXPECT_EQ(wrappedFile.GetPixels() == image->GetPixelBufferPtr(), true, "Wrapped pixels");
+    EXPECT_EQ(wrappedImage.GetPixelBufferPtr() == image->GetPixelBufferPtr(), true, "Wrapped image pixels");
+    EXPECT_EQ(memoryAllocator.InUsedMemory(), inUsedMemory, "No allocation for wrapped pixels");
+
+    // Invalid files leave the source empty
+    EXPECT_EQ(rawFile.Map(rawFilePath), false, "Raw file without dimensions");
+    EXPECT_EQ(rawFile.GetPixels() == nullptr, true, "Empty source");
+    EXPECT_EQ(rawFile.Map(rawFilePath, width, height + 1), false, "Raw file too small");
+    EXPECT_EQ(pgmFile.Map(pgmFilePath, width + 1, height), false, "PGM dimensions mismatch");
+    EXPECT_EQ(pgmFile.Map("PixelSumMissingImage.pgm"), false, "Missing file");
+
+    s_WriteImageFile(pgmFilePath, image->GetPixelBufferPtr(), pixelCount, "P5 1021 603 65535\n");
+    EXPECT_EQ(pgmFile.Map(pgmFilePath), false, "16-bit PGM file");
+
+    s_WriteImageFile(pgmFilePath, image->GetPixelBufferPtr(), pixelCount - width, "P5 1021 603 255\n");
+    EXPECT_EQ(pgmFile.Map(pgmFilePath), false, "Truncated PGM file");
+    PixelSum readPixelSum;
+    EXPECT_EQ(pgmFile.Read(pgmFilePath, 0, 0, &readPixelSum), false, "Read() truncated PGM file");
+    EXPECT_EQ(memoryAllocator.InUsedMemory(), inUsedMemory, "Read buffer freed");
+
+    remove(rawFilePath);
+    remove(pgmFilePath);
+
+    delete image;
+}
+
+// Allocations of every page size and prefault mode are aligned to their pages, writable and freed. Prefaulted
+// allocations are in memory before the first write, huge page requests fall back when no huge page is reserved.
+void VirtualMemoryBackendTest()
+{
+    VM::VirtualMemory virtualMemory;
+    const size_t basePageSize = virtualMemory.VmSize();
+    EXPECT_EQ(basePageSize >= 4096 && (basePageSize & (basePageSize - 1)) == 0, true, "Base page size");
+
+    const size_t byteSize = VM_MEM_MB(5) + 123;
+    const VM::VMPageSize pageSizes[] = { VM::VMPageSize::Default, VM::VMPageSize::Transparent, VM::VMPageSize::Huge2MB, VM::VMPageSize::Huge1GB };
+    const VM::VMPrefault prefaults[] = { VM::VMPrefault::None, VM::VMPrefault::Populate, VM::VMPrefault::Touch };
+    for (VM::VMPageSize pageSize : pageSizes)
+    {
+        for (VM::VMPrefault prefault : prefaults)
+        {
+            VM::VMPageConfig pageConfig;
+            pageConfig.pageSize = pageSize;
+            pageConfig.prefault = prefault;
+            pageConfig.touchThreadCount = 2;
+
+            VM::PageAllocation allocation;
+            EXPECT_EQ(virtualMemory.VmAllocate(byteSize, &allocation, pageConfig), true, "VmAllocate()");
+            EXPECT_EQ(allocation.size >= byteSize && allocation.size % allocation.pageSize == 0, true, "Whole pages");
+            EXPECT_EQ(VM_IS_ALIGNED(allocation.baseAddress, allocation.pageSize), true, "Aligned to the pages");
+
+#if defined(__linux__)
+            // Huge pages, reserved or transparent, need 2 MB aligned ranges
+            if (pageSize != VM::VMPageSize::Default)
+            {
+                EXPECT_EQ(VM_IS_ALIGNED(allocation.baseAddress, VM_MEM_MB(2)) && allocation.size % VM_MEM_MB(2) == 0, true, "Huge page alignment");
+            }
+
+            const size_t residentPageCount = s_ResidentPageCount(allocation, basePageSize);
+            EXPECT_EQ(residentPageCount, (prefault == VM::VMPrefault::None) ? 0 : allocation.size / basePageSize, "Resident pages");
+#endif
+
+            unsigned char* bytes = static_cast<unsigned char*>(allocation.baseAddress);
+            bytes[0] = 0x5A;
+            bytes[allocation.size - 1] = 0xA5;
+            EXPECT_EQ(bytes[0] == 0x5A && bytes[allocation.size - 1] == 0xA5, true, "Writable");
+            EXPECT_EQ(virtualMemory.VmFree(&allocation), true, "VmFree()");
+        }
+    }
+
+    // The pools take the page configuration, the free stacks the default pages
+    VM::VMPageConfig pageConfig;
+    pageConfig.pageSize = VM::VMPageSize::Transparent;
+    pageConfig.prefault = VM::VMPrefault::Touch;
+    VM::VirtualMemoryPool virtualMemoryPool({ { VM_MEM_MB(4), VM_MEM_MB(8) } }, pageConfig);
+    void* pointer = virtualMemoryPool.AllocateVirtualMemory(VM_MEM_MB(3));
+    EXPECT_EQ(pointer != nullptr, true, "Pool allocation");
+#if defined(__linux__)
+    EXPECT_EQ(VM_IS_ALIGNED(pointer, VM_MEM_MB(2)), true, "Pool on huge page boundaries");
+#endif
+    virtualMemoryPool.FreeVirtualMemory(pointer);
+    EXPECT_EQ(virtualMemoryPool.InUsedMemory(), 0, "Pool allocation freed");
+}
+
+// Threads allocating and freeing from the same pools never get a block twice, the pools are empty afterwards.
+// Threads draining a pool together get every block exactly once, cached or not. The blocks cached by other threads,
+// exited ones included, never make a pool run out before its configured blocks.
+void VirtualMemoryPoolConcurrencyTest()
+{
+    const int threadCount = 4;
+    const std::vector<size_t> allocationSizes = { 40, 64, 300, 512, 4000, VM_MEM_KB(4), VM_MEM_KB(700) };
+    {
+        VM::VirtualMemoryPool virtualMemoryPool(s_ConcurrentPoolConfig());
+
+        std::atomic<int> corruptedCount(0);
+        std::vector<std::thread> workers;
+        for (int thread = 0; thread < threadCount; thread++)
+        {
+            workers.emplace_back([&, thread]()
+            {
+                corruptedCount += s_AllocatorWorkload(1 + thread, 200000, allocationSizes,
+                                                      [&](size_t p_Size) { return virtualMemoryPool.AllocateVirtualMemory(p_Size); },
+                                                      [&](void* p_Pointer) { virtualMemoryPool.FreeVirtualMemory(p_Pointer); });
+            });
+        }
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        EXPECT_EQ(corruptedCount.load(), 0, "Blocks allocated twice");
+        EXPECT_EQ(virtualMemoryPool.InUsedMemory(), 0, "Blocks freed");
+    }
+
+    const size_t blockSizes[] = { VM_MEM_KB(4), VM_MEM_MB(1) };
+    for (size_t blockSize : blockSizes)
+    {
+        VM::VirtualMemoryPool virtualMemoryPool(s_ConcurrentPoolConfig());
+
+        // 2048 blocks of 4 KB with 8 blocks per thread cache get 64 x 8 blocks more, 32 blocks of 1 MB are not cached
+        const size_t blockCount = (blockSize == VM_MEM_KB(4)) ? (VM_MEM_MB(8) + 64 * 8 * blockSize) / blockSize : VM_MEM_MB(32) / blockSize;
+
+        std::vector<std::vector<void*>> threadBlocks(threadCount);
+        std::vector<std::thread> workers;
+        for (int thread = 0; thread < threadCount; thread++)
+        {
+            workers.emplace_back([&, thread]()
+            {
+                while (void* pointer = virtualMemoryPool.AllocateVirtualMemory(blockSize))
+                {
+                    threadBlocks[thread].push_back(pointer);
+                }
+            });
+        }
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        std::vector<void*> blocks;
+        for (const std::vector<void*>& threadBlock : threadBlocks)
+        {
+            blocks.insert(blocks.end(), threadBlock.begin(), threadBlock.end());
+        }
+
+        std::sort(blocks.begin(), blocks.end());
+        EXPECT_EQ(blocks.size(), blockCount, "Every block of the drained pool");
+        EXPECT_EQ(std::unique(blocks.begin(), blocks.end()) == blocks.end(), true, "Distinct blocks");
+        EXPECT_EQ(virtualMemoryPool.InUsedMemory(), blockCount * blockSize, "Drained pool in use");
+
+        for (void* pointer : blocks)
+        {
+            virtualMemoryPool.FreeVirtualMemory(pointer);
+        }
+
+        EXPECT_EQ(virtualMemoryPool.InUsedMemory(), 0, "Drained pool freed");
+    }
+
+    {
+        VM::VirtualMemoryPool virtualMemoryPool(s_ConcurrentPoolConfig());
+        const size_t blockSize = VM_MEM_KB(4);
+        const size_t cacheBlockCount = 8;
+
+        // Threads alive together fill the caches of their slots, which keep the blocks once the threads exited
+        const int cachingThreadCount = 16;
+        std::atomic<int> cachedThreadCount(0);
+        std::vector<std::thread> workers;
+        for (int thread = 0; thread < cachingThreadCount; thread++)
+        {
+            workers.emplace_back([&]()
+            {
+                void* blocks[cacheBlockCount];
+                for (void*& block : blocks) block = virtualMemoryPool.AllocateVirtualMemory(blockSize);
+                for (void* block : blocks) virtualMemoryPool.FreeVirtualMemory(block);
+
+                cachedThreadCount++;
+                while (cachedThreadCount.load() < cachingThreadCount) std::this_thread::yield();
+            });
+        }
+
+        for (std::thread& worker : workers)
+        {
+            worker.join();
+        }
+
+        EXPECT_EQ(virtualMemoryPool.InUsedMemory(), 0, "Cached blocks are free");
+
+        std::vector<void*> blocks;
+        for (size_t i = 0; i < VM_MEM_MB(8) / blockSize; i++)
+        {
+            void* pointer = virtualMemoryPool.AllocateVirtualMemory(blockSize);
+            if (!pointer) break;
+
+            blocks.push_back(pointer);
+        }
+        EXPECT_EQ(blocks.size(), VM_MEM_MB(8) / blockSize, "Configured blocks besides the cached ones");
+
+        for (void* pointer : blocks)
+        {
+            virtualMemoryPool.FreeVirtualMemory(pointer);
+        }
+
+        EXPECT_EQ(virtualMemoryPool.InUsedMemory(), 0, "Pool freed");
+    }
+}
+
+// Allocations go to the smallest pool of at least their size, the pool sizes rounded up to powers of two and merged
+// with their block counts kept. Freed blocks go back to the pool they came from.
+void VirtualMemoryPoolRoutingTest()
+{
+    // 100 and 128 byte pools merge into one of 4 + 4 blocks, 5000 rounds to 8192
+    VM::VirtualMemoryPool virtualMemoryPool({ { 5000, 2 * 5000 }, { 100, 4 * 100 }, { 1000, 4 * 1000 }, { 128, 4 * 128 } });
+    EXPECT_EQ(virtualMemoryPool.TotalMemoryCapacity(), 8 * 128 + 4 * 1024 + 2 * 8192, "Merged pools");
+
+    struct Routing
+    {
+        size_t allocationSize;
+        size_t blockSize;
+    };
+    const Routing routings[] = { { 0, 128 }, { 1, 128 }, { 128, 128 }, { 129, 1024 }, { 1024, 1024 }, { 1025, 8192 }, { 8192, 8192 } };
+    for (const Routing& routing : routings)
+    {
+        const size_t inUsedMemory = virtualMemoryPool.InUsedMemory();
+        void* pointer = virtualMemoryPool.AllocateVirtualMemory(routing.allocationSize);
+        EXPECT_EQ(pointer != nullptr, true, "Routed allocation");
+        EXPECT_EQ(virtualMemoryPool.InUsedMemory() - inUsedMemory, routing.blockSize, "Block of the smallest pool");
+
+        // The block is the top of the free stack of its pool once freed
+        virtualMemoryPool.FreeVirtualMemory(pointer);
+        EXPECT_EQ(virtualMemoryPool.AllocateVirtualMemory(routing.blockSize) == pointer, true, "Freed to its pool");
+        virtualMemoryPool.FreeVirtualMemory(pointer);
+    }
+
+    EXPECT_EQ(virtualMemoryPool.AllocateVirtualMemory(8193) == nullptr, true, "Larger than the largest pool");
+
+    // Every block of the pools, each pool on its own 2 MB region which holds only the configured blocks
+    std::vector<void*> blocks;
+    bool isAligned = true;
+    const size_t blockSizes[] = { 128, 1024, 8192 };
+    for (size_t blockSize : blockSizes)
+    {
+        while (void* pointer = virtualMemoryPool.AllocateVirtualMemory(blockSize))
+        {
+            isAligned = isAligned && VM_IS_ALIGNED(pointer, blockSize);
+            blocks.push_back(pointer);
+        }
+    }
+
+    EXPECT_EQ(isAligned, true, "Block alignment");
+
+    EXPECT_EQ(blocks.size(), 8u + 4u + 2u, "Blocks");
+    EXPECT_EQ(virtualMemoryPool.InUsedMemory(), virtualMemoryPool.TotalMemoryCapacity(), "Pools hold their capacity");
+
+    for (void* pointer : blocks)
+    {
+        virtualMemoryPool.FreeVirtualMemory(pointer);
+    }
+
+    EXPECT_EQ(virtualMemoryPool.InUsedMemory(), 0, "Pools freed");
+
+    // 10 blocks of 3 MB are 10 blocks of 4 MB, not the 7 blocks of 4 MB in 30 MB
+    VM::VirtualMemoryPool largeBlockPool({ { VM_MEM_MB(3), VM_MEM_MB(30) } });
+    EXPECT_EQ(largeBlockPool.TotalMemoryCapacity(), VM_MEM_MB(40), "Capacity of the rounded pool");
+
+    blocks.clear();
+    while (void* pointer = largeBlockPool.AllocateVirtualMemory(VM_MEM_MB(3)))
+    {
+        blocks.push_back(pointer);
+    }
+    EXPECT_EQ(blocks.size(), 10u, "Blocks of the rounded pool");
+
+    for (void* pointer : blocks)
+    {
+        largeBlockPool.FreeVirtualMemory(pointer);
+    }
+}
+
+// Test case to check no Nan value is returned by GetPixelAverage() or GetNonZeroAverage() function
+void SATPlusAllocationPerformanceTest()
+{
+    Image* image = new Image(IMAGE_WIDTH, IMAGE_HEIGHT);
+
+    // Fill full pixel buffer with value 1
+    const size_t dataSize = IMAGE_WIDTH * IMAGE_HEIGHT;
+    PixelSum* pixelSum = nullptr;
+    s_FillDataWithContinousNumberStartingWith(dataSize, image->GetPixelBufferPtr(), 2);
+
+    for (int i = 0; i < 8; i++)
+    {
+        const int width = (IMAGE_WIDTH >> i);
+        const int height = (IMAGE_HEIGHT >> i);
+
+        if (width * height <= 0) break;
+
+        std::cout << "Performance test includes 2 allocations and 2 SAT creation for (a) Pixel buffer SAT (b) Non-zero element" << std::endl;
+        std::cout << "Image Size: Width = " << width << ", Height = " << height << std::endl;
+
+        {
+            DefaultResults results;
+            ScopedTimer Timer(results);
+            pixelSum = new PixelSum(image->GetPixelBufferPtr(), width, height);
+        }
+
+        delete pixelSum;
+    }
+
+    delete image;
+}
+
+void TestCaseEntry()
+{
+    constexpr int MAX_IMAGE_COUNT              = 10;
+    constexpr int MAX_SUMMED_AREA_PIXEL_BUFFER = MAX_IMAGE_COUNT * 2;
+    constexpr int MAX_SUMMED_AREA_NON_ZERO     = MAX_SUMMED_AREA_PIXEL_BUFFER;
+    constexpr int MAX_SUMMED_AREA_INTERLEAVED  = 4;
+    constexpr int MAX_COMPACT_LOCAL_TABLES     = 4;
+    constexpr int MAX_COMPACT_TILE_TABLES      = MAX_COMPACT_LOCAL_TABLES * 4;
+    constexpr int MAX_LARGE_SUMMED_AREA        = 2;
+    constexpr int MAX_SUMMED_AREA_PACKED       = 4;
+    constexpr int MAX_HISTOGRAM_TABLES         = 2;
+    constexpr int MAX_THRESHOLD_COUNT_TABLES   = 1;
+    constexpr int MAX_SUMMED_AREA_PADDED       = 6;
+
+    PreallocateMemoryVirtualMemory(MAX_IMAGE_COUNT, MAX_SUMMED_AREA_PIXEL_BUFFER, MAX_SUMMED_AREA_NON_ZERO, MAX_SUMMED_AREA_INTERLEAVED,
+                                   MAX_COMPACT_TILE_TABLES, MAX_COMPACT_LOCAL_TABLES, MAX_LARGE_SUMMED_AREA, MAX_SUMMED_AREA_PACKED,
+                                   MAX_HISTOGRAM_TABLES, MAX_THRESHOLD_COUNT_TABLES, MAX_SUMMED_AREA_PADDED);
+
+    TEST_CASE(ConfigureMemoryTest);
+
+    TEST_CASE(MemoryLeakTest);
+    TEST_CASE(MemoryLeakTestCopyCtor);
+    TEST_CASE(MemoryLeakTestPixelSumAssignOperator);
+
+    TEST_CASE(GetPixelSumInvalidRangeTest);
+    TEST_CASE(GetPixelSumVsNaiveSumAreaResult);
+
+    TEST_CASE(GetPixelAverage);
+    TEST_CASE(GetPixelAverageVsNaiveSumAreaResult);
+
+    TEST_CASE(CopyConstructor);
+    TEST_CASE(AssignmentOperator);
+
+    TEST_CASE(NonZeroCountElementsCounts);
+    TEST_CASE(NanReturnValueTest);
+
+    TEST_CASE(FusedVsTwoPassBuildTest);
+    TEST_CASE(SimdKernelsVsScalarTest);
+    TEST_CASE(ParallelBuildVsSerialTest);
+
+    TEST_CASE(SearchWindowOnImageBorderTest);
+    TEST_CASE(BatchQueryVsSingleQueryTest);
+    TEST_CASE(InterleavedLayoutVsPlanarTest);
+    TEST_CASE(CompactVsPixelSumTest);
+    TEST_CASE(CompactMemoryFootprintTest);
+    TEST_CASE(CompactAllocationFailureTest);
+    TEST_CASE(WideAccumulatorTest);
+    TEST_CASE(PaddedVsPackedTablesTest);
+    TEST_CASE(UpdateRegionVsRebuildTest);
+    TEST_CASE(StreamSnapshotTest);
+    TEST_CASE(ScanlineVsPixelSumTest);
+    TEST_CASE(ScanlineEndlessStreamTest);
+    TEST_CASE(LazyBuildTest);
+    TEST_CASE(LazyBuildConcurrentReadersTest);
+    TEST_CASE(MoveSemanticsTest);
+    TEST_CASE(CopyOnWriteTablesTest);
+    TEST_CASE(VarianceVsNaiveTest);
+    TEST_CASE(MultiChannelVsPixelSumTest);
+    TEST_CASE(RotatedVsNaiveTest);
+    TEST_CASE(BoxFilterVsAverageTest);
+    TEST_CASE(CascadeVsQueryTest);
+    TEST_CASE(HistogramVsNaiveTest);
+    TEST_CASE(ThresholdCountsVsNaiveTest);
+    TEST_CASE(FileMapVsBuildTest);
+    TEST_CASE(ImageFileVsImageTest);
+    TEST_CASE(VirtualMemoryBackendTest);
+    TEST_CASE(VirtualMemoryPoolConcurrencyTest);
+    TEST_CASE(VirtualMemoryPoolRoutingTest);
 
     TEST_CASE(SATPlusAllocationPerformanceTest);
+    TEST_CASE(SATBuildModePerformanceTest);
+    TEST_CASE(SATSimdLevelPerformanceTest);
+    TEST_CASE(SATThreadScalingPerformanceTest);
+    TEST_CASE(BatchQueryPerformanceTest);
+    TEST_CASE(RegionStatsPerformanceTest);
+    TEST_CASE(AccumulatorWidthPerformanceTest);
+    TEST_CASE(QueryLatencyPerformanceTest);
+    TEST_CASE(UpdateRegionPerformanceTest);
+    TEST_CASE(StreamPerformanceTest);
+    TEST_CASE(ScanlinePushRowPerformanceTest);
+    TEST_CASE(LazyBuildPerformanceTest);
+    TEST_CASE(CopyVsSharePerformanceTest);
+    TEST_CASE(VariancePerformanceTest);
+    TEST_CASE(MultiChannelPerformanceTest);
+    TEST_CASE(RotatedSumPerformanceTest);
+    TEST_CASE(BoxFilterPerformanceTest);
+    TEST_CASE(CascadePerformanceTest);
+    TEST_CASE(HistogramPerformanceTest);
+    TEST_CASE(ThresholdCountsPerformanceTest);
+    TEST_CASE(MappedLoadPerformanceTest);
+    TEST_CASE(ImageFileLoadPerformanceTest);
+    TEST_CASE(PageConfigPerformanceTest);
+    TEST_CASE(AllocatorThroughputPerformanceTest);
+    TEST_CASE(PoolRoutingPerformanceTest);
 }